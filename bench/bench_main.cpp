@@ -0,0 +1,520 @@
+// bench_main.cpp - Banco de pruebas en host de los algoritmos del firmware
+//
+//   pio run -e native && .pio/build/native/program [traza.csv] [--repeat N] [--csv salida.csv]
+//
+// Sin traza usa un juego de trazas sintéticas con verdad conocida. Para
+// cada algoritmo y variante informa de rendimiento (muestras/s), latencia
+// por muestra (media, p99, máximo) y precisión frente a la referencia.
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "trace.h"
+#include "ppg_pipeline.h"
+#include "step_engine.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedNs(Clock::time_point start, Clock::time_point end)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// Por debajo de estas frecuencias la banda de interés no cabe (Nyquist)
+static const float PPG_MIN_RATE_HZ = 10.0f;
+static const float STEP_MIN_RATE_HZ = 10.0f;
+
+// Descartar el arranque de los filtros y de las ventanas al medir precisión
+static const unsigned long WARMUP_MS = 5000;
+
+// ===========================
+// RESULTADOS
+// ===========================
+struct Metric
+{
+    const char *name;
+    const char *unit;
+    float measured;
+    float reference;
+    bool valid;
+};
+
+struct Result
+{
+    std::string trace;
+    const char *algorithm;
+    std::string variant;
+    size_t samples;
+    double samplesPerSecond;
+    double meanNs;
+    double p99Ns;
+    double maxNs;
+    std::vector<Metric> metrics;
+};
+
+static void latencySummary(std::vector<double> &ns, Result &result)
+{
+    if (ns.empty())
+        return;
+    std::sort(ns.begin(), ns.end());
+    double sum = 0;
+    for (size_t i = 0; i < ns.size(); i++)
+        sum += ns[i];
+    result.meanNs = sum / ns.size();
+    result.p99Ns = ns[(ns.size() * 99) / 100 < ns.size() ? (ns.size() * 99) / 100 : ns.size() - 1];
+    result.maxNs = ns.back();
+}
+
+// ===========================
+// VARIANTES PPG
+// ===========================
+class PpgVariant
+{
+public:
+    virtual ~PpgVariant() {}
+    virtual std::string name() const = 0;
+    virtual void reset() = 0;
+    // true si la muestra cierra un latido
+    virtual bool update(int32_t ir, int32_t red, unsigned long timestamp) = 0;
+    virtual float heartRate() const = 0;
+    virtual float spo2() const = 0;
+};
+
+// La del firmware, en coma fija. Con acelerómetro se le pasan nivel de
+// movimiento y cadencia como en el firmware: lotes de las muestras hasta
+// cada muestra PPG, ~4 por lote a 25 Hz
+class FixedPpgVariant : public PpgVariant
+{
+public:
+    FixedPpgVariant(const PpgPipelineConfig &config, const AccelTrace *accel = NULL, const char *label = NULL)
+        : config(config), pipeline(config), accel(accel), label(label),
+          motion(accelRate(accel)), steps(accelRate(accel)), accelIndex(0) {}
+
+    std::string name() const
+    {
+        if (label)
+            return label;
+        return config.systolicPeaks ? "coma_fija" : "fija_max";
+    }
+
+    void reset()
+    {
+        pipeline.reset();
+        motion.reset();
+        steps.reset();
+        accelIndex = 0;
+    }
+
+    bool update(int32_t ir, int32_t red, unsigned long timestamp)
+    {
+        if (accel)
+        {
+            size_t start = accelIndex;
+            while (accelIndex < accel->timeMs.size() && accel->timeMs[accelIndex] <= timestamp)
+                accelIndex++;
+            motion.process(&accel->magnitudeMg[0] + start, accelIndex - start);
+            steps.process(&accel->magnitudeMg[0] + start, &accel->timeMs[0] + start, accelIndex - start);
+            pipeline.setMotion(motion.getLevelMg(), steps.getCadence());
+        }
+        return pipeline.update(ir, red, timestamp);
+    }
+
+    float heartRate() const { return pipeline.getBeatStats().getHeartRate(); }
+    float spo2() const { return pipeline.getSpo2X10() / 10.0f; }
+
+private:
+    PpgPipelineConfig config;
+    PpgPipeline pipeline;
+    const AccelTrace *accel;
+    const char *label;
+    MotionEstimator motion;
+    StepEngine steps;
+    size_t accelIndex;
+
+    static float accelRate(const AccelTrace *accel)
+    {
+        return accel && accel->sampleRateHz > 0 ? accel->sampleRateHz : 100.0f;
+    }
+};
+
+// Las mismas ecuaciones en float (referencias de dsp_fixed.h); el detector
+// de picos y la estadística de latidos son los mismos para aislar el error
+// de la aritmética
+class FloatPpgVariant : public PpgVariant
+{
+public:
+    explicit FloatPpgVariant(const PpgPipelineConfig &config)
+        : config(config), coefficients(designBandPass(config.sampleRateHz, config.bandLowHz, config.bandHighHz)),
+          irDc(config.dcShift), redDc(config.dcShift), irBandPass(coefficients), redBandPass(coefficients),
+          beatDetector(config.refractoryMs, config.maxIntervalMs, config.envelopeDecay),
+          beatStats(config.hrWindow, config.hrvWindow, config.medianSize)
+    {
+        reset();
+    }
+
+    std::string name() const { return "flotante"; }
+
+    void reset()
+    {
+        irDc = DcRemoverRef(config.dcShift);
+        redDc = DcRemoverRef(config.dcShift);
+        irBandPass = BiquadFilterRef(coefficients);
+        redBandPass = BiquadFilterRef(coefficients);
+        beatDetector.reset();
+        beatStats.reset();
+        sampleCount = 0;
+        irMeanSquare = redMeanSquare = irDcMean = redDcMean = 0;
+        spo2Value = 0;
+    }
+
+    bool update(int32_t ir, int32_t red, unsigned long timestamp)
+    {
+        float irAc = irBandPass.update(irDc.update((float)ir));
+        float redAc = redBandPass.update(redDc.update((float)red));
+
+        float alpha = 1.0f / (float)(1L << config.spo2WindowShift);
+        if (sampleCount == 0)
+        {
+            irMeanSquare = irAc * irAc;
+            redMeanSquare = redAc * redAc;
+            irDcMean = irDc.getDc();
+            redDcMean = redDc.getDc();
+        }
+        irMeanSquare += (irAc * irAc - irMeanSquare) * alpha;
+        redMeanSquare += (redAc * redAc - redMeanSquare) * alpha;
+        irDcMean += (irDc.getDc() - irDcMean) * alpha;
+        redDcMean += (redDc.getDc() - redDcMean) * alpha;
+        sampleCount++;
+
+        uint32_t interval;
+        int32_t beatSignal = (int32_t)lrintf(config.systolicPeaks ? -irAc : irAc);
+        if (!beatDetector.update(beatSignal, timestamp, interval) || interval == 0)
+            return false;
+        beatStats.add((uint16_t)interval);
+        spo2Value = estimateSpo2();
+        return true;
+    }
+
+    float heartRate() const { return beatStats.getHeartRate(); }
+    float spo2() const { return spo2Value; }
+
+private:
+    PpgPipelineConfig config;
+    BiquadCoefficients coefficients;
+    DcRemoverRef irDc;
+    DcRemoverRef redDc;
+    BiquadFilterRef irBandPass;
+    BiquadFilterRef redBandPass;
+    PeakDetector beatDetector;
+    BeatStats beatStats;
+
+    uint32_t sampleCount;
+    float irMeanSquare, redMeanSquare, irDcMean, redDcMean;
+    float spo2Value;
+
+    float estimateSpo2() const
+    {
+        if (sampleCount < config.spo2MinSamples)
+            return 0;
+        float irRms = sqrtf(irMeanSquare);
+        float redRms = sqrtf(redMeanSquare);
+        if (irDcMean <= 0 || irRms / irDcMean * 10000.0f < config.spo2MinPerfusion)
+            return 0;
+        float ratio = dspRatioOfRatiosRef(redRms, redDcMean, irRms, irDcMean);
+        float value = 110.0f - 25.0f * ratio;
+        if (ratio <= 0 || value < 70.0f)
+            return 0;
+        return value > 100.0f ? 100.0f : value;
+    }
+};
+
+// Media del ritmo y de la SpO2 publicados en cada latido tras el arranque
+static void runPpgOnce(PpgVariant &variant, const PpgTrace &ppg, float &heartRate, float &spo2)
+{
+    variant.reset();
+    double hrSum = 0, spo2Sum = 0;
+    size_t hrCount = 0, spo2Count = 0;
+    for (size_t i = 0; i < ppg.ir.size(); i++)
+    {
+        if (!variant.update(ppg.ir[i], ppg.red[i], ppg.timeMs[i]) || ppg.timeMs[i] < WARMUP_MS)
+            continue;
+        if (variant.heartRate() > 0)
+        {
+            hrSum += variant.heartRate();
+            hrCount++;
+        }
+        if (variant.spo2() > 0)
+        {
+            spo2Sum += variant.spo2();
+            spo2Count++;
+        }
+    }
+    heartRate = hrCount ? hrSum / hrCount : 0;
+    spo2 = spo2Count ? spo2Sum / spo2Count : 0;
+}
+
+static Result benchmarkPpg(PpgVariant &variant, const Trace &trace, int repeat)
+{
+    const PpgTrace &ppg = trace.ppg;
+    Result result;
+    result.trace = trace.name;
+    result.algorithm = "ppg";
+    result.variant = variant.name();
+    result.samples = ppg.ir.size();
+    result.meanNs = result.p99Ns = result.maxNs = 0;
+
+    // Precisión (y calentar cachés)
+    float heartRate, spo2;
+    runPpgOnce(variant, ppg, heartRate, spo2);
+
+    // Rendimiento: la traza entera repeat veces, sin cronometrar cada muestra
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeat; r++)
+    {
+        float unusedHr, unusedSpo2;
+        runPpgOnce(variant, ppg, unusedHr, unusedSpo2);
+    }
+    double totalNs = elapsedNs(start, Clock::now());
+    result.samplesPerSecond = totalNs > 0 ? (double)result.samples * repeat * 1e9 / totalNs : 0;
+
+    // Latencia: cada llamada por separado (incluye ~20 ns del propio reloj)
+    std::vector<double> latencies;
+    latencies.reserve(ppg.ir.size());
+    variant.reset();
+    for (size_t i = 0; i < ppg.ir.size(); i++)
+    {
+        Clock::time_point before = Clock::now();
+        variant.update(ppg.ir[i], ppg.red[i], ppg.timeMs[i]);
+        latencies.push_back(elapsedNs(before, Clock::now()));
+    }
+    latencySummary(latencies, result);
+
+    bool usable = trace.reference.valid && ppg.sampleRateHz >= PPG_MIN_RATE_HZ;
+    Metric hr = {"ritmo", "bpm", heartRate, trace.reference.heartRate, usable && trace.reference.heartRate > 0};
+    Metric oxygen = {"spo2", "%", spo2, trace.reference.spo2, usable && trace.reference.spo2 > 0};
+    result.metrics.push_back(hr);
+    result.metrics.push_back(oxygen);
+    return result;
+}
+
+// ===========================
+// VARIANTES DE PASOS
+// ===========================
+// El motor recibe lotes: batch = 1 es el modo INT (una muestra por lectura),
+// batch > 1 el vaciado del FIFO
+static uint32_t runStepsOnce(StepEngine &engine, const AccelTrace &accel, size_t batch)
+{
+    engine.reset();
+    for (size_t i = 0; i < accel.magnitudeMg.size(); i += batch)
+    {
+        size_t count = accel.magnitudeMg.size() - i < batch ? accel.magnitudeMg.size() - i : batch;
+        engine.process(&accel.magnitudeMg[i], &accel.timeMs[i], count);
+    }
+    return engine.getStepCount();
+}
+
+static Result benchmarkSteps(const Trace &trace, size_t batch, int repeat)
+{
+    const AccelTrace &accel = trace.accel;
+    StepEngine engine(accel.sampleRateHz > 0 ? accel.sampleRateHz : 100.0f);
+
+    Result result;
+    result.trace = trace.name;
+    result.algorithm = "pasos";
+    char name[32];
+    snprintf(name, sizeof(name), "lote_%u", (unsigned)batch);
+    result.variant = name;
+    result.samples = accel.magnitudeMg.size();
+    result.meanNs = result.p99Ns = result.maxNs = 0;
+
+    uint32_t steps = runStepsOnce(engine, accel, batch);
+
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeat; r++)
+        runStepsOnce(engine, accel, batch);
+    double totalNs = elapsedNs(start, Clock::now());
+    result.samplesPerSecond = totalNs > 0 ? (double)result.samples * repeat * 1e9 / totalNs : 0;
+
+    // Latencia por muestra: cada lote cronometrado y repartido entre sus muestras
+    std::vector<double> latencies;
+    engine.reset();
+    for (size_t i = 0; i < accel.magnitudeMg.size(); i += batch)
+    {
+        size_t count = accel.magnitudeMg.size() - i < batch ? accel.magnitudeMg.size() - i : batch;
+        Clock::time_point before = Clock::now();
+        engine.process(&accel.magnitudeMg[i], &accel.timeMs[i], count);
+        latencies.push_back(elapsedNs(before, Clock::now()) / count);
+    }
+    latencySummary(latencies, result);
+
+    bool usable = trace.reference.valid && accel.sampleRateHz >= STEP_MIN_RATE_HZ;
+    Metric count = {"pasos", "", (float)steps, (float)trace.reference.steps, usable};
+    result.metrics.push_back(count);
+    return result;
+}
+
+// ===========================
+// INFORME
+// ===========================
+static void printResults(const std::vector<Result> &results)
+{
+    printf("\n%-22s %-6s %-10s %8s %12s %9s %9s %9s  %s\n", "traza", "algo", "variante", "muestras",
+           "muestras/s", "media_ns", "p99_ns", "max_ns", "precisión");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        std::string accuracy;
+        for (size_t m = 0; m < r.metrics.size(); m++)
+        {
+            const Metric &metric = r.metrics[m];
+            char text[80];
+            if (metric.valid)
+                snprintf(text, sizeof(text), "%s %.1f%s (ref %.1f, err %+.1f) ", metric.name, metric.measured,
+                         metric.unit, metric.reference, metric.measured - metric.reference);
+            else
+                snprintf(text, sizeof(text), "%s %.1f%s (sin ref. válida) ", metric.name, metric.measured, metric.unit);
+            accuracy += text;
+        }
+        printf("%-22.22s %-6s %-10s %8zu %12.0f %9.0f %9.0f %9.0f  %s\n", r.trace.c_str(), r.algorithm,
+               r.variant.c_str(), r.samples, r.samplesPerSecond, r.meanNs, r.p99Ns, r.maxNs, accuracy.c_str());
+    }
+}
+
+// Una fila por métrica, para comparar ejecuciones entre versiones
+static bool writeCsv(const char *path, const std::vector<Result> &results)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+    fprintf(file, "traza,algoritmo,variante,muestras,muestras_s,media_ns,p99_ns,max_ns,metrica,medido,referencia\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        for (size_t m = 0; m < r.metrics.size(); m++)
+        {
+            const Metric &metric = r.metrics[m];
+            fprintf(file, "%s,%s,%s,%zu,%.0f,%.1f,%.1f,%.1f,%s,%.2f,", r.trace.c_str(), r.algorithm,
+                    r.variant.c_str(), r.samples, r.samplesPerSecond, r.meanNs, r.p99Ns, r.maxNs, metric.name,
+                    metric.measured);
+            if (metric.valid)
+                fprintf(file, "%.2f", metric.reference);
+            fprintf(file, "\n");
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static void benchmarkTrace(const Trace &trace, int repeat, std::vector<Result> &results)
+{
+    if (!trace.ppg.ir.empty())
+    {
+        if (trace.ppg.sampleRateHz < PPG_MIN_RATE_HZ)
+            printf("⚠️ %s: PPG a %.1f Hz, insuficiente para latidos (solo rendimiento)\n", trace.name.c_str(),
+                   trace.ppg.sampleRateHz);
+        PpgPipelineConfig config(trace.ppg.sampleRateHz > 0 ? trace.ppg.sampleRateHz : 25.0f);
+        const AccelTrace *accel = trace.accel.magnitudeMg.empty() ? NULL : &trace.accel;
+        FixedPpgVariant fixed(config, accel);
+        FloatPpgVariant floating(config);
+        results.push_back(benchmarkPpg(fixed, trace, repeat));
+        results.push_back(benchmarkPpg(floating, trace, repeat));
+
+        // Sin nivel de movimiento todos los latidos pasan: lo que aporta la compuerta
+        if (accel)
+        {
+            FixedPpgVariant ungated(config, NULL, "sin_acel");
+            results.push_back(benchmarkPpg(ungated, trace, repeat));
+        }
+
+        // Picos del IR sin invertir (muesca dícrota incluida), para comparar
+        PpgPipelineConfig maxima = config;
+        maxima.systolicPeaks = false;
+        FixedPpgVariant fixedMaxima(maxima);
+        results.push_back(benchmarkPpg(fixedMaxima, trace, repeat));
+    }
+
+    if (!trace.accel.magnitudeMg.empty())
+    {
+        if (trace.accel.sampleRateHz < STEP_MIN_RATE_HZ)
+            printf("⚠️ %s: acelerómetro a %.1f Hz, insuficiente para pasos (solo rendimiento)\n",
+                   trace.name.c_str(), trace.accel.sampleRateHz);
+        results.push_back(benchmarkSteps(trace, 1, repeat));
+        results.push_back(benchmarkSteps(trace, 10, repeat));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *tracePath = NULL;
+    const char *csvPath = NULL;
+    int repeat = 50;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+            csvPath = argv[++i];
+        else if (argv[i][0] != '-')
+            tracePath = argv[i];
+        else
+        {
+            fprintf(stderr, "uso: %s [traza.csv] [--repeat N] [--csv salida.csv]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (repeat < 1)
+        repeat = 1;
+
+    std::vector<Trace> traces;
+    if (tracePath)
+    {
+        Trace trace;
+        std::string error;
+        if (!loadTraceCsv(tracePath, trace, error))
+        {
+            fprintf(stderr, "❌ %s\n", error.c_str());
+            return 1;
+        }
+        printf("📂 %s: %zu muestras PPG (%.1f Hz), %zu de acelerómetro (%.1f Hz)\n", tracePath,
+               trace.ppg.ir.size(), trace.ppg.sampleRateHz, trace.accel.magnitudeMg.size(),
+               trace.accel.sampleRateHz);
+        traces.push_back(trace);
+    }
+    else
+    {
+        // Verdad conocida: reposo, esfuerzo con ruido, paseo + vehículo, paseo lento en modo INT,
+        // pulso andando con artefactos de movimiento
+        traces.resize(5);
+        traces[0].name = "ppg_72bpm_97";
+        makeSyntheticPpg(traces[0], 120, 25, 72, 97, 40, 1);
+        traces[1].name = "ppg_110bpm_92_ruido";
+        makeSyntheticPpg(traces[1], 120, 25, 110, 92, 150, 2);
+        traces[2].name = "paseo_108spm_vehiculo";
+        makeSyntheticWalk(traces[2], 60, 100, 108, 20, 3);
+        traces[3].name = "paseo_66spm_50hz";
+        makeSyntheticWalk(traces[3], 60, 50, 66, 0, 4);
+        traces[4].name = "ppg_paseo_95bpm_108spm";
+        makeSyntheticWalkingPpg(traces[4], 120, 25, 95, 97, 108, 20, 5);
+    }
+
+    std::vector<Result> results;
+    for (size_t i = 0; i < traces.size(); i++)
+        benchmarkTrace(traces[i], repeat, results);
+    printResults(results);
+
+    if (csvPath)
+    {
+        if (!writeCsv(csvPath, results))
+        {
+            fprintf(stderr, "❌ no se puede escribir %s\n", csvPath);
+            return 1;
+        }
+        printf("\n💾 Resultados en %s\n", csvPath);
+    }
+    return 0;
+}
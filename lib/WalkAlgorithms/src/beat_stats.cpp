@@ -0,0 +1,126 @@
+// beat_stats.cpp - Implementación de la estadística de latidos
+#include "beat_stats.h"
+#include "dsp_fixed.h"
+
+BeatStats::BeatStats(uint8_t hrWindow, uint8_t hrvWindow, uint8_t medianSize)
+    : hrWindow(hrWindow), hrvWindow(hrvWindow), medianSize(medianSize), rejectedCount(0)
+{
+    if (this->hrvWindow > MAX_WINDOW)
+        this->hrvWindow = MAX_WINDOW;
+    if (this->hrvWindow < 2)
+        this->hrvWindow = 2;
+    if (this->hrWindow > this->hrvWindow)
+        this->hrWindow = this->hrvWindow;
+    if (this->hrWindow == 0)
+        this->hrWindow = 1;
+    if (this->medianSize > MAX_MEDIAN)
+        this->medianSize = MAX_MEDIAN;
+    reset();
+}
+
+bool BeatStats::add(uint16_t rrMs)
+{
+    if (isOutlier(rrMs))
+    {
+        rejectedCount++;
+        if (++rejectStreak < REJECT_RESTART)
+            return false;
+
+        // El ritmo ha cambiado de verdad: empezar de nuevo desde este RR
+        reset();
+    }
+    rejectStreak = 0;
+
+    size_t count = intervals.size();
+
+    // Sale de la ventana del ritmo medio
+    if (count >= hrWindow)
+        hrSum -= intervals.at(count - hrWindow);
+
+    // Sale de la ventana de HRV, con su diferencia con el siguiente
+    if (count >= hrvWindow)
+    {
+        uint16_t oldest = 0;
+        intervals.pop(oldest);
+        int32_t diff = (int32_t)intervals.at(0) - oldest;
+        sum -= oldest;
+        sumSquares -= (uint32_t)oldest * oldest;
+        diffSquares -= (uint32_t)(diff * diff);
+        count--;
+    }
+
+    if (count > 0)
+    {
+        int32_t diff = (int32_t)rrMs - intervals.at(count - 1);
+        diffSquares += (uint32_t)(diff * diff);
+    }
+
+    intervals.push(rrMs);
+    hrSum += rrMs;
+    sum += rrMs;
+    sumSquares += (uint32_t)rrMs * rrMs;
+    lastInterval = rrMs;
+
+    updateMetrics();
+    return true;
+}
+
+void BeatStats::reset()
+{
+    intervals.clear();
+    hrSum = 0;
+    sum = 0;
+    sumSquares = 0;
+    diffSquares = 0;
+    heartRate = 0;
+    lastInterval = 0;
+    rmssd = 0;
+    sdnn = 0;
+    rejectStreak = 0;
+}
+
+bool BeatStats::isOutlier(uint16_t rrMs) const
+{
+    size_t count = intervals.size();
+    if (medianSize == 0 || count < medianSize)
+        return false;
+
+    // Mediana de los últimos medianSize por inserción (tamaño acotado)
+    uint16_t sorted[MAX_MEDIAN];
+    for (uint8_t i = 0; i < medianSize; i++)
+    {
+        uint16_t value = intervals.at(count - medianSize + i);
+        int j = i;
+        while (j > 0 && sorted[j - 1] > value)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    uint16_t median = sorted[medianSize / 2];
+
+    uint16_t deviation = rrMs > median ? rrMs - median : median - rrMs;
+    return deviation > median / 4;
+}
+
+void BeatStats::updateMetrics()
+{
+    size_t count = intervals.size();
+    size_t hrCount = count < hrWindow ? count : hrWindow;
+
+    heartRate = hrSum > 0 ? (int)((60000UL * hrCount + hrSum / 2) / hrSum) : 0;
+
+    if (count < 2)
+    {
+        rmssd = 0;
+        sdnn = 0;
+        return;
+    }
+
+    // Varianza muestral sin coma flotante: (n·ΣRR² - (ΣRR)²) / (n·(n-1))
+    uint64_t n = count;
+    uint64_t spread = n * sumSquares - (uint64_t)sum * sum;
+    sdnn = (uint16_t)dspSqrt64(spread / (n * (n - 1)));
+    rmssd = (uint16_t)dspSqrt64(diffSquares / (n - 1));
+}
@@ -0,0 +1,57 @@
+// beat_stats.h - Estadística incremental de latidos: ritmo medio y HRV
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ring_buffer.h"
+
+// ===========================
+// ESTADÍSTICA DE INTERVALOS RR
+// ===========================
+// Cada intervalo RR aceptado actualiza sumas deslizantes (RR, RR² y
+// diferencias sucesivas al cuadrado) sumando el que entra y restando el que
+// sale, así el ritmo medio, el SDNN y el RMSSD cuestan lo mismo con 5 que
+// con 64 latidos de ventana. Opcionalmente se rechazan los RR que se
+// desvían más de un 25 % de la mediana de los últimos medianSize.
+class BeatStats
+{
+public:
+    static const size_t MAX_WINDOW = 64;
+    static const uint8_t MAX_MEDIAN = 9;
+
+    // hrWindow <= hrvWindow <= MAX_WINDOW; medianSize = 0 desactiva el filtro
+    BeatStats(uint8_t hrWindow, uint8_t hrvWindow, uint8_t medianSize);
+
+    // Devuelve false si el intervalo se ha descartado como artefacto
+    bool add(uint16_t rrMs);
+    void reset();
+
+    int getHeartRate() const { return heartRate; }     // bpm, media de hrWindow
+    uint16_t getLastInterval() const { return lastInterval; }
+    uint16_t getRmssd() const { return rmssd; }          // ms, sobre hrvWindow
+    uint16_t getSdnn() const { return sdnn; }            // ms, sobre hrvWindow
+    uint32_t getRejectedCount() const { return rejectedCount; }
+
+private:
+    // Tras tantos rechazos seguidos se asume un cambio real de ritmo
+    static const uint8_t REJECT_RESTART = 3;
+
+    uint8_t hrWindow;
+    uint8_t hrvWindow;
+    uint8_t medianSize;
+
+    RingBuffer<uint16_t, MAX_WINDOW> intervals;
+    uint32_t hrSum;
+    uint32_t sum;
+    uint64_t sumSquares;
+    uint64_t diffSquares;
+
+    int heartRate;
+    uint16_t lastInterval;
+    uint16_t rmssd;
+    uint16_t sdnn;
+    uint8_t rejectStreak;
+    uint32_t rejectedCount;
+
+    bool isOutlier(uint16_t rrMs) const;
+    void updateMetrics();
+};
@@ -0,0 +1,133 @@
+// dsp_fixed.cpp - Implementación del procesado de señal en coma fija
+#include "dsp_fixed.h"
+#include <math.h>
+
+BiquadCoefficients designBandPass(float sampleRateHz, float lowHz, float highHz)
+{
+    float centerHz = sqrtf(lowHz * highHz);
+    float bandwidthOctaves = log2f(highHz / lowHz);
+    float w0 = 2.0f * (float)M_PI * centerHz / sampleRateHz;
+    float sinW0 = sinf(w0);
+    float alpha = sinW0 * sinhf(0.5f * logf(2.0f) * bandwidthOctaves * w0 / sinW0);
+    float a0 = 1.0f + alpha;
+
+    BiquadCoefficients c;
+    c.b0 = alpha / a0;
+    c.b1 = 0;
+    c.b2 = -alpha / a0;
+    c.a1 = -2.0f * cosf(w0) / a0;
+    c.a2 = (1.0f - alpha) / a0;
+    return c;
+}
+
+BiquadFilter::BiquadFilter(const BiquadCoefficients &c)
+    : b0(dspToFixed(c.b0, DSP_COEF_FRAC_BITS)), b1(dspToFixed(c.b1, DSP_COEF_FRAC_BITS)),
+      b2(dspToFixed(c.b2, DSP_COEF_FRAC_BITS)), a1(dspToFixed(c.a1, DSP_COEF_FRAC_BITS)),
+      a2(dspToFixed(c.a2, DSP_COEF_FRAC_BITS)), x1(0), x2(0), y1(0), y2(0)
+{
+}
+
+PeakDetector::PeakDetector(uint16_t refractoryMs, uint16_t maxIntervalMs, uint8_t decayShift)
+    : refractoryMs(refractoryMs), maxIntervalMs(maxIntervalMs), decayShift(decayShift),
+      previous(0), rising(false), envelope(0), lastPeak(0), lastPeakTime(0), havePeak(false)
+{
+}
+
+bool PeakDetector::update(int32_t value, unsigned long timestamp, uint32_t &intervalMs)
+{
+    bool beat = false;
+
+    envelope -= envelope >> decayShift;
+    if (value > envelope)
+        envelope = value;
+
+    // La muestra anterior fue un máximo local
+    if (rising && value < previous && previous > 0 && previous > (envelope >> 1))
+    {
+        unsigned long elapsed = timestamp - lastPeakTime;
+        if (!havePeak || elapsed >= refractoryMs)
+        {
+            intervalMs = (havePeak && elapsed <= maxIntervalMs) ? elapsed : 0;
+            lastPeak = previous;
+            lastPeakTime = timestamp;
+            havePeak = true;
+            beat = true;
+        }
+    }
+
+    // En una meseta se conserva la pendiente anterior
+    if (value != previous)
+        rising = value > previous;
+    previous = value;
+
+    return beat;
+}
+
+void PeakDetector::reset()
+{
+    previous = 0;
+    rising = false;
+    envelope = 0;
+    lastPeak = 0;
+    havePeak = false;
+}
+
+uint32_t dspRatioQ16(int32_t num, int32_t den)
+{
+    if (num <= 0 || den <= 0)
+        return 0;
+    uint64_t ratio = ((uint64_t)num << DSP_RATIO_FRAC_BITS) / (uint32_t)den;
+    return ratio > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)ratio;
+}
+
+uint32_t dspRatioOfRatiosQ16(uint32_t acRed, uint32_t dcRed, uint32_t acIr, uint32_t dcIr)
+{
+    uint64_t den = (uint64_t)acIr * dcRed;
+    if (den == 0)
+        return 0;
+
+    // acRed·dcIr cabe en 64 bits; para el desplazamiento Q16 se reduce antes
+    // el numerador o el denominador según haga falta
+    uint64_t num = (uint64_t)acRed * dcIr;
+    int shift = DSP_RATIO_FRAC_BITS;
+    while (shift > 0 && (num >> (63 - shift)) != 0)
+    {
+        den >>= 1;
+        shift--;
+    }
+    if (den == 0)
+        return 0xFFFFFFFFUL;
+
+    uint64_t ratio = (num << shift) / den;
+    return ratio > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)ratio;
+}
+
+int32_t dspSpo2FromRatioX10(uint32_t ratioQ16, int32_t offsetX10, int32_t slopeX10)
+{
+    int64_t drop = ((int64_t)slopeX10 * ratioQ16 + (1LL << (DSP_RATIO_FRAC_BITS - 1))) >> DSP_RATIO_FRAC_BITS;
+    return (int32_t)(offsetX10 - drop);
+}
+
+uint32_t dspSqrt64(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
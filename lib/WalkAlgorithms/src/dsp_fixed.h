@@ -0,0 +1,196 @@
+// dsp_fixed.h - Procesado de señal PPG en coma fija
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ===========================
+// FORMATOS
+// ===========================
+// Qn = entero con n bits fraccionarios. El camino por muestra es solo enteros
+// (sumas, desplazamientos y productos 32x32->64, que el Xtensa hace en dos
+// instrucciones); la coma flotante queda para diseñar coeficientes en
+// setup(). Cada bloque tiene al final su referencia en float con la misma
+// estructura para comparar salida a salida.
+const int DSP_DC_FRAC_BITS = 8;      // Media DC en Q8 (muestras de hasta 2^22)
+const int DSP_COEF_FRAC_BITS = 28;   // Coeficientes del biquad en Q28 (|c| < 8)
+const int DSP_RATIO_FRAC_BITS = 16;  // Cocientes en Q16
+
+// Convierte un real a Qn redondeando al más cercano (solo en inicialización)
+inline int32_t dspToFixed(float value, int fracBits)
+{
+    float scaled = value * (float)(1L << fracBits);
+    return (int32_t)(scaled >= 0 ? scaled + 0.5f : scaled - 0.5f);
+}
+
+// ===========================
+// ELIMINACIÓN DE LA COMPONENTE DC
+// ===========================
+// Media exponencial dc += (x - dc) / 2^shift, con corte aproximado en
+// fs / (2π·2^shift). Devuelve la componente AC (x - dc) y deja la DC a mano
+// para el cociente rojo/IR.
+class DcRemover
+{
+public:
+    explicit DcRemover(uint8_t shift) : shift(shift), dcQ8(0), primed(false) {}
+
+    int32_t update(int32_t sample)
+    {
+        int32_t sampleQ8 = sample << DSP_DC_FRAC_BITS;
+        if (!primed)
+        {
+            // Arrancar en la primera muestra evita el transitorio desde 0
+            dcQ8 = sampleQ8;
+            primed = true;
+        }
+        dcQ8 += (sampleQ8 - dcQ8) >> shift;
+        return sample - getDc();
+    }
+
+    int32_t getDc() const { return (dcQ8 + (1 << (DSP_DC_FRAC_BITS - 1))) >> DSP_DC_FRAC_BITS; }
+    void reset() { primed = false; }
+
+private:
+    uint8_t shift;
+    int32_t dcQ8;
+    bool primed;
+};
+
+// ===========================
+// BIQUAD PASO BANDA
+// ===========================
+struct BiquadCoefficients
+{
+    float b0, b1, b2, a1, a2; // a0 normalizado a 1
+};
+
+// Paso banda RBJ (ganancia 1 en el centro geométrico de la banda)
+BiquadCoefficients designBandPass(float sampleRateHz, float lowHz, float highHz);
+
+// Forma directa I: sin realimentación del estado intermedio, así que el único
+// redondeo es el de la salida. Acumulador de 64 bits para no saturar.
+class BiquadFilter
+{
+public:
+    explicit BiquadFilter(const BiquadCoefficients &c);
+
+    int32_t update(int32_t x)
+    {
+        int64_t acc = (int64_t)b0 * x + (int64_t)b1 * x1 + (int64_t)b2 * x2 -
+                      (int64_t)a1 * y1 - (int64_t)a2 * y2;
+        int32_t y = (int32_t)((acc + (1LL << (DSP_COEF_FRAC_BITS - 1))) >> DSP_COEF_FRAC_BITS);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        return y;
+    }
+
+    void reset() { x1 = x2 = y1 = y2 = 0; }
+
+private:
+    int32_t b0, b1, b2, a1, a2; // Q28
+    int32_t x1, x2, y1, y2;
+};
+
+// ===========================
+// DETECTOR DE PICOS
+// ===========================
+// Máximo local de la señal filtrada por encima de la mitad de una envolvente
+// que sigue a los picos y se relaja 1/2^decayShift por muestra. El periodo
+// refractario descarta la muesca dícrota y los rebotes.
+class PeakDetector
+{
+public:
+    PeakDetector(uint16_t refractoryMs, uint16_t maxIntervalMs, uint8_t decayShift);
+
+    // true si la muestra cierra un latido; intervalMs = 0 en el primero o
+    // tras una pausa mayor que maxIntervalMs
+    bool update(int32_t value, unsigned long timestamp, uint32_t &intervalMs);
+    void reset();
+
+    int32_t getEnvelope() const { return envelope; }
+    int32_t getLastPeak() const { return lastPeak; } // valor del último latido
+
+private:
+    uint16_t refractoryMs;
+    uint16_t maxIntervalMs;
+    uint8_t decayShift;
+
+    int32_t previous;
+    bool rising;
+    int32_t envelope;
+    int32_t lastPeak;
+    unsigned long lastPeakTime;
+    bool havePeak;
+};
+
+// ===========================
+// COCIENTES ROJO / IR
+// ===========================
+// num / den en Q16 (0 si den <= 0); una división de 64 bits por llamada
+uint32_t dspRatioQ16(int32_t num, int32_t den);
+
+// (acRed / dcRed) / (acIr / dcIr) en Q16 = acRed·dcIr / (acIr·dcRed)
+uint32_t dspRatioOfRatiosQ16(uint32_t acRed, uint32_t dcRed, uint32_t acIr, uint32_t dcIr);
+
+// SpO2 * 10 por la recta offset - slope·R, con offset y slope también * 10
+int32_t dspSpo2FromRatioX10(uint32_t ratioQ16, int32_t offsetX10, int32_t slopeX10);
+
+// Raíz cuadrada entera (por defecto); bit a bit, como mucho 32 iteraciones
+uint32_t dspSqrt64(uint64_t value);
+
+// ===========================
+// REFERENCIAS EN COMA FLOTANTE
+// ===========================
+// Mismas ecuaciones en float para validar el camino entero con trazas
+// grabadas. No se usan en el firmware.
+class DcRemoverRef
+{
+public:
+    explicit DcRemoverRef(uint8_t shift) : alpha(1.0f / (float)(1L << shift)), dc(0), primed(false) {}
+
+    float update(float sample)
+    {
+        if (!primed)
+        {
+            dc = sample;
+            primed = true;
+        }
+        dc += (sample - dc) * alpha;
+        return sample - dc;
+    }
+
+    float getDc() const { return dc; }
+
+private:
+    float alpha;
+    float dc;
+    bool primed;
+};
+
+class BiquadFilterRef
+{
+public:
+    explicit BiquadFilterRef(const BiquadCoefficients &c) : c(c), x1(0), x2(0), y1(0), y2(0) {}
+
+    float update(float x)
+    {
+        float y = c.b0 * x + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        return y;
+    }
+
+private:
+    BiquadCoefficients c;
+    float x1, x2, y1, y2;
+};
+
+inline float dspRatioOfRatiosRef(float acRed, float dcRed, float acIr, float dcIr)
+{
+    if (dcRed <= 0 || acIr <= 0 || dcIr <= 0)
+        return 0;
+    return (acRed / dcRed) / (acIr / dcIr);
+}
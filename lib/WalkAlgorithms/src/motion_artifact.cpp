@@ -0,0 +1,86 @@
+// motion_artifact.cpp - Implementación del nivel de movimiento y del SQI
+#include "motion_artifact.h"
+
+MotionEstimator::MotionEstimator(float sampleRateHz, uint16_t windowMs)
+    : gravity(GRAVITY_SHIFT)
+{
+    float samples = sampleRateHz * windowMs / 1000.0f;
+    windowSamples = samples < 1 ? 1 : (uint16_t)(samples + 0.5f);
+    reset();
+}
+
+void MotionEstimator::process(const int32_t *magnitudeMg, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        int32_t ac = gravity.update(magnitudeMg[i]);
+        windowSumSquares += (uint64_t)((int64_t)ac * ac);
+        if (++windowCount < windowSamples)
+            continue;
+
+        // Una raíz por ventana
+        uint32_t rms = dspSqrt64(windowSumSquares / windowCount);
+        uint16_t window = rms > UINT16_MAX ? UINT16_MAX : (uint16_t)rms;
+        level = window > lastWindow ? window : lastWindow;
+        lastWindow = window;
+        windowCount = 0;
+        windowSumSquares = 0;
+    }
+}
+
+void MotionEstimator::reset()
+{
+    gravity.reset();
+    windowCount = 0;
+    windowSumSquares = 0;
+    lastWindow = 0;
+    level = 0;
+}
+
+// 100 dentro de [full, zero) y lineal hasta 0 en zero (escala arbitraria)
+static uint32_t fallOff(uint32_t value, uint32_t full, uint32_t zero)
+{
+    if (value <= full)
+        return 100;
+    if (value >= zero)
+        return 0;
+    return 100 * (zero - value) / (zero - full);
+}
+
+uint8_t dspBeatQuality(uint16_t motionMg, uint16_t quietMg, uint16_t heavyMg, int32_t peak,
+                       int32_t referencePeak, uint32_t intervalMs, uint32_t expectedMs,
+                       uint32_t stepPeriodMs)
+{
+    uint32_t stillness = heavyMg > quietMg ? fallOff(motionMg, quietMg, heavyMg) : (motionMg < heavyMg ? 100 : 0);
+
+    // Amplitud en Q8 frente a la referencia: 1/4 = 64, 1/2 = 128, 2 = 512, 4 = 1024
+    uint32_t amplitude = 100;
+    if (referencePeak > 0)
+    {
+        uint64_t ratio = peak > 0 ? ((uint64_t)peak << 8) / (uint32_t)referencePeak : 0;
+        if (ratio > 512)
+            amplitude = fallOff(ratio > 1024 ? 1024 : (uint32_t)ratio, 512, 1024);
+        else if (ratio < 128)
+            amplitude = ratio <= 64 ? 0 : 100 * ((uint32_t)ratio - 64) / 64;
+    }
+
+    uint32_t rhythm = 100;
+    if (expectedMs > 0)
+    {
+        uint32_t deviation = intervalMs > expectedMs ? intervalMs - expectedMs : expectedMs - intervalMs;
+        rhythm = fallOff(deviation * 100 / expectedMs, 10, 30);
+    }
+
+    // Con el pie en el suelo, un "latido" al ritmo de la pisada es la pisada
+    if (stepPeriodMs > 0 && motionMg > quietMg)
+    {
+        uint32_t distance = intervalMs > stepPeriodMs ? intervalMs - stepPeriodMs : stepPeriodMs - intervalMs;
+        uint32_t percent = distance * 100 / stepPeriodMs;
+        uint32_t locked = percent <= 5 ? 0 : (percent >= 15 ? 100 : 10 * (percent - 5));
+        if (locked < rhythm)
+            rhythm = locked;
+    }
+
+    uint32_t coherence = amplitude < rhythm ? amplitude : rhythm;
+    return (uint8_t)((stillness + coherence) / 2);
+}
@@ -0,0 +1,53 @@
+// motion_artifact.h - Nivel de movimiento del acelerómetro y calidad de cada latido
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "dsp_fixed.h"
+
+// ===========================
+// NIVEL DE MOVIMIENTO
+// ===========================
+// RMS de la magnitud de la aceleración sin la gravedad (media DC fuera), en
+// mg, por ventanas fijas. El nivel publicado es el máximo de las dos últimas
+// ventanas completas: sube en cuanto una ventana se mueve (la ventana corta
+// llega antes de que el artefacto pase a la SpO2) y tarda una más en bajar,
+// porque el artefacto del PPG dura algo más que el golpe. Recibe los
+// mismos lotes de magnitudes que el motor de pasos.
+class MotionEstimator
+{
+public:
+    explicit MotionEstimator(float sampleRateHz, uint16_t windowMs = 500);
+
+    void process(const int32_t *magnitudeMg, size_t count);
+    void reset();
+
+    uint16_t getLevelMg() const { return level; }
+
+private:
+    static const uint8_t GRAVITY_SHIFT = 6; // corte ~0,25 Hz a 100 Hz: la marcha queda dentro
+
+    DcRemover gravity;
+    uint16_t windowSamples;
+    uint16_t windowCount;
+    uint64_t windowSumSquares;
+    uint16_t lastWindow;
+    uint16_t level;
+};
+
+// ===========================
+// CALIDAD DE LATIDO (SQI)
+// ===========================
+// 0-100, media de dos partes:
+//   quietud    100 hasta quietMg de movimiento, 0 desde heavyMg
+//   coherencia la peor de amplitud (igual entre 1/2 y 2 veces la de los
+//              latidos aceptados, 0 a 1/4 o 4 veces), intervalo (igual
+//              hasta un 10 % del esperado, 0 desde 30 %)
+//              y, con movimiento, distancia al periodo de la pisada: un
+//              intervalo a menos de un 5 % de stepPeriodMs es la pisada, no
+//              el pulso (100 desde un 15 %)
+// En reposo un latido raro sigue llegando a 50; andando solo pasan los
+// coherentes, y con mucho movimiento casi ninguno. referencePeak = 0,
+// expectedMs = 0 o stepPeriodMs = 0 (sin historia, sin pasos) no restan.
+uint8_t dspBeatQuality(uint16_t motionMg, uint16_t quietMg, uint16_t heavyMg, int32_t peak,
+                       int32_t referencePeak, uint32_t intervalMs, uint32_t expectedMs,
+                       uint32_t stepPeriodMs);
@@ -0,0 +1,30 @@
+// power_policy.cpp - Implementación de la política de energía
+#include "power_policy.h"
+
+PowerPolicy::PowerPolicy(unsigned long noFingerDelay, unsigned long stillDelay)
+    : noFingerDelay(noFingerDelay), stillDelay(stillDelay), lastPresenceTime(0), lastMovingTime(0),
+      started(false)
+{
+}
+
+uint8_t PowerPolicy::update(bool presence, bool moving, unsigned long now)
+{
+    if (!started)
+    {
+        lastPresenceTime = now;
+        lastMovingTime = now;
+        started = true;
+    }
+
+    if (presence)
+        lastPresenceTime = now;
+    if (moving)
+        lastMovingTime = now;
+
+    uint8_t state = POWER_ACTIVE;
+    if (now - lastPresenceTime > noFingerDelay)
+        state |= POWER_PPG_LOW;
+    if (now - lastMovingTime > stillDelay)
+        state |= POWER_ACCEL_LOW;
+    return state;
+}
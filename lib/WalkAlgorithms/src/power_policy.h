@@ -0,0 +1,73 @@
+// power_policy.h - Estado de energía que toca según la presencia y el movimiento
+#pragma once
+#include <stdint.h>
+
+// Bits del estado de energía: cada sensor baja a su modo de bajo consumo
+// por separado; con los dos abajo se permite además el light sleep
+const uint8_t POWER_PPG_LOW = 0x01;   // MAX30105 en proximidad a baja frecuencia
+const uint8_t POWER_ACCEL_LOW = 0x02; // MPU6050 en modo ciclo (solo movimiento)
+
+enum PowerState
+{
+    POWER_ACTIVE = 0,                                // dedo y movimiento
+    POWER_NO_FINGER = POWER_PPG_LOW,                 // sin dedo
+    POWER_STILL = POWER_ACCEL_LOW,                   // quieto
+    POWER_IDLE = POWER_PPG_LOW | POWER_ACCEL_LOW,    // sin dedo y quieto
+    POWER_STATE_COUNT = 4,
+};
+
+// ===========================
+// MOVIMIENTO PARA LA ENERGÍA
+// ===========================
+// Cada muestra del acelerómetro lo decide: |a| fuera de 1 g ± thresholdMg.
+// En reposo el offset de cero g del MPU6050 (±50 mg por eje) ya lo supera,
+// así que lo que de verdad dice "quieto" es que dejen de llegar muestras:
+// en modo quieto el sensor solo da la interrupción de movimiento y stop()
+// baja el indicador hasta la próxima, en lugar de dejarlo congelado en lo
+// que dijo la última.
+class MotionPresence
+{
+public:
+    explicit MotionPresence(uint16_t thresholdMg = 20) : thresholdMg(thresholdMg), moving(false) {}
+
+    bool update(int32_t magnitudeMg)
+    {
+        int32_t deviation = magnitudeMg - GRAVITY_MG;
+        moving = (deviation < 0 ? -deviation : deviation) > thresholdMg;
+        return moving;
+    }
+
+    // Sin muestras (modo quieto o sensor caído)
+    void stop() { moving = false; }
+
+    bool isMoving() const { return moving; }
+
+private:
+    static const int32_t GRAVITY_MG = 999; // 9,8 m/s²
+
+    uint16_t thresholdMg;
+    bool moving;
+};
+
+// ===========================
+// POLÍTICA DE ENERGÍA
+// ===========================
+// Sin presencia (dedo o proximidad) durante noFingerDelay pide POWER_PPG_LOW;
+// sin movimiento durante stillDelay, POWER_ACCEL_LOW. Sin dependencias del
+// hardware: PowerManager la aplica y lleva las cuentas, las pruebas la
+// recorren con trazas.
+class PowerPolicy
+{
+public:
+    PowerPolicy(unsigned long noFingerDelay, unsigned long stillDelay);
+
+    // Estado pedido (bits POWER_*)
+    uint8_t update(bool presence, bool moving, unsigned long now);
+
+private:
+    unsigned long noFingerDelay;
+    unsigned long stillDelay;
+    unsigned long lastPresenceTime;
+    unsigned long lastMovingTime;
+    bool started;
+};
@@ -0,0 +1,140 @@
+// ppg_pipeline.cpp - Implementación de la cadena PPG
+#include "ppg_pipeline.h"
+
+PpgPipeline::PpgPipeline(const PpgPipelineConfig &config)
+    : irDc(config.dcShift), redDc(config.dcShift),
+      irBandPass(designBandPass(config.sampleRateHz, config.bandLowHz, config.bandHighHz)),
+      redBandPass(designBandPass(config.sampleRateHz, config.bandLowHz, config.bandHighHz)),
+      spo2Estimator(config.spo2WindowShift, config.spo2MinSamples, config.spo2MinPerfusion),
+      beatDetector(config.refractoryMs, config.maxIntervalMs, config.envelopeDecay),
+      beatStats(config.hrWindow, config.hrvWindow, config.medianSize),
+      systolicPeaks(config.systolicPeaks), spo2(config.spo2), motionQuietMg(config.motionQuietMg),
+      motionSpo2Mg(config.motionSpo2Mg), motionHeavyMg(config.motionHeavyMg),
+      motionSkipMg(config.motionSkipMg), minBeatQuality(config.minBeatQuality), gateRestart(config.gateRestart),
+      beatAccepted(false), spo2X10(0), spo2Pending(0), motionMg(0), stepPeriodMs(0), restIntervalMs(0), peakReference(0), signalQuality(0),
+      gatedStreak(0), gatedCount(0)
+{
+}
+
+bool PpgPipeline::update(int32_t ir, int32_t red, unsigned long timestamp, bool detectBeats)
+{
+    // Componentes AC de IR y rojo, filtradas en la banda del pulso. Los
+    // filtros siguen corriendo con movimiento para no arrancar en frío después
+    int32_t irFiltered = irBandPass.update(irDc.update(ir));
+    if (spo2)
+    {
+        int32_t redFiltered = redBandPass.update(redDc.update(red));
+
+        // Con movimiento el artefacto entra en IR y rojo por igual y el
+        // cociente se va a ~1: la ventana de SpO2 se queda con lo de antes
+        if (motionMg < motionSpo2Mg)
+            spo2Estimator.update(irFiltered, irDc.getDc(), redFiltered, redDc.getDc());
+        else
+            spo2Pending = 0;
+    }
+
+    // Latido: máximos locales del IR filtrado (invertido: picos sistólicos)
+    uint32_t beatInterval;
+    int32_t beatSignal = systolicPeaks ? -irFiltered : irFiltered;
+    bool beat = beatDetector.update(beatSignal, timestamp, beatInterval);
+
+    // Sacudidas: no hay pulso que buscar
+    if (motionMg >= motionSkipMg)
+    {
+        signalQuality = 0;
+        return false;
+    }
+    if (!beat || beatInterval == 0 || !detectBeats)
+        return false;
+
+    if (!passesGate(beatInterval))
+    {
+        beatAccepted = false;
+        return true;
+    }
+
+    // Ritmo medio y HRV por sumas deslizantes; los RR anómalos se descartan
+    // sin tocar la media
+    beatAccepted = beatStats.add((uint16_t)beatInterval);
+    if (!beatAccepted)
+        return true;
+
+    // Referencia de amplitud: media exponencial 1/4 de los latidos buenos
+    int32_t peak = beatDetector.getLastPeak();
+    peakReference = peakReference == 0 ? peak : peakReference + ((peak - peakReference) >> 2);
+
+    // SpO2 por cociente de cocientes, una vez por latido aceptado y quieto.
+    // El nivel de movimiento llega una ventana tarde y para entonces el
+    // principio del artefacto ya está en la ventana de SpO2: cada valor se
+    // publica en el latido siguiente si entre medias no ha habido movimiento,
+    // y andando se mantiene el último de reposo
+    if (spo2 && motionMg < motionSpo2Mg)
+    {
+        if (spo2Pending > 0)
+            spo2X10 = spo2Pending;
+        spo2Pending = spo2Estimator.estimate();
+    }
+    return true;
+}
+
+// Calidad del latido recién detectado frente al movimiento y a los
+// anteriores; false si no llega al mínimo
+bool PpgPipeline::passesGate(uint32_t beatInterval)
+{
+    int heartRate = beatStats.getHeartRate();
+    uint32_t expectedMs = heartRate > 0 ? 60000UL / (uint32_t)heartRate : 0;
+
+    // En movimiento se compara con el ritmo de la última vez en reposo: con
+    // el medio, cada artefacto que colase por poco lo iría arrastrando
+    if (motionMg <= motionQuietMg)
+        restIntervalMs = expectedMs;
+    else if (restIntervalMs > 0)
+        expectedMs = restIntervalMs;
+    uint8_t quality = dspBeatQuality(motionMg, motionQuietMg, motionHeavyMg, beatDetector.getLastPeak(),
+                                     peakReference, beatInterval, expectedMs, stepPeriodMs);
+    signalQuality = (uint8_t)((3 * (uint16_t)signalQuality + quality) / 4);
+
+    if (quality >= minBeatQuality)
+    {
+        gatedStreak = 0;
+        return true;
+    }
+
+    // En movimiento se mantiene el último ritmo bueno (con la calidad baja
+    // a la vista) por mucho que dure: aceptar ahí sería engancharse a la pisada
+    gatedCount++;
+    if (++gatedStreak < gateRestart || motionMg > motionQuietMg)
+        return false;
+
+    // Quieto y aun así tanto tiempo sin un latido coherente: la referencia
+    // ya no vale (otro ritmo, el sensor se ha movido). Se empieza de nuevo
+    // desde este latido
+    gatedStreak = 0;
+    peakReference = 0;
+    beatStats.reset();
+    return true;
+}
+
+void PpgPipeline::restart()
+{
+    irDc.reset();
+    redDc.reset();
+    irBandPass.reset();
+    redBandPass.reset();
+    beatDetector.reset();
+    spo2Estimator.reset();
+}
+
+void PpgPipeline::reset()
+{
+    restart();
+    beatStats.reset();
+    beatAccepted = false;
+    spo2X10 = 0;
+    spo2Pending = 0;
+    peakReference = 0;
+    signalQuality = 0;
+    gatedStreak = 0;
+    gatedCount = 0;
+    restIntervalMs = 0;
+}
@@ -0,0 +1,131 @@
+// ppg_pipeline.h - Cadena completa del PPG: DC, paso banda, latido, SpO2 y HRV
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "dsp_fixed.h"
+#include "spo2_estimator.h"
+#include "beat_stats.h"
+#include "motion_artifact.h"
+
+// Parámetros de la cadena; el constructor deja los del firmware
+struct PpgPipelineConfig
+{
+    explicit PpgPipelineConfig(float sampleRateHz)
+        : sampleRateHz(sampleRateHz), bandLowHz(0.5f), bandHighHz(4.0f), dcShift(5),
+          refractoryMs(300), maxIntervalMs(1500), envelopeDecay(5), systolicPeaks(true),
+          spo2(true), spo2WindowShift(6), spo2MinSamples(64), spo2MinPerfusion(5),
+          hrWindow(5), hrvWindow(32), medianSize(5),
+          motionQuietMg(40), motionSpo2Mg(100), motionHeavyMg(250), motionSkipMg(800), minBeatQuality(50),
+          gateRestart(8) {}
+
+    float sampleRateHz;
+    float bandLowHz;          // 30 BPM
+    float bandHighHz;         // 240 BPM
+    uint8_t dcShift;          // media DC de ~32 muestras (corte ~0,12 Hz a 25 Hz)
+    uint16_t refractoryMs;    // 200 BPM como máximo
+    uint16_t maxIntervalMs;   // 40 BPM como mínimo
+    uint8_t envelopeDecay;
+    // La sístole es un valle del IR crudo (más sangre, menos luz): buscar
+    // los máximos del IR invertido evita contar la muesca dícrota, que en
+    // el IR sin invertir deja dos máximos por latido
+    bool systolicPeaks;
+
+    // SpO2: ventana de 2^6 muestras (~2,5 s, unos 3 latidos a 25 Hz). Con
+    // spo2 = false el rojo no se filtra y getSpo2X10() se queda en 0
+    bool spo2;
+    uint8_t spo2WindowShift;
+    uint16_t spo2MinSamples;
+    uint16_t spo2MinPerfusion; // índice de perfusión * 10000 (5 = 0,05 %)
+
+    // Ritmo medio sobre pocos latidos para responder rápido, HRV sobre una
+    // ventana más larga y mediana contra artefactos
+    uint8_t hrWindow;
+    uint8_t hrvWindow;
+    uint8_t medianSize;
+
+    // Movimiento (RMS del acelerómetro sin gravedad, mg): hasta motionQuietMg
+    // es reposo; desde motionSpo2Mg la ventana de SpO2 deja de sumar (el
+    // artefacto es igual en IR y rojo y lleva el cociente a ~1) y se
+    // mantiene la última; desde motionHeavyMg casi ningún latido llega a
+    // minBeatQuality y desde motionSkipMg ni se buscan. Andando (~150-200 mg)
+    // solo cuentan los latidos coherentes con los anteriores y lejos de la
+    // cadencia. Quieto, tras gateRestart latidos descartados seguidos se
+    // vuelve a aceptar, como BeatStats con su mediana; en movimiento se
+    // mantiene el último ritmo bueno.
+    uint16_t motionQuietMg;
+    uint16_t motionSpo2Mg;
+    uint16_t motionHeavyMg;
+    uint16_t motionSkipMg;
+    uint8_t minBeatQuality; // 0 desactiva la compuerta
+    uint8_t gateRestart;
+};
+
+// ===========================
+// CADENA PPG
+// ===========================
+// Por cada muestra con dedo: DC fuera y paso banda en coma fija para IR y
+// rojo, ventana de SpO2 y detector de picos sobre el IR. En cada latido
+// actualiza ritmo medio y HRV (si el RR no es un artefacto) y la SpO2.
+// El nivel de movimiento que llega del acelerómetro decide cuánto se fía de
+// cada latido (calidad 0-100) y descarta los de artefacto.
+// Sin dependencias del hardware: la usa el firmware y el banco de pruebas.
+class PpgPipeline
+{
+public:
+    explicit PpgPipeline(const PpgPipelineConfig &config);
+
+    // true si la muestra cierra un latido; con detectBeats = false (señal
+    // aún asentándose) se filtra igual pero no se cuentan latidos
+    bool update(int32_t ir, int32_t red, unsigned long timestamp, bool detectBeats = true);
+
+    // Último nivel de MotionEstimator y cadencia del motor de pasos (0 sin
+    // pasos); sin llamarla todo es reposo
+    void setMotion(uint16_t motionMg, uint16_t cadenceSpm)
+    {
+        this->motionMg = motionMg;
+        stepPeriodMs = cadenceSpm > 0 ? 60000UL / cadenceSpm : 0;
+    }
+
+    // Vuelve a arrancar los filtros (salto de DC) conservando los latidos
+    void restart();
+    // Todo desde cero (dedo quitado)
+    void reset();
+
+    bool isBeatAccepted() const { return beatAccepted; } // último latido no descartado
+    int32_t getSpo2X10() const { return spo2X10; }       // SpO2 * 10 del penúltimo latido quieto
+    uint8_t getSignalQuality() const { return signalQuality; } // SQI 0-100, suavizado
+    uint32_t getGatedCount() const { return gatedCount; }      // latidos descartados por calidad
+    const BeatStats &getBeatStats() const { return beatStats; }
+    const Spo2Estimator &getSpo2Estimator() const { return spo2Estimator; }
+
+private:
+    DcRemover irDc;
+    DcRemover redDc;
+    BiquadFilter irBandPass;
+    BiquadFilter redBandPass;
+    Spo2Estimator spo2Estimator;
+    PeakDetector beatDetector;
+    BeatStats beatStats;
+
+    bool systolicPeaks;
+    bool spo2;
+    uint16_t motionQuietMg;
+    uint16_t motionSpo2Mg;
+    uint16_t motionHeavyMg;
+    uint16_t motionSkipMg;
+    uint8_t minBeatQuality;
+    uint8_t gateRestart;
+
+    bool beatAccepted;
+    int32_t spo2X10;
+    int32_t spo2Pending; // del latido anterior, a falta de confirmar que no hubo movimiento
+    uint16_t motionMg;
+    uint32_t stepPeriodMs;
+    uint32_t restIntervalMs;
+    int32_t peakReference; // media de la amplitud de los latidos aceptados
+    uint8_t signalQuality;
+    uint8_t gatedStreak;
+    uint32_t gatedCount;
+
+    bool passesGate(uint32_t beatInterval);
+};
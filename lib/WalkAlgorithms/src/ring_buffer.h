@@ -0,0 +1,61 @@
+// ring_buffer.h - Buffer circular de tamaño fijo (sin memoria dinámica)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ===========================
+// BUFFER CIRCULAR
+// ===========================
+// Si se llena, push() descarta la muestra más antigua y lo cuenta en
+// getOverflowCount(), así el productor nunca se bloquea.
+template <typename T, size_t N>
+class RingBuffer
+{
+public:
+    RingBuffer() : head(0), count(0), overflowCount(0) {}
+
+    void push(const T &item)
+    {
+        buffer[(head + count) % N] = item;
+        if (count < N)
+        {
+            count++;
+        }
+        else
+        {
+            head = (head + 1) % N;
+            overflowCount++;
+        }
+    }
+
+    bool pop(T &item)
+    {
+        if (count == 0)
+            return false;
+
+        item = buffer[head];
+        head = (head + 1) % N;
+        count--;
+        return true;
+    }
+
+    // Acceso por antigüedad: 0 = más antiguo, size() - 1 = más reciente
+    const T &at(size_t index) const { return buffer[(head + index) % N]; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    static size_t capacity() { return N; }
+    uint32_t getOverflowCount() const { return overflowCount; }
+
+    void clear()
+    {
+        head = 0;
+        count = 0;
+    }
+
+private:
+    T buffer[N];
+    size_t head;
+    size_t count;
+    uint32_t overflowCount;
+};
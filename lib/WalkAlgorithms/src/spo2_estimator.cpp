@@ -0,0 +1,76 @@
+// spo2_estimator.cpp - Implementación del estimador de SpO2
+#include "spo2_estimator.h"
+
+Spo2Estimator::Spo2Estimator(uint8_t windowShift, uint16_t minSamples, uint16_t minPerfusionX10000)
+    : windowShift(windowShift), minSamples(minSamples), minPerfusionX10000(minPerfusionX10000)
+{
+    reset();
+}
+
+void Spo2Estimator::update(int32_t irAc, int32_t irDc, int32_t redAc, int32_t redDc)
+{
+    int64_t irSquareQ8 = ((int64_t)irAc * irAc) << DSP_DC_FRAC_BITS;
+    int64_t redSquareQ8 = ((int64_t)redAc * redAc) << DSP_DC_FRAC_BITS;
+    int32_t irDcQ8Sample = irDc << DSP_DC_FRAC_BITS;
+    int32_t redDcQ8Sample = redDc << DSP_DC_FRAC_BITS;
+
+    if (sampleCount == 0)
+    {
+        // Arrancar en la primera muestra en lugar de subir desde 0
+        irMeanSquareQ8 = irSquareQ8;
+        redMeanSquareQ8 = redSquareQ8;
+        irDcQ8 = irDcQ8Sample;
+        redDcQ8 = redDcQ8Sample;
+    }
+
+    irMeanSquareQ8 += (irSquareQ8 - irMeanSquareQ8) >> windowShift;
+    redMeanSquareQ8 += (redSquareQ8 - redMeanSquareQ8) >> windowShift;
+    irDcQ8 += (irDcQ8Sample - irDcQ8) >> windowShift;
+    redDcQ8 += (redDcQ8Sample - redDcQ8) >> windowShift;
+
+    if (sampleCount < 0xFFFF)
+        sampleCount++;
+}
+
+int32_t Spo2Estimator::estimate()
+{
+    ratioQ16 = 0;
+    perfusionX10000 = 0;
+
+    if (sampleCount < minSamples || irDcQ8 <= 0 || redDcQ8 <= 0)
+        return 0;
+
+    // RMS en Q4 (raíz de Q8); la escala se cancela en los cocientes
+    uint32_t irRms = dspSqrt64((uint64_t)irMeanSquareQ8);
+    uint32_t redRms = dspSqrt64((uint64_t)redMeanSquareQ8);
+    uint32_t irDc = (uint32_t)irDcQ8 >> (DSP_DC_FRAC_BITS / 2);
+    uint32_t redDc = (uint32_t)redDcQ8 >> (DSP_DC_FRAC_BITS / 2);
+
+    perfusionX10000 = (uint32_t)(((uint64_t)irRms * 10000) / irDc);
+    if (perfusionX10000 < minPerfusionX10000)
+        return 0;
+
+    ratioQ16 = dspRatioOfRatiosQ16(redRms, redDc, irRms, irDc);
+    if (ratioQ16 == 0)
+        return 0;
+
+    int32_t spO2 = dspSpo2FromRatioX10(ratioQ16, CALIBRATION_OFFSET_X10, CALIBRATION_SLOPE_X10);
+
+    // Fuera de la zona calibrada no hay medida fiable
+    if (spO2 < 700)
+        return 0;
+    if (spO2 > 1000)
+        spO2 = 1000;
+    return spO2;
+}
+
+void Spo2Estimator::reset()
+{
+    sampleCount = 0;
+    irMeanSquareQ8 = 0;
+    redMeanSquareQ8 = 0;
+    irDcQ8 = 0;
+    redDcQ8 = 0;
+    ratioQ16 = 0;
+    perfusionX10000 = 0;
+}
@@ -0,0 +1,49 @@
+// spo2_estimator.h - SpO2 por cociente de cocientes AC/DC en ventana deslizante
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "dsp_fixed.h"
+
+// ===========================
+// ESTIMADOR DE SpO2
+// ===========================
+// Para rojo e IR mantiene, como medias exponenciales de ~2^windowShift
+// muestras (unos pocos latidos), el cuadrado medio de la componente AC ya
+// filtrada y la media DC. update() es O(1) y solo enteros; la raíz y el
+// cociente R = (ACrms_rojo/DC_rojo) / (ACrms_ir/DC_ir) se calculan en
+// estimate(), que basta llamar una vez por latido.
+class Spo2Estimator
+{
+public:
+    // Recta de calibración empírica habitual para el MAX3010x: 110 - 25·R
+    static const int32_t CALIBRATION_OFFSET_X10 = 1100;
+    static const int32_t CALIBRATION_SLOPE_X10 = 250;
+
+    Spo2Estimator(uint8_t windowShift, uint16_t minSamples, uint16_t minPerfusionX10000);
+
+    void update(int32_t irAc, int32_t irDc, int32_t redAc, int32_t redDc);
+
+    // SpO2 * 10, o 0 si la ventana no está llena o la perfusión es
+    // demasiado baja para fiarse de la medida
+    int32_t estimate();
+
+    void reset();
+
+    uint32_t getRatioQ16() const { return ratioQ16; }
+    // Índice de perfusión del IR (ACrms / DC) * 10000
+    uint32_t getPerfusionX10000() const { return perfusionX10000; }
+
+private:
+    uint8_t windowShift;
+    uint16_t minSamples;
+    uint16_t minPerfusionX10000;
+
+    uint16_t sampleCount;
+    int64_t irMeanSquareQ8;
+    int64_t redMeanSquareQ8;
+    int32_t irDcQ8;
+    int32_t redDcQ8;
+
+    uint32_t ratioQ16;
+    uint32_t perfusionX10000;
+};
@@ -0,0 +1,177 @@
+// step_engine.cpp - Implementación del motor de pasos
+#include "step_engine.h"
+
+static const float STEP_BAND_LOW_HZ = 0.6;
+static const float STEP_BAND_HIGH_HZ = 3.5;
+
+StepEngine::StepEngine(float sampleRateHz)
+    : bandPass(designBandPass(sampleRateHz, STEP_BAND_LOW_HZ, STEP_BAND_HIGH_HZ)),
+      bandPassSecond(designBandPass(sampleRateHz, STEP_BAND_LOW_HZ, STEP_BAND_HIGH_HZ)), stepCount(0)
+{
+    reset();
+}
+
+void StepEngine::process(const int32_t *magnitudeMg, const unsigned long *timestamps, size_t count)
+{
+    // Histéresis para confirmar un extremo: un cuarto del umbral vigente
+    int32_t hysteresis = threshold / 4;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int32_t value = bandPassSecond.update(bandPass.update(magnitudeMg[i]));
+        unsigned long time = timestamps[i];
+
+        if (seekingPeak)
+        {
+            if (value > extremeValue)
+            {
+                extremeValue = value;
+                extremeTime = time;
+            }
+            else if (extremeValue - value > hysteresis)
+            {
+                peakValue = extremeValue;
+                peakTime = extremeTime;
+                seekingPeak = false;
+                extremeValue = value;
+            }
+        }
+        else
+        {
+            if (value < extremeValue)
+            {
+                extremeValue = value;
+            }
+            else if (value - extremeValue > hysteresis)
+            {
+                onValley(extremeValue);
+                hysteresis = threshold / 4;
+                seekingPeak = true;
+                extremeValue = value;
+                extremeTime = time;
+            }
+        }
+
+        // Sin pasos un buen rato: racha rota y umbral relajado hacia el mínimo
+        if (time - lastStepTime > MAX_STEP_INTERVAL)
+        {
+            if (haveStep)
+                breakRun();
+            swingAverage -= swingAverage >> 3;
+            threshold = swingAverage / 2 > MIN_SWING_MG ? swingAverage / 2 : MIN_SWING_MG;
+            hysteresis = threshold / 4;
+            lastStepTime = time;
+        }
+    }
+}
+
+void StepEngine::onValley(int32_t valleyValue)
+{
+    int32_t swing = peakValue - valleyValue;
+    if (swing < threshold)
+        return;
+
+    if (haveStep && peakTime - lastStepTime < MIN_STEP_INTERVAL)
+        return; // Rebote del mismo apoyo
+
+    // El umbral sigue a la mitad de la amplitud media de los últimos pasos
+    swingAverage += (swing - swingAverage) / 4;
+    threshold = swingAverage / 2 > MIN_SWING_MG ? swingAverage / 2 : MIN_SWING_MG;
+
+    acceptStep(peakTime);
+}
+
+void StepEngine::acceptStep(unsigned long time)
+{
+    if (haveStep)
+    {
+        unsigned long interval = time - lastStepTime;
+        if (interval > MAX_STEP_INTERVAL)
+            breakRun();
+        else
+            updateGaitMetrics((uint16_t)interval);
+    }
+    haveStep = true;
+    lastStepTime = time;
+
+    if (pendingSteps < STEP_CONFIRM)
+    {
+        // Racha aún sin confirmar: guardar y, al llegar al mínimo, sumarla entera
+        if (++pendingSteps == STEP_CONFIRM)
+            stepCount += STEP_CONFIRM;
+    }
+    else
+    {
+        stepCount++;
+    }
+}
+
+void StepEngine::breakRun()
+{
+    pendingSteps = 0;
+    haveStep = false;
+    intervals.clear();
+    strides.clear();
+    intervalSum = 0;
+    strideSum = 0;
+    strideSquares = 0;
+    cadence = 0;
+    regularity = 0;
+}
+
+void StepEngine::updateGaitMetrics(uint16_t interval)
+{
+    // Zancada = dos pasos seguidos (izquierdo + derecho)
+    if (!intervals.empty())
+    {
+        uint16_t stride = interval + intervals.at(intervals.size() - 1);
+        if (strides.size() == strides.capacity())
+        {
+            uint16_t oldest;
+            strides.pop(oldest);
+            strideSum -= oldest;
+            strideSquares -= (uint32_t)oldest * oldest;
+        }
+        strides.push(stride);
+        strideSum += stride;
+        strideSquares += (uint32_t)stride * stride;
+    }
+
+    if (intervals.size() == intervals.capacity())
+    {
+        uint16_t oldest;
+        intervals.pop(oldest);
+        intervalSum -= oldest;
+    }
+    intervals.push(interval);
+    intervalSum += interval;
+
+    cadence = (uint16_t)((60000UL * intervals.size() + intervalSum / 2) / intervalSum);
+
+    // Regularidad = 100 · (1 - desviación / media) de la duración de zancada
+    size_t n = strides.size();
+    if (n < 2)
+    {
+        regularity = 0;
+        return;
+    }
+    uint64_t spread = (uint64_t)n * strideSquares - (uint64_t)strideSum * strideSum;
+    uint32_t deviation = dspSqrt64(spread / ((uint64_t)n * (n - 1)));
+    uint32_t variationPercent = (uint32_t)((100ULL * deviation * n) / strideSum);
+    regularity = variationPercent >= 100 ? 0 : (uint8_t)(100 - variationPercent);
+}
+
+void StepEngine::reset()
+{
+    bandPass.reset();
+    bandPassSecond.reset();
+    seekingPeak = true;
+    extremeValue = 0;
+    extremeTime = 0;
+    peakValue = 0;
+    peakTime = 0;
+    swingAverage = 2 * MIN_SWING_MG;
+    threshold = MIN_SWING_MG;
+    lastStepTime = 0;
+    breakRun();
+}
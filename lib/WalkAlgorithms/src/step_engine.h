@@ -0,0 +1,80 @@
+// step_engine.h - Detección de pasos adaptativa: filtro, picos/valles, cadencia
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "dsp_fixed.h"
+#include "ring_buffer.h"
+
+// ===========================
+// MOTOR DE PASOS
+// ===========================
+// La magnitud de la aceleración (en mg) pasa por dos secciones paso banda de
+// 0,6-3,5 Hz en coma fija que quitan la gravedad y las vibraciones (motor,
+// traqueteo) que un solo biquad deja pasar. Sobre la señal
+// filtrada se siguen picos y valles alternos con histéresis; un paso es un
+// pico seguido de valle cuya amplitud supera un umbral que se adapta a la
+// amplitud media de los últimos pasos (caminar flojo baja el listón, correr
+// lo sube, y con el tiempo sin pasos vuelve a relajarse).
+//
+// Contra los falsos positivos (coche, tren, golpes sueltos) los pasos se
+// cuentan solo en rachas: hasta STEP_CONFIRM pasos seguidos con intervalos
+// plausibles no se suma nada, y entonces se suman todos de golpe.
+//
+// process() recibe un lote entero (p. ej. un vaciado del FIFO) y recorre
+// las muestras en un bucle con el estado en locales: coste lineal y fijo
+// por muestra, sin divisiones salvo una por paso.
+class StepEngine
+{
+public:
+    static const uint8_t INTERVAL_WINDOW = 8; // pasos para cadencia y regularidad
+
+    explicit StepEngine(float sampleRateHz);
+
+    void process(const int32_t *magnitudeMg, const unsigned long *timestamps, size_t count);
+    void reset();
+
+    uint32_t getStepCount() const { return stepCount; }
+    uint16_t getCadence() const { return cadence; }       // pasos por minuto
+    uint8_t getRegularity() const { return regularity; }  // 0-100 %, zancadas parecidas
+    int32_t getThreshold() const { return threshold; }    // mg pico a valle
+
+private:
+    static const int32_t MIN_SWING_MG = 120;        // por debajo, vibración
+    static const unsigned long MIN_STEP_INTERVAL = 250;  // 240 pasos/min
+    static const unsigned long MAX_STEP_INTERVAL = 2000; // 30 pasos/min: se rompe la racha
+    static const uint8_t STEP_CONFIRM = 4;
+
+    BiquadFilter bandPass;
+    BiquadFilter bandPassSecond;
+
+    // Picos y valles
+    bool seekingPeak;
+    int32_t extremeValue;
+    unsigned long extremeTime;
+    int32_t peakValue;
+    unsigned long peakTime;
+
+    // Umbral adaptativo
+    int32_t swingAverage;
+    int32_t threshold;
+
+    // Racha y contadores
+    unsigned long lastStepTime;
+    bool haveStep;
+    uint8_t pendingSteps;
+    uint32_t stepCount;
+
+    // Cadencia y regularidad por sumas deslizantes de intervalos y zancadas
+    RingBuffer<uint16_t, INTERVAL_WINDOW> intervals;
+    RingBuffer<uint16_t, INTERVAL_WINDOW> strides;
+    uint32_t intervalSum;
+    uint32_t strideSum;
+    uint64_t strideSquares;
+    uint16_t cadence;
+    uint8_t regularity;
+
+    void onValley(int32_t valleyValue);
+    void acceptStep(unsigned long time);
+    void breakRun();
+    void updateGaitMetrics(uint16_t interval);
+};
@@ -0,0 +1,327 @@
+// trace.cpp - Carga de CSV y generación de trazas sintéticas
+#include "trace.h"
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const float GRAVITY = 9.80665f;
+static const float TWO_PI = 6.2831853f;
+
+// ===========================
+// CSV
+// ===========================
+static std::vector<std::string> splitCsv(const std::string &line)
+{
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ','))
+    {
+        if (!field.empty() && field[field.size() - 1] == '\r')
+            field.erase(field.size() - 1);
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+static int findColumn(const std::vector<std::string> &header, const char *name)
+{
+    for (size_t i = 0; i < header.size(); i++)
+        if (header[i] == name)
+            return (int)i;
+    return -1;
+}
+
+// Segundos: número tal cual o ISO 8601 (solo importa la hora, la traza se
+// referencia a su primera fila)
+static bool parseSeconds(const std::string &text, double &seconds)
+{
+    int year, month, day, hour, minute;
+    double second;
+    if (sscanf(text.c_str(), "%d-%d-%dT%d:%d:%lf", &year, &month, &day, &hour, &minute, &second) == 6)
+    {
+        seconds = day * 86400.0 + hour * 3600.0 + minute * 60.0 + second;
+        return true;
+    }
+    char *end;
+    seconds = strtod(text.c_str(), &end);
+    return end != text.c_str();
+}
+
+static float median(std::vector<float> values)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// Frecuencia a partir de la mediana de los intervalos (robusta a huecos)
+static float estimateRate(const std::vector<unsigned long> &timeMs)
+{
+    std::vector<float> deltas;
+    for (size_t i = 1; i < timeMs.size(); i++)
+        if (timeMs[i] > timeMs[i - 1])
+            deltas.push_back((float)(timeMs[i] - timeMs[i - 1]));
+    float period = median(deltas);
+    return period > 0 ? 1000.0f / period : 0;
+}
+
+bool loadTraceCsv(const char *path, Trace &trace, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = std::string("no se puede abrir ") + path;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(file, line))
+    {
+        error = "CSV vacío";
+        return false;
+    }
+    std::vector<std::string> header = splitCsv(line);
+
+    int timeMsColumn = findColumn(header, "timestamp_ms");
+    int timeColumn = findColumn(header, "timestamp");
+    int irColumn = findColumn(header, "ir_value");
+    int redColumn = findColumn(header, "red_value");
+    int fingerColumn = findColumn(header, "finger_detected");
+    int axColumn = findColumn(header, "acel_x");
+    int ayColumn = findColumn(header, "acel_y");
+    int azColumn = findColumn(header, "acel_z");
+    int totalColumn = findColumn(header, "acel_total");
+    int hrColumn = findColumn(header, "ritmo_cardiaco");
+    int spo2Column = findColumn(header, "spo2");
+    int stepsColumn = findColumn(header, "pasos_totales");
+
+    if (timeMsColumn < 0 && timeColumn < 0)
+    {
+        error = "falta la columna timestamp o timestamp_ms";
+        return false;
+    }
+    bool havePpg = irColumn >= 0 && redColumn >= 0;
+    bool haveAccel = (axColumn >= 0 && ayColumn >= 0 && azColumn >= 0) || totalColumn >= 0;
+    if (!havePpg && !haveAccel)
+    {
+        error = "no hay columnas de PPG ni de acelerómetro";
+        return false;
+    }
+
+    trace.name = path;
+    double firstSeconds = -1;
+    std::vector<float> heartRates, spo2s;
+    bool haveSteps = false;
+    uint32_t firstSteps = 0, lastSteps = 0;
+
+    while (std::getline(file, line))
+    {
+        std::vector<std::string> fields = splitCsv(line);
+        if (fields.size() < header.size())
+            continue;
+
+        double seconds;
+        if (timeMsColumn >= 0)
+            seconds = atof(fields[timeMsColumn].c_str()) / 1000.0;
+        else if (!parseSeconds(fields[timeColumn], seconds))
+            continue;
+        if (firstSeconds < 0)
+            firstSeconds = seconds;
+        unsigned long timeMs = (unsigned long)((seconds - firstSeconds) * 1000.0 + 0.5);
+
+        bool finger = fingerColumn < 0 || atoi(fields[fingerColumn].c_str()) != 0 ||
+                      fields[fingerColumn] == "True";
+        if (havePpg && finger)
+        {
+            trace.ppg.ir.push_back(atoi(fields[irColumn].c_str()));
+            trace.ppg.red.push_back(atoi(fields[redColumn].c_str()));
+            trace.ppg.timeMs.push_back(timeMs);
+        }
+
+        if (haveAccel)
+        {
+            float magnitude;
+            if (axColumn >= 0 && ayColumn >= 0 && azColumn >= 0)
+            {
+                float x = atof(fields[axColumn].c_str());
+                float y = atof(fields[ayColumn].c_str());
+                float z = atof(fields[azColumn].c_str());
+                magnitude = sqrtf(x * x + y * y + z * z);
+            }
+            else
+            {
+                magnitude = atof(fields[totalColumn].c_str());
+            }
+            trace.accel.magnitudeMg.push_back((int32_t)(magnitude * 1000.0f / GRAVITY));
+            trace.accel.timeMs.push_back(timeMs);
+        }
+
+        if (hrColumn >= 0 && finger && atof(fields[hrColumn].c_str()) > 0)
+            heartRates.push_back(atof(fields[hrColumn].c_str()));
+        if (spo2Column >= 0 && finger && atof(fields[spo2Column].c_str()) > 0)
+            spo2s.push_back(atof(fields[spo2Column].c_str()));
+        if (stepsColumn >= 0)
+        {
+            lastSteps = strtoul(fields[stepsColumn].c_str(), NULL, 10);
+            if (!haveSteps)
+                firstSteps = lastSteps;
+            haveSteps = true;
+        }
+    }
+
+    trace.ppg.sampleRateHz = estimateRate(trace.ppg.timeMs);
+    trace.accel.sampleRateHz = estimateRate(trace.accel.timeMs);
+
+    // Lo que calculó el dispositivo al grabar hace de referencia
+    trace.reference.valid = !heartRates.empty() || !spo2s.empty() || haveSteps;
+    trace.reference.heartRate = median(heartRates);
+    trace.reference.spo2 = median(spo2s);
+    trace.reference.steps = haveSteps ? lastSteps - firstSteps : 0;
+    return true;
+}
+
+// ===========================
+// SINTÉTICAS
+// ===========================
+// Generador congruencial + Box-Muller: reproducible en cualquier host
+class NoiseSource
+{
+public:
+    explicit NoiseSource(uint32_t seed) : state(seed ? seed : 1) {}
+
+    float uniform()
+    {
+        state = state * 1664525u + 1013904223u;
+        return ((state >> 8) + 0.5f) / 16777216.0f;
+    }
+
+    float gaussian()
+    {
+        return sqrtf(-2.0f * logf(uniform())) * cosf(TWO_PI * uniform());
+    }
+
+private:
+    uint32_t state;
+};
+
+// Un latido en fase 0..1: sístole y muesca dícrota
+static float pulseShape(float phase)
+{
+    float systole = (phase - 0.15f) / 0.07f;
+    float dicrotic = (phase - 0.45f) / 0.08f;
+    return expf(-systole * systole) + 0.35f * expf(-dicrotic * dicrotic);
+}
+
+void makeSyntheticPpg(Trace &trace, float seconds, float sampleRateHz, float bpm, float spo2,
+                      float noise, uint32_t seed)
+{
+    NoiseSource random(seed);
+    const float irDc = 120000.0f;
+    const float redDc = 90000.0f;
+    const float irAc = 1500.0f;
+    // (acRojo / dcRojo) / (acIr / dcIr) = R con SpO2 = 110 - 25·R
+    float ratio = (110.0f - spo2) / 25.0f;
+    float redAc = ratio * irAc * redDc / irDc;
+
+    size_t count = (size_t)(seconds * sampleRateHz);
+    for (size_t i = 0; i < count; i++)
+    {
+        float t = i / sampleRateHz;
+        float phase = t * bpm / 60.0f;
+        float shape = pulseShape(phase - floorf(phase));
+        float drift = 1 + 0.005f * sinf(TWO_PI * 0.2f * t); // respiración
+
+        trace.ppg.ir.push_back((int32_t)(irDc * drift - irAc * shape + noise * random.gaussian()));
+        trace.ppg.red.push_back((int32_t)(redDc * drift - redAc * shape + noise * random.gaussian()));
+        trace.ppg.timeMs.push_back((unsigned long)(t * 1000.0f + 0.5f));
+    }
+    trace.ppg.sampleRateHz = sampleRateHz;
+    trace.reference.valid = true;
+    trace.reference.heartRate = bpm;
+    trace.reference.spo2 = spo2;
+}
+
+void makeSyntheticWalk(Trace &trace, float seconds, float sampleRateHz, float spm,
+                       float vehicleSeconds, uint32_t seed)
+{
+    NoiseSource random(seed);
+    float stepHz = spm / 60.0f;
+
+    size_t walkCount = (size_t)(seconds * sampleRateHz);
+    size_t total = walkCount + (size_t)(vehicleSeconds * sampleRateHz);
+    for (size_t i = 0; i < total; i++)
+    {
+        float t = i / sampleRateHz;
+        float magnitude = 1000.0f + 20.0f * random.gaussian();
+        if (i < walkCount)
+            magnitude += 250.0f * sinf(TWO_PI * stepHz * t) + 80.0f * sinf(2 * TWO_PI * stepHz * t);
+        else
+            magnitude += 90.0f * sinf(TWO_PI * 8.0f * t); // motor / traqueteo
+
+        trace.accel.magnitudeMg.push_back((int32_t)magnitude);
+        trace.accel.timeMs.push_back((unsigned long)(t * 1000.0f + 0.5f));
+    }
+    trace.accel.sampleRateHz = sampleRateHz;
+    trace.reference.valid = true;
+    trace.reference.steps = (uint32_t)(seconds * stepHz);
+}
+
+// Golpes de la mano durante la marcha: uno cada JOLT_PERIOD_S segundos
+static const float JOLT_PERIOD_S = 5.0f;
+
+// Tiempo desde el último golpe (negativo en reposo o antes del primero)
+static float sinceJolt(float walking)
+{
+    if (walking < JOLT_PERIOD_S / 2)
+        return -1;
+    return fmodf(walking - JOLT_PERIOD_S / 2, JOLT_PERIOD_S);
+}
+
+void makeSyntheticWalkingPpg(Trace &trace, float seconds, float sampleRateHz, float bpm, float spo2,
+                             float spm, float restSeconds, uint32_t seed)
+{
+    makeSyntheticPpg(trace, seconds, sampleRateHz, bpm, spo2, 40, seed);
+    NoiseSource random(seed + 1);
+    float stepHz = spm / 60.0f;
+
+    // Pisada: el sensor se desplaza ~1 % de la DC en cada paso, con el mismo
+    // porcentaje en IR y rojo (el cociente rojo/IR tiende a 1), y golpe
+    // amortiguado de ~4 %
+    for (size_t i = 0; i < trace.ppg.ir.size(); i++)
+    {
+        float walking = trace.ppg.timeMs[i] / 1000.0f - restSeconds;
+        if (walking < 0)
+            continue;
+        float artifact = 0.012f * sinf(TWO_PI * stepHz * walking + 0.7f);
+        float jolt = sinceJolt(walking);
+        if (jolt >= 0)
+            artifact += 0.04f * expf(-jolt / 0.4f) * sinf(TWO_PI * 1.5f * jolt);
+        trace.ppg.ir[i] += (int32_t)(120000.0f * artifact);
+        trace.ppg.red[i] += (int32_t)(90000.0f * artifact);
+    }
+
+    const float accelRateHz = 100.0f;
+    size_t count = (size_t)(seconds * accelRateHz);
+    for (size_t i = 0; i < count; i++)
+    {
+        float t = i / accelRateHz;
+        float walking = t - restSeconds;
+        float magnitude = 1000.0f + 20.0f * random.gaussian();
+        if (walking >= 0)
+        {
+            magnitude += 250.0f * sinf(TWO_PI * stepHz * walking) + 80.0f * sinf(2 * TWO_PI * stepHz * walking);
+            float jolt = sinceJolt(walking);
+            if (jolt >= 0)
+                magnitude += 900.0f * expf(-jolt / 0.15f) * sinf(TWO_PI * 4.0f * jolt);
+        }
+        trace.accel.magnitudeMg.push_back((int32_t)magnitude);
+        trace.accel.timeMs.push_back((unsigned long)(t * 1000.0f + 0.5f));
+    }
+    trace.accel.sampleRateHz = accelRateHz;
+    trace.reference.steps = (uint32_t)((seconds - restSeconds) * stepHz);
+}
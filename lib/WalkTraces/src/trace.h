@@ -0,0 +1,73 @@
+// trace.h - Trazas PPG y de acelerómetro para el banco y las pruebas (host)
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Referencia con la que se mide la precisión: la verdad de una traza
+// sintética o lo que calculó el dispositivo al grabarla
+struct TraceReference
+{
+    bool valid;
+    float heartRate;     // bpm
+    float spo2;          // %
+    uint32_t steps;
+};
+
+struct PpgTrace
+{
+    std::vector<int32_t> ir;
+    std::vector<int32_t> red;
+    std::vector<unsigned long> timeMs;
+    float sampleRateHz;
+};
+
+struct AccelTrace
+{
+    std::vector<int32_t> magnitudeMg;
+    std::vector<unsigned long> timeMs;
+    float sampleRateHz;
+};
+
+struct Trace
+{
+    std::string name;
+    PpgTrace ppg;
+    AccelTrace accel;
+    TraceReference reference;
+};
+
+// ===========================
+// CARGA DE CSV
+// ===========================
+// Columnas por nombre de cabecera, en cualquier orden:
+//   tiempo   timestamp_ms (ms) o timestamp (s, o ISO 8601 como el de
+//            python/session_log.py export)
+//   PPG      ir_value, red_value (y finger_detected: sin dedo se omite)
+//   accel    acel_x, acel_y, acel_z (m/s²) o acel_total
+//   referencia opcional: ritmo_cardiaco, spo2, pasos_totales
+// El CSV del dashboard va a ~2 Hz: vale para medir rendimiento pero no para
+// detectar latidos o pasos; para eso hace falta una captura a ritmo de
+// muestreo (tramas de forma de onda de OUTPUT_STREAM).
+bool loadTraceCsv(const char *path, Trace &trace, std::string &error);
+
+// ===========================
+// TRAZAS SINTÉTICAS
+// ===========================
+// Pulso de forma realista (sístole + muesca dícrota) con deriva de línea
+// base y ruido, y R elegido para dar la SpO2 pedida con la recta del
+// firmware
+void makeSyntheticPpg(Trace &trace, float seconds, float sampleRateHz, float bpm, float spo2,
+                      float noise, uint32_t seed);
+
+// Paseo a cadencia fija y, si vehicleSeconds > 0, un tramo final de
+// vibración de vehículo (8 Hz) que no debe contar pasos
+void makeSyntheticWalk(Trace &trace, float seconds, float sampleRateHz, float spm,
+                       float vehicleSeconds, uint32_t seed);
+
+// PPG de makeSyntheticPpg a bpm constante con restSeconds de reposo y luego
+// marcha a spm: artefacto de la pisada común a IR y rojo (mismo % de la DC)
+// y un golpe de la mano cada pocos segundos, con el acelerómetro (100 Hz)
+// grabado a la vez. La referencia es el pulso real, sin artefactos
+void makeSyntheticWalkingPpg(Trace &trace, float seconds, float sampleRateHz, float bpm, float spo2,
+                             float spm, float restSeconds, uint32_t seed);
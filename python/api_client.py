@@ -7,6 +7,8 @@ import json
 from datetime import datetime
 from typing import Dict, Any, Optional
 
+from upload_worker import make_session, get_shared_worker
+
 # Configuración de la API
 API_BASE_URL = "http://127.0.0.1:8000"  # Cambia esto si tu Django está en otro puerto
 ENDPOINT_CAMINATA = f"{API_BASE_URL}/metrics/caminata/"
@@ -17,6 +19,16 @@ MAX_RETRIES = 3
 RETRY_DELAY = 2  # segundos
 TIMEOUT = 5  # segundos
 
+# Una sola sesión (pool de conexiones) para todas las peticiones síncronas
+_session = None
+
+
+def _get_session() -> requests.Session:
+    global _session
+    if _session is None:
+        _session = make_session()
+    return _session
+
 # Cache para evitar envíos duplicados muy seguidos
 _last_sent_data = {
     'caminata': None,
@@ -47,21 +59,16 @@ def _should_send_data(data_type: str, new_data: Dict[str, Any]) -> bool:
 
 def _send_request(endpoint: str, data: Dict[str, Any]) -> bool:
     """
-    Envía una solicitud POST a la API con reintentos.
+    Envía una solicitud POST a la API con reintentos, reutilizando la
+    conexión de la sesión compartida.
     """
-    headers = {
-        'Content-Type': 'application/json',
-        'User-Agent': 'SensorReader/1.0'
-    }
-    
     for attempt in range(MAX_RETRIES):
         try:
             print(f"📤 Enviando a {endpoint} (intento {attempt + 1}/{MAX_RETRIES})...")
             
-            response = requests.post(
+            response = _get_session().post(
                 endpoint,
                 json=data,
-                headers=headers,
                 timeout=TIMEOUT
             )
             
@@ -215,6 +222,20 @@ def send_corazon(sensor_data: Dict[str, Any]) -> bool:
         print(f"❌ Error preparando datos de corazón: {e}")
         return False
 
+def queue_caminata(sensor_data: Dict[str, Any]) -> bool:
+    """
+    Encola datos de caminata en el trabajador compartido (por lotes, sin
+    bloquear). False si la cola está llena.
+    """
+    return get_shared_worker().submit(ENDPOINT_CAMINATA, _prepare_caminata_data(sensor_data))
+
+def queue_corazon(sensor_data: Dict[str, Any]) -> bool:
+    """
+    Encola datos de corazón en el trabajador compartido (por lotes, sin
+    bloquear). False si la cola está llena.
+    """
+    return get_shared_worker().submit(ENDPOINT_CORAZON, _prepare_corazon_data(sensor_data))
+
 def test_connection() -> bool:
     """
     Prueba la conexión con la API.
@@ -226,7 +247,7 @@ def test_connection() -> bool:
         print("🔍 Probando conexión con la API...")
         
         # Intentar conectar al endpoint de caminata
-        response = requests.get(f"{API_BASE_URL}/metrics/caminata/", timeout=3)
+        response = _get_session().get(f"{API_BASE_URL}/metrics/caminata/", timeout=3)
         
         if response.status_code == 200:
             print(f"✅ Conexión exitosa con la API en {API_BASE_URL}")
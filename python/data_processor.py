@@ -1,37 +1,156 @@
 # data_processor.py
+import sys
+
 import pandas as pd
 import matplotlib.pyplot as plt
 
-def analyze_data(csv_file='../datos/sensores_completos.csv'):
-    """Analizar y graficar datos"""
-    try:
-        df = pd.read_csv(csv_file)
+from session_log import SESSION_DIR, SessionReader, latest_session
+from stream_analysis import PLOTTED, SessionAnalyzer
+
+
+def load_data(source=None, start=None, end=None):
+    """
+    Cargar una sesión binaria (la más reciente si no se indica) o un CSV
+    antiguo. start/end en segundos desde el inicio de la sesión: solo se
+    leen los bloques de ese tramo.
+    """
+    source = source or latest_session(SESSION_DIR)
+    if source is None:
+        raise FileNotFoundError(SESSION_DIR)
+
+    if source.endswith('.csv'):
+        df = pd.read_csv(source)
         df['timestamp'] = pd.to_datetime(df['timestamp'])
-        
-        print("Resumen de datos:")
-        print(df.describe())
-        
-        # Gráficos
-        plt.figure(figsize=(12, 8))
-        
-        plt.subplot(2, 2, 1)
-        plt.plot(df['timestamp'], df['spo2'])
-        plt.title('Nivel de oxigenación en la sangre')
-        plt.xticks(rotation=45)
-        
-        plt.subplot(2, 2, 2)
+        return df
+
+    with SessionReader(source) as session:
+        t0 = session.start_time + start if start is not None else None
+        t1 = session.start_time + end if end is not None else None
+        print(f"📁 {source}: {session.count} registros en {len(session.chunks)} bloques")
+        return session.to_dataframe(t0, t1)
+
+
+PLOT_TITLES = {
+    'spo2': 'Nivel de oxigenación en la sangre',
+    'ritmo_cardiaco': 'Ritmo cardiaco (lpm)',
+    'cadencia': 'Cadencia (pasos/min)',
+    'acel_total': 'Aceleración total',
+}
+
+
+def plot_dataframe(df):
+    """Tramo ya cargado en pandas (CSV antiguo o start/end)"""
+    print("Resumen de datos:")
+    print(df.describe())
+
+    plt.figure(figsize=(12, 8))
+
+    plt.subplot(2, 2, 1)
+    plt.plot(df['timestamp'], df['spo2'])
+    plt.title(PLOT_TITLES['spo2'])
+    plt.xticks(rotation=45)
+
+    plt.subplot(2, 2, 2)
+    if 'acel_x' in df:
         plt.plot(df['timestamp'], df['acel_x'], label='X')
         plt.plot(df['timestamp'], df['acel_y'], label='Y')
         plt.plot(df['timestamp'], df['acel_z'], label='Z')
-        plt.title('Aceleración')
         plt.legend()
-        plt.xticks(rotation=45)
-        
-        plt.tight_layout()
+    else:
+        plt.plot(df['timestamp'], df['acel_total'], label='Total')
+    plt.title('Aceleración')
+    plt.xticks(rotation=45)
+
+    plt.tight_layout()
+    plt.show()
+
+
+def _session_figure():
+    """Figura con una línea por serie reducida; devuelve {columna: (ejes, línea)}"""
+    fig = plt.figure(figsize=(12, 8))
+    lines = {}
+    for i, column in enumerate(PLOTTED):
+        ax = fig.add_subplot(2, 2, i + 1)
+        line, = ax.plot([], [])
+        ax.set_title(PLOT_TITLES[column])
+        ax.set_xlabel('minutos')
+        lines[column] = (ax, line)
+    fig.tight_layout()
+    return fig, lines
+
+
+def _refresh(fig, lines, analyzer):
+    """Solo cambian los datos de las líneas: nada se recalcula desde el inicio"""
+    for column, (ax, line) in lines.items():
+        line.set_data(*analyzer.series[column].series())
+        ax.relim()
+        ax.autoscale_view()
+    summary = analyzer.summary()
+    fig.suptitle(f"{analyzer.records} registros | SpO2 p50 {summary['spo2']['p50']:.1f}%"
+                 f" | ritmo p50 {summary['ritmo']['p50']:.0f} lpm"
+                 f" | cadencia p50 {summary['cadencia']['p50']:.0f}")
+    fig.canvas.draw_idle()
+
+
+def analyze_data(source=None, start=None, end=None):
+    """
+    Analizar y graficar datos. Una sesión binaria entera se recorre por
+    bloques (estadísticas incrementales y series reducidas con LTTB); un
+    CSV o un tramo start/end se cargan en pandas como antes.
+    """
+    try:
+        if (source and source.endswith('.csv')) or start is not None or end is not None:
+            df = load_data(source, start, end)
+            if df.empty:
+                print("No hay datos en ese tramo")
+                return
+            plot_dataframe(df)
+            return
+
+        source = source or latest_session(SESSION_DIR)
+        if source is None:
+            raise FileNotFoundError(SESSION_DIR)
+        analyzer = SessionAnalyzer(source)
+        if analyzer.poll() == 0:
+            print("No hay datos en la sesión")
+            return
+        print(f"📁 {source}")
+        analyzer.print_summary()
+
+        fig, lines = _session_figure()
+        _refresh(fig, lines, analyzer)
         plt.show()
-        
+
     except FileNotFoundError:
         print("Archivo de datos no encontrado")
 
-if __name__ == "_main_":
-    analyze_data()
\ No newline at end of file
+
+def analyze_live(source=None, interval=2.0):
+    """Seguir una sesión que se está grabando: cada interval solo lo nuevo"""
+    source = source or latest_session(SESSION_DIR)
+    if source is None:
+        print("Archivo de datos no encontrado")
+        return
+
+    analyzer = SessionAnalyzer(source)
+    analyzer.poll()
+    print(f"📡 Siguiendo {source} (cierra la ventana o Ctrl+C para salir)")
+
+    plt.ion()
+    fig, lines = _session_figure()
+    try:
+        while plt.fignum_exists(fig.number):
+            _refresh(fig, lines, analyzer)
+            plt.pause(interval)
+            analyzer.poll()
+    except KeyboardInterrupt:
+        pass
+    analyzer.print_summary()
+
+
+if __name__ == "__main__":
+    args = [a for a in sys.argv[1:] if a != '--live']
+    if '--live' in sys.argv[1:]:
+        analyze_live(args[0] if args else None)
+    else:
+        analyze_data(args[0] if args else None)
@@ -0,0 +1,442 @@
+# device_gateway.py - Muchos dispositivos en un proceso: puertos y sockets en un solo bucle
+"""
+Gateway multi-dispositivo: en lugar de un CompleteSensorSystem (dos hilos y
+un puerto) por caminante, un único bucle de eventos (selectors) atiende N
+flujos a la vez:
+
+- puertos serie (pyserial): en POSIX se vigilan por su descriptor; donde
+  no se puede (Windows) se sondean cada poll_interval
+- conexiones TCP entrantes (--escuchar host:puerto): ESP32 por red o el
+  simulador de carga (device_simulator.py)
+- conexiones TCP salientes (--conectar host:puerto)
+
+Cada dispositivo lleva lo suyo: FrameDecoder y StreamDispatcher (con la
+reconstrucción del modo delta), SequenceTracker con ACK / BACKFILL, su
+registro de sesión y un ApiReporter con su número de sesión. El envío a la
+API es uno para todo el proceso (UploadWorker compartido, por lotes).
+
+Latencia de extremo a extremo por muestra, en ms: con device_epoch (el
+simulador marca timestampMs en ms desde esa hora) es hora de proceso menos
+hora de emisión; con dispositivos reales, cuyo reloj no está sincronizado
+con el host, es el retraso sobre el mínimo visto. p50 y p99 con P²
+(memoria constante), por dispositivo y del gateway entero.
+
+Uso:
+    python device_gateway.py COM3 COM4 --escuchar 0.0.0.0:5555
+        [--conectar host:puerto] [--sesiones ../datos/sesiones] [--sin-api]
+"""
+import argparse
+import os
+import re
+import selectors
+import socket
+import time
+from collections import deque
+
+import serial
+
+from device_state import ApiReporter, SequenceTracker
+from serial_ingest import StreamDispatcher
+from session_log import SessionWriter
+from stream_analysis import P2Quantile
+from upload_worker import get_shared_worker
+
+RECV_SIZE = 16 * 1024  # hueco pedido al FrameDecoder por lectura de socket
+
+
+class LatencyStats:
+    """p50 / p99 de la latencia (ms) sin guardar las muestras"""
+
+    def __init__(self):
+        self.p50 = P2Quantile(0.5)
+        self.p99 = P2Quantile(0.99)
+        self.count = 0
+        self.max = 0.0
+
+    def add(self, latency_ms):
+        self.p50.add(latency_ms)
+        self.p99.add(latency_ms)
+        self.count += 1
+        self.max = max(self.max, latency_ms)
+
+
+class DeviceConnection:
+    """Un dispositivo del gateway: transporte, decodificación y estado propio"""
+
+    def __init__(self, gateway, name, stream, sesion):
+        self.gateway = gateway
+        self.name = name
+        self.stream = stream
+        self.is_socket = isinstance(stream, socket.socket)
+
+        # El dispositivo hace de cola: el dispatcher le entrega cada muestra
+        # con put() en el mismo bucle, sin hilos de por medio
+        self.dispatcher = StreamDispatcher(self, on_log=self.handle_log,
+                                           on_resync=lambda: self.send_command("KEYFRAME"))
+        self.sequence = SequenceTracker(self.send_command)
+        self.api = None
+        if gateway.uploader is not None:
+            self.api = ApiReporter(gateway.uploader, gateway.api_base_url, sesion)
+        self.session_log = None
+        if gateway.session_dir:
+            safe_name = re.sub(r'[^A-Za-z0-9_.-]', '_', name)
+            self.session_log = SessionWriter(os.path.join(gateway.session_dir, safe_name))
+
+        self.last_sample = None
+        self.last_diag = None
+        self.config = None
+        self.events = deque(maxlen=100)
+        self.logs = deque(maxlen=50)
+        self.device_clock_offset = None
+        self.min_offset = None  # latencia relativa sin reloj común
+
+        self.samples = 0
+        self.backfilled = 0
+        self.bytes_read = 0
+        self.reads = 0
+        self.command_errors = 0
+        self.latency = LatencyStats()
+
+    # ===========================
+    # TRANSPORTE
+    # ===========================
+    def fileno(self):
+        """Descriptor para el selector, o None si hay que sondear"""
+        try:
+            return self.stream.fileno()
+        except (AttributeError, OSError, serial.SerialException):
+            return None
+
+    def read(self):
+        """
+        Lo disponible, directo al buffer del FrameDecoder sin esperar.
+        Devuelve los bytes leídos; ConnectionError si el otro extremo cerró.
+        """
+        decoder = self.dispatcher.decoder
+        if self.is_socket:
+            try:
+                with decoder.writable(RECV_SIZE) as view:
+                    count = self.stream.recv_into(view)
+            except BlockingIOError:
+                return 0
+            if count == 0:
+                raise ConnectionError("conexión cerrada")
+        else:
+            wanted = self.stream.in_waiting
+            if wanted == 0:
+                return 0
+            with decoder.writable(wanted) as view:
+                count = self.stream.readinto(view[:wanted]) or 0
+
+        decoder.commit(count)
+        self.bytes_read += count
+        self.reads += 1
+        return count
+
+    def send_command(self, command):
+        """Orden de una línea al dispositivo; sin hueco se cuenta y se pierde"""
+        data = (command + '\n').encode('ascii')
+        try:
+            if self.is_socket:
+                sent = self.stream.send(data)
+                if sent < len(data):
+                    self.command_errors += 1
+            else:
+                self.stream.write(data)
+        except (OSError, serial.SerialException):
+            self.command_errors += 1
+
+    def close(self):
+        if self.session_log:
+            self.session_log.close()
+        try:
+            self.stream.close()
+        except (OSError, serial.SerialException):
+            pass
+
+    # ===========================
+    # MUESTRAS (desde el dispatcher)
+    # ===========================
+    def handle_log(self, text):
+        self.logs.append((time.time(), text))
+        if self.gateway.show_device_logs:
+            print(f"📟 [{self.name}] {text}")
+
+    def put(self, item):
+        sensor_data, _received = item
+        if 'diag' in sensor_data:
+            self.last_diag = sensor_data['diag']
+            return
+        if 'config' in sensor_data:
+            self.config = sensor_data['config']
+            return
+        if 'evento' in sensor_data:
+            self.events.append(sensor_data['evento'])
+            return
+
+        current_time = time.time()
+        self.sequence.track(sensor_data, current_time)
+
+        if sensor_data.get('backfill'):
+            # Dato recuperado: solo al registro, no a la API
+            self.backfilled += 1
+            self.save_sample(sensor_data, current_time)
+            return
+
+        self.samples += 1
+        self.gateway.samples += 1
+        self.last_sample = sensor_data
+        if 'timestamp' in sensor_data:
+            self.device_clock_offset = current_time - sensor_data['timestamp']
+            self.gateway.record_latency(self, sensor_data['timestamp'], current_time)
+
+        self.save_sample(sensor_data, current_time)
+        if self.api:
+            self.api.send_if_ready(sensor_data, current_time)
+
+    def save_sample(self, data, current_time):
+        if not self.session_log:
+            return
+        if data.get('backfill') and self.device_clock_offset is not None:
+            # Dato recuperado: hora real a partir del reloj del ESP32
+            timestamp = data['timestamp'] + self.device_clock_offset
+        else:
+            timestamp = current_time
+        self.session_log.append(data, timestamp)
+
+
+class DeviceGateway:
+    """Bucle único para todos los dispositivos; run() en el hilo que lo atiende"""
+
+    def __init__(self, uploader=None, api_base_url="http://127.0.0.1:8000",
+                 session_dir=None, sesion_base=1, device_epoch=None,
+                 poll_interval=0.01, status_interval=None, verbose=True):
+        self.uploader = uploader
+        self.api_base_url = api_base_url
+        self.session_dir = session_dir
+        self.next_sesion = sesion_base
+        self.device_epoch = device_epoch
+        self.poll_interval = poll_interval
+        self.status_interval = status_interval
+        self.show_device_logs = False
+        self.verbose = verbose  # altas y bajas por consola
+
+        self.selector = selectors.DefaultSelector()
+        self.devices = {}
+        self.polled = []  # puertos sin descriptor vigilable
+        self.listeners = []
+
+        self.running = False
+        self.cpu_seconds = 0.0  # CPU del hilo del bucle
+        self.samples = 0        # en vivo, de todos los dispositivos que ha habido
+        self.latency = LatencyStats()
+        self.reset_requested = False
+        self.disconnected = 0
+        self.last_status = 0
+
+    # ===========================
+    # ALTAS Y BAJAS
+    # ===========================
+    def add_serial(self, port, baudrate=115200):
+        ser = serial.Serial(port=port, baudrate=baudrate, timeout=0, write_timeout=0.1)
+        ser.reset_input_buffer()
+        device = self._add(port, ser)
+        # Formato y modo de informe activos del ESP32
+        device.send_command("CONFIG")
+        return device
+
+    def connect(self, host, port):
+        sock = socket.create_connection((host, port), timeout=5)
+        sock.setblocking(False)
+        return self._add(f"{host}:{port}", sock)
+
+    def listen(self, host='0.0.0.0', port=5555, backlog=128):
+        """Aceptar dispositivos por TCP; devuelve el puerto (0 = cualquiera libre)"""
+        server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        server.bind((host, port))
+        server.listen(backlog)
+        server.setblocking(False)
+        self.selector.register(server, selectors.EVENT_READ, None)
+        self.listeners.append(server)
+        return server.getsockname()[1]
+
+    def _accept(self, server):
+        try:
+            sock, address = server.accept()
+        except BlockingIOError:
+            return
+        sock.setblocking(False)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self._add(f"{address[0]}:{address[1]}", sock)
+
+    def _add(self, name, stream):
+        device = DeviceConnection(self, name, stream, self.next_sesion)
+        self.next_sesion += 1
+        fd = device.fileno()
+        if fd is None:
+            self.polled.append(device)
+        else:
+            self.selector.register(fd, selectors.EVENT_READ, device)
+        self.devices[name] = device
+        return device
+
+    def _drop(self, device, reason):
+        if self.verbose:
+            print(f"🔌 [{device.name}] desconectado: {reason}")
+        if device in self.polled:
+            self.polled.remove(device)
+        else:
+            try:
+                self.selector.unregister(device.fileno())
+            except (KeyError, ValueError):
+                pass
+        device.close()
+        self.devices.pop(device.name, None)
+        self.disconnected += 1
+
+    # ===========================
+    # BUCLE
+    # ===========================
+    def run(self):
+        self.running = True
+        cpu_start = time.thread_time()
+        try:
+            while self.running:
+                self._run_once()
+                self.cpu_seconds = time.thread_time() - cpu_start
+        finally:
+            for device in list(self.devices.values()):
+                device.close()
+            for server in self.listeners:
+                server.close()
+            self.selector.close()
+
+    def _run_once(self):
+        timeout = self.poll_interval if self.polled else 0.1
+        if self.selector.get_map():
+            events = self.selector.select(timeout)
+        else:
+            time.sleep(timeout)  # select() sin descriptores falla en Windows
+            events = ()
+
+        for key, _ in events:
+            if key.data is None:
+                self._accept(key.fileobj)
+            else:
+                self._service(key.data)
+        for device in list(self.polled):
+            self._service(device)
+
+        if self.reset_requested:
+            self.reset_requested = False
+            self.latency = LatencyStats()
+
+        if self.status_interval and time.time() - self.last_status >= self.status_interval:
+            self.last_status = time.time()
+            self.print_status()
+
+    def _service(self, device):
+        try:
+            if device.read() == 0:
+                return
+        except (OSError, ConnectionError, serial.SerialException) as e:
+            self._drop(device, e)
+            return
+        # Decodificar antes de la siguiente lectura (los payloads son vistas)
+        device.dispatcher.dispatch(device.dispatcher.decoder.parse(), time.time())
+
+    def stop(self):
+        self.running = False
+
+    def reset_latency(self):
+        """Empezar una ventana de medida nueva (la aplica el propio bucle)"""
+        self.reset_requested = True
+
+    def record_latency(self, device, timestamp, current_time):
+        if self.device_epoch is not None:
+            latency_ms = (current_time - self.device_epoch - timestamp) * 1000.0
+        else:
+            offset = current_time - timestamp
+            if device.min_offset is None or offset < device.min_offset:
+                device.min_offset = offset
+            latency_ms = (offset - device.min_offset) * 1000.0
+        device.latency.add(latency_ms)
+        self.latency.add(latency_ms)
+
+    # ===========================
+    # ESTADO
+    # ===========================
+    def print_status(self):
+        devices = list(self.devices.values())
+        print("="*60)
+        print(f"🛰️ Gateway: {len(devices)} dispositivos | latencia p50 {self.latency.p50.value:.1f}ms"
+              f" p99 {self.latency.p99.value:.1f}ms | CPU {self.cpu_seconds:.1f}s")
+        for device in devices:
+            data = device.last_sample or {}
+            decoder = device.dispatcher.decoder
+            print(f"   {device.name:22s} {device.samples:7d} muestras"
+                  f" | ♥ {data.get('ritmo_cardiaco', 0):3d} SpO2 {data.get('spo2', 0):5.1f}%"
+                  f" pasos {data.get('pasos_totales', 0):6d}"
+                  f" | p99 {device.latency.p99.value:6.1f}ms | CRC {decoder.crc_errors}"
+                  f" | resinc. {device.dispatcher.rebuilder.resyncs}")
+        if self.uploader is not None:
+            api = self.uploader.stats
+            print(f"   API: {api['enviados']} registros en {api['lotes']} envíos"
+                  f" | pendientes {self.uploader.pending()} | descartados {api['descartados']}")
+
+
+def _address(text):
+    host, _, port = text.rpartition(':')
+    return host or '0.0.0.0', int(port)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Gateway multi-dispositivo")
+    parser.add_argument('puertos', nargs='*', help="puertos serie (COM3, /dev/ttyUSB0...)")
+    parser.add_argument('--baudios', type=int, default=115200)
+    parser.add_argument('--escuchar', help="host:puerto para dispositivos por TCP")
+    parser.add_argument('--conectar', action='append', default=[], help="host:puerto (repetible)")
+    parser.add_argument('--sesiones', help="directorio de registros (uno por dispositivo)")
+    parser.add_argument('--api', default="http://127.0.0.1:8000")
+    parser.add_argument('--sin-api', action='store_true')
+    parser.add_argument('--sesion', type=int, default=1, help="número de sesión del primero")
+    parser.add_argument('--mensajes', action='store_true', help="mostrar mensajes de los ESP32")
+    args = parser.parse_args()
+
+    uploader = None if args.sin_api else get_shared_worker()
+    gateway = DeviceGateway(uploader, args.api, args.sesiones, args.sesion, status_interval=5)
+    gateway.show_device_logs = args.mensajes
+
+    for port in args.puertos:
+        try:
+            gateway.add_serial(port, args.baudios)
+            print(f"✅ Conectado a {port}")
+        except serial.SerialException as e:
+            print(f"❌ Error conectando {port}: {e}")
+    for address in args.conectar:
+        try:
+            gateway.connect(*_address(address))
+            print(f"✅ Conectado a {address}")
+        except OSError as e:
+            print(f"❌ Error conectando {address}: {e}")
+    if args.escuchar:
+        host, port = _address(args.escuchar)
+        print(f"📡 Escuchando dispositivos en {host}:{gateway.listen(host, port)}")
+
+    if not gateway.devices and not gateway.listeners:
+        print("❌ Ningún dispositivo: indica puertos, --conectar o --escuchar")
+        return
+
+    try:
+        gateway.run()
+    except KeyboardInterrupt:
+        print("\n🛑 Gateway detenido por el usuario")
+    finally:
+        gateway.stop()
+        if uploader is not None and not uploader.flush(timeout=3):
+            print(f"⚠️ API: {uploader.pending()} registros sin enviar")
+
+
+if __name__ == "__main__":
+    main()
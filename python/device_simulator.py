@@ -0,0 +1,265 @@
+# device_simulator.py - Dispositivos sintéticos que repiten trazas contra el gateway
+"""
+Carga para device_gateway.py sin hardware: cada dispositivo simulado es una
+conexión TCP que envía lo mismo que el firmware en modo binario (tramas
+FRAME_SENSOR con SampleRecord) o, con --json, las líneas JSON, a --hz
+muestras por segundo. Los valores salen de una traza:
+
+- una sesión grabada (.wlog de session_log.py), que se repite en bucle;
+- sin sesión, una caminata generada: ritmo y SpO2 que oscilan, pasos a
+  ~108 por minuto y la aceleración del paso.
+
+Cada dispositivo empieza en un punto distinto de la traza y con un desfase
+dentro del periodo, para que no emitan todos a la vez. timestampMs son los
+ms desde --epoch (hora del host), así el gateway con la misma device_epoch
+mide la latencia de extremo a extremo.
+
+Todos los dispositivos de un proceso comparten un hilo: un montículo dice a
+quién le toca y un selector recoge sus órdenes (ACK, BACKFILL, KEYFRAME...)
+sin bloquear. No hay historial: BACKFILL se cuenta y no se responde. Si el
+proceso no llega a tiempo no recupera en ráfaga: salta y lo cuenta como
+retraso (el benchmark lo usa para saber si el cuello era el simulador).
+
+Uso:
+    python device_simulator.py --gateway 127.0.0.1:5555 --dispositivos 20
+        [--hz 10] [--segundos 60] [--sesion traza.wlog] [--json]
+"""
+import argparse
+import heapq
+import json
+import math
+import random
+import selectors
+import signal
+import socket
+import struct
+import time
+
+from frame_protocol import (FRAME_SENSOR, SAMPLE_SEQUENCE, SENSOR_PAYLOAD,
+                            decode_sensor_payload, encode_frame)
+from session_log import SessionReader
+
+TIMESTAMP = struct.Struct('<I')
+MAX_BEHIND = 1.0  # s de retraso a partir de los que se salta en vez de recuperar
+
+
+# ===========================
+# TRAZAS
+# ===========================
+def _pack_row(spo2, heart_rate, flags, ir_value, red_value, ax, ay, az, temperature,
+              steps, rr_ms, rmssd_ms, sdnn_ms, cadence, stride_regularity, signal_quality):
+    """SensorFramePayload sin timestampMs (se pone al enviar)"""
+    def fixed(value):
+        return max(-32768, min(32767, int(round(value * 100))))
+    payload = SENSOR_PAYLOAD.pack(
+        0, int(round(spo2 * 10)), min(int(heart_rate), 255), flags,
+        int(ir_value), int(red_value), fixed(ax), fixed(ay), fixed(az), fixed(temperature),
+        int(steps), 0, 0, min(int(rr_ms), 0xFFFF), min(int(rmssd_ms), 0xFFFF),
+        min(int(sdnn_ms), 0xFFFF), min(int(cadence), 255), int(stride_regularity),
+        int(signal_quality))
+    return payload[TIMESTAMP.size:]
+
+
+def load_session_trace(path):
+    """Filas de una sesión grabada (sin los datos recuperados)"""
+    with SessionReader(path) as reader:
+        columns = reader.columns()
+        rows = []
+        for i in range(reader.count):
+            flags = int(columns['flags'][i])
+            if flags & 0x10:  # FLAG_BACKFILL
+                continue
+            rows.append(_pack_row(
+                float(columns['spo2'][i]), columns['ritmo_cardiaco'][i], flags & 0x0F,
+                columns['ir_value'][i], columns['red_value'][i],
+                float(columns['acel_x'][i]), float(columns['acel_y'][i]),
+                float(columns['acel_z'][i]), float(columns['temperatura'][i]),
+                columns['pasos_totales'][i], columns['rr_ms'][i], columns['rmssd_ms'][i],
+                columns['sdnn_ms'][i], columns['cadencia'][i],
+                columns['regularidad_zancada'][i], columns['calidad_senal'][i]))
+    return rows
+
+
+def synthetic_trace(rate_hz=10, seconds=120, seed=1):
+    """Caminata generada con valores plausibles, de seconds segundos a rate_hz"""
+    rng = random.Random(seed)
+    rows = []
+    steps = 0.0
+    cadence = 108
+    flags = 0x01 | 0x02 | 0x04 | 0x08  # dedo, movimiento, ambos sensores
+    for i in range(int(rate_hz * seconds)):
+        t = i / rate_hz
+        heart_rate = 95 + 6 * math.sin(2 * math.pi * t / 40) + rng.gauss(0, 1)
+        spo2 = 97.0 + 0.5 * math.sin(2 * math.pi * t / 60) + rng.gauss(0, 0.2)
+        steps += cadence / 60.0 / rate_hz
+        phase = 2 * math.pi * cadence / 60.0 * t
+        rr_ms = 60000.0 / heart_rate
+        rows.append(_pack_row(
+            spo2, heart_rate, flags, 90000 + rng.randint(-800, 800), 70000 + rng.randint(-600, 600),
+            1.5 * math.sin(phase), 0.8 * math.cos(phase), 9.81 + 2.5 * math.sin(2 * phase),
+            31.5, int(steps), rr_ms, 35, 45, cadence, 88, 75))
+    return rows
+
+
+# ===========================
+# DISPOSITIVOS
+# ===========================
+class SimulatedDevice:
+    """Una conexión al gateway que repite la traza desde su propio punto"""
+
+    def __init__(self, sock, trace, rate_hz, epoch, json_lines, rng):
+        self.sock = sock
+        self.trace = trace
+        self.period = 1.0 / rate_hz
+        self.epoch = epoch
+        self.json_lines = json_lines
+        self.position = rng.randrange(len(trace))
+        self.next_due = time.time() + rng.random() * self.period
+        self.sample_seq = 0
+        self.frame_seq = 0
+        self.inbox = bytearray()
+
+        self.sent = 0
+        self.late = 0  # muestras saltadas por ir con retraso
+        self.commands = {}
+        self.closed = False
+
+    def emit(self, now):
+        row = self.trace[self.position]
+        self.position = (self.position + 1) % len(self.trace)
+        timestamp_ms = int((now - self.epoch) * 1000) & 0xFFFFFFFF
+        payload = TIMESTAMP.pack(timestamp_ms) + row
+
+        if self.json_lines:
+            data = decode_sensor_payload(payload)
+            data['seq'] = self.sample_seq
+            message = (json.dumps(data) + '\r\n').encode('utf-8')
+        else:
+            message = encode_frame(FRAME_SENSOR, self.frame_seq,
+                                   payload + SAMPLE_SEQUENCE.pack(self.sample_seq))
+        self.sock.sendall(message)
+        self.sample_seq += 1
+        self.frame_seq += 1
+        self.sent += 1
+
+    def handle_commands(self):
+        """Órdenes del gateway: solo se cuentan (no hay historial ni config)"""
+        try:
+            data = self.sock.recv(4096)
+        except BlockingIOError:
+            return True
+        if not data:
+            return False
+        self.inbox += data
+        while b'\n' in self.inbox:
+            line, _, rest = self.inbox.partition(b'\n')
+            self.inbox = bytearray(rest)
+            command = line.decode('ascii', errors='ignore').split(' ', 1)[0].strip()
+            if command:
+                self.commands[command] = self.commands.get(command, 0) + 1
+        return True
+
+
+def run_devices(address, count, rate_hz, seconds, trace, epoch=None, json_lines=False, seed=1):
+    """Conectar count dispositivos y emitir durante seconds; devuelve el resumen"""
+    epoch = time.time() if epoch is None else epoch
+    rng = random.Random(seed)
+    selector = selectors.DefaultSelector()
+    devices = []
+    for _ in range(count):
+        sock = socket.create_connection(address, timeout=5)
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.settimeout(1.0)  # sendall con el gateway atascado no espera para siempre
+        device = SimulatedDevice(sock, trace, rate_hz, epoch, json_lines, rng)
+        selector.register(sock, selectors.EVENT_READ, device)
+        devices.append(device)
+
+    # (próximo envío, índice): siempre al que antes le toque
+    due = [(device.next_due, i) for i, device in enumerate(devices)]
+    heapq.heapify(due)
+    end = time.time() + seconds
+
+    try:
+        while due:
+            now = time.time()
+            if now >= end:
+                break
+            for key, _ in selector.select(max(0.0, min(due[0][0], end) - now)):
+                if not key.data.handle_commands():
+                    # El gateway cerró: deja de emitir en su próximo turno
+                    selector.unregister(key.fileobj)
+                    key.data.closed = True
+
+            now = time.time()
+            while due and due[0][0] <= now:
+                next_due, i = heapq.heappop(due)
+                device = devices[i]
+                if device.closed:
+                    continue
+                if now - next_due > MAX_BEHIND:
+                    # Sin llegar a tiempo: saltar al presente en vez de una ráfaga
+                    skipped = int((now - next_due) / device.period)
+                    device.late += skipped
+                    next_due += skipped * device.period
+                try:
+                    device.emit(now)
+                except OSError:
+                    device.closed = True
+                    continue
+                heapq.heappush(due, (next_due + device.period, i))
+    except KeyboardInterrupt:
+        pass  # Ctrl+C o SIGTERM del benchmark: el resumen sale igual
+
+    commands = {}
+    for device in devices:
+        for name, n in device.commands.items():
+            commands[name] = commands.get(name, 0) + n
+        device.sock.close()
+    selector.close()
+    return {
+        'dispositivos': count,
+        'enviadas': sum(device.sent for device in devices),
+        'retrasadas': sum(device.late for device in devices),
+        'cerradas': sum(device.closed for device in devices),
+        'ordenes': commands,
+    }
+
+
+def _address(text):
+    host, _, port = text.rpartition(':')
+    return host or '127.0.0.1', int(port)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Dispositivos sintéticos para el gateway")
+    parser.add_argument('--gateway', default='127.0.0.1:5555', help="host:puerto del gateway")
+    parser.add_argument('--dispositivos', type=int, default=1)
+    parser.add_argument('--hz', type=float, default=10.0, help="muestras por segundo y dispositivo")
+    parser.add_argument('--segundos', type=float, default=60.0)
+    parser.add_argument('--sesion', help="sesión .wlog a repetir (si no, caminata generada)")
+    parser.add_argument('--json', action='store_true', help="líneas JSON en lugar de tramas")
+    parser.add_argument('--epoch', type=float, help="hora de referencia de timestampMs")
+    parser.add_argument('--semilla', type=int, default=1)
+    parser.add_argument('--resumen-json', action='store_true', help="resumen en una línea JSON")
+    args = parser.parse_args()
+
+    # terminate() del benchmark como Ctrl+C, para que imprima el resumen
+    signal.signal(signal.SIGTERM, signal.default_int_handler)
+
+    trace = load_session_trace(args.sesion) if args.sesion else synthetic_trace(args.hz)
+    if not trace:
+        print(f"❌ {args.sesion}: sin muestras que repetir")
+        return
+
+    summary = run_devices(_address(args.gateway), args.dispositivos, args.hz, args.segundos,
+                          trace, args.epoch, args.json, args.semilla)
+    if args.resumen_json:
+        print(json.dumps(summary))
+    else:
+        print(f"📤 {summary['dispositivos']} dispositivos: {summary['enviadas']} muestras"
+              f" | retrasadas {summary['retrasadas']} | cerradas {summary['cerradas']}"
+              f" | órdenes {summary['ordenes']}")
+
+
+if __name__ == "__main__":
+    main()
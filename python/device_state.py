@@ -0,0 +1,170 @@
+# device_state.py - Estado del host por dispositivo: secuencia y registros de la API
+"""
+Lo que el host lleva por cada ESP32, fuera del lector para que un lector
+de un puerto (sensor_reader.py) y el gateway de muchos (device_gateway.py)
+hagan exactamente lo mismo:
+
+- SequenceTracker: secuencia contigua más alta recibida, "ACK <seq>"
+  periódico y "BACKFILL <seq>" cuando hay huecos o al reconectar.
+- ApiReporter: registros de caminata y corazón cada send_interval hacia el
+  UploadWorker (compartido por todos los dispositivos del proceso).
+"""
+import time
+from datetime import datetime
+
+
+class SequenceTracker:
+    """Seguir la secuencia de muestras, confirmar y pedir huecos"""
+
+    def __init__(self, send_command, state_file=None):
+        self.send_command = send_command
+        # Con state_file la secuencia confirmada sobrevive a la sesión
+        self.state_file = state_file
+        self.last_contiguous_seq = self.load() if state_file else None
+        self.pending_seqs = set()
+        self.max_pending_seqs = 50000
+        self.ack_interval = 2  # segundos
+        self.last_ack_time = 0
+        self.backfill_retry = 5  # segundos entre peticiones mientras haya hueco
+        self.last_backfill_request = 0
+
+    def load(self):
+        """Leer la última secuencia confirmada de la sesión anterior"""
+        try:
+            with open(self.state_file, 'r', encoding='utf-8') as f:
+                return int(f.read().strip())
+        except (OSError, ValueError):
+            return None
+
+    def save(self):
+        if not self.state_file:
+            return
+        try:
+            with open(self.state_file, 'w', encoding='utf-8') as f:
+                f.write(str(self.last_contiguous_seq))
+        except OSError:
+            pass
+
+    def request_backfill(self, current_time):
+        self.send_command(f"BACKFILL {self.last_contiguous_seq}")
+        self.last_backfill_request = current_time
+
+    def track(self, sensor_data, current_time):
+        seq = sensor_data.get('seq')
+        if seq is None:
+            return
+
+        last = self.last_contiguous_seq
+        backfill = sensor_data.get('backfill', False)
+
+        if last is None or sensor_data.get('sin_historial') or \
+                (not backfill and seq < last - self.max_pending_seqs):
+            # Primera muestra sin estado previo, el ESP32 se ha reiniciado o
+            # no guarda historial (perfil prod): no hay huecos que pedir
+            self.last_contiguous_seq = seq
+            self.pending_seqs.clear()
+        elif seq == last + 1:
+            last = seq
+            while last + 1 in self.pending_seqs:
+                last += 1
+                self.pending_seqs.discard(last)
+            self.last_contiguous_seq = last
+        elif seq > last + 1:
+            self.pending_seqs.add(seq)
+            if len(self.pending_seqs) > self.max_pending_seqs:
+                # Hueco irrecuperable: saltar hasta lo más antiguo pendiente
+                self.last_contiguous_seq = min(self.pending_seqs) - 1
+                self.pending_seqs = {s for s in self.pending_seqs
+                                     if s > self.last_contiguous_seq}
+
+            if (not backfill and
+                    current_time - self.last_backfill_request >= self.backfill_retry):
+                self.request_backfill(current_time)
+
+        if current_time - self.last_ack_time >= self.ack_interval:
+            self.send_command(f"ACK {self.last_contiguous_seq}")
+            self.save()
+            self.last_ack_time = current_time
+
+
+class ApiReporter:
+    """Registros de caminata y corazón de un dispositivo, cada send_interval"""
+
+    def __init__(self, uploader, api_base_url="http://127.0.0.1:8000", sesion=1,
+                 send_interval=3):
+        self.uploader = uploader
+        self.endpoint_caminata = f"{api_base_url}/metrics/caminata/"
+        self.endpoint_corazon = f"{api_base_url}/metrics/corazon/"
+        self.sesion = sesion
+        # REDUCIDO: Enviar cada 3 segundos (más rápido para gráficas)
+        self.send_interval = send_interval
+
+        self.last_caminata_send = 0
+        self.last_corazon_send = 0
+        self.session_start_time = time.time()
+        self.pasos_anteriores = 0
+
+    def start(self, current_time):
+        """Inicio de la sesión (tiempo_actividad cuenta desde aquí)"""
+        self.session_start_time = current_time
+
+    def send_if_ready(self, sensor_data, current_time):
+        """Enviar a API si es tiempo (no bloqueante)"""
+        try:
+            # Enviar datos de caminata
+            if current_time - self.last_caminata_send >= self.send_interval:
+                self.send_caminata(sensor_data, current_time)
+
+            # Enviar datos de corazón
+            if current_time - self.last_corazon_send >= self.send_interval:
+                self.send_corazon(sensor_data, current_time)
+
+        except Exception as e:
+            print(f"⚠️ Error preparando envío API: {e}")
+
+    def send_caminata(self, sensor_data, current_time):
+        """Encolar datos de caminata para el envío por lotes"""
+        pasos = sensor_data.get('pasos_totales', 0)
+        pasos_nuevos = pasos - self.pasos_anteriores
+
+        # Enviar SIEMPRE, incluso si pasos_nuevos es 0
+        # Esto mantiene la serie continua en el dashboard
+
+        km_recorridos = round((max(pasos_nuevos, 0) * 0.08), 4)
+        calorias = round((max(pasos_nuevos, 0) * 0.04), 2)
+
+        data = {
+            "km_recorridos": str(km_recorridos),
+            "pasos": max(pasos_nuevos, 0),
+            "tiempo_actividad": str(int(current_time - self.session_start_time)),
+            "velocidad_promedio": "0",
+            "calorias_quemadas": str(calorias),
+            "sesion": self.sesion
+        }
+
+        # Cola llena = servidor caído hace rato: se reintenta en el próximo
+        # intervalo con los pasos acumulados, sin perderlos
+        if self.uploader.submit(self.endpoint_caminata, data):
+            self.pasos_anteriores = pasos
+        self.last_caminata_send = current_time
+
+    def send_corazon(self, sensor_data, current_time):
+        """Encolar datos de corazón para el envío por lotes"""
+        spo2 = sensor_data.get('spo2', 0)
+        ritmo = sensor_data.get('ritmo_cardiaco', 0)
+
+        # ENVIAR SIEMPRE, incluso si son 0
+        # Esto hará que las gráficas muestren la bajada a 0
+
+        now = datetime.now()
+        data = {
+            "ritmo_cardiaco": int(ritmo),
+            "presion": "90",  # Valor fijo para demo
+            "oxigenacion": str(round(spo2, 2)),
+            "fecha": now.strftime('%Y-%m-%d'),
+            "hora": now.strftime('%H%M%S'),
+            "sesion": self.sesion
+        }
+
+        self.uploader.submit(self.endpoint_corazon, data)
+        self.last_corazon_send = current_time
@@ -0,0 +1,611 @@
+# frame_protocol.py - Decodificador de las tramas binarias del ESP32
+"""
+Decodificador del protocolo binario de src/frame_protocol.h.
+
+Trama (little-endian):
+    sync u16 (A5 5A) | type u8 | seq u16 | len u16 | payload | crc u16
+
+El CRC es CRC-16/CCITT-FALSE sobre type..payload. Las líneas de texto
+(JSON o mensajes de depuración) pueden ir intercaladas con las tramas; en
+los modos binarios los mensajes van en tramas FRAME_LOG.
+"""
+import struct
+
+FRAME_SYNC = b'\xa5\x5a'
+FRAME_HEADER = struct.Struct('<2sBHH')
+FRAME_HEADER_SIZE = FRAME_HEADER.size  # 7
+FRAME_CRC_SIZE = 2
+FRAME_MAX_PAYLOAD = 1024
+
+FRAME_SENSOR = 0x01
+FRAME_WAVEFORM = 0x02
+FRAME_HISTORY = 0x03
+FRAME_DIAGNOSTIC = 0x04
+FRAME_LOG = 0x05  # texto UTF-8: mensajes de depuración en los modos binarios
+FRAME_CONFIG = 0x06  # respuesta a CONFIG / SET / SAVE / RESET
+FRAME_DELTA = 0x07  # modo delta: solo los campos cambiados (SensorStateRebuilder)
+FRAME_EVENT = 0x08  # modo delta: paso, latido, dedo, movimiento
+FRAME_COMPACT = 0x09  # perfil prod: latido, pasos y estado
+
+SENSOR_FLAG_FINGER = 0x01
+SENSOR_FLAG_MOVING = 0x02
+SENSOR_FLAG_MAX_ONLINE = 0x04
+SENSOR_FLAG_MPU_ONLINE = 0x08
+
+# Igual que SensorFramePayload en el firmware
+SENSOR_PAYLOAD = struct.Struct('<IHBBIIhhhhIBBHHHBBB')
+# SampleRecord = SensorFramePayload + secuencia de muestra u32
+SAMPLE_SEQUENCE = struct.Struct('<I')
+# Igual que CompactFramePayload en el firmware
+COMPACT_PAYLOAD = struct.Struct('<IIBBBBI')
+
+
+def _payload_fields(payload_struct):
+    """(offset, formato) de cada campo tras timestampMs, en orden del struct"""
+    fields = []
+    offset = struct.calcsize('<I')
+    for code in payload_struct.format.lstrip('<')[1:]:
+        fields.append((offset, '<' + code))
+        offset += struct.calcsize('<' + code)
+    return fields
+
+
+# Igual que DeltaHeader en el firmware; el bit i de la máscara es el campo
+# i de SENSOR_PAYLOAD sin contar el timestamp
+DELTA_HEADER = struct.Struct('<III')
+DELTA_FIELDS = _payload_fields(SENSOR_PAYLOAD)
+
+# Igual que EventFramePayload / SensorEventType en el firmware
+EVENT_PAYLOAD = struct.Struct('<IBI')
+EVENT_NAMES = {1: 'paso', 2: 'latido', 3: 'dedo_puesto', 4: 'dedo_quitado',
+               5: 'movimiento_inicio', 6: 'movimiento_fin'}
+
+# Igual que DiagnosticHeader / DiagnosticStage en el firmware
+DIAGNOSTIC_HEADER = struct.Struct('<I3HIIII4IBBHHHHBBB2I2IB7IHHBB')
+DIAGNOSTIC_STAGE = struct.Struct('<HIIII')
+DIAGNOSTIC_TASKS = ('adquisicion', 'procesado', 'transmision')
+DIAGNOSTIC_I2C_DEVICES = ('max30105', 'mpu6050')
+DIAGNOSTIC_STAGES = ('ppg_lectura', 'mpu_lectura', 'salud', 'sondeo', 'init_sensor',
+                     'ppg_proceso', 'pasos', 'json', 'trama')
+POWER_STATES = ('activo', 'sin_dedo', 'quieto', 'reposo')
+
+# Igual que ConfigFramePayload (DeviceConfig + lo activo) en el firmware
+CONFIG_PAYLOAD = struct.Struct('<BBHHHBBBBBBHBHB')
+OUTPUT_FORMATS = ('json', 'binario', 'stream')
+REPORT_MODES = ('completo', 'delta')
+
+# Igual que WaveformHeader en el firmware
+WAVEFORM_HEADER = struct.Struct('<BBBBHHI')
+WAVEFORM_RAW = 0
+WAVEFORM_DELTA = 1
+
+# Nombre y escala de cada canal según el stream
+WAVEFORM_CHANNELS = {
+    0: ('ppg', (('ir_value', 1), ('red_value', 1))),
+    1: ('accel', (('acel_x', 100.0), ('acel_y', 100.0), ('acel_z', 100.0))),
+}
+
+
+def _build_crc_table():
+    table = []
+    for byte in range(256):
+        crc = byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+        table.append(crc & 0xFFFF)
+    return table
+
+
+_CRC_TABLE = _build_crc_table()
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)"""
+    for byte in data:
+        crc = ((crc << 8) & 0xFFFF) ^ _CRC_TABLE[((crc >> 8) ^ byte) & 0xFF]
+    return crc
+
+
+def encode_frame(frame_type, seq, payload):
+    """Construir una trama (útil para simuladores y pruebas)"""
+    header = FRAME_HEADER.pack(FRAME_SYNC, frame_type, seq & 0xFFFF, len(payload))
+    crc = crc16_ccitt(header[2:] + payload)
+    return header + payload + struct.pack('<H', crc)
+
+
+def decode_sensor_payload(payload, seq=None):
+    """
+    Convertir un payload FRAME_SENSOR al mismo dict que el JSON.
+
+    'seq' es la secuencia de muestra (la que se confirma con ACK) y
+    'frame_seq' la de la trama.
+    """
+    (timestamp_ms, spo2x10, heart_rate, flags, ir_value, red_value,
+     ax, ay, az, temperature, steps, max_reconnects,
+     mpu_reconnects, rr_ms, rmssd_ms, sdnn_ms, cadence,
+     stride_regularity, signal_quality) = SENSOR_PAYLOAD.unpack_from(payload)
+
+    acel_x = ax / 100.0
+    acel_y = ay / 100.0
+    acel_z = az / 100.0
+
+    data = {
+        'timestamp': timestamp_ms / 1000.0,
+        'spo2': spo2x10 / 10.0,
+        'ritmo_cardiaco': heart_rate,
+        'rr_ms': rr_ms,
+        'rmssd_ms': rmssd_ms,
+        'sdnn_ms': sdnn_ms,
+        'calidad_senal': signal_quality,
+        'ir_value': ir_value,
+        'red_value': red_value,
+        'finger_detected': bool(flags & SENSOR_FLAG_FINGER),
+        'acel_x': acel_x,
+        'acel_y': acel_y,
+        'acel_z': acel_z,
+        'acel_total': round((acel_x ** 2 + acel_y ** 2 + acel_z ** 2) ** 0.5, 2),
+        'temperatura': temperature / 100.0,
+        'pasos_totales': steps,
+        'cadencia': cadence,
+        'regularidad_zancada': stride_regularity,
+        'is_moving': bool(flags & SENSOR_FLAG_MOVING),
+        'sensor_status': {
+            'max30102': bool(flags & SENSOR_FLAG_MAX_ONLINE),
+            'mpu6050': bool(flags & SENSOR_FLAG_MPU_ONLINE),
+            'max30102_reconexiones': max_reconnects,
+            'mpu6050_reconexiones': mpu_reconnects,
+        },
+    }
+    if len(payload) >= SENSOR_PAYLOAD.size + SAMPLE_SEQUENCE.size:
+        data['seq'] = SAMPLE_SEQUENCE.unpack_from(payload, SENSOR_PAYLOAD.size)[0]
+    if seq is not None:
+        data['frame_seq'] = seq
+    return data
+
+
+def decode_compact_payload(payload, seq=None):
+    """
+    FRAME_COMPACT (perfil prod): las mismas claves que FRAME_SENSOR para lo
+    que trae; sin SpO2, HRV, valores crudos ni acelerómetro. El dispositivo
+    no guarda historial: 'sin_historial' evita pedir BACKFILL por los huecos.
+    """
+    (timestamp_ms, sample_seq, heart_rate, flags, signal_quality, cadence,
+     steps) = COMPACT_PAYLOAD.unpack_from(payload)
+    data = {
+        'timestamp': timestamp_ms / 1000.0,
+        'seq': sample_seq,
+        'ritmo_cardiaco': heart_rate,
+        'calidad_senal': signal_quality,
+        'finger_detected': bool(flags & SENSOR_FLAG_FINGER),
+        'pasos_totales': steps,
+        'cadencia': cadence,
+        'is_moving': bool(flags & SENSOR_FLAG_MOVING),
+        'sensor_status': {
+            'max30102': bool(flags & SENSOR_FLAG_MAX_ONLINE),
+            'mpu6050': bool(flags & SENSOR_FLAG_MPU_ONLINE),
+        },
+        'sin_historial': True,
+    }
+    if seq is not None:
+        data['frame_seq'] = seq
+    return data
+
+
+def decode_log_payload(payload, seq=None):
+    """FRAME_LOG: el texto tal cual, sin pasar por JSON"""
+    return bytes(payload).decode('utf-8', errors='replace')
+
+
+def decode_history_payload(payload, seq=None):
+    """FRAME_HISTORY: igual que FRAME_SENSOR pero marcado como reenvío"""
+    data = decode_sensor_payload(payload, seq)
+    data['backfill'] = True
+    return data
+
+
+def _read_varint(payload, offset):
+    result = 0
+    shift = 0
+    while True:
+        byte = payload[offset]
+        offset += 1
+        result |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            break
+        shift += 7
+    # Deshacer zigzag
+    return (result >> 1) ^ -(result & 1), offset
+
+
+def decode_waveform_payload(payload, seq=None):
+    """
+    Convertir un payload FRAME_WAVEFORM a:
+        {'stream': 'ppg', 'timestamp': s, 'period_ms': 40,
+         'timestamps': [...], 'channels': {'ir_value': [...], ...}}
+    """
+    (stream, channel_count, encoding, _, count, period_ms,
+     first_ms) = WAVEFORM_HEADER.unpack_from(payload)
+    stream_name, channel_defs = WAVEFORM_CHANNELS.get(
+        stream, ('stream_%d' % stream, ()))
+
+    offset = WAVEFORM_HEADER.size
+    channels = {}
+    for ch in range(channel_count):
+        if ch < len(channel_defs):
+            name, scale = channel_defs[ch]
+        else:
+            name, scale = 'ch%d' % ch, 1
+
+        values = []
+        for i in range(count):
+            if encoding == WAVEFORM_DELTA and i > 0:
+                delta, offset = _read_varint(payload, offset)
+                values.append(values[-1] + delta)
+            else:
+                values.append(struct.unpack_from('<i', payload, offset)[0])
+                offset += 4
+
+        channels[name] = [v / scale for v in values] if scale != 1 else values
+
+    data = {
+        'stream': stream_name,
+        'timestamp': first_ms / 1000.0,
+        'period_ms': period_ms,
+        'timestamps': [(first_ms + i * period_ms) / 1000.0 for i in range(count)],
+        'channels': channels,
+    }
+    if seq is not None:
+        data['frame_seq'] = seq
+    return data
+
+
+def decode_diagnostic_payload(payload, seq=None):
+    """
+    Convertir un payload FRAME_DIAGNOSTIC al mismo dict que la línea JSON
+    {"diag": {...}}; cada etapa es [n, min, media, p99, max] en µs.
+    """
+    fields = DIAGNOSTIC_HEADER.unpack_from(payload)
+    uptime_ms = fields[0]
+    loops = fields[1:4]
+    ppg_dropped, accel_dropped, missed, queue_dropped = fields[4:8]
+    residency = list(fields[8:12])
+    (state, sleep_pct, current_x10, ppg_wake, accel_wake, sleep_wake,
+     led_ir, led_red, adc_range) = fields[12:21]
+    i2c_errors = fields[21:23]
+    i2c_timeouts = fields[23:25]
+    i2c_busy = fields[25]
+    (heap_free, heap_min_free, heap_largest, psram_free, psram_total,
+     arena_internal, arena_psram, late_allocations) = fields[26:34]
+    accel_hz, accel_burst = fields[34:36]
+    stage_count = fields[36]
+
+    stages = {}
+    offset = DIAGNOSTIC_HEADER.size
+    for index in range(stage_count):
+        if offset + DIAGNOSTIC_STAGE.size > len(payload):
+            break
+        name = (DIAGNOSTIC_STAGES[index] if index < len(DIAGNOSTIC_STAGES)
+                else 'etapa_%d' % index)
+        stages[name] = list(DIAGNOSTIC_STAGE.unpack_from(payload, offset))
+        offset += DIAGNOSTIC_STAGE.size
+
+    diag = {
+        'uptime_ms': uptime_ms,
+        'vueltas_hz': dict(zip(DIAGNOSTIC_TASKS, loops)),
+        'perdidas': {
+            'ppg': ppg_dropped,
+            'accel': accel_dropped,
+            'planificador': missed,
+            'colas': queue_dropped,
+        },
+        'accel': {'hz': accel_hz, 'rafaga': accel_burst},
+        'energia': {
+            'estado': POWER_STATES[state] if state < len(POWER_STATES) else state,
+            'corriente_ma': current_x10 / 10.0,
+            'sueno_pct': sleep_pct,
+            'residencia_s': residency,
+            'despertar_ppg_ms': ppg_wake,
+            'despertar_accel_ms': accel_wake,
+            'despertar_sleep_us': sleep_wake,
+        },
+        'led': {
+            'ir_ma': led_ir * 0.2,
+            'rojo_ma': led_red * 0.2,
+            'rango_na': 2048 << adc_range,
+        },
+        'i2c': {'ocupado_pct': i2c_busy},
+        'memoria': {
+            'libre': heap_free,
+            'min_libre': heap_min_free,
+            'bloque_max': heap_largest,
+            'psram_libre': psram_free,
+            'psram_total': psram_total,
+            'arena_interna': arena_internal,
+            'arena_psram': arena_psram,
+            'tardias': late_allocations,
+        },
+        'etapas_us': stages,
+    }
+    for name, errors, timeouts in zip(DIAGNOSTIC_I2C_DEVICES, i2c_errors, i2c_timeouts):
+        diag['i2c'][name] = {'errores': errors, 'timeouts': timeouts}
+    if seq is not None:
+        diag['frame_seq'] = seq
+    return {'diag': diag}
+
+
+def _format_name(value):
+    return OUTPUT_FORMATS[value] if value < len(OUTPUT_FORMATS) else value
+
+
+def decode_event_payload(payload, seq=None):
+    """FRAME_EVENT al mismo dict que la línea JSON {"evento": {...}}"""
+    timestamp_ms, event_type, value = EVENT_PAYLOAD.unpack_from(payload)
+    event = {
+        'tipo': EVENT_NAMES.get(event_type, event_type),
+        'timestamp': timestamp_ms / 1000.0,
+        'valor': value,
+    }
+    if seq is not None:
+        event['frame_seq'] = seq
+    return {'evento': event}
+
+
+def decode_config_payload(payload, seq=None):
+    """
+    Convertir un payload FRAME_CONFIG al mismo dict que la línea JSON
+    {"config": {...}}; las claves son las que acepta SET.
+    """
+    (_version, output_format, interval_ms, batch, ppg_hz, ppg_average,
+     led_ir, led_red, adc_range, report_mode, deadband_pct, keyframe_s,
+     active_format, active_interval_ms, saved) = CONFIG_PAYLOAD.unpack_from(payload)
+    config = {
+        'formato': _format_name(output_format),
+        'intervalo_ms': interval_ms,
+        'lote': batch,
+        'ppg_hz': ppg_hz,
+        'ppg_promedio': ppg_average,
+        'led_ir': led_ir,
+        'led_rojo': led_red,
+        'rango_na': 2048 << adc_range,
+        'reporte': REPORT_MODES[report_mode] if report_mode < len(REPORT_MODES) else report_mode,
+        'banda_pct': deadband_pct,
+        'keyframe_s': keyframe_s,
+        'activo': {
+            'formato': _format_name(active_format),
+            'intervalo_ms': active_interval_ms,
+        },
+        'guardado': bool(saved),
+    }
+    if seq is not None:
+        config['frame_seq'] = seq
+    return {'config': config}
+
+
+PAYLOAD_DECODERS = {
+    FRAME_SENSOR: decode_sensor_payload,
+    FRAME_COMPACT: decode_compact_payload,
+    FRAME_HISTORY: decode_history_payload,
+    FRAME_DIAGNOSTIC: decode_diagnostic_payload,
+    FRAME_CONFIG: decode_config_payload,
+    FRAME_EVENT: decode_event_payload,
+}
+
+WAVEFORM_DECODERS = {
+    FRAME_WAVEFORM: decode_waveform_payload,
+}
+
+
+class SensorStateRebuilder:
+    """
+    Estado completo de un dispositivo en modo delta ("SET reporte delta").
+
+    Cada keyframe (FRAME_SENSOR o línea JSON completa) fija la base y cada
+    delta (FRAME_DELTA o {"delta": {...}}) la actualiza y devuelve la
+    muestra entera, con las mismas claves que la completa y 'delta': True.
+    Sin base (host recién conectado, keyframe perdido) un delta no se puede
+    aplicar: devuelve None y llama una vez a on_resync() para que el
+    dispositivo mande un keyframe ("KEYFRAME"). En modo completo solo pasa
+    los keyframes tal cual. Uno por dispositivo.
+    """
+
+    def __init__(self, on_resync=None):
+        self.on_resync = on_resync or (lambda: None)
+        self.frame_base = None  # bytes de SensorFramePayload
+        self.state = None       # última muestra JSON completa o reconstruida
+        self.resync_pending = False
+        self.deltas = 0
+        self.resyncs = 0
+
+    def _missing_base(self):
+        if not self.resync_pending:
+            self.resync_pending = True
+            self.resyncs += 1
+            self.on_resync()
+        return None
+
+    def sensor_frame(self, payload, seq=None):
+        """FRAME_SENSOR: decodificar y guardar como base"""
+        self.frame_base = bytearray(payload[:SENSOR_PAYLOAD.size])
+        self.resync_pending = False
+        return decode_sensor_payload(payload, seq)
+
+    def delta_frame(self, payload, seq=None):
+        """FRAME_DELTA: aplicar los campos de la máscara sobre la base"""
+        if self.frame_base is None:
+            return self._missing_base()
+
+        timestamp_ms, sample_seq, mask = DELTA_HEADER.unpack_from(payload)
+        base = self.frame_base
+        struct.pack_into('<I', base, 0, timestamp_ms)
+        offset = DELTA_HEADER.size
+        for bit, (field_offset, code) in enumerate(DELTA_FIELDS):
+            if not mask & (1 << bit):
+                continue
+            size = struct.calcsize(code)
+            base[field_offset:field_offset + size] = payload[offset:offset + size]
+            offset += size
+
+        self.deltas += 1
+        data = decode_sensor_payload(base, seq)
+        data['seq'] = sample_seq
+        data['delta'] = True
+        return data
+
+    def json_sample(self, data):
+        """Línea JSON completa (no reenvío): nueva base"""
+        self.state = data
+        self.resync_pending = False
+        return data
+
+    def json_delta(self, delta):
+        """{"delta": {...}}: mezclar con la última muestra completa"""
+        if self.state is None:
+            return self._missing_base()
+
+        data = dict(self.state)
+        status = delta.pop('sensor_status', None)
+        if status:
+            data['sensor_status'] = dict(data.get('sensor_status', {}), **status)
+        data.update(delta)
+        data['acel_total'] = round((data.get('acel_x', 0) ** 2 + data.get('acel_y', 0) ** 2 +
+                                    data.get('acel_z', 0) ** 2) ** 0.5, 2)
+        data['delta'] = True
+
+        self.deltas += 1
+        self.state = data
+        return data
+
+
+class FrameDecoder:
+    """
+    Separa un flujo de bytes en tramas binarias y líneas de texto sin
+    copiarlo: los bytes se leen directamente a un bytearray fijo
+    (read_from / writable + commit) y parse() recorre lo recibido en su
+    sitio.
+
+    parse() devuelve una lista de tuplas:
+        ('frame', type, seq, payload)   payload: memoryview del buffer
+        ('json', bytes)                 línea que empieza por '{'
+        ('line', texto)                 cualquier otra línea
+    Los memoryview solo son válidos hasta la siguiente lectura: decodificar
+    (o copiar) antes. feed() mantiene la interfaz de copiar y analizar.
+    """
+
+    CAPACITY = 64 * 1024
+
+    def __init__(self, capacity=CAPACITY):
+        self.buffer = bytearray(capacity)
+        self.start = 0  # primer byte sin analizar
+        self.end = 0    # fin de lo recibido
+        self.crc_errors = 0
+        self.frames = 0
+        self.overflows = 0  # bytes descartados por falta de sitio
+
+    # ===========================
+    # ENTRADA
+    # ===========================
+    def writable(self, size):
+        """Hueco de al menos size bytes (o lo que quepa) tras lo recibido"""
+        capacity = len(self.buffer)
+        if capacity - self.end < size and self.start > 0:
+            # Compactar: mover lo pendiente al principio, sin cambiar de tamaño
+            pending = self.end - self.start
+            self.buffer[:pending] = self.buffer[self.start:self.end]
+            self.start, self.end = 0, pending
+        if self.end == capacity:
+            # Lleno de basura sin separadores: conservar solo el último byte
+            # por si es media palabra de sync
+            self.overflows += capacity - 1
+            self.buffer[0] = self.buffer[capacity - 1]
+            self.start, self.end = 0, 1
+        return memoryview(self.buffer)[self.end:]
+
+    def commit(self, count):
+        self.end += count
+
+    def read_from(self, stream):
+        """
+        Una lectura en bloque de stream (p. ej. serial.Serial) directa al
+        buffer: todo lo disponible, o espera al primer byte hasta el timeout
+        del puerto. Devuelve los bytes leídos.
+        """
+        wanted = max(1, getattr(stream, 'in_waiting', 0))
+        with self.writable(wanted) as view:
+            count = stream.readinto(view[:wanted]) or 0
+        self.commit(count)
+        return count
+
+    def feed(self, data):
+        """Copiar data al buffer y analizar (simuladores y pruebas)"""
+        results = []
+        data = memoryview(data)
+        while data:
+            with self.writable(len(data)) as view:
+                count = min(len(view), len(data))
+                view[:count] = data[:count]
+            self.commit(count)
+            data = data[count:]
+            # Copiar los payloads: el siguiente trozo puede reutilizar el buffer
+            results.extend(item[:3] + (bytes(item[3]),) if item[0] == 'frame' else item
+                           for item in self.parse())
+        return results
+
+    # ===========================
+    # ANÁLISIS EN EL SITIO
+    # ===========================
+    def parse(self):
+        results = []
+        buf = self.buffer
+        view = memoryview(buf)
+        start, end = self.start, self.end
+
+        while start < end:
+            sync = buf.find(FRAME_SYNC, start, end)
+            newline = buf.find(b'\n', start, end)
+
+            if sync == -1 and newline == -1:
+                break  # línea a medias: esperar al resto
+
+            if newline != -1 and (sync == -1 or newline < sync):
+                line_start = start
+                while line_start < newline and buf[line_start] in b' \t\r':
+                    line_start += 1
+                if line_start < newline:
+                    if buf[line_start] == 0x7B:  # '{'
+                        results.append(('json', bytes(view[line_start:newline])))
+                    else:
+                        line = bytes(view[line_start:newline]).decode('utf-8', errors='ignore').strip()
+                        if line:
+                            results.append(('line', line))
+                start = newline + 1
+                continue
+
+            # Trama binaria: descartar el texto suelto anterior al sync
+            start = sync
+            if end - start < FRAME_HEADER_SIZE:
+                break
+
+            _, frame_type, seq, length = FRAME_HEADER.unpack_from(buf, start)
+            if length > FRAME_MAX_PAYLOAD:
+                start += 1  # Sync falso, seguir buscando
+                continue
+
+            total = FRAME_HEADER_SIZE + length + FRAME_CRC_SIZE
+            if end - start < total:
+                break
+
+            payload_end = start + FRAME_HEADER_SIZE + length
+            expected = struct.unpack_from('<H', buf, payload_end)[0]
+            if crc16_ccitt(view[start + 2:payload_end]) != expected:
+                self.crc_errors += 1
+                start += 1
+                continue
+
+            self.frames += 1
+            results.append(('frame', frame_type, seq, view[start + FRAME_HEADER_SIZE:payload_end]))
+            start += total
+
+        self.start, self.end = start, end
+        if start == end:
+            self.start = self.end = 0
+        return results
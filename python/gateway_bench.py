@@ -0,0 +1,214 @@
+# gateway_bench.py - Cuántos dispositivos aguanta el gateway en este host
+"""
+Benchmark de device_gateway.py con carga de device_simulator.py.
+
+En cada escalón de la rampa (1, 2, 4... hasta --max, o los de --pasos):
+
+1. Arranca un DeviceGateway en un hilo, escuchando en localhost. La API
+   es un UploadWorker de verdad sobre una sesión que responde 200 sin red,
+   para que el agrupado por lotes también cuente.
+2. Lanza device_simulator.py con N dispositivos, repartidos en varios
+   procesos para que el simulador no sea el cuello de botella.
+3. Tras --calentamiento segundos con todos conectados, mide durante
+   --segundos:
+   - muestras entregadas frente a las esperadas (N * hz * segundos);
+   - latencia de extremo a extremo p50 / p99 (emisión en el simulador ->
+     procesado en el gateway, con el mismo reloj);
+   - CPU por dispositivo, en % de un núcleo: la del hilo del bucle
+     (time.thread_time) y la del proceso entero (más envío y medida).
+
+Un escalón es sostenido si entrega al menos el 99 % y p99 <= --p99-max.
+La rampa se para en el primero que no lo es; el resultado es el último
+que sí. Si el simulador va con retraso el escalón no cuenta (el límite
+sería el simulador, no el gateway).
+
+Uso:
+    python gateway_bench.py [--hz 10] [--segundos 10] [--max 1024]
+        [--pasos 1,10,100] [--sesion traza.wlog] [--p99-max 100] [--json]
+"""
+import argparse
+import json
+import os
+import subprocess
+import sys
+import threading
+import time
+
+from device_gateway import DeviceGateway
+from upload_worker import UploadWorker
+
+DEVICES_PER_SIMULATOR = 100  # por proceso simulador
+CONNECT_TIMEOUT = 20.0       # s para que se conecten todos
+SIMULATOR = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'device_simulator.py')
+
+
+class _NullResponse:
+    status_code = 200
+    text = ''
+
+
+class _NullSession:
+    """Sesión HTTP que acepta todo al instante: mide el gateway, no la red"""
+
+    def __init__(self):
+        self.posts = 0
+
+    def post(self, endpoint, json=None, timeout=None):
+        self.posts += 1
+        return _NullResponse()
+
+
+def _start_simulators(port, devices, args, epoch, seconds):
+    processes = []
+    count = (devices + DEVICES_PER_SIMULATOR - 1) // DEVICES_PER_SIMULATOR
+    count = min(count, max(1, (os.cpu_count() or 2) - 1))
+    for index in range(count):
+        share = devices // count + (1 if index < devices % count else 0)
+        command = [sys.executable, SIMULATOR, '--gateway', f'127.0.0.1:{port}',
+                   '--dispositivos', str(share), '--hz', str(args.hz),
+                   '--segundos', str(seconds), '--epoch', repr(epoch),
+                   '--semilla', str(index + 1), '--resumen-json']
+        if args.sesion:
+            command += ['--sesion', args.sesion]
+        if args.json:
+            command.append('--json')
+        processes.append(subprocess.Popen(command, stdout=subprocess.PIPE, text=True))
+    return processes
+
+
+def _simulator_summary(processes):
+    """Sumar los resúmenes JSON (última línea) de cada proceso simulador"""
+    total = {'enviadas': 0, 'retrasadas': 0, 'cerradas': 0, 'fallidos': 0}
+    for process in processes:
+        output, _ = process.communicate()
+        lines = output.strip().splitlines()
+        try:
+            summary = json.loads(lines[-1])
+        except (IndexError, ValueError):
+            total['fallidos'] += 1
+            continue
+        for key in ('enviadas', 'retrasadas', 'cerradas'):
+            total[key] += summary[key]
+    return total
+
+
+def run_step(devices, args):
+    """Un escalón de la rampa con un gateway nuevo; devuelve sus medidas"""
+    epoch = time.time()
+    uploader = UploadWorker(session=_NullSession())
+    uploader.start()
+    gateway = DeviceGateway(uploader, device_epoch=epoch, verbose=False)
+    port = gateway.listen('127.0.0.1', 0, backlog=max(128, devices))
+    thread = threading.Thread(target=gateway.run, name='gateway', daemon=True)
+    thread.start()
+
+    processes = _start_simulators(port, devices, args, epoch,
+                                  CONNECT_TIMEOUT + args.calentamiento + args.segundos)
+    result = {'dispositivos': devices}
+    try:
+        deadline = time.time() + CONNECT_TIMEOUT
+        while len(gateway.devices) < devices and time.time() < deadline:
+            time.sleep(0.05)
+        result['conectados'] = len(gateway.devices)
+
+        time.sleep(args.calentamiento)
+        gateway.reset_latency()
+        samples0, cpu0, process0, t0 = (gateway.samples, gateway.cpu_seconds,
+                                        time.process_time(), time.time())
+        time.sleep(args.segundos)
+        samples1, cpu1, process1, t1 = (gateway.samples, gateway.cpu_seconds,
+                                        time.process_time(), time.time())
+        window = t1 - t0
+
+        expected = devices * args.hz * window
+        result.update({
+            'entregadas_pct': round(100.0 * (samples1 - samples0) / expected, 1),
+            'p50_ms': round(gateway.latency.p50.value, 2),
+            'p99_ms': round(gateway.latency.p99.value, 2),
+            'max_ms': round(gateway.latency.max, 2),
+            'cpu_bucle_pct': round(100.0 * (cpu1 - cpu0) / window / devices, 3),
+            'cpu_proceso_pct': round(100.0 * (process1 - process0) / window / devices, 3),
+            'cpu_bucle_total_pct': round(100.0 * (cpu1 - cpu0) / window, 1),
+        })
+    finally:
+        for process in processes:
+            process.terminate()
+        simulator = _simulator_summary(processes)
+        gateway.stop()
+        thread.join(2)
+        uploader.stop(timeout=2)
+
+    result['api_registros'] = uploader.stats['enviados']
+    result['simulador_retrasadas'] = simulator['retrasadas']
+    return result
+
+
+def _sustained(result, args):
+    return (result.get('conectados') == result['dispositivos'] and
+            result.get('entregadas_pct', 0) >= 99.0 and
+            result.get('p99_ms', float('inf')) <= args.p99_max)
+
+
+def _ramp(args):
+    if args.pasos:
+        return [int(n) for n in args.pasos.split(',')]
+    steps = []
+    n = 1
+    while n <= args.max:
+        steps.append(n)
+        n *= 2
+    return steps
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark del gateway multi-dispositivo")
+    parser.add_argument('--hz', type=float, default=10.0, help="muestras/s por dispositivo")
+    parser.add_argument('--segundos', type=float, default=10.0, help="ventana de medida")
+    parser.add_argument('--calentamiento', type=float, default=2.0)
+    parser.add_argument('--max', type=int, default=1024, help="tope de la rampa")
+    parser.add_argument('--pasos', help="escalones a medida, p. ej. 1,10,100")
+    parser.add_argument('--sesion', help="sesión .wlog que repiten los simuladores")
+    parser.add_argument('--json', action='store_true', help="simuladores con líneas JSON")
+    parser.add_argument('--p99-max', type=float, default=100.0, help="ms")
+    parser.add_argument('--resultado-json', action='store_true')
+    args = parser.parse_args()
+
+    print(f"🏋️ Gateway: {'JSON' if args.json else 'tramas binarias'} a {args.hz:g} Hz por dispositivo,"
+          f" ventana {args.segundos:g}s, sostenido = 99 % entregado y p99 <= {args.p99_max:g}ms")
+    print(f"{'disp':>6} {'entreg.':>8} {'p50 ms':>8} {'p99 ms':>8} {'max ms':>8}"
+          f" {'CPU bucle':>10} {'CPU proc.':>10}  (CPU en % de un núcleo por dispositivo)")
+
+    results = []
+    best = None
+    for devices in _ramp(args):
+        result = run_step(devices, args)
+        results.append(result)
+        if 'entregadas_pct' not in result:
+            print(f"{devices:6d} ❌ solo {result['conectados']} conectados")
+            break
+        ok = _sustained(result, args)
+        print(f"{devices:6d} {result['entregadas_pct']:7.1f}% {result['p50_ms']:8.2f}"
+              f" {result['p99_ms']:8.2f} {result['max_ms']:8.1f}"
+              f" {result['cpu_bucle_pct']:9.3f}% {result['cpu_proceso_pct']:9.3f}%"
+              f"  {'✅' if ok else '❌'}")
+        if result['simulador_retrasadas']:
+            print(f"⚠️ El simulador fue con retraso ({result['simulador_retrasadas']} muestras):"
+                  f" el límite está en la carga, no en el gateway")
+            break
+        if not ok:
+            break
+        best = result
+
+    if best:
+        print(f"🏁 Máximo sostenido: {best['dispositivos']} dispositivos"
+              f" ({best['dispositivos'] * args.hz:g} muestras/s), p50 {best['p50_ms']:.2f}ms"
+              f" p99 {best['p99_ms']:.2f}ms, {best['cpu_bucle_pct']:.3f}% de núcleo por dispositivo")
+    else:
+        print("🏁 Ningún escalón sostenido")
+    if args.resultado_json:
+        print(json.dumps({'hz': args.hz, 'escalones': results,
+                          'max_sostenido': best['dispositivos'] if best else 0}))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,26 +1,37 @@
 # sensor_reader.py - VERSIÓN CORREGIDA
 import serial
 import time
-import json
-import csv
-from datetime import datetime
 import os
 import sys
-import requests
 import threading
 from collections import deque
 
+from device_state import ApiReporter, SequenceTracker
+from serial_ingest import SampleQueue, SerialIngest
+from session_log import SessionWriter
+from upload_worker import get_shared_worker
+
 
 class CompleteSensorSystem:
     def __init__(self, port='COM3', baudrate=115200):
         self.port = port
         self.baudrate = baudrate
         self.ser = None
-        self.csv_file = None
-        self.csv_writer = None
+        self.session_log = None  # registro binario de la sesión
+
+        # Muestras ya decodificadas, de la lectura al procesado (sin sondeo)
+        self.samples = SampleQueue(maxlen=1000)
+        self.ingest = None
+
+        # Mensajes de depuración del ESP32 (pasos, dedo...): aparte del JSON
+        self.device_logs = deque(maxlen=100)
+        self.show_device_logs = False
+        # Eventos del modo delta (paso, latido, dedo, movimiento)
+        self.device_events = deque(maxlen=200)
 
-        # Buffer de datos para procesamiento en tiempo real
-        self.data_buffer = deque(maxlen=10)  # Últimos 10 datos
+        # Formas de onda completas (modo OUTPUT_STREAM): (timestamp, valor)
+        self.waveforms = {}
+        self.waveform_maxlen = 5000
         self.last_valid_data = None
         self.data_count = 0
 
@@ -29,32 +40,36 @@ class CompleteSensorSystem:
         self.max_spo2 = 0
         self.min_spo2 = 100
 
-        # Configuración de API
-        self.api_base_url = "http://127.0.0.1:8000"
-        self.endpoint_caminata = f"{self.api_base_url}/metrics/caminata/"
-        self.endpoint_corazon = f"{self.api_base_url}/metrics/corazon/"
-
-        # Control de tiempo para envíos
-        self.last_caminata_send = 0
-        self.last_corazon_send = 0
-        # REDUCIDO: Enviar cada 3 segundos (más rápido para gráficas)
-        self.send_interval = 3
+        # Configuración de API: caminata y corazón cada 3 s (device_state.py)
+        # Un solo hilo de envío por proceso, compartido entre dispositivos
+        self.uploader = get_shared_worker()
+        self.api = ApiReporter(self.uploader, "http://127.0.0.1:8000")
         self.session_start_time = None
-        self.pasos_anteriores = 0
 
         # Estado del sistema
         self.running = True
         self.finger_last_state = False
         self.finger_state_changed_time = 0
 
-        # Hilos separados para lectura y procesamiento
-        self.read_thread = None
+        # Hilo de procesamiento (el de lectura es el de SerialIngest)
         self.process_thread = None
 
         # Mejora: Tiempo de espera reducido para detección rápida
         self.no_finger_timeout = 1.0  # 1 segundo sin dedo = reset
         self.last_finger_time = 0
 
+        # Recuperación tras cortes: secuencia contigua más alta recibida.
+        # Se confirma al ESP32 con "ACK <seq>" y al reconectar se pide
+        # "BACKFILL <seq>" para recibir lo que se perdió entre medias
+        self.sequence = SequenceTracker(self.send_command, '../datos/ultimo_seq.txt')
+        self.backfill_count = 0
+
+        # Último diagnóstico del firmware (latencias por etapa, pérdidas)
+        self.last_diag = None
+        # Última configuración informada por el firmware (CONFIG / SET ...)
+        self.device_config = None
+        self.device_clock_offset = None  # time.time() - timestamp del ESP32
+
     def connect(self):
         """Conectar al puerto serial CON CONFIGURACIÓN OPTIMIZADA"""
         try:
@@ -74,11 +89,16 @@ class CompleteSensorSystem:
             self.ser.reset_input_buffer()
             self.ser.reset_output_buffer()
 
-            # Configuración para lectura no bloqueante
-            self.ser.set_buffer_size(rx_size=128)  # Buffer pequeño
+            # Buffer del driver amplio (solo Windows): las lecturas son en bloque
+            if hasattr(self.ser, 'set_buffer_size'):
+                self.ser.set_buffer_size(rx_size=65536)
 
             time.sleep(1)  # Espera mínima para estabilización
             print(f"✅ Conectado a {self.port}")
+
+            # Pedir lo que se haya perdido desde la última sesión
+            if self.sequence.last_contiguous_seq is not None:
+                self.sequence.request_backfill(time.time())
             print(
                 f"⚡ Configuración: timeout={self.ser.timeout}s, baudrate={self.baudrate}")
             return True
@@ -101,58 +121,30 @@ class CompleteSensorSystem:
         except:
             print("   - No se pudieron listar los puertos")
 
-    def setup_csv(self, filename='../datos/sensores_completos.csv'):
-        """Configurar archivo CSV optimizado"""
+    def setup_session_log(self, directory='../datos/sesiones'):
+        """Abrir el archivo binario de la sesión (se escribe por bloques)"""
         try:
-            # Crear directorio si no existe
-            os.makedirs(os.path.dirname(filename), exist_ok=True)
-
-            self.csv_file = open(filename, 'w', newline='', encoding='utf-8')
-            self.csv_writer = csv.writer(self.csv_file)
-
-            # ENCABEZADOS SIMPLIFICADOS PARA RENDIMIENTO
-            self.csv_writer.writerow([
-                'timestamp', 'spo2', 'ritmo_cardiaco', 'ir_value', 'red_value',
-                'finger_detected', 'acel_total', 'pasos_totales',
-                'max30102_ok', 'mpu6050_ok'
-            ])
-            print(f"💾 Guardando datos en: {filename}")
+            self.session_log = SessionWriter(directory)
+            print(f"💾 Guardando sesión en: {self.session_log.path}")
             return True
         except Exception as e:
-            print(f"❌ Error con CSV: {e}")
+            print(f"❌ Error con el registro de sesión: {e}")
             return False
 
-    def read_from_serial(self):
-        """Hilo dedicado a lectura continua del puerto serial"""
-        print("📡 Iniciando hilo de lectura serial...")
-
-        buffer = ""
-        while self.running:
-            try:
-                if self.ser and self.ser.in_waiting > 0:
-                    # Leer todo lo disponible
-                    raw_data = self.ser.read(self.ser.in_waiting).decode(
-                        'utf-8', errors='ignore')
-                    buffer += raw_data
-
-                    # Procesar líneas completas
-                    while '\n' in buffer:
-                        line, buffer = buffer.split('\n', 1)
-                        line = line.strip()
-
-                        if line and line.startswith('{') and line.endswith('}'):
-                            # Agregar al buffer para procesamiento inmediato
-                            self.data_buffer.append({
-                                'raw': line,
-                                'timestamp': time.time()
-                            })
-
-                # Pequeña pausa para no saturar CPU
-                time.sleep(0.01)
-
-            except Exception as e:
-                print(f"⚠️ Error en lectura serial: {e}")
-                time.sleep(0.1)
+    def handle_device_log(self, text):
+        """Mensaje de depuración del ESP32 (FRAME_LOG o línea de texto)"""
+        self.device_logs.append((time.time(), text))
+        if self.show_device_logs:
+            print(f"📟 {text}")
+
+    def store_waveform(self, batch):
+        """Guardar un lote de forma de onda por canal para graficar"""
+        for name, values in batch['channels'].items():
+            series = self.waveforms.get(name)
+            if series is None:
+                series = deque(maxlen=self.waveform_maxlen)
+                self.waveforms[name] = series
+            series.extend(zip(batch['timestamps'], values))
 
     def process_data(self):
         """Hilo dedicado a procesamiento de datos"""
@@ -160,20 +152,40 @@ class CompleteSensorSystem:
 
         while self.running:
             try:
-                # Procesar todos los datos en el buffer
-                while self.data_buffer:
-                    data_item = self.data_buffer.popleft()
-                    line = data_item['raw']
-
-                    # Parsear JSON rápidamente
-                    try:
-                        sensor_data = json.loads(line)
-                    except json.JSONDecodeError:
-                        continue  # Ignorar datos corruptos
+                # Dormir hasta que la lectura entregue algo: todo lo acumulado
+                # de una vez, ya decodificado
+                for sensor_data, _received in self.samples.get_batch(timeout=0.5):
+                    if 'diag' in sensor_data:
+                        # Diagnóstico: solo para el dashboard, no es una muestra
+                        self.last_diag = sensor_data['diag']
+                        continue
+
+                    if 'config' in sensor_data:
+                        # Respuesta a una orden de configuración
+                        self.device_config = sensor_data['config']
+                        self.display_config()
+                        continue
+
+                    if 'evento' in sensor_data:
+                        # Modo delta: suceso puntual, el estado llega por deltas
+                        self.device_events.append(sensor_data['evento'])
+                        continue
 
                     # PROCESAMIENTO EN TIEMPO REAL
                     current_time = time.time()
 
+                    # Control de secuencia: huecos, ACK y reenvíos
+                    self.sequence.track(sensor_data, current_time)
+
+                    if sensor_data.get('backfill'):
+                        # Dato recuperado: solo al registro, no al dashboard ni a la API
+                        self.backfill_count += 1
+                        self.save_sample(sensor_data)
+                        continue
+
+                    if 'timestamp' in sensor_data:
+                        self.device_clock_offset = current_time - sensor_data['timestamp']
+
                     # 1. NO forzar valores a 0 - dejar que ESP32 controle
                     # Esto permite ver transiciones naturales en gráficas
 
@@ -192,19 +204,64 @@ class CompleteSensorSystem:
                     # 4. Mostrar dashboard
                     self.display_dashboard_realtime(sensor_data)
 
-                    # 5. Guardar en CSV
-                    self.save_to_csv_fast(sensor_data)
+                    # 5. Guardar en el registro de la sesión
+                    self.save_sample(sensor_data)
 
                     # 6. Enviar a API SIEMPRE (controlado por tiempo)
-                    self.send_to_api_if_ready(sensor_data, current_time)
-
-                # Pequeña pausa si no hay datos
-                time.sleep(0.01)
+                    self.api.send_if_ready(sensor_data, current_time)
 
             except Exception as e:
                 print(f"⚠️ Error en procesamiento: {e}")
                 time.sleep(0.1)
 
+    def send_command(self, command):
+        """Enviar una orden de una línea al ESP32"""
+        try:
+            if self.ser and self.ser.is_open:
+                self.ser.write((command + '\n').encode('ascii'))
+        except serial.SerialException as e:
+            print(f"⚠️ Error enviando orden: {e}")
+
+    def request_config(self):
+        self.send_command("CONFIG")
+
+    def set_config(self, key, value):
+        """Cambiar un ajuste en marcha (claves en src/device_config.cpp)"""
+        self.send_command(f"SET {key} {value}")
+
+    def save_config(self):
+        """Guardar en NVS la configuración activa para los próximos arranques"""
+        self.send_command("SAVE")
+
+    def reset_config(self):
+        self.send_command("RESET")
+
+    def set_report_mode(self, mode, deadband_pct=None, keyframe_s=None):
+        """'completo' o 'delta' (solo cambios, eventos y keyframes periódicos)"""
+        if deadband_pct is not None:
+            self.set_config('banda_pct', deadband_pct)
+        if keyframe_s is not None:
+            self.set_config('keyframe_s', keyframe_s)
+        self.set_config('reporte', mode)
+
+    def request_keyframe(self):
+        """Modo delta: instantánea completa para reconstruir el estado"""
+        self.send_command("KEYFRAME")
+
+    def display_config(self):
+        config = self.device_config
+        activo = config.get('activo', {})
+        reporte = config.get('reporte')
+        if reporte == 'delta':
+            reporte += f" (banda {config.get('banda_pct')}%, keyframe {config.get('keyframe_s')}s)"
+        print(f"⚙️ Config ESP32: {config.get('formato')} cada {activo.get('intervalo_ms')}ms"
+              f" (activo: {activo.get('formato')}), lote {config.get('lote')},"
+              f" PPG {config.get('ppg_hz')}Hz/{config.get('ppg_promedio')},"
+              f" LED {config.get('led_ir')}/{config.get('led_rojo')},"
+              f" rango {config.get('rango_na')}nA,"
+              f" reporte {reporte}"
+              f"{' 💾' if config.get('guardado') else ''}")
+
     def display_dashboard_realtime(self, data):
         """Dashboard optimizado para tiempo real"""
         if not data:
@@ -235,8 +292,10 @@ class CompleteSensorSystem:
 
         # Datos MAX30105
         if finger_detected:
+            calidad = data.get('calidad_senal', 0)
+            calidad_icon = "🟢" if calidad >= 70 else ("🟡" if calidad >= 40 else "🔴")
             print(f"📟 MAX30105 - Dedo: 👆 DETECTADO")
-            print(f"   SpO2: {spo2:5.1f}% | Ritmo: {ritmo:3d} bpm")
+            print(f"   SpO2: {spo2:5.1f}% | Ritmo: {ritmo:3d} bpm | Calidad: {calidad_icon} {calidad}")
             print(f"   IR: {ir_value:,} | Rojo: {data.get('red_value', 0):,}")
         else:
             print(f"📟 MAX30105 - Dedo: 👈 NO DETECTADO")
@@ -248,164 +307,86 @@ class CompleteSensorSystem:
         # Datos MPU6050
         moving_icon = "🚀 MOVIÉNDOSE" if is_moving else "💤 QUIETO"
         print(f"📊 MPU6050 - {moving_icon}")
-        print(f"   Aceleración: {acel_total:5.2f} m/s²")
+        print(f"   Aceleración: {acel_total:5.2f} m/s² | Movimiento: {data.get('movimiento_mg', 0)} mg")
         print(f"   Pasos totales: {pasos}")
         print(f"   Temperatura: {data.get('temperatura', 0):4.1f}°C")
 
+        if self.device_events:
+            recientes = list(self.device_events)[-3:]
+            print("🔔 Eventos: " + " | ".join(f"{e['tipo']} {e['valor']}" for e in recientes))
+
         print("-"*60)
+        self.display_diagnostics()
+
         print(f"📈 Datos procesados: {self.data_count}")
         print("="*60)
         print("\nPresiona Ctrl+C para salir")
 
-    def save_to_csv_fast(self, data):
-        """Guardar en CSV optimizado"""
-        if self.csv_writer and data:
-            try:
-                timestamp = datetime.now().isoformat()
-                sensor_status = data.get('sensor_status', {})
-
-                # Solo guardar campos esenciales para velocidad
-                self.csv_writer.writerow([
-                    timestamp,
-                    data.get('spo2', 0),
-                    data.get('ritmo_cardiaco', 0),
-                    data.get('ir_value', 0),
-                    data.get('red_value', 0),
-                    1 if data.get('finger_detected') else 0,
-                    data.get('acel_total', 0),
-                    data.get('pasos_totales', 0),
-                    1 if sensor_status.get('max30102', False) else 0,
-                    1 if sensor_status.get('mpu6050', False) else 0
-                ])
-
-                # Flush cada 10 registros
-                if self.data_count % 10 == 0:
-                    self.csv_file.flush()
-
-            except Exception as e:
-                print(f"⚠️ Error guardando CSV: {e}")
-
-    def send_to_api_if_ready(self, sensor_data, current_time):
-        """Enviar a API si es tiempo (no bloqueante)"""
-        try:
-            # Enviar datos de caminata
-            if current_time - self.last_caminata_send >= self.send_interval:
-                self.send_caminata_background(sensor_data, current_time)
-
-            # Enviar datos de corazón
-            if current_time - self.last_corazon_send >= self.send_interval:
-                self.send_corazon_background(sensor_data, current_time)
-
-        except Exception as e:
-            print(f"⚠️ Error preparando envío API: {e}")
-
-    def send_caminata_background(self, sensor_data, current_time):
-        """Enviar datos de caminata en segundo plano"""
-        def send_thread():
-            try:
-                pasos = sensor_data.get('pasos_totales', 0)
-                pasos_nuevos = pasos - self.pasos_anteriores
-
-                # Enviar SIEMPRE, incluso si pasos_nuevos es 0
-                # Esto mantiene la conexión activa
-
-                km_recorridos = round((max(pasos_nuevos, 0) * 0.08), 4)
-                calorias = round((max(pasos_nuevos, 0) * 0.04), 2)
-
-                data = {
-                    "km_recorridos": str(km_recorridos),
-                    "pasos": max(pasos_nuevos, 0),
-                    "tiempo_actividad": str(int(time.time() - self.session_start_time)),
-                    "velocidad_promedio": "0",
-                    "calorias_quemadas": str(calorias),
-                    "sesion": 1
-                }
-
-                response = requests.post(
-                    self.endpoint_caminata,
-                    json=data,
-                    headers={'Content-Type': 'application/json'},
-                    timeout=2
-                )
-
-                if response.status_code in [200, 201]:
-                    if pasos_nuevos > 0:
-                        print(f"✅ API Caminata: {pasos_nuevos} pasos enviados")
-                    # No mostrar mensaje si es 0 para no saturar consola
-                else:
-                    print(f"⚠️ API Caminata error: {response.status_code}")
-
-                self.pasos_anteriores = pasos
-                self.last_caminata_send = current_time
-
-            except requests.exceptions.ConnectionError:
-                print("⚠️ No hay conexión al servidor")
-            except Exception as e:
-                print(f"⚠️ Error API Caminata: {e}")
+    def display_diagnostics(self):
+        """Resumen del último diagnóstico: etapas más lentas y pérdidas"""
+        diag = self.last_diag
+        if not diag:
+            return
 
-        # Ejecutar en hilo separado
-        thread = threading.Thread(target=send_thread, daemon=True)
-        thread.start()
+        loops = diag.get('vueltas_hz', {})
+        perdidas = diag.get('perdidas', {})
+        energia = diag.get('energia', {})
+        print("⏱️ Vueltas/s: " + " | ".join(f"{k} {v}" for k, v in loops.items()))
+        print(f"   Perdidas: ppg {perdidas.get('ppg', 0)} | accel {perdidas.get('accel', 0)}"
+              f" | planificador {perdidas.get('planificador', 0)} | colas {perdidas.get('colas', 0)}")
+        accel = diag.get('accel')
+        if accel:
+            print(f"   Acelerómetro: {accel.get('hz', 0)} Hz | {accel.get('rafaga', 0)} muestras por vaciado")
+
+        # Las tres etapas con peor p99 en la última ventana
+        etapas = [(name, s) for name, s in diag.get('etapas_us', {}).items() if s[0] > 0]
+        etapas.sort(key=lambda item: item[1][3], reverse=True)
+        for name, (n, lo, media, p99, hi) in etapas[:3]:
+            print(f"   {name:12s} n={n:5d} media {media:6d}µs p99 {p99:6d}µs max {hi:6d}µs")
+
+        print(f"🔋 Energía: {energia.get('estado', '?')} ~{energia.get('corriente_ma', 0):.1f} mA"
+              f" | sueño {energia.get('sueno_pct', 0)}%")
+
+        i2c = diag.get('i2c', {})
+        dispositivos = [f"{name} {d.get('errores', 0)} err/{d.get('timeouts', 0)} t.o."
+                        for name, d in i2c.items() if isinstance(d, dict)]
+        print(f"🔌 I2C: ocupado {i2c.get('ocupado_pct', 0)}% | " + " | ".join(dispositivos))
+
+        memoria = diag.get('memoria')
+        if memoria:
+            psram = (f" | PSRAM {memoria['psram_libre'] // 1024}/{memoria['psram_total'] // 1024} KB"
+                     if memoria.get('psram_total') else "")
+            tardias = f" | ⚠️ {memoria['tardias']} reservas tardías" if memoria.get('tardias') else ""
+            print(f"🧮 Heap: {memoria.get('libre', 0) // 1024} KB libre"
+                  f" (mín. {memoria.get('min_libre', 0) // 1024} KB,"
+                  f" bloque {memoria.get('bloque_max', 0) // 1024} KB){psram}{tardias}")
+        print("-"*60)
 
-    def send_corazon_background(self, sensor_data, current_time):
-        """Enviar datos de corazón en segundo plano - CORREGIDO"""
-        def send_thread():
+    def save_sample(self, data):
+        """Añadir la muestra al registro de la sesión"""
+        if self.session_log and data:
             try:
-                spo2 = sensor_data.get('spo2', 0)
-                ritmo = sensor_data.get('ritmo_cardiaco', 0)
-                finger_detected = sensor_data.get('finger_detected', False)
-
-                # ENVIAR SIEMPRE, incluso si son 0
-                # Esto hará que las gráficas muestren la bajada a 0
-
-                now = datetime.now()
-                data = {
-                    "ritmo_cardiaco": int(ritmo),
-                    "presion": "90",  # Valor fijo para demo
-                    "oxigenacion": str(round(spo2, 2)),
-                    "fecha": now.strftime('%Y-%m-%d'),
-                    "hora": now.strftime('%H%M%S'),
-                    "sesion": 1
-                }
-
-                response = requests.post(
-                    self.endpoint_corazon,
-                    json=data,
-                    headers={'Content-Type': 'application/json'},
-                    timeout=2
-                )
-
-                if response.status_code in [200, 201]:
-                    if ritmo > 0 or spo2 > 0:
-                        print(f"✅ API Corazón: {ritmo} bpm, {spo2:.1f}% SpO2")
-                    else:
-                        # Solo mostrar cada 5 envíos cuando es 0 para no saturar
-                        if int(current_time) % 15 < 3:  # Cada ~15 segundos
-                            print(f"📉 API: Sin dedo (0 bpm, 0% SpO2)")
+                if data.get('backfill') and self.device_clock_offset is not None:
+                    # Dato recuperado: hora real a partir del reloj del ESP32
+                    timestamp = data['timestamp'] + self.device_clock_offset
                 else:
-                    print(f"⚠️ API Corazón error: {response.status_code}")
-
-                self.last_corazon_send = current_time
+                    timestamp = time.time()
+                self.session_log.append(data, timestamp)
 
-            except requests.exceptions.ConnectionError:
-                print("⚠️ No hay conexión al servidor")
             except Exception as e:
-                print(f"⚠️ Error API Corazón: {e}")
-
-        # CORRECCIÓN: Esta línea debe estar DENTRO de la función, no fuera
-        thread = threading.Thread(target=send_thread, daemon=True)
-        thread.start()
+                print(f"⚠️ Error guardando sesión: {e}")
 
     def run(self):
         """Ejecutar sistema optimizado"""
         if not self.connect():
             return
 
-        if not self.setup_csv():
+        if not self.setup_session_log():
             return
 
         # Inicializar tiempo de sesión
         self.session_start_time = time.time()
+        self.api.start(self.session_start_time)
         self.last_finger_time = time.time()
 
         try:
@@ -415,7 +396,8 @@ class CompleteSensorSystem:
             print("📟 MAX30105: Pulso y Oxigenación")
             print("📊 MPU6050:  Pasos y Movimiento")
             print("\n⚡ CONFIGURACIÓN:")
-            print("   • Envío API cada 3 segundos")
+            print(f"   • Envío API cada 3 segundos, por lotes cada "
+                  f"{self.uploader.flush_interval:.0f}s")
             print("   • Dashboard actualizado en tiempo real")
             print("   • Valores 0 también se envían")
             print("\n👆 INSTRUCCIONES:")
@@ -427,13 +409,16 @@ class CompleteSensorSystem:
 
             # Iniciar hilos
             self.running = True
-            self.read_thread = threading.Thread(
-                target=self.read_from_serial, daemon=True)
+            self.ingest = SerialIngest(self.ser, self.samples,
+                                       on_waveform=self.store_waveform,
+                                       on_log=self.handle_device_log,
+                                       on_resync=self.request_keyframe)
             self.process_thread = threading.Thread(
                 target=self.process_data, daemon=True)
 
-            self.read_thread.start()
+            self.ingest.start()
             self.process_thread.start()
+            self.request_config()
 
             # Mantener hilo principal activo
             while self.running:
@@ -459,6 +444,21 @@ class CompleteSensorSystem:
         print("="*60)
         print(f"Datos procesados: {self.data_count}")
         print(f"Pasos totales: {self.total_pasos}")
+        api = self.uploader.stats
+        print(f"API: {api['enviados']} registros en {api['lotes']} envíos"
+              f" | pendientes {self.uploader.pending()} | fallos {api['fallos']}"
+              f" | descartados {api['descartados']}")
+        if self.backfill_count:
+            print(f"Datos recuperados tras cortes: {self.backfill_count}")
+        if self.ingest:
+            decoder = self.ingest.decoder
+            print(f"Serial: {self.ingest.bytes_read} bytes en {self.ingest.reads} lecturas"
+                  f" | tramas {decoder.frames} | CRC {decoder.crc_errors}"
+                  f" | mensajes {self.ingest.log_lines} | descartadas {self.samples.dropped}")
+            rebuilder = self.ingest.rebuilder
+            if rebuilder.deltas or self.device_events:
+                print(f"Modo delta: {rebuilder.deltas} deltas | {len(self.device_events)} eventos recientes"
+                      f" | resincronizaciones {rebuilder.resyncs}")
         if self.max_spo2 > 0:
             print(f"SpO2: {self.min_spo2:.1f}% - {self.max_spo2:.1f}%")
         print("="*60)
@@ -466,7 +466,10 @@ class CompleteSensorSystem:
     def stop(self):
         """Detener el sistema"""
         self.running = False
-        time.sleep(0.5)  # Dar tiempo a los hilos para terminar
+        if self.ingest:
+            self.ingest.stop()  # también despierta al procesado
+        if self.process_thread:
+            self.process_thread.join(1.0)
 
     def cleanup(self):
         """Limpiar recursos"""
@@ -476,9 +479,14 @@ class CompleteSensorSystem:
             self.ser.close()
             print("✅ Puerto serial cerrado")
 
-        if self.csv_file:
-            self.csv_file.close()
-            print("✅ Archivo CSV guardado")
+        if self.session_log:
+            self.session_log.close()
+            print(f"✅ Sesión guardada: {self.session_log.records} registros"
+                  f" en {self.session_log.chunks} bloques")
+
+        # Lo que quede en los lotes, sin esperar indefinidamente al servidor
+        if not self.uploader.flush(timeout=3):
+            print(f"⚠️ API: {self.uploader.pending()} registros sin enviar")
 
         print(f"\n📈 RESUMEN FINAL:")
         print(f"   • Datos procesados: {self.data_count}")
@@ -0,0 +1,178 @@
+# serial_ingest.py - Lectura del puerto serial y reparto de muestras sin esperas activas
+"""
+Entrada del host: un hilo lee el puerto en bloque (espera bloqueante al
+primer byte y luego todo lo disponible) directamente al buffer del
+FrameDecoder, decodifica en el sitio y reparte:
+
+    muestras y diagnósticos -> SampleQueue (la consume el procesado)
+    formas de onda          -> on_waveform(lote)
+    mensajes de depuración  -> on_log(texto)  (FRAME_LOG o líneas sin '{')
+
+En modo delta las muestras llegan ya reconstruidas (SensorStateRebuilder):
+el consumidor no distingue un delta de una instantánea completa.
+
+Los mensajes nunca se intentan interpretar como JSON. Entre hilos no hay
+sleep(): el consumidor duerme en una variable de condición hasta que llega
+algo, así cada salto añade microsegundos y no hasta 10 ms.
+"""
+import json
+import threading
+import time
+from collections import deque
+
+import serial
+
+from frame_protocol import (FrameDecoder, FRAME_DELTA, FRAME_LOG, FRAME_SENSOR,
+                            PAYLOAD_DECODERS, WAVEFORM_DECODERS, SensorStateRebuilder,
+                            decode_log_payload)
+
+# Líneas JSON que no son muestras
+_NON_SAMPLE_KEYS = ('diag', 'config', 'evento')
+
+
+class SampleQueue:
+    """
+    Cola acotada con variable de condición: put() despierta al consumidor y
+    get_batch() devuelve todo lo acumulado de una vez. Llena, descarta lo
+    más antiguo (en tiempo real importa lo último) y lo cuenta.
+    """
+
+    def __init__(self, maxlen=1000):
+        self.items = deque()
+        self.maxlen = maxlen
+        self.cond = threading.Condition()
+        self.dropped = 0
+        self.closed = False
+
+    def put(self, item):
+        with self.cond:
+            if len(self.items) >= self.maxlen:
+                self.items.popleft()
+                self.dropped += 1
+            self.items.append(item)
+            self.cond.notify()
+
+    def get_batch(self, timeout=None):
+        """Esperar (como mucho timeout) y devolver todos los elementos"""
+        with self.cond:
+            if not self.items and not self.closed:
+                self.cond.wait(timeout)
+            batch = list(self.items)
+            self.items.clear()
+            return batch
+
+    def close(self):
+        """Despertar al consumidor para que pueda terminar"""
+        with self.cond:
+            self.closed = True
+            self.cond.notify_all()
+
+    def __len__(self):
+        with self.cond:
+            return len(self.items)
+
+
+class StreamDispatcher:
+    """
+    Reparto de lo que sale del FrameDecoder de un dispositivo: muestras
+    (reconstruidas si van en modo delta) y diagnósticos a samples.put(),
+    formas de onda y mensajes a sus callbacks. No lee: lo usan el hilo de
+    SerialIngest y el bucle del gateway (device_gateway.py), uno por
+    dispositivo. samples solo necesita put((dict, recibido)).
+    """
+
+    def __init__(self, samples, on_waveform=None, on_log=None, decoder=None,
+                 on_resync=None):
+        self.samples = samples
+        self.on_waveform = on_waveform
+        self.on_log = on_log or (lambda text: None)
+        self.decoder = decoder or FrameDecoder()
+        # on_resync(): delta sin base, pedir un keyframe al dispositivo
+        self.rebuilder = SensorStateRebuilder(on_resync)
+
+        self.json_errors = 0
+        self.log_lines = 0
+
+    def dispatch(self, items, received):
+        """Decodificar antes de la siguiente lectura (los payloads son vistas)"""
+        for item in items:
+            kind = item[0]
+            if kind == 'frame':
+                _, frame_type, seq, payload = item
+                if frame_type == FRAME_LOG:
+                    self.log_lines += 1
+                    self.on_log(decode_log_payload(payload, seq))
+                elif frame_type in WAVEFORM_DECODERS:
+                    if self.on_waveform:
+                        self.on_waveform(WAVEFORM_DECODERS[frame_type](payload, seq))
+                elif frame_type == FRAME_SENSOR:
+                    self.samples.put((self.rebuilder.sensor_frame(payload, seq), received))
+                elif frame_type == FRAME_DELTA:
+                    data = self.rebuilder.delta_frame(payload, seq)
+                    if data is not None:
+                        self.samples.put((data, received))
+                elif frame_type in PAYLOAD_DECODERS:
+                    # Trama ya decodificada, sin pasar por JSON
+                    self.samples.put((PAYLOAD_DECODERS[frame_type](payload, seq), received))
+
+            elif kind == 'json':
+                try:
+                    data = json.loads(item[1])
+                except ValueError:
+                    self.json_errors += 1
+                    continue
+                if not isinstance(data, dict):
+                    continue
+                if 'delta' in data:
+                    data = self.rebuilder.json_delta(data['delta'])
+                elif not data.get('backfill') and not any(k in data for k in _NON_SAMPLE_KEYS):
+                    data = self.rebuilder.json_sample(data)
+                if data is not None:
+                    self.samples.put((data, received))
+
+            else:
+                self.log_lines += 1
+                self.on_log(item[1])
+
+
+class SerialIngest(StreamDispatcher):
+    """Hilo de lectura: puerto -> FrameDecoder -> colas y callbacks"""
+
+    def __init__(self, ser, samples, on_waveform=None, on_log=None, decoder=None,
+                 on_resync=None):
+        super().__init__(samples, on_waveform, on_log, decoder, on_resync)
+        self.ser = ser
+        self.running = False
+        self.thread = None
+
+        self.bytes_read = 0
+        self.reads = 0
+
+    def start(self):
+        self.running = True
+        self.thread = threading.Thread(target=self.run, name='serial_ingest', daemon=True)
+        self.thread.start()
+
+    def stop(self, timeout=1.0):
+        self.running = False
+        if self.thread:
+            self.thread.join(timeout)
+        self.samples.close()
+
+    def run(self):
+        print("📡 Iniciando hilo de lectura serial...")
+        while self.running:
+            try:
+                # Bloquea hasta el primer byte (o el timeout del puerto)
+                count = self.decoder.read_from(self.ser)
+                if count == 0:
+                    continue
+                self.bytes_read += count
+                self.reads += 1
+                self.dispatch(self.decoder.parse(), time.time())
+
+            except serial.SerialException as e:
+                print(f"⚠️ Error en lectura serial: {e}")
+                time.sleep(0.5)  # puerto perdido: no girar en vacío
+            except Exception as e:
+                print(f"⚠️ Error en lectura serial: {e}")
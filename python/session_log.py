@@ -0,0 +1,423 @@
+# session_log.py - Registro binario de sesiones (registros fijos, solo añadir)
+"""
+Un archivo por sesión en ../datos/sesiones/ en lugar de una fila de CSV por
+muestra:
+
+    AAAAMMDD_HHMMSS.wlog   cabecera de 64 bytes + registros de 64 bytes
+    AAAAMMDD_HHMMSS.widx   una entrada por bloque escrito:
+                           (primer registro, cuántos, hora mínima, hora máxima)
+
+Escritura: las muestras se empaquetan en memoria y se escriben por bloques
+(CHUNK_RECORDS o FLUSH_INTERVAL segundos, lo que llegue antes) con una sola
+llamada; después se añade la entrada del índice. Ambos archivos solo
+crecen: si el proceso muere, lo ya escrito sigue valiendo y un registro a
+medias al final se ignora.
+
+Lectura: el archivo se proyecta en memoria (numpy.memmap si numpy está
+instalado, si no mmap + struct) y el índice dice qué bloques cubren un
+intervalo, así que abrir una sesión de horas o saltar a un tramo no lee ni
+interpreta el resto. Las horas no tienen por qué ser crecientes (los datos
+recuperados tras un corte llegan con su hora original): el índice guarda
+mínimo y máximo por bloque y dentro del bloque se filtra.
+
+Uso desde consola:
+    python session_log.py list
+    python session_log.py export <sesion.wlog> <salida.csv>
+"""
+import csv
+import glob
+import mmap
+import os
+import struct
+import sys
+import time
+from datetime import datetime
+
+SESSION_DIR = '../datos/sesiones'
+MAGIC = b'WLOG'
+VERSION = 1
+
+HEADER = struct.Struct('<4sHHdI')  # magic, versión, tamaño de registro, inicio, reservado
+HEADER_SIZE = 64
+
+# Campos del registro en orden; el formato struct y el dtype de numpy salen
+# de la misma tabla para que no se desalineen
+FIELDS = (
+    ('t', 'd'),                # hora del host (epoch, s); recuperados: reconstruida
+    ('device_ms', 'I'),        # reloj del ESP32
+    ('seq', 'I'),              # secuencia de muestra, NO_SEQ si no la hay
+    ('spo2', 'f'),
+    ('ritmo_cardiaco', 'H'),
+    ('ir_value', 'I'),
+    ('red_value', 'I'),
+    ('acel_x', 'f'),
+    ('acel_y', 'f'),
+    ('acel_z', 'f'),
+    ('acel_total', 'f'),
+    ('temperatura', 'f'),
+    ('pasos_totales', 'I'),
+    ('rr_ms', 'H'),
+    ('rmssd_ms', 'H'),
+    ('sdnn_ms', 'H'),
+    ('cadencia', 'B'),
+    ('regularidad_zancada', 'B'),
+    ('flags', 'B'),
+    ('calidad_senal', 'B'),
+)
+RECORD = struct.Struct('<' + ''.join(code for _, code in FIELDS))
+FIELD_NAMES = tuple(name for name, _ in FIELDS)
+
+INDEX_ENTRY = struct.Struct('<QIdd')  # primer registro, cuántos, t mínimo, t máximo
+
+NO_SEQ = 0xFFFFFFFF
+
+FLAG_FINGER = 0x01
+FLAG_MOVING = 0x02
+FLAG_MAX_ONLINE = 0x04
+FLAG_MPU_ONLINE = 0x08
+FLAG_BACKFILL = 0x10
+
+CHUNK_RECORDS = 256
+FLUSH_INTERVAL = 2.0  # segundos: lo máximo que se pierde si se va la luz
+
+# Columnas del CSV de siempre (export y herramientas que aún lo leen)
+CSV_COLUMNS = ('timestamp', 'spo2', 'ritmo_cardiaco', 'ir_value', 'red_value',
+               'finger_detected', 'acel_x', 'acel_y', 'acel_z', 'acel_total',
+               'pasos_totales', 'max30102_ok', 'mpu6050_ok')
+
+
+def _clamp(value, maximum):
+    return max(0, min(int(value or 0), maximum))
+
+
+def pack_sample(data, timestamp):
+    """Dict de muestra (JSON o trama) -> registro binario"""
+    sensor_status = data.get('sensor_status', {})
+    flags = 0
+    if data.get('finger_detected'):
+        flags |= FLAG_FINGER
+    if data.get('is_moving'):
+        flags |= FLAG_MOVING
+    if sensor_status.get('max30102', False):
+        flags |= FLAG_MAX_ONLINE
+    if sensor_status.get('mpu6050', False):
+        flags |= FLAG_MPU_ONLINE
+    if data.get('backfill'):
+        flags |= FLAG_BACKFILL
+
+    seq = data.get('seq')
+    return RECORD.pack(
+        timestamp,
+        _clamp(data.get('timestamp', 0) * 1000.0, 0xFFFFFFFF),
+        NO_SEQ if seq is None else _clamp(seq, 0xFFFFFFFF),
+        float(data.get('spo2', 0) or 0),
+        _clamp(data.get('ritmo_cardiaco', 0), 0xFFFF),
+        _clamp(data.get('ir_value', 0), 0xFFFFFFFF),
+        _clamp(data.get('red_value', 0), 0xFFFFFFFF),
+        float(data.get('acel_x', 0) or 0),
+        float(data.get('acel_y', 0) or 0),
+        float(data.get('acel_z', 0) or 0),
+        float(data.get('acel_total', 0) or 0),
+        float(data.get('temperatura', 0) or 0),
+        _clamp(data.get('pasos_totales', 0), 0xFFFFFFFF),
+        _clamp(data.get('rr_ms', 0), 0xFFFF),
+        _clamp(data.get('rmssd_ms', 0), 0xFFFF),
+        _clamp(data.get('sdnn_ms', 0), 0xFFFF),
+        _clamp(data.get('cadencia', 0), 0xFF),
+        _clamp(data.get('regularidad_zancada', 0), 0xFF),
+        flags,
+        _clamp(data.get('calidad_senal', 0), 100),
+    )
+
+
+# ===========================
+# ESCRITURA
+# ===========================
+class SessionWriter:
+    """Añade muestras a la sesión actual por bloques"""
+
+    def __init__(self, directory=SESSION_DIR, chunk_records=CHUNK_RECORDS,
+                 flush_interval=FLUSH_INTERVAL, start_time=None):
+        self.start_time = start_time or time.time()
+        self.chunk_records = chunk_records
+        self.flush_interval = flush_interval
+
+        os.makedirs(directory, exist_ok=True)
+        name = datetime.fromtimestamp(self.start_time).strftime('%Y%m%d_%H%M%S')
+        self.path = os.path.join(directory, name + '.wlog')
+        self.index_path = os.path.join(directory, name + '.widx')
+
+        self.data_file = open(self.path, 'wb')
+        self.index_file = open(self.index_path, 'wb')
+        header = HEADER.pack(MAGIC, VERSION, RECORD.size, self.start_time, 0)
+        self.data_file.write(header.ljust(HEADER_SIZE, b'\0'))
+        self.data_file.flush()
+
+        self.buffer = bytearray()
+        self.buffered = 0
+        self.buffer_min = None
+        self.buffer_max = None
+        self.last_flush = time.time()
+
+        self.records = 0  # ya en disco
+        self.chunks = 0
+
+    def append(self, data, timestamp):
+        """Empaquetar una muestra; escribe el bloque cuando toca"""
+        self.buffer += pack_sample(data, timestamp)
+        self.buffered += 1
+        if self.buffer_min is None or timestamp < self.buffer_min:
+            self.buffer_min = timestamp
+        if self.buffer_max is None or timestamp > self.buffer_max:
+            self.buffer_max = timestamp
+
+        if (self.buffered >= self.chunk_records or
+                time.time() - self.last_flush >= self.flush_interval):
+            self.flush()
+
+    def flush(self):
+        """Escribir el bloque pendiente y su entrada del índice"""
+        self.last_flush = time.time()
+        if not self.buffered:
+            return
+
+        # Datos antes que índice: una entrada nunca apunta a bytes sin escribir
+        self.data_file.write(self.buffer)
+        self.data_file.flush()
+        self.index_file.write(INDEX_ENTRY.pack(self.records, self.buffered,
+                                               self.buffer_min, self.buffer_max))
+        self.index_file.flush()
+
+        self.records += self.buffered
+        self.chunks += 1
+        self.buffer.clear()
+        self.buffered = 0
+        self.buffer_min = None
+        self.buffer_max = None
+
+    def close(self):
+        self.flush()
+        self.data_file.close()
+        self.index_file.close()
+
+
+# ===========================
+# LECTURA
+# ===========================
+def _numpy_dtype(np):
+    return np.dtype([(name, '<' + code) for name, code in FIELDS])
+
+
+class SessionReader:
+    """Sesión proyectada en memoria; range() solo toca los bloques del intervalo"""
+
+    def __init__(self, path):
+        self.path = path
+        with open(path, 'rb') as f:
+            header = f.read(HEADER_SIZE)
+        if len(header) < HEADER.size:
+            raise ValueError(f"{path}: cabecera incompleta")
+        magic, version, record_size, self.start_time, _ = HEADER.unpack_from(header)
+        if magic != MAGIC or version != VERSION or record_size != RECORD.size:
+            raise ValueError(f"{path}: formato no reconocido")
+
+        # Un registro a medias al final (corte durante la escritura) no cuenta
+        self.count = max(0, (os.path.getsize(path) - HEADER_SIZE) // RECORD.size)
+        self.chunks = self._load_index(os.path.splitext(path)[0] + '.widx')
+
+        self._file = None
+        self._map = None
+        self.records = None
+        self._open_map()
+
+    def _load_index(self, index_path):
+        chunks = []
+        try:
+            with open(index_path, 'rb') as f:
+                raw = f.read()
+        except OSError:
+            raw = b''
+
+        for offset in range(0, len(raw) - INDEX_ENTRY.size + 1, INDEX_ENTRY.size):
+            first, count, t_min, t_max = INDEX_ENTRY.unpack_from(raw, offset)
+            if first + count > self.count:
+                break
+            chunks.append((first, count, t_min, t_max))
+        return chunks
+
+    def _open_map(self):
+        if self.count == 0:
+            return
+        try:
+            import numpy as np
+            self.records = np.memmap(self.path, dtype=_numpy_dtype(np), mode='r',
+                                     offset=HEADER_SIZE, shape=(self.count,))
+        except ImportError:
+            self._file = open(self.path, 'rb')
+            self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+
+        # Registros escritos tras la última entrada del índice (índice por
+        # detrás de los datos tras un corte): un bloque más, medido ahora
+        indexed = sum(count for _, count, _, _ in self.chunks)
+        if indexed < self.count:
+            times = [self._time(i) for i in range(indexed, self.count)]
+            self.chunks.append((indexed, self.count - indexed, min(times), max(times)))
+
+    def _time(self, i):
+        if self.records is not None:
+            return float(self.records['t'][i])
+        return struct.unpack_from('<d', self._map, HEADER_SIZE + i * RECORD.size)[0]
+
+    @property
+    def end_time(self):
+        return max((t_max for _, _, _, t_max in self.chunks), default=self.start_time)
+
+    def _blocks(self, t0, t1):
+        """Bloques cuyo [mínimo, máximo] se solapa con [t0, t1]"""
+        for first, count, t_min, t_max in self.chunks:
+            if (t1 is None or t_min <= t1) and (t0 is None or t_max >= t0):
+                yield first, count
+
+    def range(self, t0=None, t1=None):
+        """
+        Registros con t0 <= t <= t1 (epoch, s; None = sin límite).
+        Con numpy: array estructurado; sin numpy: lista de tuplas en el
+        orden de FIELD_NAMES.
+        """
+        if self.count == 0:
+            return [] if self.records is None else self.records[:0]
+
+        if self.records is not None:
+            import numpy as np
+            parts = []
+            for first, count in self._blocks(t0, t1):
+                block = self.records[first:first + count]
+                mask = np.ones(count, dtype=bool)
+                if t0 is not None:
+                    mask &= block['t'] >= t0
+                if t1 is not None:
+                    mask &= block['t'] <= t1
+                parts.append(block[mask])
+            return np.concatenate(parts) if parts else self.records[:0]
+
+        rows = []
+        for first, count in self._blocks(t0, t1):
+            for values in RECORD.iter_unpack(self._map[HEADER_SIZE + first * RECORD.size:
+                                                       HEADER_SIZE + (first + count) * RECORD.size]):
+                t = values[0]
+                if (t0 is None or t >= t0) and (t1 is None or t <= t1):
+                    rows.append(values)
+        return rows
+
+    def columns(self, first=0, last=None, names=FIELD_NAMES):
+        """
+        Registros [first, last) por columnas: {nombre: secuencia}. Para
+        seguir una sesión que crece: se piden solo los nuevos por posición.
+        """
+        last = self.count if last is None else min(last, self.count)
+        if first >= last:
+            return {name: [] for name in names}
+
+        if self.records is not None:
+            block = self.records[first:last]
+            return {name: block[name] for name in names}
+
+        rows = RECORD.iter_unpack(self._map[HEADER_SIZE + first * RECORD.size:
+                                            HEADER_SIZE + last * RECORD.size])
+        by_field = dict(zip(FIELD_NAMES, zip(*rows)))
+        return {name: by_field[name] for name in names}
+
+    def to_dataframe(self, t0=None, t1=None):
+        """Tramo de la sesión como DataFrame con las columnas del CSV y más"""
+        import pandas as pd
+        df = pd.DataFrame.from_records(self.range(t0, t1), columns=FIELD_NAMES)
+
+        # Hora local como en el CSV (desfase del inicio de la sesión)
+        utc_offset = (datetime.fromtimestamp(self.start_time) -
+                      datetime.utcfromtimestamp(self.start_time))
+        df.insert(0, 'timestamp', pd.to_datetime(df.pop('t'), unit='s') + utc_offset)
+
+        flags = df.pop('flags').astype(int)
+        df['finger_detected'] = (flags & FLAG_FINGER) != 0
+        df['is_moving'] = (flags & FLAG_MOVING) != 0
+        df['max30102_ok'] = (flags & FLAG_MAX_ONLINE) != 0
+        df['mpu6050_ok'] = (flags & FLAG_MPU_ONLINE) != 0
+        df['backfill'] = (flags & FLAG_BACKFILL) != 0
+        return df
+
+    def close(self):
+        if self._map is not None:
+            self._map.close()
+            self._file.close()
+        self.records = None
+        self._map = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+def list_sessions(directory=SESSION_DIR):
+    """Sesiones del directorio, de la más antigua a la más reciente"""
+    sessions = []
+    for path in sorted(glob.glob(os.path.join(directory, '*.wlog'))):
+        try:
+            with SessionReader(path) as reader:
+                sessions.append({
+                    'path': path,
+                    'inicio': reader.start_time,
+                    'fin': reader.end_time,
+                    'registros': reader.count,
+                    'bloques': len(reader.chunks),
+                })
+        except (OSError, ValueError) as e:
+            print(f"⚠️ {path}: {e}")
+    return sessions
+
+
+def latest_session(directory=SESSION_DIR):
+    sessions = list_sessions(directory)
+    return sessions[-1]['path'] if sessions else None
+
+
+def export_csv(path, csv_path, t0=None, t1=None):
+    """Sesión -> CSV con las columnas de siempre (para herramientas externas)"""
+    index = {name: i for i, name in enumerate(FIELD_NAMES)}
+    with SessionReader(path) as reader, open(csv_path, 'w', newline='', encoding='utf-8') as f:
+        writer = csv.writer(f)
+        writer.writerow(CSV_COLUMNS)
+        rows = 0
+        for record in reader.range(t0, t1):
+            values = tuple(record)
+            flags = values[index['flags']]
+            writer.writerow([
+                datetime.fromtimestamp(values[index['t']]).isoformat(),
+                round(float(values[index['spo2']]), 1),
+                values[index['ritmo_cardiaco']],
+                values[index['ir_value']],
+                values[index['red_value']],
+                1 if flags & FLAG_FINGER else 0,
+                round(float(values[index['acel_x']]), 2),
+                round(float(values[index['acel_y']]), 2),
+                round(float(values[index['acel_z']]), 2),
+                round(float(values[index['acel_total']]), 2),
+                values[index['pasos_totales']],
+                1 if flags & FLAG_MAX_ONLINE else 0,
+                1 if flags & FLAG_MPU_ONLINE else 0,
+            ])
+            rows += 1
+    return rows
+
+
+if __name__ == "__main__":
+    if len(sys.argv) >= 2 and sys.argv[1] == 'list':
+        for s in list_sessions(sys.argv[2] if len(sys.argv) > 2 else SESSION_DIR):
+            duration = (s['fin'] - s['inicio']) / 60.0
+            print(f"📁 {s['path']}: {s['registros']} registros, {s['bloques']} bloques,"
+                  f" {duration:.1f} min")
+    elif len(sys.argv) == 4 and sys.argv[1] == 'export':
+        print(f"💾 {export_csv(sys.argv[2], sys.argv[3])} filas en {sys.argv[3]}")
+    else:
+        print(__doc__)
@@ -0,0 +1,264 @@
+# stream_analysis.py - Análisis incremental de sesiones largas
+"""
+En lugar de cargar la sesión entera en pandas y recalcular todo en cada
+vista, cada bloque nuevo de registros actualiza:
+
+- RunningStats: media y desviación (Welford), mínimo y máximo.
+- P2Quantile: percentiles con el algoritmo P² (Jain y Chlamtac), cinco
+  marcadores por percentil, sin guardar las muestras.
+- LttbDownsampler: serie reducida para graficar (Largest Triangle Three
+  Buckets en flujo): como mucho max_points puntos elegidos por área, y
+  cuando se llena se compacta a la mitad y los cubos pasan a ser el doble
+  de anchos, así que el coste por muestra nueva es constante.
+
+SessionAnalyzer junta todo y sabe seguir un .wlog que sigue creciendo:
+poll() lee solo los registros nuevos (por posición) y la gráfica en vivo
+solo cambia los datos de las líneas.
+"""
+import math
+
+from session_log import FLAG_FINGER, SessionReader
+
+# Percentiles que se siguen por variable
+QUANTILES = (0.05, 0.5, 0.95)
+
+# Variable -> (columna del registro, ¿necesita dedo?), en el orden de la vista
+TRACKED = (
+    ('spo2', 'spo2', True),
+    ('ritmo', 'ritmo_cardiaco', True),
+    ('cadencia', 'cadencia', False),
+)
+PLOTTED = ('spo2', 'ritmo_cardiaco', 'cadencia', 'acel_total')
+
+
+class RunningStats:
+    """Media, varianza (Welford), mínimo y máximo en una pasada"""
+
+    def __init__(self):
+        self.count = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+        self.min = math.inf
+        self.max = -math.inf
+
+    def add(self, value):
+        self.count += 1
+        delta = value - self.mean
+        self.mean += delta / self.count
+        self.m2 += delta * (value - self.mean)
+        if value < self.min:
+            self.min = value
+        if value > self.max:
+            self.max = value
+
+    @property
+    def std(self):
+        return math.sqrt(self.m2 / (self.count - 1)) if self.count > 1 else 0.0
+
+
+class P2Quantile:
+    """Percentil p estimado con cinco marcadores (P²), memoria constante"""
+
+    def __init__(self, p):
+        self.p = p
+        self.heights = []                    # alturas de los marcadores
+        self.positions = [1, 2, 3, 4, 5]     # posiciones reales
+        self.desired = [1, 1 + 2 * p, 1 + 4 * p, 3 + 2 * p, 5]
+        self.increments = [0, p / 2, p, (1 + p) / 2, 1]
+
+    def add(self, value):
+        q = self.heights
+        if len(q) < 5:
+            q.append(value)
+            q.sort()
+            return
+
+        # Celda del valor; los extremos se estiran si hace falta
+        if value < q[0]:
+            q[0] = value
+            k = 0
+        elif value >= q[4]:
+            q[4] = value
+            k = 3
+        else:
+            k = 0
+            while value >= q[k + 1]:
+                k += 1
+
+        n = self.positions
+        for i in range(k + 1, 5):
+            n[i] += 1
+        for i in range(5):
+            self.desired[i] += self.increments[i]
+
+        # Ajustar los tres marcadores centrales (parabólica, si no lineal)
+        for i in range(1, 4):
+            d = self.desired[i] - n[i]
+            if (d >= 1 and n[i + 1] - n[i] > 1) or (d <= -1 and n[i - 1] - n[i] < -1):
+                step = 1 if d > 0 else -1
+                candidate = self._parabolic(i, step)
+                if not q[i - 1] < candidate < q[i + 1]:
+                    candidate = q[i] + step * (q[i + step] - q[i]) / (n[i + step] - n[i])
+                q[i] = candidate
+                n[i] += step
+
+    def _parabolic(self, i, step):
+        q, n = self.heights, self.positions
+        return q[i] + step / (n[i + 1] - n[i - 1]) * (
+            (n[i] - n[i - 1] + step) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+            (n[i + 1] - n[i] - step) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]))
+
+    @property
+    def value(self):
+        q = self.heights
+        if not q:
+            return 0.0
+        if len(q) < 5:
+            # Pocas muestras: percentil exacto de lo que hay
+            return q[min(len(q) - 1, int(round(self.p * (len(q) - 1))))]
+        return q[2]
+
+
+def lttb(points, threshold):
+    """LTTB clásico sobre una lista de (x, y); conserva el primero y el último"""
+    if threshold >= len(points) or threshold < 3:
+        return list(points)
+
+    selected = [points[0]]
+    bucket = (len(points) - 2) / (threshold - 2)
+    a = points[0]
+    for i in range(threshold - 2):
+        start = int(i * bucket) + 1
+        end = int((i + 1) * bucket) + 1
+        next_end = min(int((i + 2) * bucket) + 1, len(points))
+        following = points[end:next_end] or [points[-1]]
+        cx = sum(p[0] for p in following) / len(following)
+        cy = sum(p[1] for p in following) / len(following)
+
+        best, best_area = points[start], -1.0
+        for p in points[start:end]:
+            area = abs((a[0] - cx) * (p[1] - a[1]) - (a[0] - p[0]) * (cy - a[1]))
+            if area > best_area:
+                best, best_area = p, area
+        selected.append(best)
+        a = best
+    selected.append(points[-1])
+    return selected
+
+
+class LttbDownsampler:
+    """
+    LTTB en flujo: el cubo en curso se decide cuando el siguiente está
+    completo (el tercer vértice es su media), un cubo de retraso.
+    """
+
+    def __init__(self, max_points=1000):
+        self.max_points = max_points
+        self.bucket_size = 1
+        self.points = []     # ya elegidos
+        self.current = []    # cubo pendiente de elegir
+        self.following = []  # cubo que se está llenando
+
+    def add(self, x, y):
+        if not self.points:
+            self.points.append((x, y))
+            return
+
+        self.following.append((x, y))
+        if len(self.following) < self.bucket_size:
+            return
+
+        if self.current:
+            self.points.append(self._select())
+            if len(self.points) >= self.max_points:
+                # Cubos el doble de anchos: se reduce solo lo ya elegido
+                self.points = lttb(self.points, self.max_points // 2)
+                self.bucket_size *= 2
+        self.current = self.following
+        self.following = []
+
+    def _select(self):
+        a = self.points[-1]
+        cx = sum(p[0] for p in self.following) / len(self.following)
+        cy = sum(p[1] for p in self.following) / len(self.following)
+        return max(self.current, key=lambda p: abs(
+            (a[0] - cx) * (p[1] - a[1]) - (a[0] - p[0]) * (cy - a[1])))
+
+    def series(self):
+        """Serie para graficar: lo elegido más el tramo sin decidir"""
+        tail = self.current + self.following
+        if len(tail) > 2:
+            tail = [max(tail, key=lambda p: abs(p[1] - self.points[-1][1])), tail[-1]]
+            tail.sort()
+        points = self.points + tail
+        return [p[0] for p in points], [p[1] for p in points]
+
+
+class SessionAnalyzer:
+    """Estadísticas y series reducidas de una sesión, bloque a bloque"""
+
+    def __init__(self, path, max_points=1000):
+        self.path = path
+        self.start_time = None
+        self.records = 0  # posición del siguiente registro por leer
+
+        self.stats = {name: RunningStats() for name, _, _ in TRACKED}
+        self.quantiles = {name: [P2Quantile(p) for p in QUANTILES] for name, _, _ in TRACKED}
+        self.series = {column: LttbDownsampler(max_points) for column in PLOTTED}
+
+    def poll(self):
+        """Procesar los registros añadidos desde la última llamada; cuántos"""
+        with SessionReader(self.path) as session:
+            if self.start_time is None:
+                self.start_time = session.start_time
+            names = ('t', 'flags') + tuple(set(PLOTTED) | {c for _, c, _ in TRACKED})
+            columns = session.columns(self.records, names=names)
+            new = len(columns['t'])
+            if new:
+                self.update(columns)
+            self.records += new
+            return new
+
+    def update(self, columns):
+        tracked = [(self.stats[name], self.quantiles[name], columns[column], finger)
+                   for name, column, finger in TRACKED]
+        plotted = [(self.series[column], columns[column]) for column in PLOTTED]
+        times, flags = columns['t'], columns['flags']
+
+        for i in range(len(times)):
+            finger = int(flags[i]) & FLAG_FINGER
+            for stats, quantiles, values, needs_finger in tracked:
+                value = float(values[i])
+                # 0 = sin medida: no entra en las estadísticas
+                if value > 0 and (finger or not needs_finger):
+                    stats.add(value)
+                    for quantile in quantiles:
+                        quantile.add(value)
+
+            minutes = (float(times[i]) - self.start_time) / 60.0
+            for series, values in plotted:
+                series.add(minutes, float(values[i]))
+
+    def summary(self):
+        """{variable: {n, media, desv, min, max, p5, p50, p95}}"""
+        result = {}
+        for name, _, _ in TRACKED:
+            stats = self.stats[name]
+            entry = {
+                'n': stats.count,
+                'media': stats.mean,
+                'desv': stats.std,
+                'min': stats.min if stats.count else 0.0,
+                'max': stats.max if stats.count else 0.0,
+            }
+            for quantile in self.quantiles[name]:
+                entry[f"p{int(quantile.p * 100)}"] = quantile.value
+            result[name] = entry
+        return result
+
+    def print_summary(self):
+        print(f"Resumen de datos ({self.records} registros):")
+        for name, entry in self.summary().items():
+            print(f"  {name:<9} n={entry['n']:<7} media={entry['media']:7.1f}"
+                  f" desv={entry['desv']:6.1f} min={entry['min']:6.1f} max={entry['max']:6.1f}"
+                  f" p5={entry['p5']:6.1f} p50={entry['p50']:6.1f} p95={entry['p95']:6.1f}")
@@ -0,0 +1,259 @@
+# upload_worker.py - Envío a la API por lotes con conexiones reutilizadas
+"""
+Un único hilo de envío para todo el proceso en lugar de un hilo y una
+conexión nueva por cada POST.
+
+- requests.Session con pool de conexiones: TCP (y TLS) se negocia una vez
+  por host y se reutiliza en todos los envíos.
+- Cola acotada: submit() no bloquea más de put_timeout; si la cola sigue
+  llena el registro se descarta y se cuenta (el lector serial nunca se
+  queda esperando a la red).
+- Los registros se agrupan por endpoint y se envían como una lista JSON
+  cuando hay batch_size o ha pasado flush_interval desde el primero.
+- Si el servidor no acepta listas (400/405/415 al primer lote) ese
+  endpoint pasa a registro a registro, sobre la misma conexión.
+- Errores de red o 5xx: el lote se conserva y se reintenta con espera
+  exponencial (con algo de azar) hasta max_backoff; lo pendiente por
+  endpoint está acotado a max_pending, descartando lo más antiguo.
+"""
+import queue
+import random
+import threading
+import time
+from collections import deque
+
+import requests
+from requests.adapters import HTTPAdapter
+
+DEFAULT_TIMEOUT = 5  # segundos por petición
+BULK_REJECTED = (400, 405, 415)
+
+
+def make_session(pool_size=4, user_agent='SensorReader/1.0'):
+    """Sesión HTTP con pool de conexiones y sin reintentos propios de urllib3"""
+    session = requests.Session()
+    adapter = HTTPAdapter(pool_connections=pool_size, pool_maxsize=pool_size, max_retries=0)
+    session.mount('http://', adapter)
+    session.mount('https://', adapter)
+    session.headers.update({
+        'Content-Type': 'application/json',
+        'User-Agent': user_agent,
+    })
+    return session
+
+
+class _EndpointBatch:
+    """Registros pendientes de un endpoint y su estado de reintentos"""
+
+    def __init__(self, max_pending):
+        self.records = deque(maxlen=max_pending)
+        self.first_time = None
+        self.failures = 0
+        self.retry_at = 0.0
+        self.bulk = True  # hasta que el servidor diga lo contrario
+
+
+class UploadWorker:
+    """Hilo único que agrupa y envía registros a uno o varios endpoints"""
+
+    def __init__(self, batch_size=50, flush_interval=5.0, queue_size=1000,
+                 max_pending=5000, put_timeout=0.05, base_backoff=1.0,
+                 max_backoff=60.0, timeout=DEFAULT_TIMEOUT, session=None):
+        self.batch_size = batch_size
+        self.flush_interval = flush_interval
+        self.max_pending = max_pending
+        self.put_timeout = put_timeout
+        self.base_backoff = base_backoff
+        self.max_backoff = max_backoff
+        self.timeout = timeout
+        self.session = session or make_session()
+
+        self.queue = queue.Queue(maxsize=queue_size)
+        self.batches = {}
+        self.thread = None
+        self.running = False
+        self.flush_requested = threading.Event()
+        self.idle = threading.Event()
+        self.idle.set()
+        self.lock = threading.Lock()
+
+        # Estadísticas (solo las escribe el hilo de envío, salvo dropped)
+        self.stats = {
+            'enviados': 0,       # registros aceptados por el servidor
+            'lotes': 0,          # peticiones HTTP con éxito
+            'fallos': 0,         # peticiones fallidas (se reintentan)
+            'descartados': 0,    # cola llena o pendientes desbordados
+            'rechazados': 0,     # 4xx: el servidor no los quiere
+        }
+
+    # ===========================
+    # API PARA LOS PRODUCTORES
+    # ===========================
+    def start(self):
+        """Arrancar el hilo de envío (idempotente)"""
+        with self.lock:
+            if self.thread and self.thread.is_alive():
+                return
+            self.running = True
+            self.thread = threading.Thread(target=self._run, name='upload_worker', daemon=True)
+            self.thread.start()
+
+    def submit(self, endpoint, record):
+        """
+        Encolar un registro para endpoint. Devuelve False si la cola está
+        llena (contrapresión: el productor decide si reduce el ritmo).
+        """
+        try:
+            self.queue.put((endpoint, record), timeout=self.put_timeout)
+            self.idle.clear()
+            return True
+        except queue.Full:
+            with self.lock:
+                self.stats['descartados'] += 1
+            return False
+
+    def flush(self, timeout=5.0):
+        """
+        Enviar ya lo pendiente y esperar (como mucho timeout) a que se vacíe.
+        True si no queda nada; sin servidor vuelve antes, con False.
+        """
+        self.flush_requested.set()
+        self.idle.wait(timeout)
+        return self.pending() == 0
+
+    def stop(self, timeout=5.0):
+        """Vaciar lo que se pueda y parar el hilo"""
+        self.flush(timeout)
+        self.running = False
+        if self.thread:
+            self.thread.join(timeout)
+
+    def pending(self):
+        """Registros en cola más los agrupados sin enviar"""
+        return self.queue.qsize() + sum(len(b.records) for b in list(self.batches.values()))
+
+    # ===========================
+    # HILO DE ENVÍO
+    # ===========================
+    def _run(self):
+        while self.running or not self.queue.empty():
+            self._collect(self._next_wait())
+
+            now = time.time()
+            force = self.flush_requested.is_set()
+            for endpoint, batch in self.batches.items():
+                if batch.records and self._due(batch, now, force):
+                    self._send(endpoint, batch)
+
+            if self.pending() == 0:
+                self.flush_requested.clear()
+                self.idle.set()
+            elif force and all(b.failures for b in self.batches.values() if b.records):
+                # Sin servidor no tiene sentido hacer esperar a flush()
+                self.flush_requested.clear()
+                self.idle.set()
+
+    def _next_wait(self):
+        """Cuánto esperar nuevos registros antes de revisar los lotes"""
+        now = time.time()
+        wait = self.flush_interval
+        for batch in self.batches.values():
+            if not batch.records:
+                continue
+            deadline = batch.retry_at if batch.failures else batch.first_time + self.flush_interval
+            wait = min(wait, deadline - now)
+        return max(wait, 0.01)
+
+    def _collect(self, wait):
+        """Pasar de la cola a los lotes por endpoint todo lo disponible"""
+        try:
+            item = self.queue.get(timeout=wait)
+        except queue.Empty:
+            return
+
+        while item is not None:
+            endpoint, record = item
+            batch = self.batches.get(endpoint)
+            if batch is None:
+                batch = self.batches[endpoint] = _EndpointBatch(self.max_pending)
+            if len(batch.records) == batch.records.maxlen:
+                with self.lock:
+                    self.stats['descartados'] += 1  # deque expulsa el más antiguo
+            if not batch.records:
+                batch.first_time = time.time()
+            batch.records.append(record)
+
+            try:
+                item = self.queue.get_nowait()
+            except queue.Empty:
+                item = None
+
+    def _due(self, batch, now, force):
+        if batch.failures:
+            return now >= batch.retry_at
+        return (force or len(batch.records) >= self.batch_size or
+                now - batch.first_time >= self.flush_interval)
+
+    def _send(self, endpoint, batch):
+        """Enviar el lote (o, sin soporte de listas, registro a registro)"""
+        while batch.records:
+            count = min(len(batch.records), self.batch_size) if batch.bulk else 1
+            records = [batch.records[i] for i in range(count)]
+            payload = records if batch.bulk else records[0]
+
+            try:
+                response = self.session.post(endpoint, json=payload, timeout=self.timeout)
+                status = response.status_code
+            except requests.exceptions.RequestException as e:
+                self._schedule_retry(endpoint, batch, f"{type(e).__name__}")
+                return
+
+            if status in (200, 201, 202, 204):
+                for _ in range(count):
+                    batch.records.popleft()
+                batch.failures = 0
+                self.stats['enviados'] += count
+                self.stats['lotes'] += 1
+                continue
+
+            if batch.bulk and status in BULK_REJECTED:
+                print(f"ℹ️ {endpoint} no acepta lotes ({status}): envío por registro")
+                batch.bulk = False
+                continue
+
+            if status >= 500:
+                self._schedule_retry(endpoint, batch, f"HTTP {status}")
+                return
+
+            # 4xx con un registro concreto: reintentar no lo arreglaría
+            print(f"⚠️ API {endpoint}: rechazado ({status}): {response.text[:120]}")
+            for _ in range(count):
+                batch.records.popleft()
+            self.stats['rechazados'] += count
+
+        batch.first_time = None
+
+    def _schedule_retry(self, endpoint, batch, reason):
+        batch.failures += 1
+        self.stats['fallos'] += 1
+        delay = min(self.base_backoff * (2 ** (batch.failures - 1)), self.max_backoff)
+        delay *= random.uniform(0.8, 1.2)
+        batch.retry_at = time.time() + delay
+        if batch.failures == 1 or batch.failures % 10 == 0:
+            print(f"⚠️ API {endpoint}: {reason}, {len(batch.records)} pendientes,"
+                  f" reintento en {delay:.1f}s")
+
+
+# Un único trabajador para todos los lectores del proceso
+_shared_worker = None
+_shared_lock = threading.Lock()
+
+
+def get_shared_worker():
+    """Trabajador compartido, arrancado en la primera llamada"""
+    global _shared_worker
+    with _shared_lock:
+        if _shared_worker is None:
+            _shared_worker = UploadWorker()
+            _shared_worker.start()
+        return _shared_worker
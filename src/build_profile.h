@@ -0,0 +1,72 @@
+// build_profile.h - Perfiles de compilación: qué etapas y tamaños entran en el binario
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ===========================
+// PERFILES (build_flags de platformio.ini)
+// ===========================
+//   esp32dev-debug       todo: consola, LED, JSON completo, perfilador
+//   esp32dev-prod        tramas compactas (FRAME_COMPACT) con latido, pasos
+//                        y calidad; sin consola, LED, formas de onda ni
+//                        perfilador, y además sin SpO2 ni HRV (solo la
+//                        cadena IR), sin AGC de los LED, sin historial ni
+//                        volcado a LittleFS (ni ACK / BACKFILL), sin modo
+//                        delta y sin tramas de diagnóstico
+//   esp32dev-raw-stream  OUTPUT_STREAM con lotes más largos, sin consola
+// Cada perfil solo cambia los valores por defecto: -DOUTPUT_FORMAT,
+// -DENABLE_PROFILING y demás siguen mandando si se ponen a mano.
+#define BUILD_PROFILE_DEBUG 0
+#define BUILD_PROFILE_PROD 1
+#define BUILD_PROFILE_RAW_STREAM 2
+
+#ifndef BUILD_PROFILE
+#define BUILD_PROFILE BUILD_PROFILE_DEBUG
+#endif
+
+#if BUILD_PROFILE == BUILD_PROFILE_PROD
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT OUTPUT_BINARY
+#endif
+#ifndef ENABLE_PROFILING
+#define ENABLE_PROFILING 0
+#endif
+#elif BUILD_PROFILE == BUILD_PROFILE_RAW_STREAM
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT OUTPUT_STREAM
+#endif
+#endif
+
+// Lo que el código consulta con if constexpr / como parámetro de plantilla:
+// una etapa desactivada no deja ni sus cadenas en flash
+struct BuildProfile
+{
+    const char *name;
+    bool consoleMessages;      // banner de arranque y mensajes de depuración
+    bool ledFeedback;          // LED de dedo/latido y de lectura del MPU6050
+    bool fullJson;             // LED, energía y jitter en cada línea JSON
+    bool waveforms;            // OUTPUT_STREAM (lotes y su buffer de trama)
+    uint16_t waveformBatchMax; // capacidad de cada lote, en muestras
+    size_t logQueueSize;       // mensajes en vuelo procesado -> transmisión
+    bool spo2Hrv;              // canal rojo, SpO2 y RR / RMSSD / SDNN publicados
+    bool ledAgc;               // AGC de corriente y rango de los LED
+    bool sampleHistory;        // historial en RAM, volcado a LittleFS, ACK y BACKFILL
+    bool deltaReports;         // "SET reporte delta": deltas, eventos y keyframes
+    bool diagnostics;          // tramas / líneas de diagnóstico periódicas
+    bool fullPayload;          // SensorFramePayload completo; si no, CompactFramePayload
+};
+
+constexpr BuildProfile BUILD_PROFILES[] = {
+    {"debug", true, true, true, true, 32, 16, true, true, true, true, true, true},
+    {"prod", false, false, false, false, 4, 2, false, false, false, false, false, false},
+    {"raw-stream", false, true, true, true, 64, 4, true, true, true, true, true, true},
+};
+
+static_assert(BUILD_PROFILE >= 0 && BUILD_PROFILE < sizeof(BUILD_PROFILES) / sizeof(BUILD_PROFILES[0]),
+              "BUILD_PROFILE desconocido");
+
+constexpr BuildProfile BUILD = BUILD_PROFILES[BUILD_PROFILE];
+
+// Historial y deltas guardan y comparan la instantánea completa
+static_assert(BUILD.fullPayload || (!BUILD.sampleHistory && !BUILD.deltaReports),
+              "historial y modo delta necesitan SensorFramePayload");
@@ -0,0 +1,235 @@
+// delta_reporter.cpp - Campos de SensorFramePayload, bandas muertas y codificación
+#include "delta_reporter.h"
+#include <stddef.h>
+
+// ===========================
+// CAMPOS
+// ===========================
+// Banda muerta en unidades del payload (al 100 %): lo que no merece un
+// envío por sí solo. Los contadores, flags y reconexiones salen con
+// cualquier cambio. decimals: el JSON lleva valor / 10^decimals.
+struct DeltaField
+{
+    uint8_t offset;
+    uint8_t size;
+    bool isSigned;
+    uint16_t deadband;
+    const char *jsonName; // NULL: va como flags / sensor_status
+    uint8_t decimals;
+};
+
+#define DELTA_FIELD(member, isSigned, deadband, jsonName, decimals)                                 \
+    {                                                                                               \
+        offsetof(SensorFramePayload, member), sizeof(((SensorFramePayload *)0)->member), isSigned, \
+            deadband, jsonName, decimals                                                            \
+    }
+
+static const DeltaField DELTA_FIELDS[DeltaReporter::FIELD_COUNT] = {
+    DELTA_FIELD(spo2x10, false, 5, "spo2", 1),            // 0,5 %
+    DELTA_FIELD(heartRate, false, 2, "ritmo_cardiaco", 0),
+    DELTA_FIELD(flags, false, 0, NULL, 0),
+    DELTA_FIELD(irValue, false, 2000, "ir_value", 0),     // más que la AC del pulso
+    DELTA_FIELD(redValue, false, 2000, "red_value", 0),
+    DELTA_FIELD(accelX, true, 20, "acel_x", 2),           // 0,2 m/s²
+    DELTA_FIELD(accelY, true, 20, "acel_y", 2),
+    DELTA_FIELD(accelZ, true, 20, "acel_z", 2),
+    DELTA_FIELD(temperature, true, 20, "temperatura", 2), // 0,2 °C
+    DELTA_FIELD(stepCount, false, 0, "pasos_totales", 0),
+    DELTA_FIELD(maxReconnects, false, 0, NULL, 0),
+    DELTA_FIELD(mpuReconnects, false, 0, NULL, 0),
+    DELTA_FIELD(rrIntervalMs, false, 20, "rr_ms", 0),
+    DELTA_FIELD(rmssdMs, false, 2, "rmssd_ms", 0),
+    DELTA_FIELD(sdnnMs, false, 2, "sdnn_ms", 0),
+    DELTA_FIELD(cadence, false, 2, "cadencia", 0),
+    DELTA_FIELD(strideRegularity, false, 5, "regularidad_zancada", 0),
+    DELTA_FIELD(signalQuality, false, 5, "calidad_senal", 0),
+};
+
+static const uint8_t FIELD_FLAGS = 2;
+static const uint8_t FIELD_MAX_RECONNECTS = 10;
+static const uint8_t FIELD_MPU_RECONNECTS = 11;
+
+static_assert(offsetof(SensorFramePayload, spo2x10) == sizeof(uint32_t) &&
+                  offsetof(SensorFramePayload, signalQuality) + 1 == sizeof(SensorFramePayload),
+              "DELTA_FIELDS debe cubrir SensorFramePayload entero tras timestampMs");
+
+static int64_t readField(const SensorFramePayload &payload, uint8_t index)
+{
+    const DeltaField &field = DELTA_FIELDS[index];
+    const uint8_t *bytes = (const uint8_t *)&payload + field.offset;
+    switch (field.size)
+    {
+    case 1:
+        return field.isSigned ? (int64_t)(int8_t)bytes[0] : (int64_t)bytes[0];
+    case 2:
+    {
+        uint16_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return field.isSigned ? (int64_t)(int16_t)value : (int64_t)value;
+    }
+    default:
+    {
+        uint32_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return field.isSigned ? (int64_t)(int32_t)value : (int64_t)value;
+    }
+    }
+}
+
+static void copyField(SensorFramePayload &to, const SensorFramePayload &from, uint8_t index)
+{
+    const DeltaField &field = DELTA_FIELDS[index];
+    memcpy((uint8_t *)&to + field.offset, (const uint8_t *)&from + field.offset, field.size);
+}
+
+// ===========================
+// DECISIÓN
+// ===========================
+void DeltaReporter::configure(uint16_t keyframeIntervalS, uint8_t deadbandPercent)
+{
+    keyframeIntervalMs = (unsigned long)keyframeIntervalS * 1000UL;
+    this->deadbandPercent = deadbandPercent;
+    keyframeDue = true;
+}
+
+DeltaReporter::Decision DeltaReporter::update(const SensorFramePayload &current, unsigned long now)
+{
+    changedMask = 0;
+    if (keyframeDue || now - lastKeyframe >= keyframeIntervalMs)
+    {
+        reported = current;
+        lastKeyframe = now;
+        keyframeDue = false;
+        keyframeCount++;
+        return DELTA_KEYFRAME;
+    }
+
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+    {
+        int64_t value = readField(current, i);
+        int64_t base = readField(reported, i);
+        int64_t distance = value > base ? value - base : base - value;
+        uint32_t band = (uint32_t)DELTA_FIELDS[i].deadband * deadbandPercent / 100;
+        if (distance > 0 && distance >= band)
+        {
+            changedMask |= 1UL << i;
+            copyField(reported, current, i);
+        }
+    }
+
+    if (changedMask == 0)
+    {
+        skipCount++;
+        return DELTA_SKIP;
+    }
+    reported.timestampMs = current.timestampMs;
+    deltaCount++;
+    return DELTA_CHANGES;
+}
+
+// ===========================
+// CODIFICACIÓN
+// ===========================
+size_t DeltaReporter::encodeDelta(const SampleRecord &record, uint8_t *out, size_t outSize) const
+{
+    DeltaHeader header;
+    header.timestampMs = record.sample.timestampMs;
+    header.sequence = record.sequence;
+    header.fieldMask = changedMask;
+    if (outSize < sizeof(header))
+        return 0;
+    memcpy(out, &header, sizeof(header));
+
+    size_t length = sizeof(header);
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+    {
+        if (!(changedMask & (1UL << i)))
+            continue;
+        const DeltaField &field = DELTA_FIELDS[i];
+        if (length + field.size > outSize)
+            return 0;
+        memcpy(out + length, (const uint8_t *)&record.sample + field.offset, field.size);
+        length += field.size;
+    }
+    return length;
+}
+
+static float decimalScale(uint8_t decimals)
+{
+    float scale = 1;
+    for (uint8_t i = 0; i < decimals; i++)
+        scale *= 10;
+    return scale;
+}
+
+void DeltaReporter::appendDeltaJson(TextBuffer &json, const SampleRecord &record) const
+{
+    const SensorFramePayload &sample = record.sample;
+    json.append("{\"delta\":{\"timestamp\":").appendMillisAsSeconds(sample.timestampMs);
+    json.append(",\"seq\":").appendUInt(record.sequence);
+
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+    {
+        const DeltaField &field = DELTA_FIELDS[i];
+        if (!(changedMask & (1UL << i)) || field.jsonName == NULL)
+            continue;
+        json.append(",\"").append(field.jsonName).append("\":");
+        int64_t value = readField(sample, i);
+        if (field.decimals > 0)
+            json.appendFixed(value / decimalScale(field.decimals), field.decimals);
+        else if (field.isSigned)
+            json.appendInt((int32_t)value);
+        else
+            json.appendUInt((uint32_t)value);
+    }
+
+    // flags y reconexiones con los mismos nombres que la línea completa
+    if (changedMask & (1UL << FIELD_FLAGS))
+    {
+        json.append(",\"finger_detected\":").appendBool(sample.flags & SENSOR_FLAG_FINGER);
+        json.append(",\"is_moving\":").appendBool(sample.flags & SENSOR_FLAG_MOVING);
+    }
+    uint32_t statusMask = (1UL << FIELD_FLAGS) | (1UL << FIELD_MAX_RECONNECTS) | (1UL << FIELD_MPU_RECONNECTS);
+    if (changedMask & statusMask)
+    {
+        json.append(",\"sensor_status\":{");
+        json.append("\"max30102\":").appendBool(sample.flags & SENSOR_FLAG_MAX_ONLINE);
+        json.append(",\"mpu6050\":").appendBool(sample.flags & SENSOR_FLAG_MPU_ONLINE);
+        json.append(",\"max30102_reconexiones\":").appendUInt(sample.maxReconnects);
+        json.append(",\"mpu6050_reconexiones\":").appendUInt(sample.mpuReconnects);
+        json.append('}');
+    }
+    json.append("}}\r\n");
+}
+
+// ===========================
+// EVENTOS
+// ===========================
+const char *sensorEventName(uint8_t type)
+{
+    switch (type)
+    {
+    case EVENT_STEP:
+        return "paso";
+    case EVENT_BEAT:
+        return "latido";
+    case EVENT_FINGER_ON:
+        return "dedo_puesto";
+    case EVENT_FINGER_OFF:
+        return "dedo_quitado";
+    case EVENT_MOTION_START:
+        return "movimiento_inicio";
+    case EVENT_MOTION_STOP:
+        return "movimiento_fin";
+    default:
+        return "?";
+    }
+}
+
+void appendEventJson(TextBuffer &json, const EventFramePayload &event)
+{
+    json.append("{\"evento\":{\"tipo\":\"").append(sensorEventName(event.type)).append('"');
+    json.append(",\"timestamp\":").appendMillisAsSeconds(event.timestampMs);
+    json.append(",\"valor\":").appendUInt(event.value);
+    json.append("}}\r\n");
+}
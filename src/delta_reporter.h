@@ -0,0 +1,100 @@
+// delta_reporter.h - Informe por cambios: campos que se mueven, eventos y keyframes
+#pragma once
+#include <Arduino.h>
+#include "frame_protocol.h"
+#include "sample_history.h"
+#include "text_buffer.h"
+
+enum ReportMode
+{
+    REPORT_FULL = 0,  // una instantánea completa cada intervalo (como siempre)
+    REPORT_DELTA = 1, // solo cambios, eventos y un keyframe periódico
+};
+
+// ===========================
+// TRAMAS
+// ===========================
+// FRAME_DELTA: la cabecera y, detrás, cada campo marcado en fieldMask con
+// su tamaño en SensorFramePayload, en el orden del struct (bit 0 = spo2x10,
+// bit 17 = signalQuality; timestampMs va siempre en la cabecera)
+struct __attribute__((packed)) DeltaHeader
+{
+    uint32_t timestampMs;
+    uint32_t sequence; // la de SampleRecord: ACK y BACKFILL no cambian
+    uint32_t fieldMask;
+};
+
+enum SensorEventType
+{
+    EVENT_STEP = 1,         // value: pasos totales
+    EVENT_BEAT = 2,         // value: RR en ms (solo latidos aceptados)
+    EVENT_FINGER_ON = 3,
+    EVENT_FINGER_OFF = 4,
+    EVENT_MOTION_START = 5, // value: movimiento en mg
+    EVENT_MOTION_STOP = 6,
+};
+
+// FRAME_EVENT. No entran en el historial: el estado lo reconstruyen deltas
+// y keyframes, los eventos solo dicen cuándo pasó algo
+struct __attribute__((packed)) EventFramePayload
+{
+    uint32_t timestampMs;
+    uint8_t type; // SensorEventType
+    uint32_t value;
+};
+
+const char *sensorEventName(uint8_t type);
+
+// {"evento":{"tipo":"paso","timestamp":...,"valor":...}}
+void appendEventJson(TextBuffer &json, const EventFramePayload &event);
+
+// ===========================
+// INFORME POR CAMBIOS
+// ===========================
+// Guarda lo que el host ya tiene de cada campo y solo lo vuelve a enviar
+// cuando se aleja más que su banda muerta (la de cada campo por
+// deadbandPercent / 100; 0 = cualquier cambio). Un campo que se mueve poco
+// a poco acaba saliendo porque se compara con lo enviado, no con la
+// instantánea anterior. Cada keyframeIntervalS, y cuando el host lo pide,
+// va la instantánea entera (FRAME_SENSOR normal) para resincronizar. Solo
+// lo usa la tarea de transmisión.
+class DeltaReporter
+{
+public:
+    enum Decision
+    {
+        DELTA_SKIP,     // nada que enviar
+        DELTA_CHANGES,  // FRAME_DELTA con getChangedMask()
+        DELTA_KEYFRAME, // instantánea completa
+    };
+
+    static const uint8_t FIELD_COUNT = 18;
+
+    void configure(uint16_t keyframeIntervalS, uint8_t deadbandPercent);
+    void forceKeyframe() { keyframeDue = true; }
+
+    // Decide qué sale de current y lo da por enviado
+    Decision update(const SensorFramePayload &current, unsigned long now);
+    uint32_t getChangedMask() const { return changedMask; }
+
+    // Payload de FRAME_DELTA con los campos de getChangedMask(); 0 si no cabe
+    size_t encodeDelta(const SampleRecord &record, uint8_t *out, size_t outSize) const;
+    // {"delta":{"timestamp":...,"seq":...,<campos con los nombres del JSON>}}
+    void appendDeltaJson(TextBuffer &json, const SampleRecord &record) const;
+
+    uint32_t getSkipCount() const { return skipCount; }
+    uint32_t getDeltaCount() const { return deltaCount; }
+    uint32_t getKeyframeCount() const { return keyframeCount; }
+
+private:
+    SensorFramePayload reported = {}; // lo que tiene el host
+    bool keyframeDue = true;
+    unsigned long lastKeyframe = 0;
+    unsigned long keyframeIntervalMs = 30000;
+    uint8_t deadbandPercent = 100;
+    uint32_t changedMask = 0;
+
+    uint32_t skipCount = 0;
+    uint32_t deltaCount = 0;
+    uint32_t keyframeCount = 0;
+};
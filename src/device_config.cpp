@@ -0,0 +1,303 @@
+// device_config.cpp - Validación, formato y persistencia de la configuración
+#include "device_config.h"
+#include <Preferences.h>
+#include "led_agc.h"
+#include "delta_reporter.h"
+
+static const char *const NVS_NAMESPACE = "walk";
+static const char *const NVS_KEY = "config";
+
+// Periodos del FIFO que la cadena PPG sabe seguir: de 100 Hz a ~6 Hz
+static const unsigned long PPG_PERIOD_MIN_MS = 10;
+static const unsigned long PPG_PERIOD_MAX_MS = 160;
+static const uint16_t SEND_INTERVAL_MIN_MS = 20;
+static const uint16_t SEND_INTERVAL_MAX_MS = 10000;
+
+static const uint16_t PPG_RATES[] = {50, 100, 200, 400};
+static const uint8_t PPG_RATE_COUNT = sizeof(PPG_RATES) / sizeof(PPG_RATES[0]);
+static const uint8_t PPG_AVERAGE_LOG2_MAX = 5; // 32
+
+static const char *const FORMAT_NAMES[] = {"json", "binario", "stream"};
+static const uint8_t FORMAT_COUNT = sizeof(FORMAT_NAMES) / sizeof(FORMAT_NAMES[0]);
+
+static const char *const REPORT_NAMES[] = {"completo", "delta"};
+static const uint8_t REPORT_COUNT = sizeof(REPORT_NAMES) / sizeof(REPORT_NAMES[0]);
+static const uint8_t DEADBAND_PERCENT_MAX = 250;
+static const uint16_t KEYFRAME_MIN_S = 1;
+static const uint16_t KEYFRAME_MAX_S = 3600;
+
+bool sameConfig(const DeviceConfig &a, const DeviceConfig &b)
+{
+    return memcmp(&a, &b, sizeof(DeviceConfig)) == 0;
+}
+
+static bool parseNumber(const char *text, uint32_t &value)
+{
+    char *end;
+    value = strtoul(text, &end, 0); // decimal o 0x..
+    return end != text && *end == '\0';
+}
+
+static int rateIndex(uint16_t rate)
+{
+    for (uint8_t i = 0; i < PPG_RATE_COUNT; i++)
+        if (PPG_RATES[i] == rate)
+            return i;
+    return -1;
+}
+
+static int averageLog2(uint8_t average)
+{
+    for (uint8_t i = 0; i <= PPG_AVERAGE_LOG2_MAX; i++)
+        if ((1U << i) == average)
+            return i;
+    return -1;
+}
+
+// Frecuencia y promedio se validan juntos: el periodo debe ser un número
+// entero de ms (las marcas de tiempo de las muestras se reconstruyen con él)
+static bool validPpgTiming(uint16_t rate, uint8_t average)
+{
+    unsigned long scaled = 1000UL * average;
+    return scaled % rate == 0 && scaled / rate >= PPG_PERIOD_MIN_MS && scaled / rate <= PPG_PERIOD_MAX_MS;
+}
+
+// Lo mismo que comprueba SET, sobre la configuración entera (blob de NVS)
+static bool validConfig(const DeviceConfig &config)
+{
+    return config.outputFormat < FORMAT_COUNT &&
+           (config.sendIntervalMs == 0 ||
+            (config.sendIntervalMs >= SEND_INTERVAL_MIN_MS && config.sendIntervalMs <= SEND_INTERVAL_MAX_MS)) &&
+           config.waveformBatch >= WAVEFORM_BATCH_MIN && config.waveformBatch <= WAVEFORM_BATCH_MAX &&
+           rateIndex(config.ppgSampleRate) >= 0 && averageLog2(config.ppgSampleAverage) >= 0 &&
+           validPpgTiming(config.ppgSampleRate, config.ppgSampleAverage) &&
+           config.ledIrAmplitude >= LedAgc::AMPLITUDE_MIN && config.ledRedAmplitude >= LedAgc::AMPLITUDE_MIN &&
+           config.adcRange < LED_ADC_RANGE_COUNT && config.reportMode < REPORT_COUNT &&
+           config.deadbandPercent <= DEADBAND_PERCENT_MAX &&
+           config.keyframeIntervalS >= KEYFRAME_MIN_S && config.keyframeIntervalS <= KEYFRAME_MAX_S;
+}
+
+bool setConfigValue(DeviceConfig &config, const char *key, const char *value, const char *&error)
+{
+    uint32_t number = 0;
+    bool numeric = parseNumber(value, number);
+
+    if (strcmp(key, "formato") == 0)
+    {
+        for (uint8_t i = 0; i < FORMAT_COUNT; i++)
+        {
+            if (strcmp(value, FORMAT_NAMES[i]) == 0 || (numeric && number == i))
+            {
+                if (!BUILD.waveforms && i == OUTPUT_STREAM)
+                {
+                    error = "formato: stream no entra en este perfil";
+                    return false;
+                }
+                config.outputFormat = i;
+                return true;
+            }
+        }
+        error = "formato: json, binario o stream";
+        return false;
+    }
+    if (strcmp(key, "reporte") == 0)
+    {
+        for (uint8_t i = 0; i < REPORT_COUNT; i++)
+        {
+            if (strcmp(value, REPORT_NAMES[i]) == 0 || (numeric && number == i))
+            {
+                if (!BUILD.deltaReports && i == REPORT_DELTA)
+                {
+                    error = "reporte: delta no entra en este perfil";
+                    return false;
+                }
+                config.reportMode = i;
+                return true;
+            }
+        }
+        error = "reporte: completo o delta";
+        return false;
+    }
+
+    if (!numeric)
+    {
+        error = "valor no numérico";
+        return false;
+    }
+
+    if (strcmp(key, "intervalo_ms") == 0)
+    {
+        if (number != 0 && (number < SEND_INTERVAL_MIN_MS || number > SEND_INTERVAL_MAX_MS))
+        {
+            error = "intervalo_ms: 0 (automático) o 20-10000";
+            return false;
+        }
+        config.sendIntervalMs = number;
+        return true;
+    }
+    if (strcmp(key, "lote") == 0)
+    {
+        if (number < WAVEFORM_BATCH_MIN || number > WAVEFORM_BATCH_MAX)
+        {
+            error = "lote: de 4 a la capacidad del perfil";
+            return false;
+        }
+        config.waveformBatch = number;
+        return true;
+    }
+    if (strcmp(key, "ppg_hz") == 0)
+    {
+        if (number > UINT16_MAX || rateIndex(number) < 0 || !validPpgTiming(number, config.ppgSampleAverage))
+        {
+            error = "ppg_hz: 50, 100, 200 o 400, con periodo entero de 10-160 ms";
+            return false;
+        }
+        config.ppgSampleRate = number;
+        return true;
+    }
+    if (strcmp(key, "ppg_promedio") == 0)
+    {
+        if (number > UINT8_MAX || averageLog2(number) < 0 || !validPpgTiming(config.ppgSampleRate, number))
+        {
+            error = "ppg_promedio: 1-32 (potencia de 2), con periodo entero de 10-160 ms";
+            return false;
+        }
+        config.ppgSampleAverage = number;
+        return true;
+    }
+    if (strcmp(key, "led_ir") == 0 || strcmp(key, "led_rojo") == 0)
+    {
+        if (number < LedAgc::AMPLITUDE_MIN || number > LedAgc::AMPLITUDE_MAX)
+        {
+            error = "led: 5-255 (0,2 mA por paso)";
+            return false;
+        }
+        if (strcmp(key, "led_ir") == 0)
+            config.ledIrAmplitude = number;
+        else
+            config.ledRedAmplitude = number;
+        return true;
+    }
+    if (strcmp(key, "rango_na") == 0)
+    {
+        for (uint8_t i = 0; i < LED_ADC_RANGE_COUNT; i++)
+        {
+            if (ledAdcRangeNa(i) == number)
+            {
+                config.adcRange = i;
+                return true;
+            }
+        }
+        error = "rango_na: 2048, 4096, 8192 o 16384";
+        return false;
+    }
+    if (strcmp(key, "banda_pct") == 0)
+    {
+        if (number > DEADBAND_PERCENT_MAX)
+        {
+            error = "banda_pct: 0 (cualquier cambio) a 250";
+            return false;
+        }
+        config.deadbandPercent = number;
+        return true;
+    }
+    if (strcmp(key, "keyframe_s") == 0)
+    {
+        if (number < KEYFRAME_MIN_S || number > KEYFRAME_MAX_S)
+        {
+            error = "keyframe_s: 1-3600";
+            return false;
+        }
+        config.keyframeIntervalS = number;
+        return true;
+    }
+
+    error = "clave desconocida";
+    return false;
+}
+
+// bits 0-7 IR, 8-15 rojo, 16-17 rango, 18-19 frecuencia, 20-22 log2(promedio)
+uint32_t packPpgConfig(const DeviceConfig &config)
+{
+    int rate = rateIndex(config.ppgSampleRate);
+    int average = averageLog2(config.ppgSampleAverage);
+    return (uint32_t)config.ledIrAmplitude | ((uint32_t)config.ledRedAmplitude << 8) |
+           ((uint32_t)(config.adcRange & 0x03) << 16) | ((uint32_t)(rate < 0 ? 1 : rate) << 18) |
+           ((uint32_t)(average < 0 ? 2 : average) << 20);
+}
+
+void unpackPpgConfig(uint32_t packed, DeviceConfig &config)
+{
+    config.ledIrAmplitude = packed & 0xFF;
+    config.ledRedAmplitude = (packed >> 8) & 0xFF;
+    config.adcRange = (packed >> 16) & 0x03;
+    config.ppgSampleRate = PPG_RATES[(packed >> 18) & 0x03];
+    config.ppgSampleAverage = 1 << ((packed >> 20) & 0x07);
+}
+
+void appendConfigJson(TextBuffer &json, const ConfigFramePayload &payload)
+{
+    const DeviceConfig &config = payload.config;
+    const char *format = config.outputFormat < FORMAT_COUNT ? FORMAT_NAMES[config.outputFormat] : "?";
+    const char *active = payload.activeFormat < FORMAT_COUNT ? FORMAT_NAMES[payload.activeFormat] : "?";
+    const char *report = config.reportMode < REPORT_COUNT ? REPORT_NAMES[config.reportMode] : "?";
+
+    json.append("{\"config\":{\"formato\":\"").append(format).append('"');
+    json.append(",\"intervalo_ms\":").appendUInt(config.sendIntervalMs);
+    json.append(",\"lote\":").appendUInt(config.waveformBatch);
+    json.append(",\"ppg_hz\":").appendUInt(config.ppgSampleRate);
+    json.append(",\"ppg_promedio\":").appendUInt(config.ppgSampleAverage);
+    json.append(",\"led_ir\":").appendUInt(config.ledIrAmplitude);
+    json.append(",\"led_rojo\":").appendUInt(config.ledRedAmplitude);
+    json.append(",\"rango_na\":").appendUInt(ledAdcRangeNa(config.adcRange));
+    json.append(",\"reporte\":\"").append(report).append('"');
+    json.append(",\"banda_pct\":").appendUInt(config.deadbandPercent);
+    json.append(",\"keyframe_s\":").appendUInt(config.keyframeIntervalS);
+    json.append(",\"activo\":{\"formato\":\"").append(active).append('"');
+    json.append(",\"intervalo_ms\":").appendUInt(payload.activeIntervalMs).append('}');
+    json.append(",\"guardado\":").appendBool(payload.saved);
+    json.append("}}\r\n");
+}
+
+// ===========================
+// ALMACÉN EN NVS
+// ===========================
+bool ConfigStore::load(DeviceConfig &config)
+{
+    Preferences preferences;
+    if (!preferences.begin(NVS_NAMESPACE, true))
+        return false;
+
+    DeviceConfig stored;
+    bool ok = preferences.getBytesLength(NVS_KEY) == sizeof(stored) &&
+              preferences.getBytes(NVS_KEY, &stored, sizeof(stored)) == sizeof(stored) &&
+              stored.version == DEVICE_CONFIG_VERSION;
+    preferences.end();
+
+    // Un blob de otra versión del firmware podría traer combinaciones que
+    // esta ya no acepta
+    ok = ok && validConfig(stored);
+    if (ok)
+        config = stored;
+    return ok;
+}
+
+bool ConfigStore::save(const DeviceConfig &config)
+{
+    Preferences preferences;
+    if (!preferences.begin(NVS_NAMESPACE, false))
+        return false;
+    bool ok = preferences.putBytes(NVS_KEY, &config, sizeof(config)) == sizeof(config);
+    preferences.end();
+    return ok;
+}
+
+bool ConfigStore::erase()
+{
+    Preferences preferences;
+    if (!preferences.begin(NVS_NAMESPACE, false))
+        return false;
+    bool ok = preferences.remove(NVS_KEY);
+    preferences.end();
+    return ok;
+}
@@ -0,0 +1,71 @@
+// device_config.h - Ajustes cambiables en marcha por órdenes del host, guardados en NVS
+#pragma once
+#include <Arduino.h>
+#include "build_profile.h"
+#include "frame_protocol.h"
+#include "text_buffer.h"
+
+const uint8_t DEVICE_CONFIG_VERSION = 2;
+const uint16_t WAVEFORM_BATCH_MIN = 4;
+const uint16_t WAVEFORM_BATCH_MAX = BUILD.waveformBatchMax; // capacidad de los lotes, según el perfil
+
+// Lo que antes eran constantes de main.cpp. Disposición fija: es a la vez
+// el blob de NVS y el principio del payload de FRAME_CONFIG
+struct __attribute__((packed)) DeviceConfig
+{
+    uint8_t version;          // DEVICE_CONFIG_VERSION
+    uint8_t outputFormat;     // OutputFormat
+    uint16_t sendIntervalMs;  // 0 = según el formato (JSON 500 ms, binario 100 ms)
+    uint16_t waveformBatch;   // muestras por lote de forma de onda (OUTPUT_STREAM)
+    uint16_t ppgSampleRate;   // Hz del MAX30105: 50, 100, 200 o 400
+    uint8_t ppgSampleAverage; // promedio del FIFO: 1, 2, 4, 8, 16 o 32
+    uint8_t ledIrAmplitude;   // punto de partida del AGC (0,2 mA por paso)
+    uint8_t ledRedAmplitude;
+    uint8_t adcRange;         // índice de rango (led_agc.h)
+    uint8_t reportMode;       // ReportMode (delta_reporter.h)
+    uint8_t deadbandPercent;  // escala de las bandas muertas del modo delta
+    uint16_t keyframeIntervalS; // instantánea completa cada tanto en modo delta
+};
+
+// FRAME_CONFIG: lo configurado más lo que de verdad está en marcha (sin
+// memoria para lotes, OUTPUT_STREAM se queda en OUTPUT_BINARY)
+struct __attribute__((packed)) ConfigFramePayload
+{
+    DeviceConfig config;
+    uint8_t activeFormat;
+    uint16_t activeIntervalMs;
+    uint8_t saved; // 1 si coincide con lo guardado en NVS
+};
+
+// Periodo efectivo del FIFO del MAX30105 (1000 * promedio / frecuencia)
+inline unsigned long ppgSamplePeriodMs(const DeviceConfig &config)
+{
+    return 1000UL * config.ppgSampleAverage / config.ppgSampleRate;
+}
+
+bool sameConfig(const DeviceConfig &a, const DeviceConfig &b);
+
+// "SET <clave> <valor>": cambia config solo si el valor es válido; si no,
+// deja config como estaba y error apunta al motivo
+bool setConfigValue(DeviceConfig &config, const char *key, const char *value, const char *&error);
+
+// Frecuencia, promedio, LED y rango juntos en una palabra, para pasarlos de
+// la tarea que recibe la orden a la de adquisición con un solo atómico
+uint32_t packPpgConfig(const DeviceConfig &config);
+void unpackPpgConfig(uint32_t packed, DeviceConfig &config);
+
+// {"config":{...}} con los mismos nombres que acepta SET
+void appendConfigJson(TextBuffer &json, const ConfigFramePayload &payload);
+
+// ===========================
+// ALMACÉN EN NVS
+// ===========================
+// Un único blob versionado: si cambia la versión o el tamaño se ignora y
+// se arranca con los valores de compilación.
+class ConfigStore
+{
+public:
+    bool load(DeviceConfig &config);
+    bool save(const DeviceConfig &config);
+    bool erase();
+};
@@ -0,0 +1,41 @@
+// frame_protocol.cpp - Codificación de tramas binarias
+#include "frame_protocol.h"
+
+uint16_t crc16Ccitt(const uint8_t *data, size_t length, uint16_t crc)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+size_t FrameEncoder::encode(uint8_t type, const void *payload, uint16_t length,
+                            uint8_t *out, size_t outSize)
+{
+    size_t total = FRAME_OVERHEAD + length;
+    if (length > FRAME_MAX_PAYLOAD || total > outSize)
+        return 0;
+
+    uint16_t seq = sequence++;
+
+    out[0] = FRAME_SYNC & 0xFF;
+    out[1] = FRAME_SYNC >> 8;
+    out[2] = type;
+    out[3] = seq & 0xFF;
+    out[4] = seq >> 8;
+    out[5] = length & 0xFF;
+    out[6] = length >> 8;
+    memcpy(out + FRAME_HEADER_SIZE, payload, length);
+
+    // El CRC cubre desde type hasta el final del payload
+    uint16_t crc = crc16Ccitt(out + 2, FRAME_HEADER_SIZE - 2 + length);
+    out[FRAME_HEADER_SIZE + length] = crc & 0xFF;
+    out[FRAME_HEADER_SIZE + length + 1] = crc >> 8;
+
+    return total;
+}
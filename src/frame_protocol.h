@@ -0,0 +1,102 @@
+// frame_protocol.h - Protocolo binario compacto de tramas por serial
+#pragma once
+#include <Arduino.h>
+
+// ===========================
+// FORMATO DE TRAMA (LITTLE-ENDIAN)
+// ===========================
+//   sync   u16  0x5AA5 (bytes A5 5A)
+//   type   u8   FrameType
+//   seq    u16  número de secuencia, +1 por trama
+//   len    u16  bytes de payload
+//   payload     len bytes
+//   crc    u16  CRC-16/CCITT-FALSE de type..payload
+//
+// El decodificador de python/frame_protocol.py debe mantenerse igual.
+const uint16_t FRAME_SYNC = 0x5AA5;
+const size_t FRAME_HEADER_SIZE = 7;
+const size_t FRAME_CRC_SIZE = 2;
+const size_t FRAME_OVERHEAD = FRAME_HEADER_SIZE + FRAME_CRC_SIZE;
+const size_t FRAME_MAX_PAYLOAD = 1024;
+
+enum FrameType
+{
+    FRAME_SENSOR = 0x01,   // SampleRecord en vivo (sample_history.h)
+    FRAME_WAVEFORM = 0x02, // WaveformHeader + muestras (waveform_batch.h)
+    FRAME_HISTORY = 0x03,  // SampleRecord reenviado tras "BACKFILL <seq>"
+    FRAME_DIAGNOSTIC = 0x04, // DiagnosticHeader + etapas (stage_profiler.h)
+    FRAME_LOG = 0x05,        // texto UTF-8 sin salto de línea (mensajes de depuración)
+    FRAME_CONFIG = 0x06,     // ConfigFramePayload, respuesta a las órdenes de configuración (device_config.h)
+    FRAME_DELTA = 0x07,      // DeltaHeader + campos cambiados de SensorFramePayload (delta_reporter.h)
+    FRAME_EVENT = 0x08,      // EventFramePayload: paso, latido, dedo, movimiento (delta_reporter.h)
+    FRAME_COMPACT = 0x09,    // CompactFramePayload en vivo (perfiles sin BUILD.fullPayload)
+};
+
+enum OutputFormat
+{
+    OUTPUT_JSON = 0,
+    OUTPUT_BINARY = 1,
+    OUTPUT_STREAM = 2, // OUTPUT_BINARY + lotes de forma de onda cruda
+};
+
+// Bits de SensorFramePayload::flags
+const uint8_t SENSOR_FLAG_FINGER = 0x01;
+const uint8_t SENSOR_FLAG_MOVING = 0x02;
+const uint8_t SENSOR_FLAG_MAX_ONLINE = 0x04;
+const uint8_t SENSOR_FLAG_MPU_ONLINE = 0x08;
+
+// Instantánea de SensorData en disposición fija (39 bytes frente a ~500 del JSON)
+struct __attribute__((packed)) SensorFramePayload
+{
+    uint32_t timestampMs;
+    uint16_t spo2x10;     // SpO2 * 10
+    uint8_t heartRate;    // bpm
+    uint8_t flags;        // SENSOR_FLAG_*
+    uint32_t irValue;
+    uint32_t redValue;
+    int16_t accelX;       // m/s² * 100
+    int16_t accelY;
+    int16_t accelZ;
+    int16_t temperature;  // °C * 100
+    uint32_t stepCount;
+    uint8_t maxReconnects; // saturado a 255
+    uint8_t mpuReconnects;
+    uint16_t rrIntervalMs; // último intervalo RR aceptado
+    uint16_t rmssdMs;      // HRV sobre la ventana de latidos
+    uint16_t sdnnMs;
+    uint8_t cadence;          // pasos por minuto, saturado a 255
+    uint8_t strideRegularity; // 0-100 %
+    uint8_t signalQuality;    // SQI del PPG 0-100 (ppg_pipeline.h)
+};
+
+// Lo que publica el perfil prod: latido, pasos y estado (16 bytes)
+struct __attribute__((packed)) CompactFramePayload
+{
+    uint32_t timestampMs;
+    uint32_t sequence;     // de muestra, +1 por instantánea (sin historial ni ACK)
+    uint8_t heartRate;     // bpm
+    uint8_t flags;         // SENSOR_FLAG_*
+    uint8_t signalQuality; // SQI del PPG 0-100
+    uint8_t cadence;       // pasos por minuto, saturado a 255
+    uint32_t stepCount;
+};
+
+uint16_t crc16Ccitt(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+// ===========================
+// CODIFICADOR DE TRAMAS
+// ===========================
+class FrameEncoder
+{
+public:
+    FrameEncoder() : sequence(0) {}
+
+    // Escribe la trama completa en out; devuelve su tamaño o 0 si no cabe
+    size_t encode(uint8_t type, const void *payload, uint16_t length,
+                  uint8_t *out, size_t outSize);
+
+    uint16_t getSequence() const { return sequence; }
+
+private:
+    uint16_t sequence;
+};
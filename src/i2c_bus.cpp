@@ -0,0 +1,177 @@
+// i2c_bus.cpp - Implementación del planificador del bus I2C
+#include "i2c_bus.h"
+#include <Wire.h>
+#include "esp_timer.h"
+
+I2cBus::I2cBus(i2c_port_t port) : port(port), deviceCount(0), busTask(NULL), doneSignal(NULL)
+{
+    for (uint8_t i = 0; i < MAX_DEVICES; i++)
+    {
+        devices[i].name = "";
+        devices[i].address = 0;
+        devices[i].transfers.store(0);
+        devices[i].bytes.store(0);
+        devices[i].errors.store(0);
+        devices[i].timeouts.store(0);
+        devices[i].busyUs.store(0);
+    }
+}
+
+int I2cBus::addDevice(const char *name, uint8_t address)
+{
+    if (deviceCount >= MAX_DEVICES || findDevice(address) >= 0)
+        return -1;
+
+    devices[deviceCount].name = name;
+    devices[deviceCount].address = address;
+    return deviceCount++;
+}
+
+bool I2cBus::begin(int sda, int scl, uint32_t clockHz, BaseType_t core, UBaseType_t priority)
+{
+    // Wire instala el driver de IDF en el puerto 0 con los pines y el reloj;
+    // las librerías que llaman después a Wire.begin() lo encuentran ya activo
+    if (port != I2C_NUM_0 || !Wire.begin(sda, scl, clockHz))
+        return false;
+
+    doneSignal = xSemaphoreCreateBinary();
+    if (doneSignal == NULL)
+        return false;
+
+    return xTaskCreatePinnedToCore(taskEntry, "i2c_bus", 2048, this, priority, &busTask, core) == pdPASS;
+}
+
+int I2cBus::findDevice(uint8_t address) const
+{
+    for (uint8_t i = 0; i < deviceCount; i++)
+        if (devices[i].address == address)
+            return i;
+    return -1;
+}
+
+bool I2cBus::submit(I2cTransfer &transfer)
+{
+    if (busTask == NULL || findDevice(transfer.address) < 0)
+        return false;
+
+    transfer.state.store(I2cTransfer::QUEUED, std::memory_order_relaxed);
+    if (!queue.push(&transfer))
+    {
+        transfer.state.store(I2cTransfer::IDLE, std::memory_order_relaxed);
+        return false;
+    }
+    xTaskNotifyGive(busTask);
+    return true;
+}
+
+bool I2cBus::wait(I2cTransfer &transfer)
+{
+    uint8_t state;
+    while ((state = transfer.state.load(std::memory_order_acquire)) == I2cTransfer::QUEUED)
+    {
+        // El aviso es común a todas las transacciones: volver a mirar la
+        // nuestra. Sin tope propio: cada una acaba como mucho en
+        // TRANSFER_TIMEOUT y hasta entonces la tarea del bus usa su memoria
+        xSemaphoreTake(doneSignal, portMAX_DELAY);
+    }
+    return state == I2cTransfer::DONE && transfer.result == ESP_OK;
+}
+
+bool I2cBus::readRegisters(uint8_t address, uint8_t reg, uint8_t *data, uint16_t length)
+{
+    I2cTransfer transfer;
+    transfer.address = address;
+    transfer.reg = reg;
+    transfer.data = data;
+    transfer.length = length;
+    return submit(transfer) && wait(transfer);
+}
+
+bool I2cBus::writeRegister(uint8_t address, uint8_t reg, uint8_t value)
+{
+    I2cTransfer transfer;
+    transfer.address = address;
+    transfer.reg = reg;
+    transfer.data = &value;
+    transfer.length = 1;
+    transfer.write = true;
+    return submit(transfer) && wait(transfer);
+}
+
+I2cBus::DeviceStats I2cBus::getStats(int device) const
+{
+    const Device &source = devices[device];
+    DeviceStats stats;
+    stats.transfers = source.transfers.load(std::memory_order_relaxed);
+    stats.bytes = source.bytes.load(std::memory_order_relaxed);
+    stats.errors = source.errors.load(std::memory_order_relaxed);
+    stats.timeouts = source.timeouts.load(std::memory_order_relaxed);
+    stats.busyUs = source.busyUs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// ===========================
+// TAREA DEL BUS
+// ===========================
+esp_err_t I2cBus::execute(const I2cTransfer &transfer)
+{
+    // Escritura: START | dir+W | reg | datos | STOP
+    // Lectura:   START | dir+W | reg | START repetido | dir+R | datos | STOP
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(linkBuffer, sizeof(linkBuffer));
+    if (cmd == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (uint8_t)(transfer.address << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, transfer.reg, true);
+    if (transfer.write)
+    {
+        i2c_master_write(cmd, transfer.data, transfer.length, true);
+    }
+    else
+    {
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, (uint8_t)(transfer.address << 1) | I2C_MASTER_READ, true);
+        i2c_master_read(cmd, transfer.data, transfer.length, I2C_MASTER_LAST_NACK);
+    }
+    i2c_master_stop(cmd);
+
+    esp_err_t result = i2c_master_cmd_begin(port, cmd, TRANSFER_TIMEOUT);
+    i2c_cmd_link_delete_static(cmd);
+    return result;
+}
+
+void I2cBus::taskEntry(void *parameter)
+{
+    static_cast<I2cBus *>(parameter)->run();
+}
+
+void I2cBus::run()
+{
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        I2cTransfer *transfer;
+        while (queue.pop(transfer))
+        {
+            int64_t start = esp_timer_get_time();
+            esp_err_t result = execute(*transfer);
+            uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+            Device &device = devices[findDevice(transfer->address)];
+            device.transfers.fetch_add(1, std::memory_order_relaxed);
+            device.busyUs.fetch_add(elapsed, std::memory_order_relaxed);
+            if (result == ESP_OK)
+                device.bytes.fetch_add(transfer->length, std::memory_order_relaxed);
+            else if (result == ESP_ERR_TIMEOUT)
+                device.timeouts.fetch_add(1, std::memory_order_relaxed);
+            else
+                device.errors.fetch_add(1, std::memory_order_relaxed);
+
+            transfer->result = result;
+            transfer->state.store(I2cTransfer::DONE, std::memory_order_release);
+            xSemaphoreGive(doneSignal);
+        }
+    }
+}
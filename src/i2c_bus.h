@@ -0,0 +1,115 @@
+// i2c_bus.h - Planificador de transacciones del bus I2C compartido (ESP-IDF)
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "driver/i2c.h"
+#include "spsc_queue.h"
+
+// Una lectura o escritura de registros de un dispositivo. La memoria de data
+// es del que la pide y debe seguir viva hasta que wait() devuelva.
+struct I2cTransfer
+{
+    enum State : uint8_t
+    {
+        IDLE = 0,
+        QUEUED = 1,
+        DONE = 2,
+    };
+
+    I2cTransfer() : address(0), reg(0), data(NULL), length(0), write(false), state(IDLE), result(ESP_OK) {}
+
+    uint8_t address;
+    uint8_t reg;
+    uint8_t *data;
+    uint16_t length;
+    bool write;
+
+    std::atomic<uint8_t> state;
+    esp_err_t result; // válido con state == DONE
+};
+
+// ===========================
+// BUS I2C PLANIFICADO
+// ===========================
+// Las transacciones se encolan y las ejecuta en orden una tarea propia con
+// la API de command link del driver de ESP-IDF: i2c_master_cmd_begin() deja
+// la transferencia al hardware y duerme hasta la interrupción de fin, así
+// que quien pidió la transacción sigue trabajando (p. ej. decodificando el
+// bloque anterior) mientras los bytes están en el cable.
+//
+// Wire usa el mismo driver y el mismo puerto: las librerías de los sensores
+// pueden seguir configurándolos por Wire y el driver serializa ambos
+// caminos. Por este bus va el camino caliente (FIFOs, estado, sondeos).
+//
+// submit()/wait() solo desde una tarea (la de adquisición, o setup() antes
+// de que arranque). Las estadísticas se pueden leer desde cualquier tarea.
+class I2cBus
+{
+public:
+    static const uint8_t MAX_DEVICES = 4;
+    static const uint32_t CLOCK_HZ = 400000;           // modo rápido, el máximo de MAX30105 y MPU6050
+    static const TickType_t TRANSFER_TIMEOUT = pdMS_TO_TICKS(20); // 32 muestras PPG = ~5 ms a 400 kHz
+
+    struct DeviceStats
+    {
+        uint32_t transfers;
+        uint32_t bytes;
+        uint32_t errors;   // NACK o fallo del bus
+        uint32_t timeouts; // el driver no terminó a tiempo (bus colgado)
+        uint32_t busyUs;   // tiempo acumulado en el cable (da la vuelta)
+    };
+
+    explicit I2cBus(i2c_port_t port);
+
+    // Antes de begin(); devuelve el índice del dispositivo o -1
+    int addDevice(const char *name, uint8_t address);
+
+    // Instala el driver (vía Wire) y arranca la tarea del bus
+    bool begin(int sda, int scl, uint32_t clockHz, BaseType_t core, UBaseType_t priority);
+
+    // Encola sin bloquear; false si la cola está llena o el dispositivo no existe
+    bool submit(I2cTransfer &transfer);
+    // Bloquea hasta que la transacción termina; true si fue bien
+    bool wait(I2cTransfer &transfer);
+
+    // submit() + wait()
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t *data, uint16_t length);
+    bool writeRegister(uint8_t address, uint8_t reg, uint8_t value);
+
+    uint8_t getDeviceCount() const { return deviceCount; }
+    const char *getDeviceName(int device) const { return devices[device].name; }
+    DeviceStats getStats(int device) const;
+
+private:
+    static const size_t QUEUE_SIZE = 8;
+
+    struct Device
+    {
+        const char *name;
+        uint8_t address;
+
+        // Solo la tarea del bus escribe
+        std::atomic<uint32_t> transfers;
+        std::atomic<uint32_t> bytes;
+        std::atomic<uint32_t> errors;
+        std::atomic<uint32_t> timeouts;
+        std::atomic<uint32_t> busyUs;
+    };
+
+    i2c_port_t port;
+    Device devices[MAX_DEVICES];
+    uint8_t deviceCount;
+
+    SpscQueue<I2cTransfer *, QUEUE_SIZE> queue; // pedidor -> tarea del bus
+    TaskHandle_t busTask;
+    SemaphoreHandle_t doneSignal; // alguna transacción ha terminado
+
+    // Comandos de una transacción (start, dirección, registro, datos, stop)
+    uint8_t linkBuffer[I2C_LINK_RECOMMENDED_SIZE(3)];
+
+    int findDevice(uint8_t address) const;
+    esp_err_t execute(const I2cTransfer &transfer);
+
+    static void taskEntry(void *parameter);
+    void run();
+};
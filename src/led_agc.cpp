@@ -0,0 +1,174 @@
+// led_agc.cpp - Implementación del control automático de ganancia del MAX30105
+#include "led_agc.h"
+
+// Media de la DC cruda: 2^3 muestras (~320 ms a 25 Hz)
+static const uint8_t DC_SHIFT = 3;
+
+LedAgc::LedAgc(const LedSettings &initial)
+    : effective(initial), adoptedGeneration(0), adoptedTime(0), irDc(0), redDc(0),
+      primed(false), outOfBandTime(0), outOfBand(false), adjustmentCount(0)
+{
+    defaults.store(pack(initial, 0));
+    requested.store(pack(initial, 0));
+    applied.store(pack(initial, 0));
+    appliedBoundary.store(0);
+}
+
+uint32_t LedAgc::pack(const LedSettings &settings, uint8_t generation)
+{
+    return (uint32_t)settings.irAmplitude | ((uint32_t)settings.redAmplitude << 8) |
+           ((uint32_t)settings.adcRange << 16) | ((uint32_t)generation << 24);
+}
+
+LedSettings LedAgc::unpack(uint32_t packed)
+{
+    LedSettings settings;
+    settings.irAmplitude = packed & 0xFF;
+    settings.redAmplitude = (packed >> 8) & 0xFF;
+    settings.adcRange = (packed >> 16) & 0xFF;
+    return settings;
+}
+
+// Amplitud que lleva la DC al centro de la banda; a la mitad si satura
+static uint32_t wantedAmplitude(uint8_t amplitude, uint32_t dc, uint32_t sample)
+{
+    if (sample >= LedAgc::SATURATION)
+        return amplitude / 2;
+    return (uint32_t)amplitude * LedAgc::DC_TARGET / (dc > 0 ? dc : 1);
+}
+
+static bool inBand(uint32_t dc, uint32_t sample)
+{
+    return sample < LedAgc::SATURATION && dc >= LedAgc::DC_LOW && dc <= LedAgc::DC_HIGH;
+}
+
+void LedAgc::update(uint32_t ir, uint32_t red, unsigned long timestamp)
+{
+    if (!primed)
+    {
+        irDc = ir;
+        redDc = red;
+        primed = true;
+    }
+    irDc += ((int32_t)ir - (int32_t)irDc) >> DC_SHIFT;
+    redDc += ((int32_t)red - (int32_t)redDc) >> DC_SHIFT;
+
+    // Cambio recién adoptado o aún sin aplicar: esperar
+    if (isSettling(timestamp) || (requested.load(std::memory_order_relaxed) & 0xFFFFFF) !=
+                                     (applied.load(std::memory_order_relaxed) & 0xFFFFFF))
+        return;
+
+    bool irOk = inBand(irDc, ir);
+    bool redOk = inBand(redDc, red);
+    bool saturated = ir >= SATURATION || red >= SATURATION;
+    if (irOk && redOk)
+    {
+        outOfBand = false;
+        return;
+    }
+    if (!saturated)
+    {
+        // Fuera de banda, pero solo se corrige si dura
+        if (!outOfBand)
+        {
+            outOfBand = true;
+            outOfBandTime = timestamp;
+            return;
+        }
+        if (timestamp - outOfBandTime < HOLD_MS)
+            return;
+    }
+
+    // Cada canal fuera de banda se corrige; el otro se queda como está
+    uint32_t irWant = irOk ? effective.irAmplitude : wantedAmplitude(effective.irAmplitude, irDc, ir);
+    uint32_t redWant = redOk ? effective.redAmplitude : wantedAmplitude(effective.redAmplitude, redDc, red);
+    uint8_t range = effective.adcRange;
+
+    // Sin corriente suficiente: rango más sensible (el doble de cuentas)
+    while ((irWant > AMPLITUDE_MAX || redWant > AMPLITUDE_MAX) && range > 0)
+    {
+        range--;
+        irWant = (irWant + 1) / 2;
+        redWant = (redWant + 1) / 2;
+    }
+    // Demasiada luz aun con la mínima: rango menos sensible
+    while ((irWant < AMPLITUDE_MIN || redWant < AMPLITUDE_MIN) && range < LED_ADC_RANGE_COUNT - 1 &&
+           irWant * 2 <= AMPLITUDE_MAX && redWant * 2 <= AMPLITUDE_MAX)
+    {
+        range++;
+        irWant *= 2;
+        redWant *= 2;
+    }
+
+    LedSettings next;
+    next.irAmplitude = irWant < AMPLITUDE_MIN ? AMPLITUDE_MIN : (irWant > AMPLITUDE_MAX ? AMPLITUDE_MAX : irWant);
+    next.redAmplitude = redWant < AMPLITUDE_MIN ? AMPLITUDE_MIN : (redWant > AMPLITUDE_MAX ? AMPLITUDE_MAX : redWant);
+    next.adcRange = range;
+
+    outOfBand = false;
+    if (next.irAmplitude == effective.irAmplitude && next.redAmplitude == effective.redAmplitude &&
+        next.adcRange == effective.adcRange)
+        return; // en el límite: no hay nada mejor que pedir
+
+    requested.store(pack(next, 0), std::memory_order_relaxed);
+    adjustmentCount++;
+}
+
+void LedAgc::release()
+{
+    requested.store(defaults.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    primed = false;
+    outOfBand = false;
+}
+
+bool LedAgc::adopt(unsigned long timestamp)
+{
+    uint32_t current = applied.load(std::memory_order_acquire);
+    uint8_t generation = current >> 24;
+    if (generation == adoptedGeneration)
+        return false;
+
+    // Muestras anteriores a la frontera aún llevan la configuración vieja
+    if ((long)(timestamp - appliedBoundary.load(std::memory_order_relaxed)) <= 0)
+        return false;
+
+    adoptedGeneration = generation;
+    effective = unpack(current);
+    adoptedTime = timestamp;
+    primed = false;
+    outOfBand = false;
+    return true;
+}
+
+uint32_t LedAgc::normalizeIr(uint32_t ir) const
+{
+    // Cuentas ∝ amplitud / fondo de escala
+    LedSettings reference = getDefaults();
+    uint64_t scaled = ((uint64_t)ir * reference.irAmplitude) << effective.adcRange;
+    uint32_t divisor = (uint32_t)(effective.irAmplitude > 0 ? effective.irAmplitude : 1) << reference.adcRange;
+    return (uint32_t)(scaled / divisor);
+}
+
+bool LedAgc::getPending(LedSettings &settings) const
+{
+    uint32_t wanted = requested.load(std::memory_order_relaxed) & 0xFFFFFF;
+    if (wanted == (applied.load(std::memory_order_relaxed) & 0xFFFFFF))
+        return false;
+    settings = unpack(wanted);
+    return true;
+}
+
+void LedAgc::setDefaults(const LedSettings &settings)
+{
+    // También como lo pedido: si no, el siguiente vaciado volvería a aplicar
+    // lo último que pidió el AGC con la configuración anterior
+    defaults.store(pack(settings, 0), std::memory_order_relaxed);
+    requested.store(pack(settings, 0), std::memory_order_relaxed);
+}
+
+void LedAgc::markApplied(const LedSettings &settings, unsigned long boundary)
+{
+    uint8_t generation = (applied.load(std::memory_order_relaxed) >> 24) + 1;
+    appliedBoundary.store(boundary, std::memory_order_relaxed);
+    applied.store(pack(settings, generation), std::memory_order_release);
+}
@@ -0,0 +1,97 @@
+// led_agc.h - Control automático de corriente de LED y rango del ADC del MAX30105
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Rango del ADC: índice 0..3 = fondo de escala 2048, 4096, 8192, 16384 nA.
+// Cada paso arriba divide por dos las cuentas para la misma luz.
+const uint8_t LED_ADC_RANGE_COUNT = 4;
+
+struct LedSettings
+{
+    uint8_t irAmplitude;  // 0,2 mA por paso
+    uint8_t redAmplitude;
+    uint8_t adcRange;     // índice de rango
+};
+
+inline uint16_t ledAdcRangeNa(uint8_t range) { return 2048U << range; }
+inline uint32_t ledAmplitudeUa(uint8_t amplitude) { return (uint32_t)amplitude * 200; }
+
+// ===========================
+// CONTROL AUTOMÁTICO DE GANANCIA
+// ===========================
+// El procesado sigue la DC cruda de cada canal y, si se sale de la banda
+// [DC_LOW, DC_HIGH] durante HOLD_MS (o satura), pide una amplitud que la
+// lleve al centro; si una no cabe en el rango de amplitudes, cambia el
+// rango del ADC, común a los dos canales. Tras cada cambio espera
+// SETTLE_MS antes de volver a evaluar. Con la señal dentro de la banda no
+// se toca nada: la histéresis es la propia banda.
+//
+// La adquisición, dueña del bus, aplica lo pedido justo después de vaciar
+// el FIFO y marca como frontera la última muestra leída: las posteriores
+// ya llevan la nueva configuración. El procesado la adopta en la primera
+// de ellas (adopt) y reinicia ahí la cadena DSP.
+class LedAgc
+{
+public:
+    static const uint32_t ADC_FULL_SCALE = 262143;  // 18 bits (pulso 411 µs)
+    static const uint32_t SATURATION = 250000;
+    static const uint32_t DC_LOW = 60000;
+    static const uint32_t DC_HIGH = 200000;
+    static const uint32_t DC_TARGET = 130000;
+    static const uint8_t AMPLITUDE_MIN = 0x05;      // 1 mA
+    static const uint8_t AMPLITUDE_MAX = 0xFF;      // 51 mA
+    static const uint16_t HOLD_MS = 500;
+    static const uint16_t SETTLE_MS = 1000;
+
+    explicit LedAgc(const LedSettings &initial);
+
+    // Procesado. update() solo con dedo; release() al quitarlo vuelve a
+    // pedir la configuración por defecto
+    void update(uint32_t ir, uint32_t red, unsigned long timestamp);
+    void release();
+
+    // true si la muestra es la primera con una configuración nueva
+    bool adopt(unsigned long timestamp);
+    // Tras adoptar, la señal aún se asienta: no fiarse de los latidos
+    bool isSettling(unsigned long timestamp) const { return timestamp - adoptedTime < SETTLE_MS; }
+
+    // IR llevado a la configuración por defecto, para que el umbral de
+    // dedo no dependa de la ganancia actual
+    uint32_t normalizeIr(uint32_t ir) const;
+
+    const LedSettings &getEffective() const { return effective; }
+    uint32_t getAdjustmentCount() const { return adjustmentCount; }
+
+    // Adquisición
+    bool getPending(LedSettings &settings) const;
+    void markApplied(const LedSettings &settings, unsigned long boundary);
+    LedSettings getDefaults() const { return unpack(defaults.load(std::memory_order_relaxed)); }
+    // Punto de partida nuevo (orden del host): se aplica entero con el
+    // siguiente markApplied, que hace que el procesado lo adopte
+    void setDefaults(const LedSettings &settings);
+
+private:
+    static uint32_t pack(const LedSettings &settings, uint8_t generation);
+    static LedSettings unpack(uint32_t packed);
+
+    // La escribe la adquisición y la lee el procesado (normalizeIr, release)
+    std::atomic<uint32_t> defaults;
+
+    // Solo procesado
+    LedSettings effective;
+    uint8_t adoptedGeneration;
+    unsigned long adoptedTime;
+    uint32_t irDc;
+    uint32_t redDc;
+    bool primed;
+    unsigned long outOfBandTime;
+    bool outOfBand;
+    uint32_t adjustmentCount;
+
+    // Compartido: lo pedido (sin generación) y lo aplicado con su generación;
+    // la frontera se escribe antes que applied
+    std::atomic<uint32_t> requested;
+    std::atomic<uint32_t> applied;
+    std::atomic<unsigned long> appliedBoundary;
+};
@@ -0,0 +1,61 @@
+// led_effects.h - Efectos de LED no bloqueantes
+#pragma once
+#include <Arduino.h>
+
+// ===========================
+// LED CON PULSOS NO BLOQUEANTES
+// ===========================
+// Sustituye a digitalWrite(HIGH); delay(); digitalWrite(LOW): pulse() enciende
+// y update() apaga cuando vence, sin detener la tarea que lo llama. La
+// resolución del pulso es la frecuencia con la que se llame a update().
+class LedEffect
+{
+public:
+    explicit LedEffect(int pin) : pin(pin), level(false), pulseActive(false), pulseEnd(0) {}
+
+    void begin()
+    {
+        pinMode(pin, OUTPUT);
+        digitalWrite(pin, LOW);
+        level = false;
+    }
+
+    // Estado fijo; cancela cualquier pulso en curso
+    void set(bool on)
+    {
+        pulseActive = false;
+        write(on);
+    }
+
+    // Encender durante durationMs y acabar apagado
+    void pulse(unsigned long durationMs, unsigned long now)
+    {
+        pulseActive = true;
+        pulseEnd = now + durationMs;
+        write(true);
+    }
+
+    void update(unsigned long now)
+    {
+        if (pulseActive && (long)(now - pulseEnd) >= 0)
+        {
+            pulseActive = false;
+            write(false);
+        }
+    }
+
+private:
+    int pin;
+    bool level;
+    bool pulseActive;
+    unsigned long pulseEnd;
+
+    void write(bool on)
+    {
+        if (on != level)
+        {
+            level = on;
+            digitalWrite(pin, on ? HIGH : LOW);
+        }
+    }
+};
@@ -1,9 +1,34 @@
 // main.cpp - VERSIÓN PARA GRÁFICAS EN TIEMPO REAL
 #include <Arduino.h>
 #include <Wire.h>
+#include <atomic>
+#include "build_profile.h"
 #include <Adafruit_Sensor.h>
 #include <Adafruit_MPU6050.h>
 #include "MAX30105.h"
+#include "sensor_health.h"
+#include "ppg_acquisition.h"
+#include "spsc_queue.h"
+#include "ring_buffer.h"
+#include "sample_scheduler.h"
+#include "led_effects.h"
+#include "frame_protocol.h"
+#include "waveform_batch.h"
+#include "text_buffer.h"
+#include "serial_output.h"
+#include "net_uplink.h"
+#include "sample_history.h"
+#include "ppg_pipeline.h"
+#include "mpu6050_raw.h"
+#include "step_engine.h"
+#include "motion_artifact.h"
+#include "power_manager.h"
+#include "led_agc.h"
+#include "stage_profiler.h"
+#include "i2c_bus.h"
+#include "device_config.h"
+#include "memory_arena.h"
+#include "delta_reporter.h"
 
 // ===========================
 // OBJETOS GLOBALES
@@ -19,379 +44,1428 @@ struct SensorData
     // MAX30105
     float spO2 = 0;
     int heartRate = 0;
+    uint16_t rrInterval = 0; // ms, último latido aceptado
+    uint16_t rmssd = 0;      // ms
+    uint16_t sdnn = 0;       // ms
+    uint8_t signalQuality = 0; // SQI 0-100 de los últimos latidos
     int32_t irValue = 0;
     int32_t redValue = 0;
     bool fingerDetected = false;
+    LedSettings led = {};         // configuración de LED y ADC de estas muestras
+    uint32_t ledAdjustments = 0;  // cambios pedidos por el AGC
 
     // MPU6050
     float accelX = 0, accelY = 0, accelZ = 0;
     float temperature = 0;
-    int stepCount = 0;
+    uint32_t stepCount = 0;
+    uint16_t cadence = 0;       // pasos por minuto
+    uint8_t strideRegularity = 0; // 0-100 %
+    uint16_t motionMg = 0;        // RMS del movimiento sin gravedad
 } sensorData;
 
 // ===========================
 // VARIABLES PARA DETECCIÓN MEJORADA
 // ===========================
-// Para MAX30105
-unsigned long lastBeatTime = 0;
-const int BEAT_ARRAY_SIZE = 5; // Más pequeño para respuesta más rápida
-int beatArray[BEAT_ARRAY_SIZE];
-int beatIndex = 0;
-int beatSamples = 0;
-
-// Para MPU6050
-unsigned long lastStepTime = 0;
-const unsigned long STEP_COOLDOWN = 300; // ms entre pasos
-float lastAcceleration = 9.8;
-const float STEP_THRESHOLD = 0.5; // Umbral más bajo para mejor detección
-int stepCounter = 0;
-bool isMoving = false;
+// Para MPU6050 (el motor de pasos va junto a la configuración del FIFO):
+// movimiento muestra a muestra para el gestor de energía, solo el procesado
+MotionPresence motionPresence;
 
 // LEDs
 const int LED_PULSE = 2;
 const int LED_READ = 19;
+const unsigned long BEAT_BLINK_DURATION = 10; // ms de parpadeo por latido
+LedEffect pulseLed(LED_PULSE);
 
-// Control de tiempo
+// Control de tiempo (intervalo_ms = 0: según el formato)
 unsigned long lastSendTime = 0;
 const unsigned long SEND_INTERVAL = 500; // Enviar cada 500ms (más rápido para gráficas)
+const unsigned long BINARY_SEND_INTERVAL = 100; // Las tramas binarias caben de sobra a 10 Hz
+std::atomic<unsigned long> sendInterval(SEND_INTERVAL); // lo fija la transmisión, lo lee el procesado
 
 // ===========================
-// SETUP
+// FORMATO DE SALIDA
 // ===========================
-void setup()
-{
-    Serial.begin(115200);
-    Wire.begin(21, 22);
+// JSON legible por defecto; -DOUTPUT_FORMAT=OUTPUT_BINARY en build_flags
+// activa las tramas binarias (~10x menos bytes por muestra) y
+// -DOUTPUT_FORMAT=OUTPUT_STREAM añade además las formas de onda completas.
+// Es solo el valor inicial: "SET formato ..." lo cambia en marcha. Los
+// perfiles prod y raw-stream ya traen el suyo (build_profile.h)
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT OUTPUT_JSON
+#endif
+
+#ifndef WAVEFORM_DELTA_ENCODING
+#define WAVEFORM_DELTA_ENCODING 1
+#endif
+
+// Acelerómetro por el FIFO del MPU6050 (100 Hz en lotes) por defecto;
+// -DACCEL_MODE=ACCEL_MODE_INTERRUPT vuelve a una lectura por dato listo (50 Hz)
+#ifndef ACCEL_MODE
+#define ACCEL_MODE ACCEL_MODE_FIFO
+#endif
+
+static_assert(BUILD.waveforms || OUTPUT_FORMAT != OUTPUT_STREAM, "este perfil no incluye OUTPUT_STREAM");
+static_assert(BUILD.fullPayload || !ENABLE_NET_UPLINK, "el uplink manda SensorFramePayload");
+
+std::atomic<OutputFormat> outputFormat(OUTPUT_FORMAT); // lo cambia la transmisión
+const AccelMode accelMode = ACCEL_MODE;
+FrameEncoder frameEncoder;
+uint8_t frameBuffer[FRAME_OVERHEAD + sizeof(SampleRecord)];
 
-    pinMode(LED_PULSE, OUTPUT);
-    pinMode(LED_READ, OUTPUT);
+// ===========================
+// INFORME POR CAMBIOS ("SET reporte delta")
+// ===========================
+// En lugar de una instantánea por intervalo, solo los campos que se salen
+// de su banda muerta, eventos sueltos (paso, latido, dedo, movimiento) y un
+// keyframe completo cada keyframe_s. Las instantáneas sin cambios no
+// consumen número de secuencia: ACK y BACKFILL siguen siendo contiguos.
+DeltaReporter deltaReporter;                // solo la transmisión
+std::atomic<bool> deltaReporting(false);    // lo fija la transmisión, lo lee el procesado
+const uint16_t MOTION_EVENT_START_MG = 60;  // histéresis de movimiento_inicio / _fin
+const uint16_t MOTION_EVENT_STOP_MG = 30;
 
-    delay(2000);
+// ===========================
+// MEMORIA: TODO RESERVADO EN EL ARRANQUE
+// ===========================
+// Tramas, colas, textos y pilas de las tareas de la canalización son
+// estáticos; historial y lotes de forma de onda salen de bootArena en
+// setup(), que se cierra antes de arrancar las tareas. El diagnóstico
+// informa del heap libre, su mínimo, el bloque más grande y la PSRAM.
+MemoryArena bootArena;
+
+const uint32_t TASK_STACK_SIZE = 4096; // bytes (StackType_t es uint8_t en ESP-IDF)
+StackType_t acquisitionStack[TASK_STACK_SIZE];
+StackType_t processingStack[TASK_STACK_SIZE];
+StackType_t transportStack[TASK_STACK_SIZE];
+StaticTask_t acquisitionTaskBuffer;
+StaticTask_t processingTaskBuffer;
+StaticTask_t transportTaskBuffer;
 
-    Serial.println("\n🎯 SISTEMA PARA GRÁFICAS EN TIEMPO REAL");
-    Serial.println("========================================\n");
+// ===========================
+// HISTORIAL Y RECUPERACIÓN TRAS CORTES
+// ===========================
+#ifndef ENABLE_HISTORY_SPILL
+#define ENABLE_HISTORY_SPILL 1
+#endif
 
-    // Inicializar MAX30105
-    Serial.print("📟 MAX30105: ");
-    if (particleSensor.begin(Wire, I2C_SPEED_FAST))
+SampleHistory sampleHistory;
+const size_t BACKFILL_BURST = 16; // tramas de historial por despertar de la transmisión
+const TickType_t BACKFILL_WAKE = pdMS_TO_TICKS(10);
+const TickType_t COMMAND_POLL_WAKE = pdMS_TO_TICKS(100);
+
+// Órdenes del host por serial (una por línea)
+char commandLine[48];
+size_t commandLength = 0;
+
+// Muestras por canal en cada lote, según el perfil: con 32, ~1.3 s de PPG y
+// 0.3-0.6 s de acelerómetro (capacidad; "SET lote" los cierra antes)
+const uint16_t WAVEFORM_BATCH_SAMPLES = WAVEFORM_BATCH_MAX;
+const WaveformEncoding WAVEFORM_ENCODING = WAVEFORM_DELTA_ENCODING ? WAVEFORM_DELTA : WAVEFORM_RAW;
+
+// ===========================
+// GESTIÓN DE ENERGÍA
+// ===========================
+// Sin dedo durante NO_FINGER_POWER_DELAY el MAX30105 pasa a proximidad (IR
+// débil a 6 Hz); quieto durante STILL_POWER_DELAY el MPU6050 pasa a modo
+// ciclo. Con ambos abajo, y solo si se activa -DENABLE_LIGHT_SLEEP=1 (en
+// batería; por USB corta la consola), la adquisición duerme en light sleep
+// entre temporizadores. Incompatible con el uplink Wi-Fi.
+#ifndef ENABLE_LIGHT_SLEEP
+#define ENABLE_LIGHT_SLEEP 0
+#endif
+#if ENABLE_NET_UPLINK
+#undef ENABLE_LIGHT_SLEEP
+#define ENABLE_LIGHT_SLEEP 0
+#endif
+
+const unsigned long NO_FINGER_POWER_DELAY = 3000;
+const unsigned long STILL_POWER_DELAY = 30000;
+PowerManager powerManager(NO_FINGER_POWER_DELAY, STILL_POWER_DELAY);
+
+// ===========================
+// CANALIZACIÓN FREERTOS (ADQUISICIÓN -> PROCESADO -> TRANSMISIÓN)
+// ===========================
+// Adquisición en el núcleo 1 (el bus I2C solo se toca desde esta tarea);
+// procesado y transmisión en el núcleo 0, que antes estaba ocioso. Así una
+// escritura lenta por UART nunca retrasa la siguiente lectura de sensores.
+// Periodo de cada lectura, arrancada por su propio temporizador hardware;
+// el pin INT del MPU6050 despierta además su propio canal de evento
+const uint32_t PPG_READ_PERIOD_US = 40000;      // vaciar FIFO al ritmo del MAX30105
+const uint32_t HEALTH_CHECK_PERIOD_US = 100000; // sondeo de salud (barato)
+const uint32_t ACCEL_FIFO_DRAIN_PERIOD_US = 100000; // ~10 muestras por ráfaga
+
+// Frecuencia de salida del MPU6050 (periodo entre muestras de acelerómetro)
+const uint32_t ACCEL_READ_PERIOD_US = accelMode == ACCEL_MODE_FIFO ? 10000 : 20000;
+
+SampleScheduler sampleScheduler;
+
+// Duración de cada etapa del camino caliente; se resume cada
+// DIAGNOSTIC_INTERVAL en una trama (o línea JSON) de diagnóstico
+StageProfiler stageProfiler;
+const unsigned long DIAGNOSTIC_INTERVAL = 5000;
+int ppgChannel = -1;
+int accelChannel = -1;
+int accelFifoChannel = -1;
+int healthChannel = -1;
+
+const BaseType_t ACQUISITION_CORE = 1;
+const BaseType_t PROCESSING_CORE = 0;
+const BaseType_t TRANSPORT_CORE = 0;
+
+const UBaseType_t I2C_BUS_PRIORITY = 6; // por encima de su único cliente, la adquisición
+const UBaseType_t ACQUISITION_PRIORITY = 5;
+const UBaseType_t PROCESSING_PRIORITY = 3;
+const UBaseType_t TRANSPORT_PRIORITY = 2;
+
+struct AccelSample
+{
+    float x, y, z;
+    float temperature;
+    unsigned long timestamp;
+    bool valid; // false si la lectura falló o el sensor está caído
+    bool still; // el MPU6050 pasa a quieto: no llegarán más hasta que se mueva
+};
+
+// Copia consistente del estado que la tarea de transmisión serializa
+struct SensorSnapshot
+{
+    SensorData data;
+    bool isMoving;
+    unsigned long timestamp;
+};
+
+// Mensajes de depuración: se imprimen desde la tarea de transmisión para no
+// intercalarse en medio de una línea JSON
+struct LogLine
+{
+    char text[64];
+};
+
+SpscQueue<PpgSample, 64> ppgQueue;         // adquisición -> procesado
+SpscQueue<AccelSample, 64> accelQueue;     // adquisición -> procesado
+SpscQueue<SensorSnapshot, 4> snapshotQueue; // procesado -> transmisión
+SpscQueue<LogLine, BUILD.logQueueSize> logQueue; // procesado -> transmisión
+SpscQueue<EventFramePayload, 16> eventQueue;     // procesado -> transmisión (modo delta)
+
+TaskHandle_t acquisitionTaskHandle = NULL;
+TaskHandle_t processingTaskHandle = NULL;
+TaskHandle_t transportTaskHandle = NULL;
+
+void acquisitionTask(void *parameter);
+void processingTask(void *parameter);
+void transportTask(void *parameter);
+
+// Solo desde la tarea de procesado (productor único de logQueue). Sin
+// BUILD.consoleMessages la llamada entera, formato incluido, desaparece
+template <typename... Args>
+void logMessage(const char *format, Args... args)
+{
+    if constexpr (BUILD.consoleMessages)
     {
-        Serial.println("✅ CONECTADO");
+        LogLine line;
+        snprintf(line.text, sizeof(line.text), format, args...);
 
-        // Configuración optimizada para respuesta rápida
-        particleSensor.setup(100, 4, 2, 100, 411, 4096); // Brillo más alto
-        particleSensor.setPulseAmplitudeRed(0x3A);       // Brillo alto para mejor lectura
-        particleSensor.setPulseAmplitudeIR(0x2A);
+        if (logQueue.push(line) && transportTaskHandle != NULL)
+            xTaskNotifyGive(transportTaskHandle);
+    }
+}
 
-        // Apagar LED verde
-        particleSensor.setPulseAmplitudeGreen(0);
+// Eventos del modo delta; en el completo no salen
+void pushEvent(SensorEventType type, unsigned long now, uint32_t value = 0)
+{
+    if constexpr (!BUILD.deltaReports)
+        return;
+    if (!deltaReporting.load(std::memory_order_relaxed))
+        return;
+
+    EventFramePayload event;
+    event.timestampMs = now;
+    event.type = type;
+    event.value = value;
+    if (eventQueue.push(event) && transportTaskHandle != NULL)
+        xTaskNotifyGive(transportTaskHandle);
+}
 
-        // Habilitar todas las funcionalidades
-        particleSensor.enableDIETEMPRDY();
+// Consola de arranque (setup()). Los fallos graves van siempre por Serial
+template <typename T>
+void consolePrint(const T &value)
+{
+    if constexpr (BUILD.consoleMessages)
+        Serial.print(value);
+}
+
+template <typename T>
+void consolePrintln(const T &value)
+{
+    if constexpr (BUILD.consoleMessages)
+        Serial.println(value);
+}
+
+void consolePrint(float value, int decimals)
+{
+    if constexpr (BUILD.consoleMessages)
+        Serial.print(value, decimals);
+}
+
+// LED de dedo y latido (pulseLed) y de actividad del MPU6050 (LED_READ)
+void showFinger(bool present)
+{
+    if constexpr (BUILD.ledFeedback)
+        pulseLed.set(present);
+}
+
+// Con el reloj de pulseLed.update(), no con la hora de la muestra: la
+// muestra del FIFO ya es vieja y el parpadeo vencería en la misma vuelta
+void showBeat()
+{
+    if constexpr (BUILD.ledFeedback)
+        pulseLed.pulse(BEAT_BLINK_DURATION, millis());
+}
+
+void toggleReadLed()
+{
+    if constexpr (BUILD.ledFeedback)
+    {
+        static bool ledState = false;
+        ledState = !ledState;
+        digitalWrite(LED_READ, ledState);
     }
+}
+
+// Lotes de forma de onda en marcha; siempre false si el perfil no los trae
+inline bool streamingWaveforms()
+{
+    return BUILD.waveforms && outputFormat == OUTPUT_STREAM;
+}
+
+// ===========================
+// INICIALIZACIÓN Y SONDEO DE SENSORES
+// ===========================
+const uint8_t MAX30105_ADDRESS = 0x57;
+const uint8_t MAX30105_REG_PART_ID = 0xFF;
+const uint8_t MAX30105_PART_ID = 0x15;
+const uint8_t MPU6050_ADDRESS = 0x68;
+const uint8_t MPU6050_WHO_AM_I = 0x75;
+
+// Bus compartido por ambos sensores (SDA 21, SCL 22) a 400 kHz: FIFOs,
+// estado y sondeos van por el planificador; la configuración, por Wire
+const int I2C_SDA_PIN = 21;
+const int I2C_SCL_PIN = 22;
+I2cBus i2cBus(I2C_NUM_0);
+int maxBusDevice = -1;
+int mpuBusDevice = -1;
+
+// Pin INT del MPU6050: movimiento, más dato listo (modo INT) o desbordamiento
+// del FIFO (modo FIFO)
+const int MPU_INT_PIN = 4;
+// Con el DLPF activo la base es 1 kHz: salida = 1 kHz / (1 + div), o sea
+// un periodo de (1 + div) ms
+const uint8_t MPU_SAMPLE_RATE_DIVIDER = ACCEL_READ_PERIOD_US / 1000 - 1;
+static_assert(ACCEL_READ_PERIOD_US % 1000 == 0 &&
+                  1000 / (1 + MPU_SAMPLE_RATE_DIVIDER) == 1000000 / ACCEL_READ_PERIOD_US,
+              "SMPLRT_DIV no da el periodo del acelerómetro");
+const uint8_t MPU_MOTION_THRESHOLD = 20;        // ~40 mg sobre el paso alto de 5 Hz
+const uint8_t MPU_MOTION_DURATION = 1;          // ms
+const float MPU_ACCEL_SCALE = 9.80665f / 8192.0f; // m/s² por cuenta a ±4 g
+
+// Sin movimiento durante MPU_STILL_TIMEOUT se deja solo la interrupción de
+// movimiento y la adquisición del acelerómetro duerme hasta que vuelva
+const unsigned long MPU_STILL_TIMEOUT = 5000;
+const unsigned long MPU_TEMPERATURE_INTERVAL = 1000; // temperatura de tarde en tarde
+const unsigned long ACCEL_STALL_TIMEOUT = 500;       // sin dato listo = INT perdido
+const uint8_t MPU_FIFO_MAX_BURST = 64;               // muestras por vaciado como mucho
+// 100 ms a 100 Hz = 10 muestras por vaciado, con margen hasta la ráfaga
+// máxima y el FIFO del chip si un vaciado llega tarde
+const uint32_t MPU_FIFO_SAMPLES_PER_DRAIN = ACCEL_FIFO_DRAIN_PERIOD_US / ACCEL_READ_PERIOD_US;
+static_assert(accelMode != ACCEL_MODE_FIFO ||
+                  (ACCEL_FIFO_DRAIN_PERIOD_US % ACCEL_READ_PERIOD_US == 0 &&
+                   2 * MPU_FIFO_SAMPLES_PER_DRAIN <= MPU_FIFO_MAX_BURST &&
+                   MPU_FIFO_MAX_BURST <= Mpu6050Raw::FIFO_SIZE / Mpu6050Raw::FIFO_SAMPLE_BYTES),
+              "el vaciado del FIFO no cuadra con la frecuencia del MPU6050");
+
+Mpu6050Raw mpuRaw(i2cBus, MPU6050_ADDRESS);
+
+// Estado del MPU6050, solo desde la tarea de adquisición (y setup())
+bool mpuStill = false;
+unsigned long lastMotionTime = 0;
+unsigned long lastAccelTime = 0;
+unsigned long lastTemperatureTime = 0;
+
+// Muestras de acelerómetro entregadas y las del último vaciado del FIFO:
+// el diagnóstico las usa para comprobar la frecuencia real del sensor
+std::atomic<uint32_t> accelSampleCount(0);
+std::atomic<uint8_t> accelLastBurst(0);
+float mpuTemperature = 25.0;
+
+// Configuración del FIFO por defecto: 100 Hz con promedio de 4 = una
+// muestra cada 40 ms ("SET ppg_hz" / "SET ppg_promedio" la cambian)
+const int PPG_SAMPLE_RATE = 100;
+const int PPG_SAMPLE_AVERAGE = 4;
+const unsigned long PPG_SAMPLE_PERIOD = 1000UL * PPG_SAMPLE_AVERAGE / PPG_SAMPLE_RATE;
+
+// Proximidad en bajo consumo: 50 Hz con promedio de 8 = una muestra cada
+// 160 ms, solo IR y a poca corriente; basta para ver que llega un dedo
+const int PPG_LOW_SAMPLE_RATE = 50;
+const int PPG_LOW_SAMPLE_AVERAGE = 8;
+const unsigned long PPG_LOW_SAMPLE_PERIOD = 1000UL * PPG_LOW_SAMPLE_AVERAGE / PPG_LOW_SAMPLE_RATE;
+const uint32_t PPG_LOW_READ_PERIOD_US = PPG_LOW_SAMPLE_PERIOD * 1000;
+const uint8_t PPG_PROXIMITY_AMPLITUDE = 0x0A;
+const int32_t PROXIMITY_IR_THRESHOLD = 5000; // IR con dedo a 0x0A (~1/4 que a 0x2A)
+
+// Medida completa: se arranca con IR 0x2A, rojo 0x3A y rango de 4096 nA, y
+// el AGC ajusta luego cada LED y el rango según la DC. El umbral de dedo se
+// compara con el IR llevado a esta configuración
+const LedSettings LED_DEFAULTS = {0x2A, 0x3A, 1};
+const uint32_t FINGER_IR_THRESHOLD = 30000;
+const uint8_t LED_ADC_RANGE_BITS[LED_ADC_RANGE_COUNT] = {MAX30105_ADCRANGE_2048, MAX30105_ADCRANGE_4096,
+                                                          MAX30105_ADCRANGE_8192, MAX30105_ADCRANGE_16384};
+LedAgc ledAgc(LED_DEFAULTS);
+const unsigned long PPG_STALL_TIMEOUT = 1000; // ms sin muestras = FIFO atascado
+
+PpgAcquisition ppgAcquisition(i2cBus, MAX30105_ADDRESS);
+
+// Lotes de forma de onda (solo en OUTPUT_STREAM)
+WaveformBatcher ppgWaveform(WAVEFORM_PPG, 2, WAVEFORM_BATCH_SAMPLES, PPG_SAMPLE_PERIOD);
+
+// Cadena del latido en coma fija (lib/WalkAlgorithms): DC fuera -> paso
+// banda -> picos, con SpO2 y HRV por latido
+PpgPipelineConfig ppgPipelineConfig(unsigned long periodMs)
+{
+    PpgPipelineConfig config(1000.0f / periodMs);
+    config.spo2 = BUILD.spo2Hrv;
+    return config;
+}
+
+PpgPipeline ppgPipeline(ppgPipelineConfig(PPG_SAMPLE_PERIOD));
+WaveformBatcher accelWaveform(WAVEFORM_ACCEL, 3, WAVEFORM_BATCH_SAMPLES, ACCEL_READ_PERIOD_US / 1000);
+
+// Pasos a la frecuencia completa del acelerómetro, por lotes de magnitudes;
+// el mismo lote da el nivel de movimiento con el que la cadena PPG descarta
+// los latidos de artefacto
+StepEngine stepEngine(1000000.0f / ACCEL_READ_PERIOD_US);
+MotionEstimator motionEstimator(1000000.0f / ACCEL_READ_PERIOD_US);
+const size_t STEP_BATCH_SIZE = 64;
+int32_t stepBatchMagnitude[STEP_BATCH_SIZE]; // mg
+unsigned long stepBatchTime[STEP_BATCH_SIZE];
+size_t stepBatchCount = 0;
+uint8_t waveformFrameBuffer[FRAME_OVERHEAD + sizeof(WaveformHeader) +
+                            sizeof(int32_t) * WaveformBatcher::MAX_CHANNELS * WAVEFORM_BATCH_SAMPLES];
+
+// ===========================
+// CONFIGURACIÓN EN MARCHA (ÓRDENES DEL HOST, NVS)
+// ===========================
+// Las constantes de arriba son solo el punto de partida: "SET clave valor"
+// las cambia sin reflashear y "SAVE" las deja en NVS para el siguiente
+// arranque. La transmisión recibe las órdenes y es la dueña de
+// activeConfig: formato, intervalo y lote los aplica ella misma; lo del
+// MAX30105 lo pide por requestedPpgConfig y lo aplica la adquisición,
+// dueña del bus, como el AGC o el modo de energía.
+DeviceConfig makeDefaultConfig()
+{
+    DeviceConfig config;
+    config.version = DEVICE_CONFIG_VERSION;
+    config.outputFormat = OUTPUT_FORMAT;
+    config.sendIntervalMs = 0;
+    config.waveformBatch = WAVEFORM_BATCH_SAMPLES;
+    config.ppgSampleRate = PPG_SAMPLE_RATE;
+    config.ppgSampleAverage = PPG_SAMPLE_AVERAGE;
+    config.ledIrAmplitude = LED_DEFAULTS.irAmplitude;
+    config.ledRedAmplitude = LED_DEFAULTS.redAmplitude;
+    config.adcRange = LED_DEFAULTS.adcRange;
+    config.reportMode = REPORT_FULL;
+    config.deadbandPercent = 100;
+    config.keyframeIntervalS = 30;
+    return config;
+}
+
+ConfigStore configStore;
+DeviceConfig activeConfig; // solo la transmisión (y setup())
+DeviceConfig savedConfig;  // lo que hay en NVS, si configSaved
+bool configSaved = false;
+std::atomic<uint32_t> requestedPpgConfig(0); // transmisión -> adquisición
+
+// Lo aplicado al MAX30105: solo la adquisición (y setup())
+DeviceConfig ppgConfig;
+uint32_t appliedPpgConfig = 0;
+uint32_t ppgReadPeriodUs = PPG_READ_PERIOD_US;
+
+// Periodo de las muestras a ritmo completo; se publica antes del
+// markApplied del AGC, con el que el procesado lo adopta en la frontera
+std::atomic<unsigned long> ppgSamplePeriod(PPG_SAMPLE_PERIOD);
+unsigned long pipelinePeriod = PPG_SAMPLE_PERIOD; // solo procesado
+
+// Vaciar el FIFO cada 40 ms, o a cada muestra si son más lentas
+uint32_t ppgReadPeriodFor(const DeviceConfig &config)
+{
+    uint32_t periodUs = ppgSamplePeriodMs(config) * 1000;
+    return periodUs > PPG_READ_PERIOD_US ? periodUs : PPG_READ_PERIOD_US;
+}
+
+// Formato, intervalo y lote (transmisión, o setup()). Los lotes ya están
+// reservados desde el arranque; sin ellos OUTPUT_STREAM se queda en binario
+void applyOutputConfig(const DeviceConfig &config)
+{
+    OutputFormat format = (OutputFormat)config.outputFormat;
+    if (format == OUTPUT_STREAM && !(BUILD.waveforms && ppgWaveform.isReady() && accelWaveform.isReady()))
+        format = OUTPUT_BINARY;
+
+    ppgWaveform.setBatchSize(config.waveformBatch);
+    accelWaveform.setBatchSize(config.waveformBatch);
+    outputFormat = format;
+
+    if (config.sendIntervalMs > 0)
+        sendInterval = config.sendIntervalMs;
     else
+        sendInterval = format == OUTPUT_JSON ? SEND_INTERVAL : BINARY_SEND_INTERVAL;
+
+    // Cualquier cambio de configuración arranca con un keyframe
+    if constexpr (BUILD.deltaReports)
     {
-        Serial.println("❌ NO CONECTADO");
+        deltaReporter.configure(config.keyframeIntervalS, config.deadbandPercent);
+        deltaReporting = config.reportMode == REPORT_DELTA;
     }
+}
 
-    // Inicializar MPU6050
-    Serial.print("📊 MPU6050: ");
-    if (mpu.begin())
+// Medida completa o proximidad de bajo consumo
+void configureMax30105(bool lowPower)
+{
+    if (lowPower)
     {
-        Serial.println("✅ CONECTADO");
-        mpu.setAccelerometerRange(MPU6050_RANGE_4_G);
-        mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
+        particleSensor.setup(PPG_PROXIMITY_AMPLITUDE, PPG_LOW_SAMPLE_AVERAGE, 2, PPG_LOW_SAMPLE_RATE, 411, 4096);
+        particleSensor.setPulseAmplitudeRed(0);
+        particleSensor.setPulseAmplitudeIR(PPG_PROXIMITY_AMPLITUDE);
     }
     else
     {
-        Serial.println("❌ NO CONECTADO");
+        // Configuración optimizada para respuesta rápida; el AGC parte de aquí
+        LedSettings led = ledAgc.getDefaults();
+        particleSensor.setup(100, ppgConfig.ppgSampleAverage, 2, ppgConfig.ppgSampleRate, 411,
+                             ledAdcRangeNa(led.adcRange));
+        particleSensor.setPulseAmplitudeRed(led.redAmplitude);
+        particleSensor.setPulseAmplitudeIR(led.irAmplitude);
     }
 
-    Serial.println("\n⚡ SISTEMA LISTO PARA GRÁFICAS");
-    Serial.println("👆 Pon tu dedo en el sensor MAX30105");
-    Serial.println("🎯 Agita el MPU6050 para contar 'pasos'");
-    Serial.println("📈 Datos se envían cada 500ms");
-    Serial.println("========================================\n");
+    // Apagar LED verde
+    particleSensor.setPulseAmplitudeGreen(0);
+
+    // Habilitar todas las funcionalidades
+    particleSensor.enableDIETEMPRDY();
 
-    // Inicializar array de latidos
-    for (int i = 0; i < BEAT_ARRAY_SIZE; i++)
+    // Empezar a vaciar el FIFO desde cero
+    unsigned long period = lowPower ? PPG_LOW_SAMPLE_PERIOD : ppgSamplePeriodMs(ppgConfig);
+    ppgAcquisition.begin(period, millis());
+    if (!lowPower)
     {
-        beatArray[i] = 0;
+        ppgSamplePeriod.store(period, std::memory_order_relaxed);
+        ledAgc.markApplied(ledAgc.getDefaults(), ppgAcquisition.getLastSampleTime());
     }
 }
 
-// ===========================
-// FUNCIÓN PARA CALCULAR SpO2 MEJORADA
-// ===========================
-float calculateSpO2(int32_t ir, int32_t red)
+// Aplica lo que pida el AGC justo tras vaciar el FIFO: las muestras ya
+// leídas son las últimas con la configuración anterior
+void applyLedAgc()
+{
+    if constexpr (!BUILD.ledAgc)
+        return;
+
+    LedSettings led;
+    if (powerManager.isPpgLowPower() || !ledAgc.getPending(led))
+        return;
+
+    particleSensor.setPulseAmplitudeIR(led.irAmplitude);
+    particleSensor.setPulseAmplitudeRed(led.redAmplitude);
+    particleSensor.setADCRange(LED_ADC_RANGE_BITS[led.adcRange]);
+    ledAgc.markApplied(led, ppgAcquisition.getLastSampleTime());
+}
+
+bool initMax30105()
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_SENSOR_INIT);
+    if (!particleSensor.begin(Wire, I2cBus::CLOCK_HZ))
+        return false;
+
+    // Tras un reinicio, volver al modo que estuviera aplicado
+    configureMax30105(powerManager.isPpgLowPower());
+    return true;
+}
+
+// Fuentes de INT mientras hay actividad (en reposo, solo movimiento)
+uint8_t activeMpuInterrupts()
 {
-    if (ir < 20000 || red < 5000) // Umbral más bajo para detección temprana
-        return 0;
+    uint8_t samples = accelMode == ACCEL_MODE_FIFO ? MPU6050_INT_FIFO_OVERFLOW : MPU6050_INT_DATA_READY;
+    return samples | MPU6050_INT_MOTION;
+}
+
+bool initMpu6050()
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_SENSOR_INIT);
+    if (!mpu.begin())
+        return false;
+
+    mpu.setAccelerometerRange(MPU6050_RANGE_4_G);
+    mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
+
+    // El giroscopio nunca se lee: en espera ahorra ~3 mA. Tras un reinicio
+    // el chip sale del modo ciclo, así que el estado aplicado lo refleja
+    if (!mpuRaw.setAccelOnly())
+        return false;
+    powerManager.setApplied(powerManager.getApplied() & ~POWER_ACCEL_LOW);
+
+    // Tras (re)inicializar, interrupciones activas y datos frescos
+    mpuStill = false;
+    lastMotionTime = millis();
+    lastAccelTime = lastMotionTime;
+    if (!mpuRaw.configureInterrupts(MPU_SAMPLE_RATE_DIVIDER, MPU_MOTION_THRESHOLD,
+                                    MPU_MOTION_DURATION))
+        return false;
+
+    if (accelMode == ACCEL_MODE_FIFO)
+        return mpuRaw.setInterruptSources(activeMpuInterrupts()) && mpuRaw.enableFifo();
+    return true;
+}
 
-    // Fórmula mejorada para rango más realista
-    float ratio = (float)red / (float)ir;
+// Lectura de un solo registro, sin resetear ni reconfigurar el chip
+bool probeMax30105()
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_PROBE);
+    uint8_t partId;
+    return i2cBus.readRegisters(MAX30105_ADDRESS, MAX30105_REG_PART_ID, &partId, 1) &&
+           partId == MAX30105_PART_ID;
+}
 
-    // Ajustar fórmula para valores más realistas
-    float spO2 = 104.0 - (17.0 * ratio); // Ajustado para mejor rango
+bool probeMpu6050()
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_PROBE);
+    uint8_t whoAmI;
+    return mpuRaw.readRegisters(MPU6050_WHO_AM_I, &whoAmI, 1) && whoAmI == MPU6050_ADDRESS;
+}
 
-    // Limitar a rango razonable pero permitir variación
-    if (spO2 < 70.0)
-        spO2 = 0; // Si es muy bajo, devolver 0
-    if (spO2 > 100.0)
-        spO2 = 100.0;
+SensorHealthMonitor maxHealth(probeMax30105, initMax30105);
+SensorHealthMonitor mpuHealth(probeMpu6050, initMpu6050);
 
-    return spO2;
+// Solo avisa a la tarea de adquisición; el bus se lee fuera de la ISR
+void IRAM_ATTR onMpuInterrupt()
+{
+    sampleScheduler.notifyFromIsr(accelChannel);
 }
 
 // ===========================
-// FUNCIÓN PARA DETECTAR PASOS MEJORADA
+// SETUP
 // ===========================
-void detectStep(float currentAccel)
+void setup()
 {
-    unsigned long currentTime = millis();
+    serialOutput.begin(115200);
 
-    // Calcular cambio en aceleración
-    float accelChange = abs(currentAccel - lastAcceleration);
+    // El bus antes que nada: la inicialización de los sensores ya lo usa
+    maxBusDevice = i2cBus.addDevice("max30105", MAX30105_ADDRESS);
+    mpuBusDevice = i2cBus.addDevice("mpu6050", MPU6050_ADDRESS);
+    bool busReady = i2cBus.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2cBus::CLOCK_HZ, ACQUISITION_CORE, I2C_BUS_PRIORITY);
 
-    // Si el cambio es significativo y ha pasado el tiempo de cooldown
-    if (accelChange > STEP_THRESHOLD && (currentTime - lastStepTime) > STEP_COOLDOWN)
+    if constexpr (BUILD.ledFeedback)
     {
-        stepCounter++;
-        lastStepTime = currentTime;
+        pulseLed.begin();
+        pinMode(LED_READ, OUTPUT);
+    }
 
-        // Solo mostrar cada 5 pasos para no saturar serial
-        if (stepCounter % 5 == 0)
+    // Tiempo para abrir el monitor serie y no perder el banner
+    if constexpr (BUILD.consoleMessages)
+        delay(2000);
+
+    consolePrintln("\n🎯 SISTEMA PARA GRÁFICAS EN TIEMPO REAL");
+    consolePrintln("========================================\n");
+
+    if (!busReady)
+        Serial.println("❌ No se pudo arrancar el bus I2C");
+
+    // Configuración: la guardada en NVS o, si no hay, la de compilación
+    activeConfig = makeDefaultConfig();
+    configSaved = configStore.load(activeConfig);
+    savedConfig = activeConfig;
+    ppgConfig = activeConfig;
+    appliedPpgConfig = packPpgConfig(ppgConfig);
+    requestedPpgConfig.store(appliedPpgConfig);
+    LedSettings led = {ppgConfig.ledIrAmplitude, ppgConfig.ledRedAmplitude, ppgConfig.adcRange};
+    ledAgc.setDefaults(led);
+    ppgReadPeriodUs = ppgReadPeriodFor(ppgConfig);
+    consolePrint("🧩 Perfil: ");
+    consolePrintln(BUILD.name);
+    consolePrintln(configSaved ? "⚙️ Configuración: guardada en NVS" : "⚙️ Configuración: por defecto");
+
+    // Inicializar MAX30105
+    consolePrint("📟 MAX30105: ");
+    bool maxConnected = initMax30105();
+    maxHealth.begin(maxConnected, millis());
+    consolePrintln(maxConnected ? "✅ CONECTADO" : "❌ NO CONECTADO");
+
+    // Inicializar MPU6050
+    consolePrint("📊 MPU6050: ");
+    bool mpuConnected = initMpu6050();
+    mpuHealth.begin(mpuConnected, millis());
+    consolePrintln(mpuConnected ? "✅ CONECTADO" : "❌ NO CONECTADO");
+
+    // Consumo estimado por estado (tablas de los datasheets, sin sueño)
+    consolePrint("🔋 Consumo estimado (mA): activo ");
+    consolePrint(PowerManager::componentCurrentUa(POWER_ACTIVE, 0) / 1000.0f, 1);
+    consolePrint(" | sin dedo ");
+    consolePrint(PowerManager::componentCurrentUa(POWER_NO_FINGER, 0) / 1000.0f, 1);
+    consolePrint(" | quieto ");
+    consolePrint(PowerManager::componentCurrentUa(POWER_STILL, 0) / 1000.0f, 1);
+    consolePrint(" | reposo ");
+    consolePrint(PowerManager::componentCurrentUa(POWER_IDLE, 0) / 1000.0f, 1);
+    consolePrintln(ENABLE_LIGHT_SLEEP ? " (light sleep activo)" : "");
+
+    consolePrintln("\n⚡ SISTEMA LISTO PARA GRÁFICAS");
+    consolePrintln("👆 Pon tu dedo en el sensor MAX30105");
+    consolePrintln("🎯 Agita el MPU6050 para contar 'pasos'");
+
+    // Lotes reservados en el perfil que los trae, se arranque o no en
+    // OUTPUT_STREAM: "SET formato stream" no puede reservar más tarde
+    if (BUILD.waveforms && !(ppgWaveform.begin(bootArena) && accelWaveform.begin(bootArena)))
+        Serial.println("❌ Sin memoria para lotes de forma de onda, OUTPUT_STREAM no disponible");
+    applyOutputConfig(activeConfig);
+    consolePrint("📈 Datos se envían cada ");
+    consolePrint(sendInterval.load());
+    consolePrintln(outputFormat == OUTPUT_JSON ? "ms (JSON)" : "ms (tramas binarias)");
+
+    if constexpr (BUILD.sampleHistory)
+    {
+        if (sampleHistory.begin(bootArena, ENABLE_HISTORY_SPILL))
+        {
+            consolePrint("🗂️ Historial: ");
+            consolePrint(sampleHistory.getCapacity());
+            consolePrintln(" muestras");
+        }
+        else
         {
-            Serial.print("👣 Paso #");
-            Serial.println(stepCounter);
+            Serial.println("❌ Historial: SIN MEMORIA");
         }
     }
 
-    lastAcceleration = currentAccel;
+    bootArena.seal();
+    HeapStats heap = MemoryArena::readHeapStats();
+    consolePrint("🧮 Memoria: arena ");
+    consolePrint((bootArena.getReservedBytes(MEMORY_INTERNAL) + 512) / 1024);
+    consolePrint(" KB interna + ");
+    consolePrint((bootArena.getReservedBytes(MEMORY_PSRAM) + 512) / 1024);
+    consolePrint(" KB PSRAM | heap libre ");
+    consolePrint(heap.internalFree / 1024);
+    consolePrint(" KB (bloque máx. ");
+    consolePrint(heap.internalLargest / 1024);
+    consolePrintln(" KB)");
+    consolePrintln("========================================\n");
+
+    // Cada sensor con su propio periodo fijo; el MPU6050 por interrupción.
+    // Registrados antes de las tareas, que ya leen los índices (y sus
+    // estadísticas) desde su primera vuelta
+    ppgChannel = sampleScheduler.addChannel("ppg", ppgReadPeriodUs);
+    accelChannel = sampleScheduler.addEventChannel("accel");
+    if (accelMode == ACCEL_MODE_FIFO)
+        accelFifoChannel = sampleScheduler.addChannel("accel_fifo", ACCEL_FIFO_DRAIN_PERIOD_US);
+    healthChannel = sampleScheduler.addChannel("health", HEALTH_CHECK_PERIOD_US);
+
+    // Arrancar la canalización: consumidores primero para que los avisos
+    // de la adquisición siempre tengan destino. Pilas y TCB estáticos
+    transportTaskHandle = xTaskCreateStaticPinnedToCore(transportTask, "transport", TASK_STACK_SIZE, NULL,
+                                                        TRANSPORT_PRIORITY, transportStack,
+                                                        &transportTaskBuffer, TRANSPORT_CORE);
+    processingTaskHandle = xTaskCreateStaticPinnedToCore(processingTask, "processing", TASK_STACK_SIZE, NULL,
+                                                         PROCESSING_PRIORITY, processingStack,
+                                                         &processingTaskBuffer, PROCESSING_CORE);
+    acquisitionTaskHandle = xTaskCreateStaticPinnedToCore(acquisitionTask, "acquisition", TASK_STACK_SIZE, NULL,
+                                                          ACQUISITION_PRIORITY, acquisitionStack,
+                                                          &acquisitionTaskBuffer, ACQUISITION_CORE);
+
+    // Temporizadores en marcha ya con la tarea que recibe sus avisos
+    if (!sampleScheduler.start(acquisitionTaskHandle))
+        Serial.println("❌ No se pudo arrancar el temporizador de muestreo");
+
+    pinMode(MPU_INT_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(MPU_INT_PIN), onMpuInterrupt, RISING);
+
+#if ENABLE_NET_UPLINK
+    bool uplinkReady = netUplink.begin();
+    consolePrint("📡 Uplink MQTT: ");
+    consolePrintln(uplinkReady ? "✅ ACTIVO" : "❌ SIN CONFIGURAR (WIFI_SSID / MQTT_HOST)");
+#endif
+}
+
+// ===========================
+// PASOS: MOTOR ADAPTATIVO SOBRE EL LOTE ACUMULADO
+// ===========================
+// El movimiento de motionPresence cambia muestra a muestra; los eventos
+// siguen al nivel ya promediado por ventana, con histéresis
+void reportMotionLevel(unsigned long now)
+{
+    static bool movingEvent = false;
+    if (!movingEvent && sensorData.motionMg >= MOTION_EVENT_START_MG)
+    {
+        movingEvent = true;
+        pushEvent(EVENT_MOTION_START, now, sensorData.motionMg);
+    }
+    else if (movingEvent && sensorData.motionMg < MOTION_EVENT_STOP_MG)
+    {
+        movingEvent = false;
+        pushEvent(EVENT_MOTION_STOP, now, sensorData.motionMg);
+    }
+}
+
+void runStepEngine()
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_STEP_ENGINE);
+    if (stepBatchCount == 0)
+        return;
+
+    uint32_t before = stepEngine.getStepCount();
+    stepEngine.process(stepBatchMagnitude, stepBatchTime, stepBatchCount);
+    motionEstimator.process(stepBatchMagnitude, stepBatchCount);
+    stepBatchCount = 0;
+
+    sensorData.stepCount = stepEngine.getStepCount();
+    sensorData.cadence = stepEngine.getCadence();
+    sensorData.strideRegularity = stepEngine.getRegularity();
+    sensorData.motionMg = motionEstimator.getLevelMg();
+    ppgPipeline.setMotion(sensorData.motionMg, sensorData.cadence);
+
+    unsigned long now = millis();
+    if (sensorData.stepCount != before)
+        pushEvent(EVENT_STEP, now, sensorData.stepCount);
+    reportMotionLevel(now);
+
+    // Solo mostrar cada 5 pasos para no saturar serial
+    if (sensorData.stepCount / 5 != before / 5)
+    {
+        logMessage("👣 Paso #%u (%u pasos/min)", (unsigned)sensorData.stepCount,
+                   (unsigned)sensorData.cadence);
+    }
 }
 
 // ===========================
 // FUNCIÓN PARA ENVIAR DATOS (JSON)
 // ===========================
-void sendSensorData()
+// Toda la línea se formatea en un único buffer estático y sale en una sola
+// escritura no bloqueante. El buffer es solo de la tarea de transmisión.
+char textStorage[1536]; // la línea de diagnóstico es la más larga
+TextBuffer textBuffer(textStorage, sizeof(textStorage));
+
+// LED, energía y jitter: solo en los perfiles con JSON completo
+void appendJsonDetails(TextBuffer &json, const SensorData &sensorData)
 {
-    unsigned long currentTime = millis();
+    json.append(",\"led\":{");
+    json.append("\"ir_ma\":").appendFixed(ledAmplitudeUa(sensorData.led.irAmplitude) / 1000.0f, 1);
+    json.append(",\"rojo_ma\":").appendFixed(ledAmplitudeUa(sensorData.led.redAmplitude) / 1000.0f, 1);
+    json.append(",\"rango_na\":").appendUInt(ledAdcRangeNa(sensorData.led.adcRange));
+    json.append(",\"ajustes\":").appendUInt(sensorData.ledAdjustments);
+    json.append('}');
+
+    // Jitter de muestreo (µs) de la última ventana de 5 s
+    SampleScheduler::ChannelStats ppgStats = sampleScheduler.getStats(ppgChannel);
+    SampleScheduler::ChannelStats accelStats =
+        sampleScheduler.getStats(accelFifoChannel >= 0 ? accelFifoChannel : accelChannel);
+
+    PowerManager::StateReport power = powerManager.getReport(powerManager.getApplied());
+    json.append(",\"energia\":{");
+    json.append("\"estado\":").appendUInt(powerManager.getApplied());
+    json.append(",\"corriente_ma\":").appendFixed(power.currentUa / 1000.0f, 1);
+    json.append(",\"sueno_pct\":").appendUInt(power.sleepPercent);
+    json.append('}');
+
+    json.append(",\"jitter_us\":{");
+    json.append("\"max30102\":").appendUInt(ppgStats.meanJitterUs);
+    json.append(",\"max30102_max\":").appendUInt(ppgStats.maxJitterUs);
+    json.append(",\"mpu6050\":").appendUInt(accelStats.meanJitterUs);
+    json.append(",\"mpu6050_max\":").appendUInt(accelStats.maxJitterUs);
+    json.append(",\"perdidos\":").appendUInt(ppgStats.missedCount + accelStats.missedCount);
+    json.append('}');
+}
 
-    // Crear JSON
-    Serial.print("{");
+void sendSensorData(const SensorSnapshot &snapshot, uint32_t sequence)
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_JSON);
+    const SensorData &sensorData = snapshot.data;
+    TextBuffer &json = textBuffer;
+    json.clear();
 
     // Timestamp (en segundos con decimales para gráficas)
-    Serial.print("\"timestamp\":");
-    Serial.print(currentTime / 1000.0, 3);
-    Serial.print(",");
+    json.append("{\"timestamp\":").appendMillisAsSeconds(snapshot.timestamp);
+    json.append(",\"seq\":").appendUInt(sequence);
 
     // ===== DATOS MAX30105 - SIEMPRE PRESENTES =====
-    Serial.print("\"spo2\":");
-    Serial.print(sensorData.spO2, 1);
-    Serial.print(",\"ritmo_cardiaco\":");
-    Serial.print(sensorData.heartRate);
-    Serial.print(",\"ir_value\":");
-    Serial.print(sensorData.irValue);
-    Serial.print(",\"red_value\":");
-    Serial.print(sensorData.redValue);
-    Serial.print(",\"finger_detected\":");
-    Serial.print(sensorData.fingerDetected ? "true" : "false");
-    Serial.print(",");
+    // (SpO2 y HRV solo en los perfiles que los calculan)
+    if constexpr (BUILD.spo2Hrv)
+        json.append(",\"spo2\":").appendFixed(sensorData.spO2, 1);
+    json.append(",\"ritmo_cardiaco\":").appendInt(sensorData.heartRate);
+    if constexpr (BUILD.spo2Hrv)
+    {
+        json.append(",\"rr_ms\":").appendUInt(sensorData.rrInterval);
+        json.append(",\"rmssd_ms\":").appendUInt(sensorData.rmssd);
+        json.append(",\"sdnn_ms\":").appendUInt(sensorData.sdnn);
+    }
+    json.append(",\"calidad_senal\":").appendUInt(sensorData.signalQuality);
+    json.append(",\"ir_value\":").appendInt(sensorData.irValue);
+    json.append(",\"red_value\":").appendInt(sensorData.redValue);
+    json.append(",\"finger_detected\":").appendBool(sensorData.fingerDetected);
 
     // ===== DATOS MPU6050 - SIEMPRE PRESENTES =====
     float accelTotal = sqrt(sensorData.accelX * sensorData.accelX +
                             sensorData.accelY * sensorData.accelY +
                             sensorData.accelZ * sensorData.accelZ);
 
-    Serial.print("\"acel_x\":");
-    Serial.print(sensorData.accelX, 2);
-    Serial.print(",\"acel_y\":");
-    Serial.print(sensorData.accelY, 2);
-    Serial.print(",\"acel_z\":");
-    Serial.print(sensorData.accelZ, 2);
-    Serial.print(",\"acel_total\":");
-    Serial.print(accelTotal, 2);
-    Serial.print(",\"temperatura\":");
-    Serial.print(sensorData.temperature, 1);
-    Serial.print(",\"pasos_totales\":");
-    Serial.print(sensorData.stepCount);
-    Serial.print(",\"is_moving\":");
-    Serial.print(isMoving ? "true" : "false");
-    Serial.print(",");
+    json.append(",\"acel_x\":").appendFixed(sensorData.accelX, 2);
+    json.append(",\"acel_y\":").appendFixed(sensorData.accelY, 2);
+    json.append(",\"acel_z\":").appendFixed(sensorData.accelZ, 2);
+    json.append(",\"acel_total\":").appendFixed(accelTotal, 2);
+    json.append(",\"temperatura\":").appendFixed(sensorData.temperature, 1);
+    json.append(",\"pasos_totales\":").appendUInt(sensorData.stepCount);
+    json.append(",\"cadencia\":").appendUInt(sensorData.cadence);
+    json.append(",\"regularidad_zancada\":").appendUInt(sensorData.strideRegularity);
+    json.append(",\"is_moving\":").appendBool(snapshot.isMoving);
+    json.append(",\"movimiento_mg\":").appendUInt(sensorData.motionMg);
+
+    // Estado sensores (cacheado por los monitores de salud, sin tocar el bus)
+    json.append(",\"sensor_status\":{");
+    json.append("\"max30102\":").appendBool(maxHealth.isOnline());
+    json.append(",\"mpu6050\":").appendBool(mpuHealth.isOnline());
+    json.append(",\"max30102_reconexiones\":").appendUInt(maxHealth.getReconnectCount());
+    json.append(",\"mpu6050_reconexiones\":").appendUInt(mpuHealth.getReconnectCount());
+    json.append('}');
+
+    if constexpr (BUILD.fullJson)
+        appendJsonDetails(json, sensorData);
+
+#if ENABLE_NET_UPLINK
+    json.append(",\"uplink\":{");
+    json.append("\"conectado\":").appendBool(netUplink.isConnected());
+    json.append(",\"pendientes\":").appendUInt(netUplink.getPendingCount());
+    json.append(",\"descartados\":").appendUInt(netUplink.getDroppedCount());
+    json.append('}');
+#endif
+
+    json.append("}\r\n");
+
+    // Una línea truncada no sería JSON válido: mejor no enviarla
+    if (!json.overflowed())
+        serialOutput.write(json.bytes(), json.size());
+}
+
+// ===========================
+// FUNCIÓN PARA ENVIAR DATOS (TRAMA BINARIA)
+// ===========================
+int16_t toFixed16(float value, float scale)
+{
+    float scaled = value * scale;
+    if (scaled > 32767.0f)
+        return 32767;
+    if (scaled < -32768.0f)
+        return -32768;
+    return (int16_t)lroundf(scaled);
+}
+
+void buildSensorPayload(const SensorSnapshot &snapshot, SensorFramePayload &payload)
+{
+    const SensorData &sensorData = snapshot.data;
+
+    payload.timestampMs = snapshot.timestamp;
+    payload.spo2x10 = (uint16_t)lroundf(sensorData.spO2 * 10.0f);
+    payload.heartRate = (uint8_t)constrain(sensorData.heartRate, 0, 255);
+
+    payload.flags = 0;
+    if (sensorData.fingerDetected)
+        payload.flags |= SENSOR_FLAG_FINGER;
+    if (snapshot.isMoving)
+        payload.flags |= SENSOR_FLAG_MOVING;
+    if (maxHealth.isOnline())
+        payload.flags |= SENSOR_FLAG_MAX_ONLINE;
+    if (mpuHealth.isOnline())
+        payload.flags |= SENSOR_FLAG_MPU_ONLINE;
+
+    payload.irValue = sensorData.irValue;
+    payload.redValue = sensorData.redValue;
+    payload.accelX = toFixed16(sensorData.accelX, 100.0f);
+    payload.accelY = toFixed16(sensorData.accelY, 100.0f);
+    payload.accelZ = toFixed16(sensorData.accelZ, 100.0f);
+    payload.temperature = toFixed16(sensorData.temperature, 100.0f);
+    payload.stepCount = sensorData.stepCount;
+    payload.maxReconnects = (uint8_t)min(maxHealth.getReconnectCount(), (uint32_t)255);
+    payload.mpuReconnects = (uint8_t)min(mpuHealth.getReconnectCount(), (uint32_t)255);
+    payload.rrIntervalMs = sensorData.rrInterval;
+    payload.rmssdMs = sensorData.rmssd;
+    payload.sdnnMs = sensorData.sdnn;
+    payload.cadence = (uint8_t)min(sensorData.cadence, (uint16_t)255);
+    payload.strideRegularity = sensorData.strideRegularity;
+    payload.signalQuality = sensorData.signalQuality;
+}
+
+void sendSensorFrame(const SampleRecord &record, FrameType type)
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_FRAME);
+    // Una sola escritura por trama en lugar de ~40 Serial.print
+    size_t length = frameEncoder.encode(type, &record, sizeof(record),
+                                        frameBuffer, sizeof(frameBuffer));
+    if (length > 0)
+        serialOutput.write(frameBuffer, length);
+}
+
+// Sin BUILD.fullPayload: latido, pasos y estado, sin historial detrás (la
+// secuencia solo deja ver huecos). En JSON la línea de siempre
+uint8_t compactFrameBuffer[FRAME_OVERHEAD + sizeof(CompactFramePayload)];
+uint32_t compactSequence = 1;
+
+void sendCompactSample(const SensorSnapshot &snapshot)
+{
+    uint32_t sequence = compactSequence++;
+    if (outputFormat == OUTPUT_JSON)
+    {
+        sendSensorData(snapshot, sequence);
+        return;
+    }
+
+    PROFILE_SCOPE(stageProfiler, PROFILE_FRAME);
+    const SensorData &sensorData = snapshot.data;
+    CompactFramePayload payload;
+    payload.timestampMs = snapshot.timestamp;
+    payload.sequence = sequence;
+    payload.heartRate = (uint8_t)constrain(sensorData.heartRate, 0, 255);
+    payload.flags = 0;
+    if (sensorData.fingerDetected)
+        payload.flags |= SENSOR_FLAG_FINGER;
+    if (snapshot.isMoving)
+        payload.flags |= SENSOR_FLAG_MOVING;
+    if (maxHealth.isOnline())
+        payload.flags |= SENSOR_FLAG_MAX_ONLINE;
+    if (mpuHealth.isOnline())
+        payload.flags |= SENSOR_FLAG_MPU_ONLINE;
+    payload.signalQuality = sensorData.signalQuality;
+    payload.cadence = (uint8_t)min(sensorData.cadence, (uint16_t)255);
+    payload.stepCount = sensorData.stepCount;
+
+    size_t length = frameEncoder.encode(FRAME_COMPACT, &payload, sizeof(payload),
+                                        compactFrameBuffer, sizeof(compactFrameBuffer));
+    if (length > 0)
+        serialOutput.write(compactFrameBuffer, length);
+}
+
+// Modo delta: los campos marcados por deltaReporter.update()
+uint8_t deltaFrameBuffer[FRAME_OVERHEAD + sizeof(DeltaHeader) + sizeof(SensorFramePayload)];
+uint8_t eventFrameBuffer[FRAME_OVERHEAD + sizeof(EventFramePayload)];
 
-    // Estado sensores
-    bool maxConnected = particleSensor.begin(Wire, I2C_SPEED_FAST);
-    bool mpuConnected = mpu.begin();
+void sendDelta(const SampleRecord &record)
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_FRAME);
+    if (outputFormat != OUTPUT_JSON)
+    {
+        static uint8_t payload[sizeof(DeltaHeader) + sizeof(SensorFramePayload)];
+        size_t payloadLength = deltaReporter.encodeDelta(record, payload, sizeof(payload));
+        size_t length = frameEncoder.encode(FRAME_DELTA, payload, payloadLength,
+                                            deltaFrameBuffer, sizeof(deltaFrameBuffer));
+        if (payloadLength > 0 && length > 0)
+            serialOutput.write(deltaFrameBuffer, length);
+        return;
+    }
+
+    textBuffer.clear();
+    deltaReporter.appendDeltaJson(textBuffer, record);
+    if (!textBuffer.overflowed())
+        serialOutput.write(textBuffer.bytes(), textBuffer.size());
+}
 
-    Serial.print("\"sensor_status\":{");
-    Serial.print("\"max30102\":");
-    Serial.print(maxConnected ? "true" : "false");
-    Serial.print(",\"mpu6050\":");
-    Serial.print(mpuConnected ? "true" : "false");
-    Serial.print("}");
+void sendEvent(const EventFramePayload &event)
+{
+    if (outputFormat != OUTPUT_JSON)
+    {
+        size_t length = frameEncoder.encode(FRAME_EVENT, &event, sizeof(event),
+                                            eventFrameBuffer, sizeof(eventFrameBuffer));
+        if (length > 0)
+            serialOutput.write(eventFrameBuffer, length);
+        return;
+    }
 
-    Serial.println("}");
+    textBuffer.clear();
+    appendEventJson(textBuffer, event);
+    serialOutput.write(textBuffer.bytes(), textBuffer.size());
 }
 
 // ===========================
-// LOOP PRINCIPAL - OPTIMIZADO PARA GRÁFICAS
+// ÓRDENES DEL HOST: ACK / BACKFILL / CONFIGURACIÓN
 // ===========================
-void loop()
+//   ACK <seq>            el host ya tiene todo hasta seq
+//   BACKFILL <seq>       reenviar todo lo posterior a seq
+//   CONFIG               responder con la configuración activa
+//   SET <clave> <valor>  cambiarla en marcha (claves en device_config.cpp)
+//   SAVE                 guardarla en NVS para los próximos arranques
+//   RESET                volver a la de compilación y borrar la de NVS
+//   KEYFRAME             instantánea completa ya (modo delta, para resincronizar)
+// Las de configuración responden con FRAME_CONFIG (o una línea
+// {"config":...} en JSON) ya en el formato nuevo; los errores van como
+// mensaje. Todo desde la tarea de transmisión.
+uint8_t configFrameBuffer[FRAME_OVERHEAD + sizeof(ConfigFramePayload)];
+
+void sendLogLine(const LogLine &line);
+
+void sendConfig()
 {
-    static unsigned long lastDebugTime = 0;
-    unsigned long currentTime = millis();
+    ConfigFramePayload payload;
+    payload.config = activeConfig;
+    payload.activeFormat = outputFormat;
+    payload.activeIntervalMs = (uint16_t)sendInterval.load();
+    payload.saved = configSaved && sameConfig(activeConfig, savedConfig);
 
-    // LED indicador de actividad
-    static bool ledState = false;
-    ledState = !ledState;
-    digitalWrite(LED_READ, ledState);
+    if (outputFormat != OUTPUT_JSON)
+    {
+        size_t length = frameEncoder.encode(FRAME_CONFIG, &payload, sizeof(payload),
+                                            configFrameBuffer, sizeof(configFrameBuffer));
+        if (length > 0)
+            serialOutput.write(configFrameBuffer, length);
+        return;
+    }
+
+    textBuffer.clear();
+    appendConfigJson(textBuffer, payload);
+    if (!textBuffer.overflowed())
+        serialOutput.write(textBuffer.bytes(), textBuffer.size());
+}
+
+void sendCommandError(const char *command, const char *error)
+{
+    LogLine line;
+    snprintf(line.text, sizeof(line.text), "❌ %s: %s", command, error);
+    sendLogLine(line);
+}
+
+// Lo de salida ya; lo del MAX30105 en el próximo sondeo de salud
+void applyConfig()
+{
+    applyOutputConfig(activeConfig);
+    requestedPpgConfig.store(packPpgConfig(activeConfig), std::memory_order_relaxed);
+}
+
+void handleHostCommand(const char *line)
+{
+    unsigned long sequence;
+    char key[16];
+    char value[16];
+
+    if (sscanf(line, "ACK %lu", &sequence) == 1)
+    {
+        if constexpr (BUILD.sampleHistory)
+            sampleHistory.acknowledge(sequence);
+    }
+    else if (sscanf(line, "BACKFILL %lu", &sequence) == 1)
+    {
+        if constexpr (!BUILD.sampleHistory)
+        {
+            sendCommandError("BACKFILL", "sin historial en este perfil");
+            return;
+        }
+        sampleHistory.acknowledge(sequence);
+        sampleHistory.requestBackfill(sequence);
+        // El historial trae instantáneas completas; lo vivo vuelve a partir de una
+        if constexpr (BUILD.deltaReports)
+            deltaReporter.forceKeyframe();
+    }
+    else if (strcmp(line, "KEYFRAME") == 0)
+    {
+        if constexpr (BUILD.deltaReports)
+            deltaReporter.forceKeyframe();
+    }
+    else if (strcmp(line, "CONFIG") == 0)
+    {
+        sendConfig();
+    }
+    else if (sscanf(line, "SET %15s %15s", key, value) == 2)
+    {
+        const char *error = "";
+        if (!setConfigValue(activeConfig, key, value, error))
+        {
+            sendCommandError(key, error);
+            return;
+        }
+        applyConfig();
+        sendConfig();
+    }
+    else if (strcmp(line, "SAVE") == 0)
+    {
+        if (!configStore.save(activeConfig))
+        {
+            sendCommandError("SAVE", "no se pudo escribir en NVS");
+            return;
+        }
+        savedConfig = activeConfig;
+        configSaved = true;
+        sendConfig();
+    }
+    else if (strcmp(line, "RESET") == 0)
+    {
+        configStore.erase();
+        configSaved = false;
+        activeConfig = makeDefaultConfig();
+        applyConfig();
+        sendConfig();
+    }
+    else
+    {
+        sendCommandError("orden", "desconocida");
+    }
+}
+
+void pollHostCommands()
+{
+    while (Serial.available() > 0)
+    {
+        char c = Serial.read();
+        if (c == '\n' || c == '\r')
+        {
+            if (commandLength > 0)
+            {
+                commandLine[commandLength] = '\0';
+                handleHostCommand(commandLine);
+                commandLength = 0;
+            }
+        }
+        else if (commandLength < sizeof(commandLine) - 1)
+        {
+            commandLine[commandLength++] = c;
+        }
+    }
+}
 
-    // ===========================
-    // LEER MAX30105 - CADA ITERACIÓN
-    // ===========================
-    sensorData.irValue = particleSensor.getIR();
-    sensorData.redValue = particleSensor.getRed();
+// Reenvío por tandas: solo si hay hueco en la UART, para no tapar lo vivo
+void sendBackfill()
+{
+    const size_t frameSize = FRAME_OVERHEAD + sizeof(SampleRecord);
+
+    SampleRecord record;
+    for (size_t i = 0; i < BACKFILL_BURST && serialOutput.canWrite(frameSize); i++)
+    {
+        if (!sampleHistory.nextBackfill(record))
+            break;
+        sendSensorFrame(record, FRAME_HISTORY);
+    }
+}
+
+// ===========================
+// FUNCIÓN PARA ENVIAR LOTES DE FORMA DE ONDA
+// ===========================
+void sendWaveformBatches(WaveformBatcher &batcher)
+{
+    static uint8_t payload[sizeof(waveformFrameBuffer) - FRAME_OVERHEAD];
+
+    WaveformBatch *batch;
+    while (batcher.takeFull(batch))
+    {
+        size_t payloadLength = batcher.encode(*batch, WAVEFORM_ENCODING, payload, sizeof(payload));
+        batcher.release(batch);
+        if (payloadLength == 0)
+            continue;
+
+        size_t length = frameEncoder.encode(FRAME_WAVEFORM, payload, payloadLength,
+                                            waveformFrameBuffer, sizeof(waveformFrameBuffer));
+        if (length > 0)
+            serialOutput.write(waveformFrameBuffer, length);
+    }
+}
+
+// ===========================
+// PROCESAR UNA MUESTRA PPG (DEDO, LATIDO, SpO2)
+// ===========================
+// Presencia vista en modo proximidad; la lee el gestor de energía
+bool proximityPresent = false;
+bool ppgWakePending = false;
+unsigned long ppgWakeRequestTime = 0;
+
+// Sin dedo o sin MAX30105: nada de lo calculado sigue valiendo
+void clearPpgOutputs()
+{
+    sensorData.heartRate = 0;
+    sensorData.spO2 = 0;
+    sensorData.rrInterval = 0;
+    sensorData.rmssd = 0;
+    sensorData.sdnn = 0;
+    sensorData.signalQuality = 0;
+}
+
+void processPpgSample(const PpgSample &sample)
+{
+    PROFILE_SCOPE(stageProfiler, PROFILE_PPG_PROCESS);
+    unsigned long sampleTime = sample.timestamp;
+    sensorData.irValue = sample.ir;
+    sensorData.redValue = sample.red;
+
+    if (powerManager.isPpgLowPower())
+    {
+        // Proximidad: solo ver si se acerca un dedo para volver a medir
+        proximityPresent = (int32_t)sample.ir > PROXIMITY_IR_THRESHOLD;
+        if (proximityPresent && !ppgWakePending)
+        {
+            ppgWakePending = true;
+            ppgWakeRequestTime = sampleTime;
+        }
+        return;
+    }
+
+    proximityPresent = false;
+    if (ppgWakePending)
+    {
+        // Primera muestra a ritmo completo tras detectar el dedo
+        ppgWakePending = false;
+        powerManager.recordPpgWake(sampleTime - ppgWakeRequestTime);
+    }
+
+    // Primera muestra con LED o rango nuevos: la DC salta, así que la
+    // cadena DSP vuelve a arrancar desde aquí
+    bool ledChanged = ledAgc.adopt(sampleTime);
+    if (ledChanged)
+    {
+        sensorData.led = ledAgc.getEffective();
+
+        // Frecuencia nueva (orden del host): filtros diseñados para ella
+        unsigned long period = ppgSamplePeriod.load(std::memory_order_relaxed);
+        if (period != pipelinePeriod)
+        {
+            pipelinePeriod = period;
+            ppgPipeline = PpgPipeline(ppgPipelineConfig(period));
+            if (ppgWaveform.setSamplePeriod(period))
+                xTaskNotifyGive(transportTaskHandle);
+        }
+        ppgPipeline.restart();
+    }
+
+    if (streamingWaveforms())
+    {
+        int32_t values[2] = {(int32_t)sample.ir, (int32_t)sample.red};
+        if (ppgWaveform.add(values, sampleTime))
+            xTaskNotifyGive(transportTaskHandle);
+    }
 
     // Detectar dedo con histéresis para evitar flickering
     static bool lastFingerState = false;
     static unsigned long fingerStateTime = 0;
 
-    bool currentFingerDetected = (sensorData.irValue > 30000); // Umbral más bajo
+    bool currentFingerDetected = ledAgc.normalizeIr(sample.ir) > FINGER_IR_THRESHOLD;
 
     // Aplicar histéresis: cambiar estado solo después de 100ms estable
     if (currentFingerDetected != lastFingerState)
     {
-        if (currentTime - fingerStateTime > 100)
+        if (sampleTime - fingerStateTime > 100)
         {
             sensorData.fingerDetected = currentFingerDetected;
             lastFingerState = currentFingerDetected;
-            fingerStateTime = currentTime;
+            fingerStateTime = sampleTime;
+
+            pushEvent(sensorData.fingerDetected ? EVENT_FINGER_ON : EVENT_FINGER_OFF, sampleTime);
 
             // Feedback visual inmediato
             if (sensorData.fingerDetected)
             {
-                Serial.println("✅ DEDO DETECTADO - Comenzando medición...");
-                digitalWrite(LED_PULSE, HIGH);
+                logMessage("✅ DEDO DETECTADO - Comenzando medición...");
+                showFinger(true);
             }
             else
             {
-                Serial.println("❌ DEDO QUITADO - Deteniendo medición...");
-                digitalWrite(LED_PULSE, LOW);
+                logMessage("❌ DEDO QUITADO - Deteniendo medición...");
+                showFinger(false);
             }
         }
     }
     else
     {
-        fingerStateTime = currentTime;
+        fingerStateTime = sampleTime;
     }
 
     if (sensorData.fingerDetected)
     {
-        // Detección de latido mejorada
-        static int32_t lastIR = 0;
-        static int32_t lastLastIR = 0;
-        int32_t delta = sensorData.irValue - lastIR;
-        int32_t lastDelta = lastIR - lastLastIR;
-
-        // Detectar picos (latidos) - algoritmo mejorado
-        static bool wasRising = false;
-
-        // Solo detectar si hay suficiente señal
-        if (abs(delta) > 80)
+        if constexpr (BUILD.ledAgc)
         {
-            if (delta > 0 && lastDelta <= 0 && !wasRising)
-            {
-                wasRising = true;
-            }
+            ledAgc.update(sample.ir, sample.red, sampleTime);
+            sensorData.ledAdjustments = ledAgc.getAdjustmentCount();
+        }
 
-            if (delta < 0 && lastDelta >= 0 && wasRising)
+        // Latidos solo con la señal ya asentada tras un cambio del AGC
+        if (ppgPipeline.update(sensorData.irValue, sensorData.redValue, sampleTime, !ledAgc.isSettling(sampleTime)))
+        {
+            // Un latido descartado por movimiento deja ritmo, HRV y SpO2
+            // como estaban; solo baja la calidad
+            if (ppgPipeline.isBeatAccepted())
             {
-                wasRising = false;
-
-                if (currentTime - lastBeatTime > 300) // Mínimo 300ms entre latidos
+                const BeatStats &beats = ppgPipeline.getBeatStats();
+                sensorData.heartRate = beats.getHeartRate();
+                if constexpr (BUILD.spo2Hrv)
                 {
-                    long beatInterval = currentTime - lastBeatTime;
-
-                    if (beatInterval > 300 && beatInterval < 1500) // 40-200 BPM
-                    {
-                        int bpm = 60000 / beatInterval;
-
-                        // Promediar últimos latidos
-                        beatArray[beatIndex] = bpm;
-                        beatIndex = (beatIndex + 1) % BEAT_ARRAY_SIZE;
-                        beatSamples = min(beatSamples + 1, BEAT_ARRAY_SIZE);
-
-                        // Calcular promedio
-                        int sum = 0;
-                        for (int i = 0; i < beatSamples; i++)
-                        {
-                            sum += beatArray[i];
-                        }
-
-                        sensorData.heartRate = sum / beatSamples;
-
-                        // Parpadeo LED con latido
-                        digitalWrite(LED_PULSE, HIGH);
-                        delay(10);
-                        digitalWrite(LED_PULSE, LOW);
-                    }
-
-                    lastBeatTime = currentTime;
+                    sensorData.rrInterval = beats.getLastInterval();
+                    sensorData.rmssd = beats.getRmssd();
+                    sensorData.sdnn = beats.getSdnn();
+                    sensorData.spO2 = ppgPipeline.getSpo2X10() / 10.0f;
                 }
-            }
-        }
-
-        lastLastIR = lastIR;
-        lastIR = sensorData.irValue;
+                pushEvent(EVENT_BEAT, sampleTime, beats.getLastInterval());
 
-        // Calcular SpO2 con valores actuales
-        sensorData.spO2 = calculateSpO2(sensorData.irValue, sensorData.redValue);
-
-        // Si SpO2 es 0 pero hay dedo, usar valor por defecto
-        if (sensorData.spO2 == 0 && sensorData.irValue > 50000)
-        {
-            sensorData.spO2 = 98.0; // Valor por defecto cuando hay dedo
+                // Parpadeo LED con latido (sin bloquear el procesado)
+                showBeat();
+            }
         }
+        sensorData.signalQuality = ppgPipeline.getSignalQuality();
     }
     else
     {
         // SIN DEDO - PONER TODO EN 0 INMEDIATAMENTE
-        sensorData.heartRate = 0;
-        sensorData.spO2 = 0;
+        clearPpgOutputs();
 
-        // Resetear variables de latido
-        for (int i = 0; i < BEAT_ARRAY_SIZE; i++)
-        {
-            beatArray[i] = 0;
-        }
-        beatIndex = 0;
-        beatSamples = 0;
+        // La cadena arranca limpia con el próximo dedo
+        ppgPipeline.reset();
+        if constexpr (BUILD.ledAgc)
+            ledAgc.release();
 
-        digitalWrite(LED_PULSE, LOW);
+        showFinger(false);
     }
+}
 
-    // ===========================
-    // LEER MPU6050 - CADA ITERACIÓN
-    // ===========================
-    sensors_event_t a, g, temp;
-    if (mpu.getEvent(&a, &g, &temp))
+// ===========================
+// PROCESAR UNA MUESTRA DEL MPU6050 (PASOS, MOVIMIENTO)
+// ===========================
+void processAccelSample(const AccelSample &sample)
+{
+    if (sample.still)
     {
-        sensorData.accelX = a.acceleration.x;
-        sensorData.accelY = a.acceleration.y;
-        sensorData.accelZ = a.acceleration.z;
-        sensorData.temperature = temp.temperature;
+        // MPU6050 quieto: lo pendiente al motor de pasos y movimiento a
+        // cero hasta la próxima muestra, o el gestor de energía nunca
+        // llegaría a pedir el modo ciclo
+        runStepEngine();
+        motionPresence.stop();
+        motionEstimator.reset();
+        sensorData.motionMg = 0;
+        ppgPipeline.setMotion(0, sensorData.cadence);
+        reportMotionLevel(sample.timestamp);
+        return;
+    }
+
+    if (sample.valid)
+    {
+        sensorData.accelX = sample.x;
+        sensorData.accelY = sample.y;
+        sensorData.accelZ = sample.z;
+        sensorData.temperature = sample.temperature;
+
+        if (streamingWaveforms())
+        {
+            int32_t values[3] = {toFixed16(sample.x, 100.0f), toFixed16(sample.y, 100.0f),
+                                 toFixed16(sample.z, 100.0f)};
+            if (accelWaveform.add(values, sample.timestamp))
+                xTaskNotifyGive(transportTaskHandle);
+        }
 
         // Calcular aceleración total
         float currentAccel = sqrt(sensorData.accelX * sensorData.accelX +
                                   sensorData.accelY * sensorData.accelY +
                                   sensorData.accelZ * sensorData.accelZ);
 
-        // Detectar pasos
-        detectStep(currentAccel);
-        sensorData.stepCount = stepCounter;
+        // Acumular para el motor de pasos (se procesa el lote entero)
+        if (stepBatchCount == STEP_BATCH_SIZE)
+            runStepEngine();
+        int32_t magnitudeMg = (int32_t)(currentAccel * (1000.0f / 9.80665f));
+        stepBatchMagnitude[stepBatchCount] = magnitudeMg;
+        stepBatchTime[stepBatchCount] = sample.timestamp;
+        stepBatchCount++;
 
         // Determinar si hay movimiento
-        float accelVariation = abs(currentAccel - 9.8);
-        isMoving = (accelVariation > 0.2); // Umbral más bajo
+        motionPresence.update(magnitudeMg);
     }
     else
     {
@@ -400,41 +1474,687 @@ void loop()
         sensorData.accelY = 0;
         sensorData.accelZ = 9.8;
         sensorData.temperature = 25.0;
-        isMoving = false;
+        motionPresence.stop();
+    }
+}
+
+// ===========================
+// DIAGNÓSTICO (CADA DIAGNOSTIC_INTERVAL)
+// ===========================
+// Latencia por etapa, vueltas por segundo de cada tarea, muestras perdidas,
+// energía y LED. En binario va como FRAME_DIAGNOSTIC; en JSON como una
+// línea {"diag":{...}} aparte de las de datos.
+struct DiagnosticReport
+{
+    DiagnosticHeader header;
+    DiagnosticStage stages[PROFILE_STAGE_COUNT];
+};
+
+uint8_t diagnosticFrameBuffer[FRAME_OVERHEAD + sizeof(DiagnosticReport)];
+
+static const char *const POWER_STATE_NAMES[POWER_STATE_COUNT] = {"activo", "sin_dedo", "quieto", "reposo"};
+static const char *const PROFILE_TASK_NAMES[PROFILE_TASK_COUNT] = {"adquisicion", "procesado", "transmision"};
+
+static uint16_t saturate16(uint32_t value)
+{
+    return value > UINT16_MAX ? UINT16_MAX : value;
+}
+
+void buildDiagnostics(const SensorSnapshot &snapshot, DiagnosticReport &report)
+{
+    static uint32_t lastLoops[PROFILE_TASK_COUNT] = {};
+    static uint32_t lastBusyUs = 0;
+    static uint32_t lastAccelSamples = 0;
+    static unsigned long lastTime = 0;
+
+    DiagnosticHeader &header = report.header;
+    unsigned long elapsed = snapshot.timestamp - lastTime;
+    header.uptimeMs = snapshot.timestamp;
+    for (uint8_t task = 0; task < PROFILE_TASK_COUNT; task++)
+    {
+        uint32_t loops = stageProfiler.getLoopCount(task);
+        header.loopRateHz[task] = elapsed > 0 ? saturate16((loops - lastLoops[task]) * 1000ULL / elapsed) : 0;
+        lastLoops[task] = loops;
+    }
+    lastTime = snapshot.timestamp;
+
+    header.ppgDropped = ppgAcquisition.getDroppedCount() + ppgQueue.getDroppedCount();
+    header.accelDropped = accelQueue.getDroppedCount();
+
+    // Debe salir 1 s / ACCEL_READ_PERIOD_US (y MPU_FIFO_SAMPLES_PER_DRAIN por
+    // vaciado) mientras hay movimiento; 0 con el sensor quieto
+    uint32_t accelSamples = accelSampleCount.load(std::memory_order_relaxed);
+    header.accelRateHz = elapsed > 0 ? saturate16((accelSamples - lastAccelSamples) * 1000ULL / elapsed) : 0;
+    header.accelFifoBurst = accelLastBurst.load(std::memory_order_relaxed);
+    lastAccelSamples = accelSamples;
+    header.schedulerMissed = 0;
+    int channels[] = {ppgChannel, accelChannel, accelFifoChannel, healthChannel};
+    for (int channel : channels)
+        if (channel >= 0)
+            header.schedulerMissed += sampleScheduler.getStats(channel).missedCount;
+    header.queueDropped = snapshotQueue.getDroppedCount() + logQueue.getDroppedCount();
+
+    uint8_t state = powerManager.getApplied();
+    for (uint8_t i = 0; i < POWER_STATE_COUNT; i++)
+        header.powerResidencyS[i] = powerManager.getReport(i).residencyMs / 1000;
+    PowerManager::StateReport power = powerManager.getReport(state);
+    header.powerState = state;
+    header.sleepPercent = power.sleepPercent;
+    header.currentX10Ma = saturate16(power.currentUa / 100);
+    header.ppgWakeMs = saturate16(powerManager.getPpgWakeMs());
+    header.accelWakeMs = saturate16(powerManager.getAccelWakeMs());
+    header.sleepWakeUs = saturate16(powerManager.getSleepWakeUs());
+
+    header.ledIrAmplitude = snapshot.data.led.irAmplitude;
+    header.ledRedAmplitude = snapshot.data.led.redAmplitude;
+    header.adcRange = snapshot.data.led.adcRange;
+
+    uint32_t busyUs = 0;
+    for (uint8_t device = 0; device < DIAGNOSTIC_I2C_DEVICES; device++)
+    {
+        I2cBus::DeviceStats stats = device < i2cBus.getDeviceCount() ? i2cBus.getStats(device) : I2cBus::DeviceStats();
+        header.i2cErrors[device] = stats.errors;
+        header.i2cTimeouts[device] = stats.timeouts;
+        busyUs += stats.busyUs;
+    }
+    uint32_t busyPercent = elapsed > 0 ? (busyUs - lastBusyUs) / 10 / elapsed : 0;
+    header.i2cBusyPercent = busyPercent > 100 ? 100 : busyPercent;
+    lastBusyUs = busyUs;
+
+    HeapStats heap = MemoryArena::readHeapStats();
+    header.heapFree = heap.internalFree;
+    header.heapMinFree = heap.internalMinFree;
+    header.heapLargestBlock = heap.internalLargest;
+    header.psramFree = heap.psramFree;
+    header.psramTotal = heap.psramTotal;
+    header.arenaInternal = bootArena.getReservedBytes(MEMORY_INTERNAL);
+    header.arenaPsram = bootArena.getReservedBytes(MEMORY_PSRAM);
+    header.lateAllocations = saturate16(bootArena.getLateCount());
+
+    header.stageCount = PROFILE_STAGE_COUNT;
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++)
+    {
+        StageProfiler::StageStats stats = stageProfiler.getStats(i);
+        DiagnosticStage &stage = report.stages[i];
+        stage.count = saturate16(stats.count);
+        stage.minUs = stats.minUs;
+        stage.meanUs = stats.meanUs;
+        stage.p99Us = stats.p99Us;
+        stage.maxUs = stats.maxUs;
+    }
+}
+
+void sendDiagnostics(const SensorSnapshot &snapshot)
+{
+    DiagnosticReport report;
+    buildDiagnostics(snapshot, report);
+    const DiagnosticHeader &header = report.header;
+
+    if (outputFormat != OUTPUT_JSON)
+    {
+        size_t length = frameEncoder.encode(FRAME_DIAGNOSTIC, &report, sizeof(report),
+                                            diagnosticFrameBuffer, sizeof(diagnosticFrameBuffer));
+        if (length > 0)
+            serialOutput.write(diagnosticFrameBuffer, length);
+        return;
+    }
+
+    TextBuffer &json = textBuffer;
+    json.clear();
+    json.append("{\"diag\":{\"uptime_ms\":").appendUInt(header.uptimeMs);
+
+    json.append(",\"vueltas_hz\":{");
+    for (uint8_t task = 0; task < PROFILE_TASK_COUNT; task++)
+    {
+        if (task > 0)
+            json.append(',');
+        json.append('"').append(PROFILE_TASK_NAMES[task]).append("\":").appendUInt(header.loopRateHz[task]);
+    }
+    json.append('}');
+
+    json.append(",\"perdidas\":{");
+    json.append("\"ppg\":").appendUInt(header.ppgDropped);
+    json.append(",\"accel\":").appendUInt(header.accelDropped);
+    json.append(",\"planificador\":").appendUInt(header.schedulerMissed);
+    json.append(",\"colas\":").appendUInt(header.queueDropped);
+    json.append('}');
+
+    json.append(",\"accel\":{\"hz\":").appendUInt(header.accelRateHz);
+    json.append(",\"rafaga\":").appendUInt(header.accelFifoBurst).append('}');
+
+    json.append(",\"energia\":{\"estado\":\"").append(POWER_STATE_NAMES[header.powerState]).append('"');
+    json.append(",\"corriente_ma\":").appendFixed(header.currentX10Ma / 10.0f, 1);
+    json.append(",\"sueno_pct\":").appendUInt(header.sleepPercent);
+    json.append(",\"residencia_s\":[");
+    for (uint8_t i = 0; i < POWER_STATE_COUNT; i++)
+    {
+        if (i > 0)
+            json.append(',');
+        json.appendUInt(header.powerResidencyS[i]);
+    }
+    json.append("],\"despertar_ppg_ms\":").appendUInt(header.ppgWakeMs);
+    json.append(",\"despertar_accel_ms\":").appendUInt(header.accelWakeMs);
+    json.append(",\"despertar_sleep_us\":").appendUInt(header.sleepWakeUs);
+    json.append('}');
+
+    json.append(",\"led\":{");
+    json.append("\"ir_ma\":").appendFixed(ledAmplitudeUa(header.ledIrAmplitude) / 1000.0f, 1);
+    json.append(",\"rojo_ma\":").appendFixed(ledAmplitudeUa(header.ledRedAmplitude) / 1000.0f, 1);
+    json.append(",\"rango_na\":").appendUInt(ledAdcRangeNa(header.adcRange));
+    json.append('}');
+
+    json.append(",\"i2c\":{\"ocupado_pct\":").appendUInt(header.i2cBusyPercent);
+    for (uint8_t device = 0; device < DIAGNOSTIC_I2C_DEVICES && device < i2cBus.getDeviceCount(); device++)
+    {
+        json.append(",\"").append(i2cBus.getDeviceName(device)).append("\":{");
+        json.append("\"errores\":").appendUInt(header.i2cErrors[device]);
+        json.append(",\"timeouts\":").appendUInt(header.i2cTimeouts[device]).append('}');
+    }
+    json.append('}');
+
+    // Bytes; tardias = reservas pedidas a la arena ya cerrada
+    json.append(",\"memoria\":{\"libre\":").appendUInt(header.heapFree);
+    json.append(",\"min_libre\":").appendUInt(header.heapMinFree);
+    json.append(",\"bloque_max\":").appendUInt(header.heapLargestBlock);
+    json.append(",\"psram_libre\":").appendUInt(header.psramFree);
+    json.append(",\"psram_total\":").appendUInt(header.psramTotal);
+    json.append(",\"arena_interna\":").appendUInt(header.arenaInternal);
+    json.append(",\"arena_psram\":").appendUInt(header.arenaPsram);
+    json.append(",\"tardias\":").appendUInt(header.lateAllocations);
+    json.append('}');
+
+    // Por etapa: [n, min, media, p99, max] en µs
+    json.append(",\"etapas_us\":{");
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++)
+    {
+        const DiagnosticStage &stage = report.stages[i];
+        if (i > 0)
+            json.append(',');
+        json.append('"').append(StageProfiler::stageName(i)).append("\":[");
+        json.appendUInt(stage.count).append(',').appendUInt(stage.minUs).append(',');
+        json.appendUInt(stage.meanUs).append(',').appendUInt(stage.p99Us).append(',');
+        json.appendUInt(stage.maxUs).append(']');
+    }
+    json.append("}}}\r\n");
+
+    if (!json.overflowed())
+        serialOutput.write(json.bytes(), json.size());
+}
+
+// ===========================
+// TAREA DE ADQUISICIÓN (NÚCLEO 1) - ÚNICA DUEÑA DEL BUS I2C
+// ===========================
+// Latencia de salida del modo ciclo: del movimiento a la primera muestra
+bool accelWakePending = false;
+unsigned long accelWakeTime = 0;
+
+// Sale del reposo: fuera del modo ciclo y vuelven las interrupciones de
+// muestra (y el FIFO)
+void wakeMpu6050(unsigned long now)
+{
+    bool ok = true;
+    if (powerManager.getApplied() & POWER_ACCEL_LOW)
+    {
+        ok = mpuRaw.setCycleMode(false, MPU6050_WAKE_5HZ);
+        if (ok)
+        {
+            powerManager.setApplied(powerManager.getApplied() & ~POWER_ACCEL_LOW);
+            accelWakePending = true;
+            accelWakeTime = now;
+        }
+    }
+    ok = ok && mpuRaw.setInterruptSources(activeMpuInterrupts());
+    if (ok && accelMode == ACCEL_MODE_FIFO)
+        ok = mpuRaw.enableFifo();
+    if (ok)
+    {
+        mpuStill = false;
+        lastAccelTime = now;
+    }
+}
+
+void pushAccelSample(const int16_t raw[3], unsigned long timestamp)
+{
+    AccelSample accel;
+    accel.valid = true;
+    accel.still = false;
+    accel.x = raw[0] * MPU_ACCEL_SCALE;
+    accel.y = raw[1] * MPU_ACCEL_SCALE;
+    accel.z = raw[2] * MPU_ACCEL_SCALE;
+    accel.temperature = mpuTemperature;
+    accel.timestamp = timestamp;
+    accelQueue.push(accel);
+    accelSampleCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (accelWakePending)
+    {
+        accelWakePending = false;
+        powerManager.recordAccelWake(millis() - accelWakeTime);
+    }
+}
+
+// Vacía el FIFO del MPU6050 en una o dos ráfagas; como en el PPG, la última
+// muestra es la más reciente y las demás se reparten hacia atrás
+void drainMpuFifo(unsigned long now)
+{
+    static int16_t raw[MPU_FIFO_MAX_BURST][3];
+    static unsigned long lastSampleTime = 0;
+    const unsigned long period = 1 + MPU_SAMPLE_RATE_DIVIDER; // ms, el del chip
+
+    uint16_t count;
+    bool overflowed;
+    bool ok = mpuRaw.readFifoAccel(raw, MPU_FIFO_MAX_BURST, count, overflowed);
+    mpuHealth.reportRead(ok);
+    if (!ok || count == 0)
+        return;
+    accelLastBurst.store(count, std::memory_order_relaxed);
+
+    // LED indicador de actividad
+    toggleReadLed();
+
+    unsigned long timestamp = now - (unsigned long)(count - 1) * period;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        // Mantener las marcas de tiempo estrictamente crecientes
+        if ((long)(timestamp - lastSampleTime) <= 0)
+            timestamp = lastSampleTime + 1;
+        pushAccelSample(raw[i], timestamp);
+        lastSampleTime = timestamp;
+        timestamp += period;
+    }
+    lastAccelTime = now;
+}
+
+// Atiende el INT del MPU6050: 1 byte de estado (que además lo libera) y,
+// en modo INT, en la misma transacción los 6 bytes del acelerómetro
+void serviceMpu6050(unsigned long now)
+{
+    if (!mpuHealth.isOnline())
+        return;
+
+    uint8_t status;
+    int16_t raw[3];
+    bool ok = accelMode == ACCEL_MODE_INTERRUPT ? mpuRaw.readStatusAndAccel(status, raw)
+                                                : mpuRaw.readInterruptStatus(status);
+    if (!ok)
+    {
+        mpuHealth.reportRead(false);
+        if (accelMode == ACCEL_MODE_INTERRUPT)
+        {
+            AccelSample accel;
+            accel.valid = false;
+            accel.still = false;
+            accel.timestamp = now;
+            accelQueue.push(accel);
+        }
+        return;
+    }
+
+    if (status & MPU6050_INT_MOTION)
+    {
+        lastMotionTime = now;
+        if (mpuStill)
+            wakeMpu6050(now);
+    }
+
+    if (accelMode == ACCEL_MODE_FIFO)
+    {
+        // Desbordado: readFifoAccel lo detecta y lo reinicia
+        if ((status & MPU6050_INT_FIFO_OVERFLOW) && !mpuStill)
+            drainMpuFifo(now);
+        return;
+    }
+
+    if (!(status & MPU6050_INT_DATA_READY))
+        return;
+
+    // LED indicador de actividad
+    toggleReadLed();
+
+    mpuHealth.reportRead(true);
+    pushAccelSample(raw, now);
+    lastAccelTime = now;
+}
+
+// Tareas lentas del MPU6050 al ritmo del sondeo de salud
+void mpuHousekeeping(unsigned long now)
+{
+    if (!mpuHealth.isOnline())
+    {
+        // Sensor caído: el procesado pasa a valores por defecto
+        AccelSample accel;
+        accel.valid = false;
+        accel.still = false;
+        accel.timestamp = now;
+        accelQueue.push(accel);
+        return;
+    }
+
+    // Flanco perdido (INT enclavado en alto sin atender) o pin sin cablear:
+    // leer el estado lo libera y, de paso, recoge el dato si lo hay
+    bool stalled = !mpuStill && now - lastAccelTime > ACCEL_STALL_TIMEOUT;
+    if (digitalRead(MPU_INT_PIN) == HIGH || stalled)
+        serviceMpu6050(now);
+
+    // El FIFO debería llenarse solo: si no avanza, el sensor no responde bien
+    if (stalled && accelMode == ACCEL_MODE_FIFO)
+        mpuHealth.reportRead(false);
+
+    // Quieto: solo la interrupción de movimiento, sin muestras ni FIFO
+    if (!mpuStill && now - lastMotionTime > MPU_STILL_TIMEOUT &&
+        mpuRaw.setInterruptSources(MPU6050_INT_MOTION))
+    {
+        if (accelMode == ACCEL_MODE_FIFO)
+            mpuRaw.disableFifo();
+        mpuStill = true;
+
+        // Sin muestras el procesado se quedaría con el movimiento y el nivel
+        // de la última: se lo dice él mismo, por la misma cola
+        AccelSample accel;
+        accel.valid = false;
+        accel.still = true;
+        accel.timestamp = now;
+        accelQueue.push(accel);
+    }
+
+    // Quieto y sin movimiento en un buen rato: modo ciclo (solo movimiento)
+    if (mpuStill && (powerManager.getRequested() & POWER_ACCEL_LOW) &&
+        !(powerManager.getApplied() & POWER_ACCEL_LOW) &&
+        mpuRaw.setCycleMode(true, MPU6050_WAKE_5HZ))
+        powerManager.setApplied(powerManager.getApplied() | POWER_ACCEL_LOW);
+
+    if (!(powerManager.getApplied() & POWER_ACCEL_LOW) &&
+        now - lastTemperatureTime >= MPU_TEMPERATURE_INTERVAL)
+    {
+        lastTemperatureTime = now;
+        mpuRaw.readTemperature(mpuTemperature);
+    }
+}
+
+// Errores y timeouts del bus de cada sensor, también los de transacciones
+// que nadie comprueba (configuración, temperatura)
+void reportBusHealth()
+{
+    I2cBus::DeviceStats stats = i2cBus.getStats(maxBusDevice);
+    maxHealth.reportBusCounters(stats.errors, stats.timeouts);
+    stats = i2cBus.getStats(mpuBusDevice);
+    mpuHealth.reportBusCounters(stats.errors, stats.timeouts);
+}
+
+// Cambia el MAX30105 entre medida completa y proximidad si el gestor lo pide
+void applyPpgPower()
+{
+    uint8_t applied = powerManager.getApplied();
+    bool wantLow = powerManager.getRequested() & POWER_PPG_LOW;
+    if (wantLow == (bool)(applied & POWER_PPG_LOW) || !maxHealth.isOnline())
+        return;
+
+    configureMax30105(wantLow);
+    sampleScheduler.setPeriod(ppgChannel, wantLow ? PPG_LOW_READ_PERIOD_US : ppgReadPeriodUs);
+    powerManager.setApplied(wantLow ? (applied | POWER_PPG_LOW) : (applied & ~POWER_PPG_LOW));
+}
+
+// Frecuencia, promedio y LED nuevos pedidos por el host: el MAX30105 se
+// reconfigura entero; en proximidad basta con dejarlo para el despertar
+void applyPpgConfig()
+{
+    uint32_t wanted = requestedPpgConfig.load(std::memory_order_relaxed);
+    if (wanted == appliedPpgConfig || !maxHealth.isOnline())
+        return;
+
+    appliedPpgConfig = wanted;
+    unpackPpgConfig(wanted, ppgConfig);
+    LedSettings led = {ppgConfig.ledIrAmplitude, ppgConfig.ledRedAmplitude, ppgConfig.adcRange};
+    ledAgc.setDefaults(led);
+    ppgReadPeriodUs = ppgReadPeriodFor(ppgConfig);
+
+    if (powerManager.isPpgLowPower())
+        return;
+    configureMax30105(false);
+    sampleScheduler.setPeriod(ppgChannel, ppgReadPeriodUs);
+}
+
+void acquisitionTask(void *parameter)
+{
+    while (true)
+    {
+        // Dormir hasta que venza algún temporizador: sin espera activa
+        uint32_t due = sampleScheduler.wait();
+        unsigned long currentTime = millis();
+        PROFILE_LOOP(stageProfiler, PROFILE_TASK_ACQUISITION);
+
+        // Salud de sensores: sondeo barato, reinicio solo si falla
+        if (due & (1UL << healthChannel))
+        {
+            sampleScheduler.markStart(healthChannel);
+            PROFILE_SCOPE(stageProfiler, PROFILE_HEALTH);
+            reportBusHealth();
+            maxHealth.update(currentTime);
+            mpuHealth.update(currentTime);
+            mpuHousekeeping(currentTime);
+            applyPpgConfig();
+            applyPpgPower();
+        }
+
+        // MAX30105: vaciar el FIFO completo
+        if ((due & (1UL << ppgChannel)) && maxHealth.isOnline())
+        {
+            sampleScheduler.markStart(ppgChannel);
+            PROFILE_SCOPE(stageProfiler, PROFILE_PPG_READ);
+            ppgAcquisition.drain(currentTime);
+
+            // Sin muestras nuevas durante ~1 s = FIFO atascado o sensor perdido
+            maxHealth.reportRead(currentTime - ppgAcquisition.getLastSampleTime() < PPG_STALL_TIMEOUT);
+
+            PpgSample sample;
+            while (ppgAcquisition.pop(sample))
+            {
+                ppgQueue.push(sample);
+            }
+            applyLedAgc();
+        }
+
+        // MPU6050: INT avisa de movimiento y de dato listo / FIFO desbordado
+        if (due & (1UL << accelChannel))
+        {
+            sampleScheduler.markStart(accelChannel);
+            PROFILE_SCOPE(stageProfiler, PROFILE_MPU_READ);
+            serviceMpu6050(currentTime);
+        }
+
+        // MPU6050 en modo FIFO: vaciado por lotes a periodo fijo
+        if (accelFifoChannel >= 0 && (due & (1UL << accelFifoChannel)))
+        {
+            sampleScheduler.markStart(accelFifoChannel);
+            PROFILE_SCOPE(stageProfiler, PROFILE_MPU_READ);
+            if (mpuHealth.isOnline() && !mpuStill)
+                drainMpuFifo(currentTime);
+        }
+
+        xTaskNotifyGive(processingTaskHandle);
+
+#if ENABLE_LIGHT_SLEEP
+        // Todo en bajo consumo: dormir hasta el próximo temporizador o el INT
+        if (powerManager.getApplied() == POWER_IDLE && powerManager.sleepUntilNextTimer(MPU_INT_PIN))
+            serviceMpu6050(millis());
+#endif
+    }
+}
+
+// ===========================
+// TAREA DE PROCESADO (NÚCLEO 0) - LATIDO, SpO2, PASOS
+// ===========================
+void processingTask(void *parameter)
+{
+    while (true)
+    {
+        // Esperar a que la adquisición avise (o publicar igualmente al vencer)
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sendInterval));
+        PROFILE_LOOP(stageProfiler, PROFILE_TASK_PROCESSING);
+
+        if (maxHealth.isOnline())
+        {
+            // Detección de latido y SpO2 sobre todas las muestras, no solo la última
+            PpgSample sample;
+            while (ppgQueue.pop(sample))
+            {
+                processPpgSample(sample);
+            }
+        }
+        else
+        {
+            sensorData.irValue = 0;
+            sensorData.redValue = 0;
+            sensorData.fingerDetected = false;
+            clearPpgOutputs();
+        }
+
+        AccelSample accel;
+        while (accelQueue.pop(accel))
+        {
+            processAccelSample(accel);
+        }
+        runStepEngine();
+
+        // Estado de energía deseado; lo aplica la adquisición
+        powerManager.update(sensorData.fingerDetected || proximityPresent, motionPresence.isMoving(), millis());
+
+        if constexpr (BUILD.ledFeedback)
+            pulseLed.update(millis());
+
+        // Publicar una copia del estado cada sendInterval (para gráficas suaves)
+        unsigned long currentTime = millis();
+        if (currentTime - lastSendTime >= sendInterval)
+        {
+            lastSendTime = currentTime;
+
+            SensorSnapshot snapshot;
+            snapshot.data = sensorData;
+            snapshot.isMoving = motionPresence.isMoving();
+            snapshot.timestamp = currentTime;
+
+            if (snapshotQueue.push(snapshot))
+                xTaskNotifyGive(transportTaskHandle);
+        }
     }
+}
 
-    // ===========================
-    // ENVIAR DATOS CADA 500ms (PARA GRÁFICAS SUAVES)
-    // ===========================
-    if (currentTime - lastSendTime >= SEND_INTERVAL)
+// Mensajes de depuración: líneas de texto junto al JSON, o tramas
+// FRAME_LOG en los modos binarios para que el host las separe por tipo sin
+// intentar interpretarlas
+uint8_t logFrameBuffer[FRAME_OVERHEAD + sizeof(LogLine::text)];
+
+void sendLogLine(const LogLine &line)
+{
+    if (outputFormat != OUTPUT_JSON)
+    {
+        size_t length = frameEncoder.encode(FRAME_LOG, line.text, strnlen(line.text, sizeof(line.text)),
+                                            logFrameBuffer, sizeof(logFrameBuffer));
+        if (length > 0)
+            serialOutput.write(logFrameBuffer, length);
+        return;
+    }
+
+    textBuffer.clear();
+    textBuffer.append(line.text).append("\r\n");
+    serialOutput.write(textBuffer.bytes(), textBuffer.size());
+}
+
+// ===========================
+// TAREA DE TRANSMISIÓN (NÚCLEO 0) - SERIAL
+// ===========================
+void transportTask(void *parameter)
+{
+    unsigned long lastDiagnosticTime = 0;
+
+    while (true)
     {
-        lastSendTime = currentTime;
+        // Despertar también sin datos para atender órdenes y el reenvío
+        ulTaskNotifyTake(pdTRUE, BUILD.sampleHistory && sampleHistory.isBackfilling() ? BACKFILL_WAKE
+                                                                                      : COMMAND_POLL_WAKE);
+        PROFILE_LOOP(stageProfiler, PROFILE_TASK_TRANSPORT);
+
+        pollHostCommands();
+
+        LogLine line;
+        while (logQueue.pop(line))
+        {
+            sendLogLine(line);
+        }
 
-        // Enviar datos
-        sendSensorData();
+        EventFramePayload event;
+        while (eventQueue.pop(event))
+        {
+            sendEvent(event);
+        }
 
-        // Debug cada 5 segundos
-        if (currentTime - lastDebugTime >= 5000)
+        SensorSnapshot snapshot;
+        while (snapshotQueue.pop(snapshot))
         {
-            lastDebugTime = currentTime;
-
-            Serial.print("📊 ESTADO: ");
-            Serial.print("SpO2: ");
-            Serial.print(sensorData.spO2, 1);
-            Serial.print("% | HR: ");
-            Serial.print(sensorData.heartRate);
-            Serial.print(" | IR: ");
-            Serial.print(sensorData.irValue);
-            Serial.print(" | Dedo: ");
-            Serial.print(sensorData.fingerDetected ? "SI" : "NO");
-            Serial.print(" | Pasos: ");
-            Serial.print(sensorData.stepCount);
-            Serial.print(" | Mov: ");
-            Serial.print(isMoving ? "SI" : "NO");
-            Serial.println();
+            if constexpr (!BUILD.fullPayload)
+            {
+                sendCompactSample(snapshot);
+            }
+            else
+            {
+                SensorFramePayload payload;
+                buildSensorPayload(snapshot, payload);
+
+                // Modo delta: lo que no ha cambiado ni se guarda ni se envía
+                DeltaReporter::Decision decision = DeltaReporter::DELTA_KEYFRAME;
+                if (BUILD.deltaReports && deltaReporting)
+                    decision = deltaReporter.update(payload, snapshot.timestamp);
+
+                if (decision != DeltaReporter::DELTA_SKIP)
+                {
+                    // Guardar con número de secuencia antes de enviar
+                    SampleRecord record;
+                    sampleHistory.append(payload, record);
+
+                    // Enviar datos
+                    if (decision == DeltaReporter::DELTA_CHANGES)
+                        sendDelta(record);
+                    else if (outputFormat != OUTPUT_JSON)
+                        sendSensorFrame(record, FRAME_SENSOR);
+                    else
+                        sendSensorData(snapshot, record.sequence);
+
+#if ENABLE_NET_UPLINK
+                    // Copia al uplink MQTT (lotes, buffer offline y reintentos en su tarea)
+                    netUplink.enqueue(payload);
+#endif
+                }
+            }
+
+            // Diagnóstico cada DIAGNOSTIC_INTERVAL
+            if constexpr (BUILD.diagnostics)
+            {
+                if (snapshot.timestamp - lastDiagnosticTime >= DIAGNOSTIC_INTERVAL)
+                {
+                    lastDiagnosticTime = snapshot.timestamp;
+                    sendDiagnostics(snapshot);
+                }
+            }
+        }
+
+        if (streamingWaveforms())
+        {
+            sendWaveformBatches(ppgWaveform);
+            sendWaveformBatches(accelWaveform);
+        }
+
+        if constexpr (BUILD.sampleHistory)
+        {
+            if (sampleHistory.isBackfilling())
+                sendBackfill();
         }
     }
+}
 
-    // Pequeña pausa para no saturar
-    delay(50);
-}
\ No newline at end of file
+// ===========================
+// LOOP PRINCIPAL - TODO EL TRABAJO VIVE EN LAS TAREAS
+// ===========================
+void loop()
+{
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,35 @@
+// memory_arena.cpp - Implementación de la arena de arranque
+#include "memory_arena.h"
+#include "esp_heap_caps.h"
+
+static const uint32_t REGION_CAPS[MEMORY_REGION_COUNT] = {
+    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT,
+};
+
+void *MemoryArena::reserve(size_t bytes, MemoryRegion region)
+{
+    if (sealed.load())
+    {
+        lateCount.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    if (bytes == 0)
+        return NULL;
+
+    void *block = heap_caps_malloc(bytes, REGION_CAPS[region]);
+    if (block != NULL)
+        reservedBytes[region] += bytes;
+    return block;
+}
+
+HeapStats MemoryArena::readHeapStats()
+{
+    HeapStats stats;
+    stats.internalFree = heap_caps_get_free_size(REGION_CAPS[MEMORY_INTERNAL]);
+    stats.internalMinFree = heap_caps_get_minimum_free_size(REGION_CAPS[MEMORY_INTERNAL]);
+    stats.internalLargest = heap_caps_get_largest_free_block(REGION_CAPS[MEMORY_INTERNAL]);
+    stats.psramFree = heap_caps_get_free_size(REGION_CAPS[MEMORY_PSRAM]);
+    stats.psramTotal = heap_caps_get_total_size(REGION_CAPS[MEMORY_PSRAM]);
+    return stats;
+}
@@ -0,0 +1,51 @@
+// memory_arena.h - Reservas de memoria solo en el arranque, y estado del heap
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+enum MemoryRegion
+{
+    MEMORY_INTERNAL = 0,
+    MEMORY_PSRAM = 1,
+    MEMORY_REGION_COUNT,
+};
+
+// Estado del heap para el diagnóstico (bytes)
+struct HeapStats
+{
+    uint32_t internalFree;
+    uint32_t internalMinFree;  // mínimo desde el arranque
+    uint32_t internalLargest;  // bloque libre más grande: mide la fragmentación
+    uint32_t psramFree;
+    uint32_t psramTotal;       // 0 sin PSRAM
+};
+
+// ===========================
+// ARENA DE ARRANQUE
+// ===========================
+// Los buffers de larga vida que no pueden ser estáticos (su tamaño depende
+// de si hay PSRAM: historial, lotes de forma de onda) se reservan aquí desde
+// setup() y no se liberan nunca, así el heap no se fragmenta con los días y
+// nada en el camino de muestreo llama a malloc. Tramas y colas ya son
+// arrays estáticos. Tras seal() toda reserva falla y se cuenta en
+// getLateCount(), para que un uso tardío se vea en el diagnóstico.
+class MemoryArena
+{
+public:
+    // NULL si no cabe en esa región o la arena ya está cerrada
+    void *reserve(size_t bytes, MemoryRegion region);
+
+    // Fin del arranque (setup(), antes de arrancar las tareas)
+    void seal() { sealed.store(true); }
+    bool isSealed() const { return sealed.load(); }
+
+    uint32_t getReservedBytes(MemoryRegion region) const { return reservedBytes[region]; }
+    uint32_t getLateCount() const { return lateCount.load(std::memory_order_relaxed); }
+
+    static HeapStats readHeapStats();
+
+private:
+    std::atomic<bool> sealed{false};
+    uint32_t reservedBytes[MEMORY_REGION_COUNT] = {};
+    std::atomic<uint32_t> lateCount{0};
+};
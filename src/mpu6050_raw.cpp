@@ -0,0 +1,199 @@
+// mpu6050_raw.cpp - Implementación del acceso a registros del MPU6050
+#include "mpu6050_raw.h"
+
+// INT_PIN_CFG: LATCH_INT_EN (bit 5) mantiene INT hasta leer INT_STATUS, así
+// un flanco no se pierde aunque la tarea tarde en atenderlo
+static const uint8_t INT_PIN_LATCHED = 0x20;
+
+// ACCEL_CONFIG: ACCEL_HPF = 1 (5 Hz), el filtro que usa la detección de
+// movimiento; el rango (bits 4:3) se conserva
+static const uint8_t ACCEL_HPF_MASK = 0x07;
+static const uint8_t ACCEL_HPF_5HZ = 0x01;
+
+bool Mpu6050Raw::configureInterrupts(uint8_t sampleRateDivider, uint8_t motionThreshold,
+                                     uint8_t motionDurationMs)
+{
+    uint8_t accelConfig;
+    if (!readRegisters(MPU6050_REG_ACCEL_CONFIG, &accelConfig, 1))
+        return false;
+    accelConfig = (accelConfig & ~ACCEL_HPF_MASK) | ACCEL_HPF_5HZ;
+
+    return writeRegister(MPU6050_REG_SMPLRT_DIV, sampleRateDivider) &&
+           writeRegister(MPU6050_REG_ACCEL_CONFIG, accelConfig) &&
+           writeRegister(MPU6050_REG_MOT_THR, motionThreshold) &&
+           writeRegister(MPU6050_REG_MOT_DUR, motionDurationMs) &&
+           writeRegister(MPU6050_REG_INT_PIN_CFG, INT_PIN_LATCHED) &&
+           setInterruptSources(MPU6050_INT_DATA_READY | MPU6050_INT_MOTION);
+}
+
+bool Mpu6050Raw::setInterruptSources(uint8_t sources)
+{
+    return writeRegister(MPU6050_REG_INT_ENABLE, sources);
+}
+
+bool Mpu6050Raw::readInterruptStatus(uint8_t &status)
+{
+    return readRegisters(MPU6050_REG_INT_STATUS, &status, 1);
+}
+
+void Mpu6050Raw::decodeAccel(const uint8_t *bytes, int16_t raw[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        raw[i] = (int16_t)((bytes[2 * i] << 8) | bytes[2 * i + 1]);
+    }
+}
+
+bool Mpu6050Raw::readAccelRaw(int16_t raw[3])
+{
+    uint8_t data[6];
+    if (!readRegisters(MPU6050_REG_ACCEL_XOUT_H, data, sizeof(data)))
+        return false;
+
+    decodeAccel(data, raw);
+    return true;
+}
+
+bool Mpu6050Raw::readStatusAndAccel(uint8_t &status, int16_t raw[3])
+{
+    uint8_t data[7];
+    if (!readRegisters(MPU6050_REG_INT_STATUS, data, sizeof(data)))
+        return false;
+
+    status = data[0];
+    decodeAccel(data + 1, raw);
+    return true;
+}
+
+bool Mpu6050Raw::readTemperature(float &celsius)
+{
+    uint8_t data[2];
+    if (!readRegisters(MPU6050_REG_TEMP_OUT_H, data, sizeof(data)))
+        return false;
+
+    int16_t raw = (int16_t)((data[0] << 8) | data[1]);
+    celsius = raw / 340.0f + 36.53f;
+    return true;
+}
+
+bool Mpu6050Raw::writeRegister(uint8_t reg, uint8_t value)
+{
+    return bus.writeRegister(address, reg, value);
+}
+
+bool Mpu6050Raw::readRegisters(uint8_t reg, uint8_t *data, uint8_t length)
+{
+    return bus.readRegisters(address, reg, data, length);
+}
+
+// USER_CTRL: FIFO_EN (bit 6) y FIFO_RESET (bit 2); FIFO_EN: ACCEL_FIFO_EN (bit 3)
+static const uint8_t USER_CTRL_FIFO_ENABLE = 0x40;
+static const uint8_t USER_CTRL_FIFO_RESET = 0x04;
+static const uint8_t FIFO_EN_ACCEL = 0x08;
+
+bool Mpu6050Raw::enableFifo()
+{
+    return writeRegister(MPU6050_REG_USER_CTRL, 0) &&
+           writeRegister(MPU6050_REG_USER_CTRL, USER_CTRL_FIFO_RESET) &&
+           writeRegister(MPU6050_REG_FIFO_EN, FIFO_EN_ACCEL) &&
+           writeRegister(MPU6050_REG_USER_CTRL, USER_CTRL_FIFO_ENABLE);
+}
+
+bool Mpu6050Raw::disableFifo()
+{
+    return writeRegister(MPU6050_REG_FIFO_EN, 0) &&
+           writeRegister(MPU6050_REG_USER_CTRL, USER_CTRL_FIFO_RESET);
+}
+
+bool Mpu6050Raw::submitFifoBurst(I2cTransfer &transfer, uint8_t *buffer, uint16_t wanted,
+                                 uint16_t &requested, uint16_t &chunk)
+{
+    chunk = wanted - requested;
+    if (chunk > FIFO_BURST_BYTES / FIFO_SAMPLE_BYTES)
+        chunk = FIFO_BURST_BYTES / FIFO_SAMPLE_BYTES;
+
+    transfer.address = address;
+    transfer.reg = MPU6050_REG_FIFO_R_W;
+    transfer.data = buffer;
+    transfer.length = chunk * FIFO_SAMPLE_BYTES;
+    transfer.write = false;
+    if (!bus.submit(transfer))
+        return false;
+    requested += chunk;
+    return true;
+}
+
+bool Mpu6050Raw::readFifoAccel(int16_t (*samples)[3], uint16_t maxSamples, uint16_t &count,
+                               bool &overflowed)
+{
+    count = 0;
+    overflowed = false;
+
+    uint8_t countBytes[2];
+    if (!readRegisters(MPU6050_REG_FIFO_COUNT_H, countBytes, sizeof(countBytes)))
+        return false;
+    uint16_t available = ((uint16_t)countBytes[0] << 8) | countBytes[1];
+
+    // Lleno = se han sobrescrito muestras y puede haber una a medias: empezar
+    // de cero antes que desalinear los ejes
+    if (available >= FIFO_SIZE)
+    {
+        overflowed = true;
+        return enableFifo();
+    }
+
+    uint16_t wanted = available / FIFO_SAMPLE_BYTES;
+    if (wanted > maxSamples)
+        wanted = maxSamples;
+
+    // Doble buffer: mientras el bus trae una ráfaga se decodifica la anterior
+    uint8_t burst[2][FIFO_BURST_BYTES];
+    I2cTransfer transfers[2];
+    uint16_t chunks[2] = {0, 0};
+    uint16_t requested = 0;
+    bool ok = submitFifoBurst(transfers[0], burst[0], wanted, requested, chunks[0]);
+
+    for (uint8_t slot = 0; ok && count < wanted; slot ^= 1)
+    {
+        // La siguiente al otro buffer, ya decodificado en la vuelta anterior
+        if (requested < wanted)
+            ok = submitFifoBurst(transfers[slot ^ 1], burst[slot ^ 1], wanted, requested, chunks[slot ^ 1]);
+
+        if (!bus.wait(transfers[slot]))
+            ok = false;
+        if (!ok)
+            break;
+
+        for (uint16_t i = 0; i < chunks[slot]; i++)
+        {
+            decodeAccel(burst[slot] + i * FIFO_SAMPLE_BYTES, samples[count]);
+            count++;
+        }
+    }
+
+    // No salir con una ráfaga en vuelo: su buffer es local
+    bus.wait(transfers[0]);
+    bus.wait(transfers[1]);
+    return ok;
+}
+
+// PWR_MGMT_1: CYCLE (bit 5), TEMP_DIS (bit 3), CLKSEL = 0 (oscilador interno)
+// PWR_MGMT_2: LP_WAKE_CTRL (bits 7:6), STBY_XG/YG/ZG (bits 2:0)
+static const uint8_t PWR1_CYCLE = 0x20;
+static const uint8_t PWR1_TEMP_DISABLE = 0x08;
+static const uint8_t PWR2_GYRO_STANDBY = 0x07;
+
+bool Mpu6050Raw::setAccelOnly()
+{
+    return writeRegister(MPU6050_REG_PWR_MGMT_1, 0) &&
+           writeRegister(MPU6050_REG_PWR_MGMT_2, PWR2_GYRO_STANDBY);
+}
+
+bool Mpu6050Raw::setCycleMode(bool enable, Mpu6050WakeRate wakeRate)
+{
+    if (!enable)
+        return setAccelOnly();
+
+    return writeRegister(MPU6050_REG_PWR_MGMT_2, (uint8_t)(wakeRate << 6) | PWR2_GYRO_STANDBY) &&
+           writeRegister(MPU6050_REG_PWR_MGMT_1, PWR1_CYCLE | PWR1_TEMP_DISABLE);
+}
@@ -0,0 +1,114 @@
+// mpu6050_raw.h - Acceso directo a registros del MPU6050 (interrupciones y ráfagas)
+#pragma once
+#include <Arduino.h>
+#include "i2c_bus.h"
+
+// Registros usados (mapa de registros MPU-6000/6050, rev. 4.2)
+const uint8_t MPU6050_REG_SMPLRT_DIV = 0x19;
+const uint8_t MPU6050_REG_ACCEL_CONFIG = 0x1C;
+const uint8_t MPU6050_REG_MOT_THR = 0x1F;
+const uint8_t MPU6050_REG_MOT_DUR = 0x20;
+const uint8_t MPU6050_REG_FIFO_EN = 0x23;
+const uint8_t MPU6050_REG_INT_PIN_CFG = 0x37;
+const uint8_t MPU6050_REG_INT_ENABLE = 0x38;
+const uint8_t MPU6050_REG_INT_STATUS = 0x3A;
+const uint8_t MPU6050_REG_ACCEL_XOUT_H = 0x3B;
+const uint8_t MPU6050_REG_TEMP_OUT_H = 0x41;
+const uint8_t MPU6050_REG_USER_CTRL = 0x6A;
+const uint8_t MPU6050_REG_PWR_MGMT_1 = 0x6B;
+const uint8_t MPU6050_REG_PWR_MGMT_2 = 0x6C;
+const uint8_t MPU6050_REG_FIFO_COUNT_H = 0x72;
+const uint8_t MPU6050_REG_FIFO_R_W = 0x74;
+
+// Bits de INT_ENABLE / INT_STATUS
+const uint8_t MPU6050_INT_DATA_READY = 0x01;
+const uint8_t MPU6050_INT_FIFO_OVERFLOW = 0x10;
+const uint8_t MPU6050_INT_MOTION = 0x40;
+
+// Frecuencia de despertar en modo ciclo (PWR_MGMT_2, LP_WAKE_CTRL)
+enum Mpu6050WakeRate
+{
+    MPU6050_WAKE_1_25HZ = 0,
+    MPU6050_WAKE_5HZ = 1,
+    MPU6050_WAKE_20HZ = 2,
+    MPU6050_WAKE_40HZ = 3,
+};
+
+// Cómo llegan las muestras del acelerómetro
+enum AccelMode
+{
+    ACCEL_MODE_INTERRUPT = 0, // INT de dato listo, una ráfaga de 6 bytes por muestra
+    ACCEL_MODE_FIFO = 1,      // FIFO interno a ritmo fijo, vaciado por lotes
+};
+
+// ===========================
+// MPU6050 A NIVEL DE REGISTRO
+// ===========================
+// getEvent() de Adafruit lee 14 bytes (acelerómetro, temperatura y giroscopio)
+// en cada llamada haya dato nuevo o no. Aquí el pin INT avisa del dato listo
+// y del movimiento, y cada lectura pide solo lo que hace falta: 1 byte de
+// estado y 6 de acelerómetro; la temperatura, aparte y de tarde en tarde.
+// La configuración base (rango, filtro) sigue haciéndola Adafruit_MPU6050
+// por Wire; todo lo demás va por el bus planificado (i2c_bus.h).
+class Mpu6050Raw
+{
+public:
+    Mpu6050Raw(I2cBus &bus, uint8_t address) : bus(bus), address(address) {}
+
+    // INT activo a nivel alto, enclavado hasta leer INT_STATUS. Frecuencia de
+    // salida = 1 kHz / (1 + sampleRateDivider) con el DLPF activo. Umbral de
+    // movimiento en unidades de 2 mg y duración en ms (a 1 kHz)
+    bool configureInterrupts(uint8_t sampleRateDivider, uint8_t motionThreshold,
+                             uint8_t motionDurationMs);
+
+    // Cambia qué fuentes disparan INT (MPU6050_INT_*)
+    bool setInterruptSources(uint8_t sources);
+
+    // Lee y borra el estado de interrupción
+    bool readInterruptStatus(uint8_t &status);
+
+    // Ráfaga de 6 bytes desde ACCEL_XOUT_H: x, y, z en cuentas crudas
+    bool readAccelRaw(int16_t raw[3]);
+
+    // INT_STATUS va justo antes de ACCEL_XOUT_H: estado y acelerómetro en
+    // una sola transacción de 7 bytes. raw solo es válido con dato listo
+    bool readStatusAndAccel(uint8_t &status, int16_t raw[3]);
+
+    bool readTemperature(float &celsius);
+
+    // Giroscopio en espera (nunca se lee) con el oscilador interno como reloj,
+    // ya que el PLL del giroscopio deja de estar disponible
+    bool setAccelOnly();
+
+    // Modo ciclo: el chip duerme y despierta a wakeRate para una sola
+    // lectura del acelerómetro; la detección de movimiento sigue activa
+    bool setCycleMode(bool enable, Mpu6050WakeRate wakeRate);
+
+    // FIFO solo con el acelerómetro (6 bytes por muestra, 1024 bytes = 170
+    // muestras). enableFifo() lo vacía antes de activarlo
+    static const uint16_t FIFO_SIZE = 1024;
+    static const uint8_t FIFO_SAMPLE_BYTES = 6;
+
+    bool enableFifo();
+    bool disableFifo();
+
+    // Lee hasta maxSamples muestras completas en ráfagas de como mucho
+    // FIFO_BURST_BYTES, pidiendo la siguiente antes de decodificar la
+    // actual. overflowed = el FIFO se llenó y se ha reiniciado, perdiendo
+    // lo que había
+    bool readFifoAccel(int16_t (*samples)[3], uint16_t maxSamples, uint16_t &count,
+                       bool &overflowed);
+
+    bool writeRegister(uint8_t reg, uint8_t value);
+    bool readRegisters(uint8_t reg, uint8_t *data, uint8_t length);
+
+private:
+    static const uint8_t FIFO_BURST_BYTES = 120;
+
+    I2cBus &bus;
+    uint8_t address;
+
+    static void decodeAccel(const uint8_t *bytes, int16_t raw[3]);
+    bool submitFifoBurst(I2cTransfer &transfer, uint8_t *buffer, uint16_t wanted,
+                         uint16_t &requested, uint16_t &chunk);
+};
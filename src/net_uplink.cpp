@@ -0,0 +1,140 @@
+// net_uplink.cpp - Implementación del envío Wi-Fi/MQTT
+#include "net_uplink.h"
+
+#if ENABLE_NET_UPLINK
+
+#include <WiFi.h>
+#include <PubSubClient.h>
+
+NetUplink netUplink;
+
+static WiFiClient wifiClient;
+static PubSubClient mqttClient(wifiClient);
+
+static const char MQTT_TOPIC[] = "walkpip/" DEVICE_ID "/frames";
+static const size_t FRAME_SIZE = FRAME_OVERHEAD + sizeof(SensorFramePayload);
+static uint8_t messageBuffer[NetUplink::BATCH_MAX * FRAME_SIZE];
+
+bool NetUplink::begin()
+{
+    if (strlen(WIFI_SSID) == 0 || strlen(MQTT_HOST) == 0)
+        return false;
+
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false); // el backoff lo controlamos nosotros
+
+    mqttClient.setServer(MQTT_HOST, MQTT_PORT);
+    mqttClient.setBufferSize(sizeof(messageBuffer) + 64);
+
+    // Núcleo 0 junto a la pila Wi-Fi, prioridad por debajo de la transmisión
+    return xTaskCreatePinnedToCore(taskEntry, "uplink", 6144, this, 1, NULL, 0) == pdPASS;
+}
+
+void NetUplink::enqueue(const SensorFramePayload &payload)
+{
+    inbox.push(payload);
+}
+
+void NetUplink::taskEntry(void *parameter)
+{
+    static_cast<NetUplink *>(parameter)->run();
+}
+
+void NetUplink::run()
+{
+    while (true)
+    {
+        unsigned long now = millis();
+
+        // Pasar lo nuevo al buffer offline (el más antiguo se pierde si se llena)
+        SensorFramePayload payload;
+        while (inbox.pop(payload))
+        {
+            if (backlog.size() == backlog.capacity())
+                backlogDropped++;
+            backlog.push(payload);
+        }
+        pendingCount = backlog.size();
+
+        if (ensureConnected(now))
+        {
+            mqttClient.loop();
+
+            // Publicar al llenar un lote o al vencer el intervalo
+            bool full = backlog.size() >= BATCH_MAX;
+            bool due = !backlog.empty() && now - lastPublish >= BATCH_INTERVAL;
+            if ((full || due) && !publishBatch())
+            {
+                mqttClient.disconnect();
+                scheduleRetry(now);
+            }
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+bool NetUplink::ensureConnected(unsigned long now)
+{
+    connected = WiFi.status() == WL_CONNECTED && mqttClient.connected();
+    if (connected)
+        return true;
+
+    if ((long)(now - nextAttempt) < 0)
+        return false;
+
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        // Conexión asíncrona: se comprueba en la siguiente vuelta
+        WiFi.disconnect();
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+        scheduleRetry(now);
+        return false;
+    }
+
+    if (mqttClient.connect(DEVICE_ID))
+    {
+        backoff = BACKOFF_MIN;
+        connected = true;
+        return true;
+    }
+
+    scheduleRetry(now);
+    return false;
+}
+
+void NetUplink::scheduleRetry(unsigned long now)
+{
+    // Backoff exponencial con algo de azar para que una flota no se sincronice
+    nextAttempt = now + backoff + random(backoff / 4 + 1);
+    backoff = backoff * 2 > BACKOFF_MAX ? BACKOFF_MAX : backoff * 2;
+}
+
+bool NetUplink::publishBatch()
+{
+    size_t count = backlog.size() < BATCH_MAX ? backlog.size() : BATCH_MAX;
+    size_t length = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        length += encoder.encode(FRAME_SENSOR, &backlog.at(i), sizeof(SensorFramePayload),
+                                 messageBuffer + length, sizeof(messageBuffer) - length);
+    }
+
+    // Solo se sacan del buffer cuando el broker ha aceptado el mensaje
+    if (!mqttClient.publish(MQTT_TOPIC, messageBuffer, length))
+        return false;
+
+    SensorFramePayload sent;
+    for (size_t i = 0; i < count; i++)
+    {
+        backlog.pop(sent);
+    }
+
+    pendingCount = backlog.size();
+    publishedCount += count;
+    lastPublish = millis();
+    return true;
+}
+
+#endif
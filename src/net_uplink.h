@@ -0,0 +1,82 @@
+// net_uplink.h - Envío directo por Wi-Fi/MQTT sin el puente serial de Python
+#pragma once
+#include <Arduino.h>
+#include "frame_protocol.h"
+#include "ring_buffer.h"
+#include "spsc_queue.h"
+
+// ===========================
+// CONFIGURACIÓN (build_flags)
+// ===========================
+//   -DENABLE_NET_UPLINK=1
+//   -DWIFI_SSID=\"mi-red\" -DWIFI_PASSWORD=\"clave\"
+//   -DMQTT_HOST=\"192.168.1.10\" -DMQTT_PORT=1883 -DDEVICE_ID=\"walker-01\"
+#ifndef ENABLE_NET_UPLINK
+#define ENABLE_NET_UPLINK 0
+#endif
+#ifndef WIFI_SSID
+#define WIFI_SSID ""
+#endif
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD ""
+#endif
+#ifndef MQTT_HOST
+#define MQTT_HOST ""
+#endif
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+#ifndef DEVICE_ID
+#define DEVICE_ID "walker"
+#endif
+
+// ===========================
+// UPLINK MQTT
+// ===========================
+// La tarea de transmisión solo encola la instantánea (enqueue(), sin
+// bloquear). Una tarea propia en el núcleo 0 gestiona Wi-Fi y MQTT con
+// reintentos en backoff exponencial, guarda lo pendiente en un buffer offline
+// (descarta lo más antiguo si se llena) y publica en lotes: varias tramas
+// FRAME_SENSOR concatenadas por mensaje en walkpip/<DEVICE_ID>/frames, que
+// se decodifican con el mismo python/frame_protocol.py que el serial.
+class NetUplink
+{
+public:
+    static const size_t BACKLOG_SIZE = 512;          // ~4 min a 500 ms
+    static const size_t BATCH_MAX = 32;              // tramas por mensaje
+    static const unsigned long BATCH_INTERVAL = 2000; // ms máx. entre mensajes
+    static const unsigned long BACKOFF_MIN = 1000;
+    static const unsigned long BACKOFF_MAX = 60000;
+
+    bool begin();
+
+    // Desde la tarea de transmisión
+    void enqueue(const SensorFramePayload &payload);
+
+    bool isConnected() const { return connected; }
+    size_t getPendingCount() const { return pendingCount; }
+    uint32_t getDroppedCount() const { return inbox.getDroppedCount() + backlogDropped; }
+    uint32_t getPublishedCount() const { return publishedCount; }
+
+private:
+    SpscQueue<SensorFramePayload, 32> inbox;             // transmisión -> uplink
+    RingBuffer<SensorFramePayload, BACKLOG_SIZE> backlog; // solo la tarea uplink
+    FrameEncoder encoder;
+
+    volatile bool connected = false;
+    volatile size_t pendingCount = 0;
+    volatile uint32_t backlogDropped = 0;
+    volatile uint32_t publishedCount = 0;
+
+    unsigned long nextAttempt = 0;
+    unsigned long backoff = BACKOFF_MIN;
+    unsigned long lastPublish = 0;
+
+    static void taskEntry(void *parameter);
+    void run();
+    bool ensureConnected(unsigned long now);
+    void scheduleRetry(unsigned long now);
+    bool publishBatch();
+};
+
+extern NetUplink netUplink;
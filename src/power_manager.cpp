@@ -0,0 +1,100 @@
+// power_manager.cpp - Implementación del gestor de energía
+#include "power_manager.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+
+// Consumos típicos (hojas de datos; µA)
+static const uint32_t ESP32_ACTIVE_UA = 50000;     // 240 MHz, dos núcleos, sin radio
+static const uint32_t ESP32_LIGHT_SLEEP_UA = 800;
+static const uint32_t MAX30105_FULL_UA = 1400;     // IR 0x2A + rojo 0x3A, 411 µs a 100 Hz
+static const uint32_t MAX30105_PROXIMITY_UA = 650; // IR 0x0A a 50 Hz, rojo apagado
+static const uint32_t MPU6050_ACCEL_UA = 500;      // solo acelerómetro, giroscopio en espera
+static const uint32_t MPU6050_CYCLE_UA = 20;       // modo ciclo a 5 Hz
+
+PowerManager::PowerManager(unsigned long noFingerDelay, unsigned long stillDelay)
+    : policy(noFingerDelay, stillDelay), lastUpdateTime(0), started(false), sleepRemainderUs(0)
+{
+    requested.store(POWER_ACTIVE);
+    applied.store(POWER_ACTIVE);
+    for (int i = 0; i < POWER_STATE_COUNT; i++)
+    {
+        residencyMs[i].store(0);
+        sleepMs[i].store(0);
+    }
+    ppgWakeMs.store(0);
+    accelWakeMs.store(0);
+    sleepWakeUs.store(0);
+}
+
+void PowerManager::update(bool presence, bool moving, unsigned long now)
+{
+    if (!started)
+    {
+        lastUpdateTime = now;
+        started = true;
+    }
+
+    // Tiempo en el estado que estaba aplicado desde la última llamada
+    residencyMs[getApplied()].fetch_add(now - lastUpdateTime, std::memory_order_relaxed);
+    lastUpdateTime = now;
+
+    requested.store(policy.update(presence, moving, now), std::memory_order_relaxed);
+}
+
+bool PowerManager::sleepUntilNextTimer(int wakePin)
+{
+    int64_t start = esp_timer_get_time();
+    int64_t sleepUs = esp_timer_get_next_alarm() - start - SLEEP_MARGIN_US;
+    if (sleepUs < MIN_SLEEP_US)
+        return false;
+
+    // Terminar lo que haya en la UART: el light sleep la para a media trama
+    uart_wait_tx_idle_polling(UART_NUM_0);
+
+    esp_sleep_enable_timer_wakeup((uint64_t)sleepUs);
+    gpio_wakeup_enable((gpio_num_t)wakePin, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_light_sleep_start();
+
+    // gpio_wakeup_enable cambia el tipo de interrupción del pin: devolverle
+    // el flanco de subida que usa attachInterrupt()
+    gpio_wakeup_disable((gpio_num_t)wakePin);
+    gpio_set_intr_type((gpio_num_t)wakePin, GPIO_INTR_POSEDGE);
+
+    int64_t woke = esp_timer_get_time();
+    bool byPin = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+
+    // Retraso del despertar por temporizador respecto a lo previsto
+    if (!byPin)
+    {
+        int64_t late = woke - (start + sleepUs);
+        sleepWakeUs.store(late > 0 ? (uint32_t)late : 0, std::memory_order_relaxed);
+    }
+
+    uint32_t slept = sleepRemainderUs + (uint32_t)(woke - start);
+    sleepMs[getApplied()].fetch_add(slept / 1000, std::memory_order_relaxed);
+    sleepRemainderUs = slept % 1000;
+    return byPin;
+}
+
+PowerManager::StateReport PowerManager::getReport(uint8_t state) const
+{
+    StateReport report;
+    report.residencyMs = residencyMs[state].load(std::memory_order_relaxed);
+    uint32_t slept = sleepMs[state].load(std::memory_order_relaxed);
+    if (slept > report.residencyMs)
+        slept = report.residencyMs;
+    report.sleepPercent = report.residencyMs > 0 ? (uint8_t)((100ULL * slept) / report.residencyMs) : 0;
+    report.currentUa = componentCurrentUa(state, report.sleepPercent);
+    return report;
+}
+
+uint32_t PowerManager::componentCurrentUa(uint8_t state, uint8_t sleepPercent)
+{
+    uint32_t esp = (ESP32_ACTIVE_UA * (100 - sleepPercent) + ESP32_LIGHT_SLEEP_UA * sleepPercent) / 100;
+    uint32_t ppg = (state & POWER_PPG_LOW) ? MAX30105_PROXIMITY_UA : MAX30105_FULL_UA;
+    uint32_t accel = (state & POWER_ACCEL_LOW) ? MPU6050_CYCLE_UA : MPU6050_ACCEL_UA;
+    return esp + ppg + accel;
+}
@@ -0,0 +1,72 @@
+// power_manager.h - Modos de bajo consumo según dedo y movimiento
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "power_policy.h"
+
+// ===========================
+// GESTOR DE ENERGÍA
+// ===========================
+// El procesado decide (update, con PowerPolicy de lib/WalkAlgorithms) qué
+// estado toca según el dedo y el movimiento; la adquisición, dueña del bus, lo aplica a los sensores y
+// confirma con setApplied(). El gestor lleva la cuenta del tiempo en cada
+// estado y del tiempo dormido, y con una tabla de consumos típicos de hoja
+// de datos estima la corriente media de cada estado. Las latencias de
+// salida de cada modo se miden en la propia canalización.
+class PowerManager
+{
+public:
+    struct StateReport
+    {
+        uint32_t residencyMs;  // tiempo total en el estado
+        uint8_t sleepPercent;  // parte de ese tiempo en light sleep
+        uint32_t currentUa;    // corriente media estimada (µA)
+    };
+
+    PowerManager(unsigned long noFingerDelay, unsigned long stillDelay);
+
+    // Procesado: presencia (dedo o proximidad) y movimiento
+    void update(bool presence, bool moving, unsigned long now);
+    uint8_t getRequested() const { return requested.load(std::memory_order_relaxed); }
+
+    // Adquisición
+    void setApplied(uint8_t state) { applied.store(state, std::memory_order_relaxed); }
+    uint8_t getApplied() const { return applied.load(std::memory_order_relaxed); }
+    bool isPpgLowPower() const { return getApplied() & POWER_PPG_LOW; }
+
+    // Duerme en light sleep hasta el próximo temporizador o hasta que
+    // wakePin suba. Devuelve true si despertó por el pin
+    bool sleepUntilNextTimer(int wakePin);
+
+    void recordPpgWake(uint32_t ms) { ppgWakeMs.store(ms, std::memory_order_relaxed); }
+    void recordAccelWake(uint32_t ms) { accelWakeMs.store(ms, std::memory_order_relaxed); }
+
+    // Desde cualquier tarea
+    StateReport getReport(uint8_t state) const;
+    uint32_t getPpgWakeMs() const { return ppgWakeMs.load(std::memory_order_relaxed); }
+    uint32_t getAccelWakeMs() const { return accelWakeMs.load(std::memory_order_relaxed); }
+    uint32_t getSleepWakeUs() const { return sleepWakeUs.load(std::memory_order_relaxed); }
+
+    // Consumo típico de cada bloque (µA): para estimar, no para medir
+    static uint32_t componentCurrentUa(uint8_t state, uint8_t sleepPercent);
+
+private:
+    static const int64_t MIN_SLEEP_US = 3000;   // menos no compensa entrar y salir
+    static const int64_t SLEEP_MARGIN_US = 1000; // despertar antes del temporizador
+
+    // Solo el procesado
+    PowerPolicy policy;
+    unsigned long lastUpdateTime;
+    bool started;
+
+    std::atomic<uint8_t> requested;
+    std::atomic<uint8_t> applied;
+
+    std::atomic<uint32_t> residencyMs[POWER_STATE_COUNT];
+    std::atomic<uint32_t> sleepMs[POWER_STATE_COUNT];
+    uint32_t sleepRemainderUs; // solo la adquisición
+
+    std::atomic<uint32_t> ppgWakeMs;
+    std::atomic<uint32_t> accelWakeMs;
+    std::atomic<uint32_t> sleepWakeUs;
+};
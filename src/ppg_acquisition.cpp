@@ -0,0 +1,74 @@
+// ppg_acquisition.cpp - Implementación del vaciado del FIFO del MAX30105
+#include "ppg_acquisition.h"
+
+// Registros del FIFO (datasheet MAX30105, tabla 1)
+static const uint8_t REG_FIFO_WR_PTR = 0x04; // seguido de OVF_COUNTER y FIFO_RD_PTR
+static const uint8_t REG_FIFO_DATA = 0x07;
+static const uint8_t FIFO_POINTER_MASK = 0x1F;
+static const uint32_t SAMPLE_MASK = 0x3FFFF; // 18 bits con el ADC a 411 µs
+
+PpgAcquisition::PpgAcquisition(I2cBus &bus, uint8_t address)
+    : bus(bus), address(address), samplePeriod(40), lastSampleTime(0), droppedCount(0)
+{
+}
+
+void PpgAcquisition::begin(unsigned long samplePeriodMs, unsigned long now)
+{
+    samplePeriod = samplePeriodMs > 0 ? samplePeriodMs : 1;
+    lastSampleTime = now;
+    samples.clear();
+
+    // Como clearFIFO(): punteros y contador de desbordamiento a cero
+    uint8_t zeros[3] = {0, 0, 0};
+    I2cTransfer transfer;
+    transfer.address = address;
+    transfer.reg = REG_FIFO_WR_PTR;
+    transfer.data = zeros;
+    transfer.length = sizeof(zeros);
+    transfer.write = true;
+    if (bus.submit(transfer))
+        bus.wait(transfer);
+}
+
+uint16_t PpgAcquisition::drain(unsigned long now)
+{
+    // WR_PTR, OVF_COUNTER y RD_PTR en una sola lectura
+    uint8_t pointers[3];
+    if (!bus.readRegisters(address, REG_FIFO_WR_PTR, pointers, sizeof(pointers)))
+        return 0;
+
+    uint8_t overflow = pointers[1] & FIFO_POINTER_MASK;
+    uint16_t fresh = (pointers[0] - pointers[2]) & FIFO_POINTER_MASK;
+    // Punteros iguales con desbordamiento = FIFO lleno, no vacío
+    if (fresh == 0 && overflow > 0)
+        fresh = FIFO_DEPTH;
+    if (fresh == 0)
+        return 0;
+    droppedCount += overflow;
+
+    // Leer de FIFO_DATA avanza RD_PTR solo: no hace falta escribirlo
+    uint8_t data[FIFO_DEPTH * SAMPLE_BYTES];
+    if (!bus.readRegisters(address, REG_FIFO_DATA, data, fresh * SAMPLE_BYTES))
+        return 0;
+
+    // La última muestra es la más reciente: repartir hacia atrás con el periodo
+    unsigned long timestamp = now - (unsigned long)(fresh - 1) * samplePeriod;
+    for (uint16_t i = 0; i < fresh; i++)
+    {
+        const uint8_t *bytes = data + i * SAMPLE_BYTES;
+        PpgSample sample;
+        sample.red = (((uint32_t)bytes[0] << 16) | ((uint32_t)bytes[1] << 8) | bytes[2]) & SAMPLE_MASK;
+        sample.ir = (((uint32_t)bytes[3] << 16) | ((uint32_t)bytes[4] << 8) | bytes[5]) & SAMPLE_MASK;
+
+        // Mantener las marcas de tiempo estrictamente crecientes
+        if ((long)(timestamp - lastSampleTime) <= 0)
+            timestamp = lastSampleTime + 1;
+        sample.timestamp = timestamp;
+        lastSampleTime = timestamp;
+
+        samples.push(sample);
+        timestamp += samplePeriod;
+    }
+
+    return fresh;
+}
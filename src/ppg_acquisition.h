@@ -0,0 +1,56 @@
+// ppg_acquisition.h - Vaciado del FIFO del MAX30105 a ritmo completo
+#pragma once
+#include <Arduino.h>
+#include "i2c_bus.h"
+#include "ring_buffer.h"
+
+struct PpgSample
+{
+    uint32_t ir;
+    uint32_t red;
+    unsigned long timestamp; // ms (millis) estimado de la muestra
+};
+
+// ===========================
+// ADQUISICIÓN PPG POR RÁFAGAS
+// ===========================
+// En lugar de getIR()/getRed() (que esperan hasta 250 ms a un dato nuevo y
+// devuelven solo el último), drain() lee los punteros del FIFO y después,
+// en una sola ráfaga por el bus planificado, todas las muestras nuevas.
+// Cada muestra se guarda con su marca de tiempo reconstruida a partir del
+// periodo de muestreo configurado. La configuración del sensor (setup, LED)
+// sigue en la librería de SparkFun; siempre en modo rojo + IR.
+class PpgAcquisition
+{
+public:
+    static const size_t BUFFER_SIZE = 32; // = profundidad del FIFO del sensor
+
+    PpgAcquisition(I2cBus &bus, uint8_t address);
+
+    // Periodo efectivo del FIFO: 1000 * sampleAverage / sampleRate
+    void begin(unsigned long samplePeriodMs, unsigned long now);
+
+    // Vacía el FIFO del sensor al buffer; devuelve las muestras nuevas
+    // (0 también si falla el bus, que se ve en sus contadores)
+    uint16_t drain(unsigned long now);
+
+    bool pop(PpgSample &sample) { return samples.pop(sample); }
+    size_t pending() const { return samples.size(); }
+
+    unsigned long getLastSampleTime() const { return lastSampleTime; }
+    unsigned long getSamplePeriod() const { return samplePeriod; }
+
+    // Muestras perdidas: FIFO desbordado entre vaciados o buffer lleno
+    uint32_t getDroppedCount() const { return droppedCount + samples.getOverflowCount(); }
+
+private:
+    static const uint8_t FIFO_DEPTH = 32;
+    static const uint8_t SAMPLE_BYTES = 6; // rojo y luego IR, 3 bytes cada uno
+
+    I2cBus &bus;
+    uint8_t address;
+    RingBuffer<PpgSample, BUFFER_SIZE> samples;
+    unsigned long samplePeriod;
+    unsigned long lastSampleTime;
+    uint32_t droppedCount;
+};
@@ -0,0 +1,204 @@
+// sample_history.cpp - Implementación del historial con volcado a LittleFS
+#include "sample_history.h"
+#include <LittleFS.h>
+
+static const char *SPILL_FILES[2] = {"/historial_a.bin", "/historial_b.bin"};
+
+bool SampleHistory::begin(MemoryArena &arena, bool enableSpill)
+{
+    capacity = PSRAM_CAPACITY;
+    records = (SampleRecord *)arena.reserve(capacity * sizeof(SampleRecord), MEMORY_PSRAM);
+    if (records == NULL)
+    {
+        capacity = INTERNAL_CAPACITY;
+        records = (SampleRecord *)arena.reserve(capacity * sizeof(SampleRecord), MEMORY_INTERNAL);
+    }
+    if (records == NULL)
+    {
+        capacity = 0;
+        return false;
+    }
+
+    if (enableSpill)
+        spillChunk = (SampleRecord *)arena.reserve(SPILL_CHUNK * sizeof(SampleRecord), MEMORY_INTERNAL);
+
+    // El historial de un arranque anterior no sirve: las secuencias reinician
+    spillEnabled = spillChunk != NULL && LittleFS.begin(true);
+    if (spillEnabled)
+    {
+        LittleFS.remove(SPILL_FILES[0]);
+        LittleFS.remove(SPILL_FILES[1]);
+    }
+    return true;
+}
+
+void SampleHistory::append(const SensorFramePayload &sample, SampleRecord &record)
+{
+    record.sample = sample;
+    record.sequence = nextSequence++;
+
+    if (capacity == 0)
+        return;
+
+    if (count == capacity)
+    {
+        // El más antiguo sale del buffer: a flash si el host aún no lo tiene
+        spill(records[head]);
+        head = (head + 1) % capacity;
+        count--;
+    }
+
+    records[(head + count) % capacity] = record;
+    count++;
+}
+
+void SampleHistory::acknowledge(uint32_t sequence)
+{
+    if (sequence <= ackedSequence || sequence >= nextSequence)
+        return;
+
+    ackedSequence = sequence;
+
+    // Todo lo volcado está confirmado: liberar la flash
+    if (spillEnabled && spillCount == 0 && lastSpilledSequence != 0 &&
+        ackedSequence >= lastSpilledSequence && !backfilling)
+    {
+        LittleFS.remove(SPILL_FILES[0]);
+        LittleFS.remove(SPILL_FILES[1]);
+        lastSpilledSequence = 0;
+    }
+}
+
+void SampleHistory::spill(const SampleRecord &record)
+{
+    if (record.sequence <= ackedSequence)
+        return; // Ya confirmado, se puede perder
+
+    if (!spillEnabled)
+    {
+        lostCount++;
+        return;
+    }
+
+    spillChunk[spillCount++] = record;
+    if (spillCount == SPILL_CHUNK)
+        flushSpill();
+}
+
+void SampleHistory::flushSpill()
+{
+    File file = LittleFS.open(SPILL_FILES[spillFile], FILE_APPEND);
+    if (file && file.size() >= SPILL_FILE_MAX)
+    {
+        // Rotar: el otro fichero (el más antiguo) se sobrescribe
+        file.close();
+        spillFile ^= 1;
+        file = LittleFS.open(SPILL_FILES[spillFile], FILE_WRITE);
+    }
+
+    if (!file || file.write((const uint8_t *)spillChunk, spillCount * sizeof(SampleRecord)) !=
+                     spillCount * sizeof(SampleRecord))
+    {
+        lostCount += spillCount;
+    }
+    else
+    {
+        spilledCount += spillCount;
+        lastSpilledSequence = spillChunk[spillCount - 1].sequence;
+    }
+
+    if (file)
+        file.close();
+    spillCount = 0;
+}
+
+void SampleHistory::requestBackfill(uint32_t fromSequence)
+{
+    if (backfillFile)
+        backfillFile.close();
+
+    backfillNext = fromSequence + 1;
+    backfillEnd = nextSequence - 1;
+    backfilling = backfillNext <= backfillEnd;
+    stage = spillEnabled ? STAGE_OLD_FILE : STAGE_SPILL_CHUNK;
+}
+
+bool SampleHistory::accept(const SampleRecord &candidate, SampleRecord &out)
+{
+    if (candidate.sequence < backfillNext || candidate.sequence > backfillEnd)
+        return false;
+
+    out = candidate;
+    backfillNext = candidate.sequence + 1;
+    return true;
+}
+
+bool SampleHistory::nextFromFile(uint8_t file, SampleRecord &record)
+{
+    if (!backfillFile)
+    {
+        backfillFile = LittleFS.open(SPILL_FILES[file], FILE_READ);
+        if (!backfillFile)
+            return false;
+    }
+
+    SampleRecord candidate;
+    while (backfillFile.read((uint8_t *)&candidate, sizeof(candidate)) == sizeof(candidate))
+    {
+        if (accept(candidate, record))
+            return true;
+    }
+
+    backfillFile.close();
+    return false;
+}
+
+bool SampleHistory::nextBackfill(SampleRecord &record)
+{
+    while (backfilling)
+    {
+        switch (stage)
+        {
+        case STAGE_OLD_FILE:
+            if (nextFromFile(spillFile ^ 1, record))
+                return true;
+            stage = STAGE_CURRENT_FILE;
+            break;
+
+        case STAGE_CURRENT_FILE:
+            if (nextFromFile(spillFile, record))
+                return true;
+            stage = STAGE_SPILL_CHUNK;
+            break;
+
+        case STAGE_SPILL_CHUNK:
+            for (size_t i = 0; i < spillCount; i++)
+            {
+                if (accept(spillChunk[i], record))
+                    return true;
+            }
+            stage = STAGE_MEMORY;
+            break;
+
+        case STAGE_MEMORY:
+            if (count > 0)
+            {
+                // Las secuencias en memoria son contiguas: acceso directo
+                uint32_t oldest = records[head].sequence;
+                if (backfillNext < oldest)
+                    backfillNext = oldest;
+
+                uint32_t offset = backfillNext - oldest;
+                if (offset < count && accept(records[(head + offset) % capacity], record))
+                    return true;
+            }
+            stage = STAGE_DONE;
+            break;
+
+        case STAGE_DONE:
+            backfilling = false;
+            break;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,90 @@
+// sample_history.h - Historial de muestras en PSRAM con recuperación tras cortes
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include "frame_protocol.h"
+#include "memory_arena.h"
+
+// Muestra con número de secuencia propio (32 bits, no se repite en horas)
+struct __attribute__((packed)) SampleRecord
+{
+    SensorFramePayload sample;
+    uint32_t sequence;
+};
+
+// ===========================
+// HISTORIAL DE MUESTRAS
+// ===========================
+// Cada instantánea enviada se guarda con su secuencia en un buffer circular
+// en PSRAM (en RAM interna, mucho más pequeño, si no hay PSRAM). El host
+// confirma con "ACK <seq>" lo que ya tiene y, al reconectar, pide con
+// "BACKFILL <seq>" todo lo posterior; se reenvía como tramas FRAME_HISTORY.
+//
+// Si el buffer se llena con muestras sin confirmar, las más antiguas se
+// vuelcan a LittleFS por bloques (dos ficheros que rotan) en lugar de
+// perderse. El buffer y el bloque de volcado salen de la arena de arranque
+// (sin begin(), perfil prod, no ocupan nada); todo lo demás se usa desde la
+// tarea de transmisión.
+class SampleHistory
+{
+public:
+    static const size_t PSRAM_CAPACITY = 16384;  // ~2 h a 500 ms
+    static const size_t INTERNAL_CAPACITY = 256;
+    static const size_t SPILL_CHUNK = 64;          // registros por escritura en flash
+    static const size_t SPILL_FILE_MAX = 256 * 1024; // bytes por fichero
+
+    bool begin(MemoryArena &arena, bool enableSpill);
+
+    // Asigna la secuencia y guarda; record recibe la muestra completa
+    void append(const SensorFramePayload &sample, SampleRecord &record);
+
+    void acknowledge(uint32_t sequence);
+
+    // Reenviar todo lo posterior a fromSequence que aún se conserve
+    void requestBackfill(uint32_t fromSequence);
+    bool nextBackfill(SampleRecord &record);
+    bool isBackfilling() const { return backfilling; }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getStoredCount() const { return count; }
+    uint32_t getAckedSequence() const { return ackedSequence; }
+    uint32_t getSpilledCount() const { return spilledCount; }
+    uint32_t getLostCount() const { return lostCount; }
+
+private:
+    SampleRecord *records = NULL;
+    size_t capacity = 0;
+    size_t head = 0; // índice del más antiguo
+    size_t count = 0;
+    uint32_t nextSequence = 1;
+    uint32_t ackedSequence = 0;
+    uint32_t lostCount = 0;
+
+    // Volcado a flash
+    bool spillEnabled = false;
+    SampleRecord *spillChunk = NULL; // SPILL_CHUNK registros de la arena
+    size_t spillCount = 0;
+    uint8_t spillFile = 0;          // fichero en el que se escribe ahora
+    uint32_t lastSpilledSequence = 0;
+    uint32_t spilledCount = 0;
+
+    // Reenvío en curso: etapas ordenadas de más antiguo a más nuevo
+    enum BackfillStage
+    {
+        STAGE_OLD_FILE,
+        STAGE_CURRENT_FILE,
+        STAGE_SPILL_CHUNK,
+        STAGE_MEMORY,
+        STAGE_DONE,
+    };
+    bool backfilling = false;
+    BackfillStage stage = STAGE_DONE;
+    uint32_t backfillNext = 0;
+    uint32_t backfillEnd = 0;
+    File backfillFile;
+
+    void spill(const SampleRecord &record);
+    void flushSpill();
+    bool nextFromFile(uint8_t file, SampleRecord &record);
+    bool accept(const SampleRecord &record, SampleRecord &out);
+};
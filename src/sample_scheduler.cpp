@@ -0,0 +1,188 @@
+// sample_scheduler.cpp - Implementación del planificador de muestreo
+#include "sample_scheduler.h"
+
+SampleScheduler::SampleScheduler() : channelCount(0), task(NULL)
+{
+}
+
+int SampleScheduler::addChannel(const char *name, uint32_t periodUs)
+{
+    if (periodUs == 0)
+        return -1;
+    return initChannel(name, periodUs);
+}
+
+int SampleScheduler::addEventChannel(const char *name)
+{
+    return initChannel(name, 0);
+}
+
+int SampleScheduler::initChannel(const char *name, uint32_t periodUs)
+{
+    if (channelCount >= MAX_CHANNELS)
+        return -1;
+
+    Channel &channel = channels[channelCount];
+    channel.name = name;
+    channel.periodUs = periodUs;
+    channel.timer = NULL;
+    channel.owner = this;
+    channel.index = channelCount;
+    channel.nextDeadline = 0;
+    channel.windowStart = 0;
+    channel.windowSum = 0;
+    channel.windowCount = 0;
+    channel.windowMax = 0;
+    channel.eventTime = 0;
+    channel.pendingEvents.store(0);
+    channel.meanJitterUs.store(0);
+    channel.maxJitterUs.store(0);
+    channel.missedCount.store(0);
+
+    return channelCount++;
+}
+
+bool SampleScheduler::start(TaskHandle_t ownerTask)
+{
+    task = ownerTask;
+
+    for (uint8_t i = 0; i < channelCount; i++)
+    {
+        Channel &channel = channels[i];
+        if (channel.periodUs == 0)
+        {
+            channel.windowStart = esp_timer_get_time();
+            continue;
+        }
+
+        esp_timer_create_args_t args = {};
+        args.callback = onTimer;
+        args.arg = &channel;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = channel.name;
+
+        if (esp_timer_create(&args, &channel.timer) != ESP_OK)
+            return false;
+
+        int64_t now = esp_timer_get_time();
+        channel.nextDeadline = now + channel.periodUs;
+        channel.windowStart = now;
+
+        if (esp_timer_start_periodic(channel.timer, channel.periodUs) != ESP_OK)
+            return false;
+    }
+
+    return true;
+}
+
+bool SampleScheduler::setPeriod(int index, uint32_t periodUs)
+{
+    if (!isChannel(index))
+        return false;
+    Channel &channel = channels[index];
+    if (channel.periodUs == 0 || periodUs == 0 || channel.timer == NULL)
+        return false;
+    if (periodUs == channel.periodUs)
+        return true;
+
+    esp_timer_stop(channel.timer);
+    channel.periodUs = periodUs;
+    channel.nextDeadline = esp_timer_get_time() + periodUs;
+    return esp_timer_start_periodic(channel.timer, periodUs) == ESP_OK;
+}
+
+uint32_t SampleScheduler::wait(TickType_t timeout)
+{
+    uint32_t bits = 0;
+    xTaskNotifyWait(0, 0xFFFFFFFF, &bits, timeout);
+    return bits;
+}
+
+void SampleScheduler::notifyFromIsr(int index)
+{
+    if (!isChannel(index))
+        return;
+    Channel &channel = channels[index];
+    channel.eventTime = esp_timer_get_time();
+    channel.pendingEvents.fetch_add(1, std::memory_order_relaxed);
+
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(task, 1UL << index, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void SampleScheduler::markStart(int index)
+{
+    if (!isChannel(index))
+        return;
+    Channel &channel = channels[index];
+    int64_t now = esp_timer_get_time();
+
+    if (channel.periodUs == 0)
+    {
+        // Varias interrupciones antes de atender la primera = eventos perdidos
+        uint32_t pending = channel.pendingEvents.exchange(0, std::memory_order_relaxed);
+        if (pending > 1)
+            channel.missedCount.fetch_add(pending - 1, std::memory_order_relaxed);
+
+        int64_t latency = pending > 0 ? now - channel.eventTime : 0;
+        recordJitter(channel, now, latency > 0 ? (uint32_t)latency : 0);
+        return;
+    }
+
+    int64_t lateness = now - channel.nextDeadline;
+
+    // Un adelanto (deriva del propio temporizador) también es jitter
+    if (lateness < 0)
+        lateness = -lateness;
+
+    // Si nos retrasamos más de un periodo, esos periodos se han perdido
+    if (lateness >= channel.periodUs)
+    {
+        uint32_t missed = lateness / channel.periodUs;
+        channel.missedCount.fetch_add(missed, std::memory_order_relaxed);
+        channel.nextDeadline += (int64_t)missed * channel.periodUs;
+        lateness -= (int64_t)missed * channel.periodUs;
+    }
+    channel.nextDeadline += channel.periodUs;
+
+    recordJitter(channel, now, (uint32_t)lateness);
+}
+
+void SampleScheduler::recordJitter(Channel &channel, int64_t now, uint32_t jitter)
+{
+    channel.windowSum += jitter;
+    channel.windowCount++;
+    if (jitter > channel.windowMax)
+        channel.windowMax = jitter;
+
+    if (now - channel.windowStart >= STATS_WINDOW_US)
+    {
+        channel.meanJitterUs.store(channel.windowSum / channel.windowCount, std::memory_order_relaxed);
+        channel.maxJitterUs.store(channel.windowMax, std::memory_order_relaxed);
+        channel.windowStart = now;
+        channel.windowSum = 0;
+        channel.windowCount = 0;
+        channel.windowMax = 0;
+    }
+}
+
+SampleScheduler::ChannelStats SampleScheduler::getStats(int index) const
+{
+    ChannelStats stats = {};
+    if (!isChannel(index))
+        return stats;
+
+    const Channel &channel = channels[index];
+    stats.meanJitterUs = channel.meanJitterUs.load(std::memory_order_relaxed);
+    stats.maxJitterUs = channel.maxJitterUs.load(std::memory_order_relaxed);
+    stats.missedCount = channel.missedCount.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Corre en la tarea de esp_timer: solo avisa, nunca toca el bus
+void SampleScheduler::onTimer(void *arg)
+{
+    Channel *channel = static_cast<Channel *>(arg);
+    xTaskNotify(channel->owner->task, 1UL << channel->index, eSetBits);
+}
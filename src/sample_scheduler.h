@@ -0,0 +1,96 @@
+// sample_scheduler.h - Planificador de muestreo por temporizador hardware
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "esp_timer.h"
+
+// ===========================
+// PLANIFICADOR DE MUESTREO
+// ===========================
+// Cada canal (un sensor o tarea periódica) tiene su propio esp_timer
+// periódico que despierta a la tarea dueña con un bit de notificación. La
+// lectura empieza siempre en un periodo fijo, independiente de lo que tarde
+// el resto del trabajo, y sin espera activa: la tarea duerme en wait().
+//
+// markStart() mide el retraso de cada lectura respecto a su instante ideal;
+// cada STATS_WINDOW_US se publica la media y el máximo de esa ventana.
+//
+// Un canal de evento no tiene temporizador: lo dispara una interrupción
+// (p. ej. el pin INT de un sensor) con notifyFromIsr(), y su "retraso" es
+// el tiempo entre la interrupción y el inicio de la lectura.
+class SampleScheduler
+{
+public:
+    static const uint8_t MAX_CHANNELS = 4;
+    static const int64_t STATS_WINDOW_US = 5000000; // 5 s
+
+    struct ChannelStats
+    {
+        uint32_t meanJitterUs; // Retraso medio de la última ventana
+        uint32_t maxJitterUs;  // Peor retraso de la última ventana
+        uint32_t missedCount;  // Periodos perdidos desde el arranque
+    };
+
+    SampleScheduler();
+
+    // Devuelve el índice del canal (bit de notificación) o -1 si no caben más
+    int addChannel(const char *name, uint32_t periodUs);
+
+    // Canal sin temporizador, disparado desde una ISR
+    int addEventChannel(const char *name);
+    void IRAM_ATTR notifyFromIsr(int channel);
+
+    // Cambia el periodo de un canal con temporizador ya arrancado (desde la
+    // tarea dueña, p. ej. al pasar un sensor a bajo consumo)
+    bool setPeriod(int channel, uint32_t periodUs);
+
+    // Crea y arranca los temporizadores; task recibirá las notificaciones
+    bool start(TaskHandle_t task);
+
+    // Bloquea hasta que vence algún canal; devuelve la máscara de canales
+    uint32_t wait(TickType_t timeout = portMAX_DELAY);
+
+    // Llamar justo al empezar la lectura del canal
+    void markStart(int channel);
+
+    // Se puede consultar desde otra tarea; un canal sin registrar (-1, o
+    // fuera de la tabla) da estadísticas y periodo a cero
+    ChannelStats getStats(int channel) const;
+    uint32_t getPeriodUs(int channel) const { return isChannel(channel) ? channels[channel].periodUs : 0; }
+
+private:
+    bool isChannel(int index) const { return index >= 0 && index < channelCount; }
+    struct Channel
+    {
+        const char *name;
+        uint32_t periodUs; // 0 = canal de evento
+        esp_timer_handle_t timer;
+        SampleScheduler *owner;
+        uint8_t index;
+
+        // Solo la tarea dueña
+        int64_t nextDeadline;
+        int64_t windowStart;
+        uint64_t windowSum;
+        uint32_t windowCount;
+        uint32_t windowMax;
+
+        // Escrito por la ISR en canales de evento
+        volatile int64_t eventTime;
+        std::atomic<uint32_t> pendingEvents;
+
+        // Publicado para otras tareas
+        std::atomic<uint32_t> meanJitterUs;
+        std::atomic<uint32_t> maxJitterUs;
+        std::atomic<uint32_t> missedCount;
+    };
+
+    Channel channels[MAX_CHANNELS];
+    uint8_t channelCount;
+    TaskHandle_t task;
+
+    int initChannel(const char *name, uint32_t periodUs);
+    void recordJitter(Channel &channel, int64_t now, uint32_t jitter);
+
+    static void onTimer(void *arg);
+};
@@ -0,0 +1,91 @@
+// sensor_health.cpp - Implementación del monitor de salud de sensores
+#include "sensor_health.h"
+
+SensorHealthMonitor::SensorHealthMonitor(ProbeFn probe, InitFn init)
+    : probeFn(probe), initFn(init), online(false), consecutiveFailures(0),
+      lastBusErrors(0), lastBusTimeouts(0),
+      reconnectCount(0), failureCount(0), lastProbeTime(0), lastReinitTime(0)
+{
+}
+
+void SensorHealthMonitor::begin(bool initialized, unsigned long now)
+{
+    online.store(initialized);
+    consecutiveFailures = 0;
+    lastProbeTime = now;
+    lastReinitTime = now;
+}
+
+void SensorHealthMonitor::reportRead(bool ok)
+{
+    if (ok)
+    {
+        consecutiveFailures = 0;
+        return;
+    }
+
+    if (consecutiveFailures < 255)
+        consecutiveFailures++;
+}
+
+void SensorHealthMonitor::reportBusCounters(uint32_t errors, uint32_t timeouts)
+{
+    bool newErrors = errors != lastBusErrors;
+    bool newTimeouts = timeouts != lastBusTimeouts;
+    lastBusErrors = errors;
+    lastBusTimeouts = timeouts;
+
+    if (newTimeouts && consecutiveFailures < FAILURE_THRESHOLD)
+        consecutiveFailures = FAILURE_THRESHOLD;
+    else if (newErrors)
+        reportRead(false);
+}
+
+void SensorHealthMonitor::update(unsigned long now)
+{
+    // Sensor caído: reintentar la inicialización completa con límite de ritmo
+    if (!isOnline())
+    {
+        if (now - lastReinitTime >= REINIT_INTERVAL)
+            tryReinit(now);
+        return;
+    }
+
+    // Sondear si las lecturas fallan seguidas o si toca el sondeo periódico
+    bool suspicious = consecutiveFailures >= FAILURE_THRESHOLD;
+    if (!suspicious && now - lastProbeTime < PROBE_INTERVAL)
+        return;
+
+    // Aun sospechoso, no sondear más de una vez por intervalo de reintento
+    if (suspicious && now - lastProbeTime < REINIT_INTERVAL)
+        return;
+
+    lastProbeTime = now;
+
+    if (probeFn())
+    {
+        if (!suspicious)
+            return;
+
+        // Responde pero las lecturas siguen fallando (p. ej. FIFO atascado):
+        // la configuración se ha perdido, re-inicializar
+    }
+
+    // Fallo confirmado
+    online.store(false);
+    failureCount.fetch_add(1);
+    tryReinit(now);
+}
+
+void SensorHealthMonitor::tryReinit(unsigned long now)
+{
+    lastReinitTime = now;
+    lastProbeTime = now;
+
+    if (initFn())
+    {
+        online.store(true);
+        consecutiveFailures = 0;
+        reconnectCount.fetch_add(1);
+    }
+}
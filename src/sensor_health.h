@@ -0,0 +1,59 @@
+// sensor_health.h - Estado de salud de sensores I2C sin re-inicializarlos
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// ===========================
+// MONITOR DE SALUD DE SENSOR
+// ===========================
+// La vida del sensor se deduce de las lecturas normales (reportRead) y de un
+// sondeo barato (WHO_AM_I / PART_ID) que se hace como mucho cada
+// PROBE_INTERVAL ms. La inicialización completa solo se repite cuando el
+// sondeo confirma el fallo, y nunca más de una vez cada REINIT_INTERVAL ms.
+// begin/reportRead/update deben llamarse siempre desde la misma tarea.
+class SensorHealthMonitor
+{
+public:
+    typedef bool (*ProbeFn)(); // Lectura de un registro de identificación
+    typedef bool (*InitFn)();  // begin() + configuración completa
+
+    static const unsigned long PROBE_INTERVAL = 5000;  // ms entre sondeos
+    static const unsigned long REINIT_INTERVAL = 2000; // ms entre reintentos
+    static const uint8_t FAILURE_THRESHOLD = 3;        // fallos seguidos = sospechoso
+
+    SensorHealthMonitor(ProbeFn probe, InitFn init);
+
+    // Llamar una vez en setup() con el resultado de la inicialización
+    void begin(bool initialized, unsigned long now);
+
+    // Resultado de una lectura normal (getEvent, FIFO atascado, etc.)
+    void reportRead(bool ok);
+
+    // Contadores acumulados del bus para este dispositivo (i2c_bus.h): un
+    // error nuevo cuenta como una lectura fallida y un timeout (bus colgado
+    // o sensor reteniendo SCL) hace sondear en cuanto se pueda
+    void reportBusCounters(uint32_t errors, uint32_t timeouts);
+
+    // Sondeo periódico y reconexión; barato si no toca sondear
+    void update(unsigned long now);
+
+    // Se pueden consultar desde otra tarea (p. ej. la de transmisión)
+    bool isOnline() const { return online.load(std::memory_order_relaxed); }
+    uint32_t getReconnectCount() const { return reconnectCount.load(std::memory_order_relaxed); }
+    uint32_t getFailureCount() const { return failureCount.load(std::memory_order_relaxed); }
+
+private:
+    ProbeFn probeFn;
+    InitFn initFn;
+
+    std::atomic<bool> online;
+    uint8_t consecutiveFailures;
+    uint32_t lastBusErrors;
+    uint32_t lastBusTimeouts;
+    std::atomic<uint32_t> reconnectCount;
+    std::atomic<uint32_t> failureCount;
+    unsigned long lastProbeTime;
+    unsigned long lastReinitTime;
+
+    void tryReinit(unsigned long now);
+};
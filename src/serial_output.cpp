@@ -0,0 +1,24 @@
+// serial_output.cpp - Implementación de la salida serial no bloqueante
+#include "serial_output.h"
+
+SerialOutput serialOutput;
+
+void SerialOutput::begin(unsigned long baud)
+{
+    // El tamaño del buffer TX debe fijarse antes de instalar el driver
+    Serial.setTxBufferSize(TX_BUFFER_SIZE);
+    Serial.begin(baud);
+}
+
+bool SerialOutput::write(const uint8_t *data, size_t length)
+{
+    if (!canWrite(length))
+    {
+        droppedFrames++;
+        return false;
+    }
+
+    Serial.write(data, length);
+    bytesWritten += length;
+    return true;
+}
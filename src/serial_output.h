@@ -0,0 +1,35 @@
+// serial_output.h - Escritura por UART sin bloquear la tarea que envía
+#pragma once
+#include <Arduino.h>
+
+// ===========================
+// SALIDA SERIAL NO BLOQUEANTE
+// ===========================
+// Serial.setTxBufferSize() hace que el driver UART de ESP-IDF reserve un ring
+// buffer de transmisión: cada write() copia la trama entera a ese buffer y
+// vuelve enseguida, y la ISR la va sacando por el puerto. Si la trama no cabe
+// en el hueco libre se descarta entera (nunca a medias) y se cuenta, en vez
+// de esperar a que la UART vacíe.
+class SerialOutput
+{
+public:
+    static const size_t TX_BUFFER_SIZE = 4096;
+
+    // Llamar en setup() en lugar de Serial.begin()
+    void begin(unsigned long baud);
+
+    // Una sola escritura por trama; false si se ha descartado
+    bool write(const uint8_t *data, size_t length);
+
+    // Para tráfico de baja prioridad: comprobar antes de generar la trama
+    bool canWrite(size_t length) const { return (size_t)Serial.availableForWrite() >= length; }
+
+    uint32_t getDroppedFrames() const { return droppedFrames; }
+    uint32_t getBytesWritten() const { return bytesWritten; }
+
+private:
+    uint32_t droppedFrames = 0;
+    uint32_t bytesWritten = 0;
+};
+
+extern SerialOutput serialOutput;
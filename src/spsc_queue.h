@@ -0,0 +1,62 @@
+// spsc_queue.h - Cola sin bloqueos de un productor y un consumidor
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// ===========================
+// COLA SPSC (LOCK-FREE)
+// ===========================
+// Segura entre dos tareas (incluso en núcleos distintos) siempre que solo una
+// llame a push() y solo otra a pop(). N debe ser potencia de 2. Si la cola
+// está llena push() falla sin bloquear y lo cuenta en getDroppedCount().
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+public:
+    SpscQueue() : head(0), tail(0), droppedCount(0) {}
+
+    // Solo desde la tarea productora
+    bool push(const T &item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N)
+        {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        buffer[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Solo desde la tarea consumidora
+    bool pop(T &item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+
+        item = buffer[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    static size_t capacity() { return N; }
+    uint32_t getDroppedCount() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    T buffer[N];
+    std::atomic<size_t> head; // Escrito solo por el productor
+    std::atomic<size_t> tail; // Escrito solo por el consumidor
+    std::atomic<uint32_t> droppedCount;
+};
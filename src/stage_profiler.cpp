@@ -0,0 +1,114 @@
+// stage_profiler.cpp - Implementación del perfilador por etapas
+#include "stage_profiler.h"
+
+static const char *const STAGE_NAMES[PROFILE_STAGE_COUNT] = {
+    "ppg_lectura", "mpu_lectura", "salud", "sondeo", "init_sensor",
+    "ppg_proceso", "pasos", "json", "trama",
+};
+
+StageProfiler::StageProfiler()
+{
+    for (int i = 0; i < PROFILE_STAGE_COUNT; i++)
+    {
+        Stage &stage = stages[i];
+        memset(stage.buckets, 0, sizeof(stage.buckets));
+        stage.windowCount = 0;
+        stage.windowSum = 0;
+        stage.windowMin = UINT32_MAX;
+        stage.windowMax = 0;
+        stage.windowStart = 0;
+        stage.count.store(0);
+        stage.minUs.store(0);
+        stage.meanUs.store(0);
+        stage.p99Us.store(0);
+        stage.maxUs.store(0);
+    }
+    for (int i = 0; i < PROFILE_TASK_COUNT; i++)
+        loopCount[i].store(0);
+}
+
+// Cubos exactos de 0 a 3 µs; a partir de ahí 4 por octava según los dos
+// bits que siguen al más alto
+uint8_t StageProfiler::bucketOf(uint32_t us)
+{
+    if (us < 4)
+        return us;
+    uint8_t msb = 31 - __builtin_clz(us);
+    uint32_t bucket = (uint32_t)(msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+    return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+}
+
+uint32_t StageProfiler::bucketUpperUs(uint8_t bucket)
+{
+    if (bucket < 3)
+        return bucket;
+    // Inicio del cubo siguiente menos 1
+    uint8_t next = bucket + 1;
+    uint8_t msb = next / 4 + 1;
+    return ((uint32_t)(4 + next % 4) << (msb - 2)) - 1;
+}
+
+void StageProfiler::record(uint8_t stage, uint32_t elapsedUs, int64_t now)
+{
+    Stage &s = stages[stage];
+    if (s.windowStart == 0)
+        s.windowStart = now;
+
+    uint8_t bucket = bucketOf(elapsedUs);
+    if (s.buckets[bucket] < UINT16_MAX)
+        s.buckets[bucket]++;
+    s.windowCount++;
+    s.windowSum += elapsedUs;
+    if (elapsedUs < s.windowMin)
+        s.windowMin = elapsedUs;
+    if (elapsedUs > s.windowMax)
+        s.windowMax = elapsedUs;
+
+    if (now - s.windowStart >= WINDOW_US)
+        publish(s, now);
+}
+
+void StageProfiler::publish(Stage &stage, int64_t now)
+{
+    // Percentil 99: primer cubo en el que el acumulado llega al 99 %
+    uint32_t target = stage.windowCount - stage.windowCount / 100;
+    uint32_t seen = 0;
+    uint8_t bucket = 0;
+    for (; bucket < BUCKET_COUNT - 1; bucket++)
+    {
+        seen += stage.buckets[bucket];
+        if (seen >= target)
+            break;
+    }
+    uint32_t p99 = bucketUpperUs(bucket);
+
+    stage.count.store(stage.windowCount, std::memory_order_relaxed);
+    stage.minUs.store(stage.windowMin, std::memory_order_relaxed);
+    stage.meanUs.store(stage.windowSum / stage.windowCount, std::memory_order_relaxed);
+    stage.p99Us.store(p99 < stage.windowMax ? p99 : stage.windowMax, std::memory_order_relaxed);
+    stage.maxUs.store(stage.windowMax, std::memory_order_relaxed);
+
+    memset(stage.buckets, 0, sizeof(stage.buckets));
+    stage.windowCount = 0;
+    stage.windowSum = 0;
+    stage.windowMin = UINT32_MAX;
+    stage.windowMax = 0;
+    stage.windowStart = now;
+}
+
+StageProfiler::StageStats StageProfiler::getStats(uint8_t index) const
+{
+    const Stage &stage = stages[index];
+    StageStats stats;
+    stats.count = stage.count.load(std::memory_order_relaxed);
+    stats.minUs = stage.minUs.load(std::memory_order_relaxed);
+    stats.meanUs = stage.meanUs.load(std::memory_order_relaxed);
+    stats.p99Us = stage.p99Us.load(std::memory_order_relaxed);
+    stats.maxUs = stage.maxUs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+const char *StageProfiler::stageName(uint8_t stage)
+{
+    return stage < PROFILE_STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
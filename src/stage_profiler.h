@@ -0,0 +1,177 @@
+// stage_profiler.h - Histogramas de latencia por etapa del camino caliente
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "esp_timer.h"
+#include "build_profile.h"
+
+// Con -DENABLE_PROFILING=0 (por defecto en el perfil prod) los PROFILE_SCOPE
+// desaparecen del binario
+#ifndef ENABLE_PROFILING
+#define ENABLE_PROFILING 1
+#endif
+
+// Etapas medidas. Cada una la mide siempre la misma tarea
+enum ProfileStage
+{
+    PROFILE_PPG_READ = 0,  // vaciado del FIFO del MAX30105 (I2C)
+    PROFILE_MPU_READ,      // INT + ráfaga o FIFO del MPU6050 (I2C)
+    PROFILE_HEALTH,        // salud, energía y mantenimiento (incluye sondeos)
+    PROFILE_PROBE,         // sondeo WHO_AM_I / PART_ID
+    PROFILE_SENSOR_INIT,   // begin() + configuración completa de un sensor
+    PROFILE_PPG_PROCESS,   // dedo, DSP, latido y SpO2 por muestra
+    PROFILE_STEP_ENGINE,   // motor de pasos por lote
+    PROFILE_JSON,          // construir y enviar la línea JSON
+    PROFILE_FRAME,         // construir y enviar una trama de muestra
+    PROFILE_STAGE_COUNT,
+};
+
+// Tareas cuyas vueltas se cuentan
+enum ProfileTask
+{
+    PROFILE_TASK_ACQUISITION = 0,
+    PROFILE_TASK_PROCESSING,
+    PROFILE_TASK_TRANSPORT,
+    PROFILE_TASK_COUNT,
+};
+
+// ===========================
+// PERFILADOR POR ETAPAS
+// ===========================
+// Cada etapa acumula sus duraciones (µs) en un histograma logarítmico con 4
+// sub-cubos por octava (error < 25 %) y, cada WINDOW_US, publica mínimo,
+// media, p99 y máximo de la ventana. Como el jitter del planificador, se
+// escribe solo desde la tarea que ejecuta la etapa y se lee desde cualquiera.
+class StageProfiler
+{
+public:
+    static const int64_t WINDOW_US = 5000000; // 5 s
+    static const uint8_t BUCKET_COUNT = 80;    // hasta ~2 s
+
+    struct StageStats
+    {
+        uint32_t count;  // ejecuciones en la última ventana
+        uint32_t minUs;
+        uint32_t meanUs;
+        uint32_t p99Us;  // límite superior del cubo del percentil 99
+        uint32_t maxUs;
+    };
+
+    StageProfiler();
+
+    // Tarea dueña de la etapa
+    void record(uint8_t stage, uint32_t elapsedUs, int64_t now);
+    void countLoop(uint8_t task) { loopCount[task].fetch_add(1, std::memory_order_relaxed); }
+
+    // Cualquier tarea
+    StageStats getStats(uint8_t stage) const;
+    uint32_t getLoopCount(uint8_t task) const { return loopCount[task].load(std::memory_order_relaxed); }
+
+    static const char *stageName(uint8_t stage);
+
+private:
+    struct Stage
+    {
+        // Solo la tarea dueña
+        uint16_t buckets[BUCKET_COUNT];
+        uint32_t windowCount;
+        uint32_t windowSum;
+        uint32_t windowMin;
+        uint32_t windowMax;
+        int64_t windowStart;
+
+        // Publicado para otras tareas
+        std::atomic<uint32_t> count;
+        std::atomic<uint32_t> minUs;
+        std::atomic<uint32_t> meanUs;
+        std::atomic<uint32_t> p99Us;
+        std::atomic<uint32_t> maxUs;
+    };
+
+    Stage stages[PROFILE_STAGE_COUNT];
+    std::atomic<uint32_t> loopCount[PROFILE_TASK_COUNT];
+
+    void publish(Stage &stage, int64_t now);
+
+    static uint8_t bucketOf(uint32_t us);
+    static uint32_t bucketUpperUs(uint8_t bucket);
+};
+
+// Mide el bloque que la contiene, de la construcción al final del ámbito
+class ProfileScope
+{
+public:
+    ProfileScope(StageProfiler &profiler, uint8_t stage)
+        : profiler(profiler), stage(stage), start(esp_timer_get_time()) {}
+
+    ~ProfileScope()
+    {
+        int64_t now = esp_timer_get_time();
+        profiler.record(stage, (uint32_t)(now - start), now);
+    }
+
+private:
+    StageProfiler &profiler;
+    uint8_t stage;
+    int64_t start;
+};
+
+#if ENABLE_PROFILING
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(profiler, stage) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(profiler, stage)
+#define PROFILE_LOOP(profiler, task) (profiler).countLoop(task)
+#else
+#define PROFILE_SCOPE(profiler, stage) ((void)0)
+#define PROFILE_LOOP(profiler, task) ((void)0)
+#endif
+
+// ===========================
+// TRAMA DE DIAGNÓSTICO
+// ===========================
+// Payload de FRAME_DIAGNOSTIC: cabecera y detrás stageCount DiagnosticStage.
+// El decodificador de python/frame_protocol.py debe mantenerse igual.
+const uint8_t DIAGNOSTIC_I2C_DEVICES = 2; // MAX30105, MPU6050 (orden de i2c_bus.h)
+
+struct __attribute__((packed)) DiagnosticHeader
+{
+    uint32_t uptimeMs;
+    uint16_t loopRateHz[PROFILE_TASK_COUNT]; // vueltas por segundo de cada tarea
+    uint32_t ppgDropped;       // FIFO del MAX30105 + cola de adquisición
+    uint32_t accelDropped;     // cola de adquisición del MPU6050
+    uint32_t schedulerMissed;  // periodos perdidos, todos los canales
+    uint32_t queueDropped;     // colas de instantáneas y de log
+    uint32_t powerResidencyS[4]; // tiempo en cada PowerState
+    uint8_t powerState;        // PowerState aplicado
+    uint8_t sleepPercent;      // en ese estado
+    uint16_t currentX10Ma;     // corriente media estimada en ese estado
+    uint16_t ppgWakeMs;
+    uint16_t accelWakeMs;
+    uint16_t sleepWakeUs;
+    uint8_t ledIrAmplitude;
+    uint8_t ledRedAmplitude;
+    uint8_t adcRange;          // índice (led_agc.h)
+    uint32_t i2cErrors[DIAGNOSTIC_I2C_DEVICES];   // acumulados desde el arranque
+    uint32_t i2cTimeouts[DIAGNOSTIC_I2C_DEVICES];
+    uint8_t i2cBusyPercent;    // bus ocupado en la ventana
+    uint32_t heapFree;         // RAM interna libre (bytes)
+    uint32_t heapMinFree;      // su mínimo desde el arranque
+    uint32_t heapLargestBlock; // bloque libre más grande: fragmentación
+    uint32_t psramFree;
+    uint32_t psramTotal;       // 0 sin PSRAM
+    uint32_t arenaInternal;    // reservado en el arranque (memory_arena.h)
+    uint32_t arenaPsram;
+    uint16_t lateAllocations;  // reservas rechazadas con la arena cerrada
+    uint16_t accelRateHz;      // muestras de acelerómetro por segundo, medidas
+    uint8_t accelFifoBurst;    // muestras en el último vaciado del FIFO
+    uint8_t stageCount;
+};
+
+struct __attribute__((packed)) DiagnosticStage
+{
+    uint16_t count;  // saturado a 65535
+    uint32_t minUs;
+    uint32_t meanUs;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
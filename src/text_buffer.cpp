@@ -0,0 +1,100 @@
+// text_buffer.cpp - Implementación del formateo sobre buffer fijo
+#include "text_buffer.h"
+
+static const uint32_t POWERS_OF_TEN[] = {1, 10, 100, 1000, 10000};
+
+TextBuffer &TextBuffer::append(const char *text)
+{
+    while (*text)
+    {
+        append(*text++);
+    }
+    return *this;
+}
+
+TextBuffer &TextBuffer::append(char c)
+{
+    // Se reserva un byte para el terminador de c_str()
+    if (length + 1 < capacity)
+        data[length++] = c;
+    else
+        overflow = true;
+    return *this;
+}
+
+TextBuffer &TextBuffer::appendDigits(uint32_t value, uint8_t minDigits)
+{
+    char digits[10];
+    uint8_t count = 0;
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (count < minDigits && count < sizeof(digits))
+    {
+        digits[count++] = '0';
+    }
+
+    while (count > 0)
+    {
+        append(digits[--count]);
+    }
+    return *this;
+}
+
+TextBuffer &TextBuffer::appendUInt(uint32_t value)
+{
+    return appendDigits(value, 1);
+}
+
+TextBuffer &TextBuffer::appendInt(int32_t value)
+{
+    if (value < 0)
+    {
+        append('-');
+        return appendDigits((uint32_t)(-(int64_t)value), 1);
+    }
+    return appendDigits((uint32_t)value, 1);
+}
+
+TextBuffer &TextBuffer::appendFixed(float value, uint8_t decimals)
+{
+    if (decimals > 4)
+        decimals = 4;
+
+    // NaN/infinito no son JSON válido
+    if (!isfinite(value))
+        return append('0');
+
+    uint32_t scale = POWERS_OF_TEN[decimals];
+    int64_t scaled = llroundf(value * (float)scale);
+
+    if (scaled < 0)
+    {
+        append('-');
+        scaled = -scaled;
+    }
+
+    appendDigits((uint32_t)(scaled / scale), 1);
+    if (decimals > 0)
+    {
+        append('.');
+        appendDigits((uint32_t)(scaled % scale), decimals);
+    }
+    return *this;
+}
+
+TextBuffer &TextBuffer::appendMillisAsSeconds(uint32_t ms)
+{
+    appendDigits(ms / 1000, 1);
+    append('.');
+    return appendDigits(ms % 1000, 3);
+}
+
+const char *TextBuffer::c_str()
+{
+    data[length < capacity ? length : capacity - 1] = '\0';
+    return data;
+}
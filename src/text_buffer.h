@@ -0,0 +1,47 @@
+// text_buffer.h - Formateo rápido de texto sobre un buffer fijo
+#pragma once
+#include <Arduino.h>
+
+// ===========================
+// BUFFER DE TEXTO
+// ===========================
+// Sustituye las decenas de Serial.print de cada trama: todo se formatea en un
+// buffer reutilizable con enteros y punto fijo (sin printf ni dtostrf) y luego
+// se escribe de una vez. Si no cabe, el texto se trunca y overflowed() avisa.
+class TextBuffer
+{
+public:
+    TextBuffer(char *storage, size_t capacity)
+        : data(storage), capacity(capacity), length(0), overflow(false) {}
+
+    void clear()
+    {
+        length = 0;
+        overflow = false;
+    }
+
+    TextBuffer &append(const char *text);
+    TextBuffer &append(char c);
+    TextBuffer &appendInt(int32_t value);
+    TextBuffer &appendUInt(uint32_t value);
+    TextBuffer &appendBool(bool value) { return append(value ? "true" : "false"); }
+
+    // Número con 'decimals' cifras decimales (máx. 4), redondeado
+    TextBuffer &appendFixed(float value, uint8_t decimals);
+
+    // Milisegundos como segundos con 3 decimales, exacto ("12.345")
+    TextBuffer &appendMillisAsSeconds(uint32_t ms);
+
+    const char *c_str();
+    const uint8_t *bytes() const { return (const uint8_t *)data; }
+    size_t size() const { return length; }
+    bool overflowed() const { return overflow; }
+
+private:
+    char *data;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+    TextBuffer &appendDigits(uint32_t value, uint8_t minDigits);
+};
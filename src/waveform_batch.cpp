@@ -0,0 +1,162 @@
+// waveform_batch.cpp - Implementación de los lotes de forma de onda
+#include "waveform_batch.h"
+
+WaveformBatcher::WaveformBatcher(WaveformStream stream, uint8_t channelCount,
+                                 uint16_t capacity, uint16_t samplePeriodMs)
+    : stream(stream), channelCount(channelCount > MAX_CHANNELS ? MAX_CHANNELS : channelCount), capacity(capacity),
+      samplePeriodMs(samplePeriodMs), ready(false), current(NULL), droppedCount(0)
+{
+    batchSize.store(capacity);
+}
+
+bool WaveformBatcher::begin(MemoryArena &arena)
+{
+    if (ready)
+        return true;
+
+    size_t bytes = sizeof(int32_t) * channelCount * capacity * POOL_SIZE;
+
+    // Un solo bloque para todo el pool; PSRAM primero, RAM interna si no hay
+    int32_t *storage = (int32_t *)arena.reserve(bytes, MEMORY_PSRAM);
+    if (storage == NULL)
+        storage = (int32_t *)arena.reserve(bytes, MEMORY_INTERNAL);
+    if (storage == NULL)
+        return false;
+
+    for (size_t i = 0; i < POOL_SIZE; i++)
+    {
+        batches[i].count = 0;
+        batches[i].samplePeriodMs = samplePeriodMs;
+        batches[i].firstTimestamp = 0;
+        batches[i].samples = storage + i * channelCount * capacity;
+        freeBatches.push(&batches[i]);
+    }
+    ready = true;
+    return true;
+}
+
+void WaveformBatcher::setBatchSize(uint16_t samples)
+{
+    if (samples == 0)
+        samples = 1;
+    batchSize.store(samples > capacity ? capacity : samples, std::memory_order_relaxed);
+}
+
+bool WaveformBatcher::setSamplePeriod(uint16_t periodMs)
+{
+    if (periodMs == samplePeriodMs)
+        return false;
+    samplePeriodMs = periodMs;
+    return flush();
+}
+
+bool WaveformBatcher::add(const int32_t *values, unsigned long timestamp)
+{
+    bool completed = false;
+
+    // Un hueco en el tiempo rompe la rejilla de muestreo: cerrar el lote
+    if (current != NULL && current->count > 0)
+    {
+        unsigned long expected = current->firstTimestamp +
+                                 (unsigned long)current->count * samplePeriodMs;
+        long drift = (long)(timestamp - expected);
+        if (drift > (long)samplePeriodMs || drift < -(long)samplePeriodMs)
+            completed = flush();
+    }
+
+    if (current == NULL && !freeBatches.pop(current))
+    {
+        droppedCount++; // La transmisión no da abasto; perder la muestra
+        return completed;
+    }
+
+    if (current->count == 0)
+    {
+        current->firstTimestamp = timestamp;
+        current->samplePeriodMs = samplePeriodMs;
+    }
+
+    for (uint8_t ch = 0; ch < channelCount; ch++)
+    {
+        current->samples[ch * capacity + current->count] = values[ch];
+    }
+    current->count++;
+
+    if (current->count >= batchSize.load(std::memory_order_relaxed))
+        completed = flush() || completed;
+
+    return completed;
+}
+
+bool WaveformBatcher::flush()
+{
+    if (current == NULL || current->count == 0)
+        return false;
+
+    fullBatches.push(current);
+    current = NULL;
+    return true;
+}
+
+size_t WaveformBatcher::maxPayloadSize() const
+{
+    return sizeof(WaveformHeader) + sizeof(int32_t) * channelCount * capacity;
+}
+
+// Zigzag + varint: deltas pequeños (forma de onda suave) ocupan 1-2 bytes
+static size_t writeVarint(int32_t value, uint8_t *out, size_t room)
+{
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    size_t written = 0;
+    do
+    {
+        if (written >= room)
+            return 0;
+        uint8_t byte = zigzag & 0x7F;
+        zigzag >>= 7;
+        out[written++] = zigzag ? (byte | 0x80) : byte;
+    } while (zigzag);
+    return written;
+}
+
+size_t WaveformBatcher::encode(const WaveformBatch &batch, WaveformEncoding encoding,
+                               uint8_t *out, size_t outSize) const
+{
+    if (outSize < sizeof(WaveformHeader))
+        return 0;
+
+    WaveformHeader header;
+    header.stream = stream;
+    header.channelCount = channelCount;
+    header.encoding = encoding;
+    header.reserved = 0;
+    header.sampleCount = batch.count;
+    header.samplePeriodMs = batch.samplePeriodMs;
+    header.firstTimestampMs = batch.firstTimestamp;
+
+    size_t offset = sizeof(WaveformHeader);
+    for (uint8_t ch = 0; ch < channelCount; ch++)
+    {
+        const int32_t *channel = batch.samples + ch * capacity;
+        for (uint16_t i = 0; i < batch.count; i++)
+        {
+            if (encoding == WAVEFORM_DELTA && i > 0)
+            {
+                size_t n = writeVarint(channel[i] - channel[i - 1], out + offset, outSize - offset);
+                if (n == 0)
+                    return encoding == WAVEFORM_DELTA ? encode(batch, WAVEFORM_RAW, out, outSize) : 0;
+                offset += n;
+            }
+            else
+            {
+                if (offset + sizeof(int32_t) > outSize)
+                    return encoding == WAVEFORM_DELTA ? encode(batch, WAVEFORM_RAW, out, outSize) : 0;
+                memcpy(out + offset, &channel[i], sizeof(int32_t));
+                offset += sizeof(int32_t);
+            }
+        }
+    }
+
+    memcpy(out, &header, sizeof(header));
+    return offset;
+}
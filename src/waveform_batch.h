@@ -0,0 +1,99 @@
+// waveform_batch.h - Lotes de muestras crudas (PPG y acelerómetro) por trama
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "spsc_queue.h"
+#include "memory_arena.h"
+
+enum WaveformStream
+{
+    WAVEFORM_PPG = 0,   // canales: ir, red
+    WAVEFORM_ACCEL = 1, // canales: x, y, z (m/s² * 100)
+};
+
+enum WaveformEncoding
+{
+    WAVEFORM_RAW = 0,   // int32 por muestra
+    WAVEFORM_DELTA = 1, // primera muestra int32 + deltas zigzag varint
+};
+
+// Cabecera del payload FRAME_WAVEFORM; las muestras van detrás, por canal
+struct __attribute__((packed)) WaveformHeader
+{
+    uint8_t stream;        // WaveformStream
+    uint8_t channelCount;
+    uint8_t encoding;      // WaveformEncoding
+    uint8_t reserved;
+    uint16_t sampleCount;
+    uint16_t samplePeriodMs;
+    uint32_t firstTimestampMs;
+};
+
+struct WaveformBatch
+{
+    uint16_t count;
+    uint16_t samplePeriodMs; // el de la primera muestra; el lote no lo mezcla
+    unsigned long firstTimestamp;
+    int32_t *samples; // channelCount * capacity, un canal tras otro
+};
+
+// ===========================
+// LOTES DE FORMA DE ONDA
+// ===========================
+// Buffers preasignados una sola vez en el arranque, de la arena (en PSRAM si
+// la hay). La tarea de procesado llena un lote con add() y lo entrega lleno;
+// la de transmisión lo recoge con takeFull() y lo devuelve con release(). Dos
+// colas SPSC hacen de pool, así nadie reserva memoria ni se bloquea en el
+// camino de muestreo.
+class WaveformBatcher
+{
+public:
+    static const uint8_t MAX_CHANNELS = 3;
+    static const size_t POOL_SIZE = 4;
+
+    WaveformBatcher(WaveformStream stream, uint8_t channelCount,
+                    uint16_t capacity, uint16_t samplePeriodMs);
+
+    bool begin(MemoryArena &arena);
+    bool isReady() const { return ready; }
+
+    // Muestras por lote (hasta la capacidad); lo cambia la transmisión y
+    // rige desde la siguiente muestra
+    void setBatchSize(uint16_t samples);
+    // Procesado: nuevo periodo de muestreo. Cierra el lote en curso;
+    // devuelve true si con ello se completó uno
+    bool setSamplePeriod(uint16_t periodMs);
+
+    // Procesado: añade una muestra (channelCount valores). Devuelve true si
+    // con ella se ha completado un lote (para avisar a la transmisión)
+    bool add(const int32_t *values, unsigned long timestamp);
+
+    // Transmisión
+    bool takeFull(WaveformBatch *&batch) { return fullBatches.pop(batch); }
+    void release(WaveformBatch *batch) { freeBatches.push(batch); }
+
+    // Serializa cabecera + muestras; devuelve bytes escritos o 0 si no cabe
+    size_t encode(const WaveformBatch &batch, WaveformEncoding encoding,
+                  uint8_t *out, size_t outSize) const;
+
+    // Tamaño máximo del payload en crudo (el delta nunca se usa si no cabe)
+    size_t maxPayloadSize() const;
+
+    uint32_t getDroppedCount() const { return droppedCount; }
+
+private:
+    WaveformStream stream;
+    uint8_t channelCount;
+    uint16_t capacity;
+    uint16_t samplePeriodMs; // solo procesado
+    std::atomic<uint16_t> batchSize;
+    bool ready;
+
+    WaveformBatch batches[POOL_SIZE];
+    SpscQueue<WaveformBatch *, POOL_SIZE> freeBatches; // transmisión -> procesado
+    SpscQueue<WaveformBatch *, POOL_SIZE> fullBatches; // procesado -> transmisión
+    WaveformBatch *current;
+    uint32_t droppedCount;
+
+    bool flush();
+};
@@ -0,0 +1,262 @@
+// test_main.cpp - PpgPipeline, StepEngine y PowerPolicy sobre trazas con verdad conocida
+//
+//   pio test -e native -f test_algorithms
+//
+// Las trazas sintéticas del banco de pruebas (bench/bench_main.cpp) con las
+// cotas que este garantiza: ritmo a ~1 bpm, pasos exactos (también con el
+// tramo de vehículo y en lotes como el vaciado del FIFO) y el ritmo andando
+// con la compuerta de movimiento; y que un MPU6050 quieto deje bajar la
+// energía. Un cambio en los algoritmos que empeore alguna hace fallar el
+// test en vez de solo mover una cifra del banco.
+#include <unity.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "trace.h"
+#include "ppg_pipeline.h"
+#include "step_engine.h"
+#include "power_policy.h"
+
+// Como en el banco: fuera el arranque de filtros y ventanas
+static const unsigned long WARMUP_MS = 5000;
+
+static const float HR_TOLERANCE_BPM = 1.0f;
+// La SpO2 sintética sale ~2 puntos baja (la ventana RMS del paso banda
+// recorta algo más el rojo); la cota vigila que no empeore
+static const float SPO2_TOLERANCE = 3.0f;
+// Sin compuerta el ritmo andando se va >10 bpm: por debajo de esto la
+// traza ya no prueba nada
+static const float UNGATED_MIN_ERROR_BPM = 5.0f;
+
+static Trace restPpg, noisyPpg, walkingPpg, walkVehicle, slowWalk;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Media del ritmo y de la SpO2 publicados en cada latido tras el arranque.
+// Con withMotion el acelerómetro de la traza alimenta MotionEstimator y
+// StepEngine en lotes hasta cada muestra PPG, como en el firmware
+static void averagePpg(const Trace &trace, bool withMotion, float &heartRate, float &spo2)
+{
+    const PpgTrace &ppg = trace.ppg;
+    const AccelTrace &accel = trace.accel;
+    PpgPipeline pipeline((PpgPipelineConfig(ppg.sampleRateHz)));
+    MotionEstimator motion(accel.sampleRateHz > 0 ? accel.sampleRateHz : 100.0f);
+    StepEngine steps(accel.sampleRateHz > 0 ? accel.sampleRateHz : 100.0f);
+    size_t accelIndex = 0;
+
+    double hrSum = 0, spo2Sum = 0;
+    size_t hrCount = 0, spo2Count = 0;
+    for (size_t i = 0; i < ppg.ir.size(); i++)
+    {
+        if (withMotion)
+        {
+            size_t start = accelIndex;
+            while (accelIndex < accel.timeMs.size() && accel.timeMs[accelIndex] <= ppg.timeMs[i])
+                accelIndex++;
+            if (accelIndex > start)
+            {
+                motion.process(&accel.magnitudeMg[start], accelIndex - start);
+                steps.process(&accel.magnitudeMg[start], &accel.timeMs[start], accelIndex - start);
+            }
+            pipeline.setMotion(motion.getLevelMg(), steps.getCadence());
+        }
+
+        if (!pipeline.update(ppg.ir[i], ppg.red[i], ppg.timeMs[i]) || ppg.timeMs[i] < WARMUP_MS)
+            continue;
+        const BeatStats &beats = pipeline.getBeatStats();
+        if (beats.getHeartRate() > 0)
+        {
+            hrSum += beats.getHeartRate();
+            hrCount++;
+        }
+        if (pipeline.getSpo2X10() > 0)
+        {
+            spo2Sum += pipeline.getSpo2X10() / 10.0;
+            spo2Count++;
+        }
+    }
+    TEST_ASSERT_TRUE_MESSAGE(hrCount > 0, "ningún latido tras el arranque");
+    heartRate = hrSum / hrCount;
+    spo2 = spo2Count ? spo2Sum / spo2Count : 0;
+}
+
+// batch = 1 es el modo INT, batch = 10 un vaciado del FIFO a 100 Hz
+static uint32_t countSteps(const AccelTrace &accel, size_t batch)
+{
+    StepEngine engine(accel.sampleRateHz);
+    for (size_t i = 0; i < accel.magnitudeMg.size(); i += batch)
+    {
+        size_t count = accel.magnitudeMg.size() - i < batch ? accel.magnitudeMg.size() - i : batch;
+        engine.process(&accel.magnitudeMg[i], &accel.timeMs[i], count);
+    }
+    return engine.getStepCount();
+}
+
+// ===========================
+// RITMO Y SPO2
+// ===========================
+void test_heart_rate_at_rest(void)
+{
+    float heartRate, spo2;
+    averagePpg(restPpg, false, heartRate, spo2);
+    TEST_ASSERT_FLOAT_WITHIN(HR_TOLERANCE_BPM, restPpg.reference.heartRate, heartRate);
+    TEST_ASSERT_FLOAT_WITHIN(SPO2_TOLERANCE, restPpg.reference.spo2, spo2);
+}
+
+void test_heart_rate_with_noise(void)
+{
+    float heartRate, spo2;
+    averagePpg(noisyPpg, false, heartRate, spo2);
+    TEST_ASSERT_FLOAT_WITHIN(HR_TOLERANCE_BPM, noisyPpg.reference.heartRate, heartRate);
+    TEST_ASSERT_FLOAT_WITHIN(SPO2_TOLERANCE, noisyPpg.reference.spo2, spo2);
+}
+
+// Andando, la compuerta de movimiento mantiene el ritmo del pulso y no el
+// de la pisada; sin ella la misma traza se desvía claramente
+void test_motion_gated_heart_rate_walking(void)
+{
+    float heartRate, spo2;
+    averagePpg(walkingPpg, true, heartRate, spo2);
+    TEST_ASSERT_FLOAT_WITHIN(HR_TOLERANCE_BPM, walkingPpg.reference.heartRate, heartRate);
+    TEST_ASSERT_FLOAT_WITHIN(SPO2_TOLERANCE, walkingPpg.reference.spo2, spo2);
+
+    float ungatedHeartRate, ungatedSpo2;
+    averagePpg(walkingPpg, false, ungatedHeartRate, ungatedSpo2);
+    TEST_ASSERT_TRUE_MESSAGE(fabsf(ungatedHeartRate - walkingPpg.reference.heartRate) > UNGATED_MIN_ERROR_BPM,
+                             "sin compuerta el artefacto de la pisada debería notarse");
+}
+
+// Perfil prod (config.spo2 = false): sin el canal rojo el ritmo es el mismo
+// y la SpO2 no llega a publicarse
+void test_heart_rate_without_spo2(void)
+{
+    const PpgTrace &ppg = restPpg.ppg;
+    PpgPipelineConfig config(ppg.sampleRateHz);
+    PpgPipeline full(config);
+    config.spo2 = false;
+    PpgPipeline irOnly(config);
+    for (size_t i = 0; i < ppg.ir.size(); i++)
+    {
+        bool beat = full.update(ppg.ir[i], ppg.red[i], ppg.timeMs[i]);
+        TEST_ASSERT_EQUAL(beat, irOnly.update(ppg.ir[i], ppg.red[i], ppg.timeMs[i]));
+        TEST_ASSERT_EQUAL_INT(full.getBeatStats().getHeartRate(), irOnly.getBeatStats().getHeartRate());
+        TEST_ASSERT_EQUAL_INT32(0, irOnly.getSpo2X10());
+    }
+    TEST_ASSERT_TRUE(full.getSpo2X10() > 0);
+}
+
+// ===========================
+// PASOS
+// ===========================
+// El tramo final de vibración de vehículo no debe sumar ninguno
+void test_steps_exact_with_vehicle(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(walkVehicle.reference.steps, countSteps(walkVehicle.accel, 1));
+    TEST_ASSERT_EQUAL_UINT32(walkVehicle.reference.steps, countSteps(walkVehicle.accel, 10));
+}
+
+void test_steps_exact_slow_walk_50hz(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(slowWalk.reference.steps, countSteps(slowWalk.accel, 1));
+    TEST_ASSERT_EQUAL_UINT32(slowWalk.reference.steps, countSteps(slowWalk.accel, 10));
+}
+
+void test_steps_exact_walking_ppg(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(walkingPpg.reference.steps, countSteps(walkingPpg.accel, 1));
+    TEST_ASSERT_EQUAL_UINT32(walkingPpg.reference.steps, countSteps(walkingPpg.accel, 10));
+}
+
+// ===========================
+// ENERGÍA
+// ===========================
+// Los retardos del firmware (main.cpp)
+static const unsigned long NO_FINGER_POWER_DELAY = 3000;
+static const unsigned long STILL_POWER_DELAY = 30000;
+static const unsigned long MPU_STILL_TIMEOUT = 5000;
+static const float STILL_SECONDS = 60;
+
+// El procesado pide estado cada 10 ms. Las muestras llegan hasta que el
+// MPU6050 pasa a quieto (sin interrupción de movimiento durante
+// MPU_STILL_TIMEOUT); a partir de ahí solo el aviso de quieto, si lo hay
+static uint8_t runStillTrace(const AccelTrace &accel, bool presence, bool stillNotice, bool &movingBeforeStill)
+{
+    MotionPresence motion;
+    PowerPolicy policy(NO_FINGER_POWER_DELAY, STILL_POWER_DELAY);
+    uint8_t state = POWER_ACTIVE;
+    size_t index = 0;
+    movingBeforeStill = false;
+    for (unsigned long now = 0; now <= (unsigned long)(STILL_SECONDS * 1000); now += 10)
+    {
+        if (now < MPU_STILL_TIMEOUT)
+        {
+            while (index < accel.timeMs.size() && accel.timeMs[index] <= now)
+                movingBeforeStill |= motion.update(accel.magnitudeMg[index++]);
+        }
+        else if (now == MPU_STILL_TIMEOUT && stillNotice)
+        {
+            motion.stop();
+        }
+        state = policy.update(presence, motion.isMoving(), now);
+    }
+    return state;
+}
+
+// Quieto sobre la mesa con el offset de cero g de un MPU6050 de serie
+// (+50 mg): muestra a muestra parece que se mueve, pero al dejar de llegar
+// muestras debe acabar en STILL (con dedo) o IDLE (sin él)
+void test_still_trace_reaches_low_power(void)
+{
+    AccelTrace accel;
+    accel.sampleRateHz = 100;
+    srand(6);
+    for (unsigned long t = 0; t < (unsigned long)(STILL_SECONDS * 1000); t += 10)
+    {
+        accel.timeMs.push_back(t);
+        accel.magnitudeMg.push_back(1049 + rand() % 5 - 2);
+    }
+
+    bool movingBeforeStill;
+    TEST_ASSERT_EQUAL_UINT32(POWER_IDLE, runStillTrace(accel, false, true, movingBeforeStill));
+    TEST_ASSERT_TRUE_MESSAGE(movingBeforeStill, "el offset debería pasar el umbral por muestra");
+    TEST_ASSERT_EQUAL_UINT32(POWER_STILL, runStillTrace(accel, true, true, movingBeforeStill));
+
+    // Sin el aviso el movimiento se queda congelado y nunca baja el MPU6050
+    TEST_ASSERT_EQUAL_UINT32(POWER_NO_FINGER, runStillTrace(accel, false, false, movingBeforeStill));
+}
+
+// Andando llegan muestras todo el rato: el motor nunca pide el modo ciclo
+void test_walk_keeps_accel_active(void)
+{
+    MotionPresence motion;
+    PowerPolicy policy(NO_FINGER_POWER_DELAY, STILL_POWER_DELAY);
+    const AccelTrace &accel = walkVehicle.accel;
+    for (size_t i = 0; i < accel.magnitudeMg.size(); i++)
+    {
+        motion.update(accel.magnitudeMg[i]);
+        TEST_ASSERT_FALSE(policy.update(true, motion.isMoving(), accel.timeMs[i]) & POWER_ACCEL_LOW);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // Las mismas que el banco sin traza
+    makeSyntheticPpg(restPpg, 120, 25, 72, 97, 40, 1);
+    makeSyntheticPpg(noisyPpg, 120, 25, 110, 92, 150, 2);
+    makeSyntheticWalk(walkVehicle, 60, 100, 108, 20, 3);
+    makeSyntheticWalk(slowWalk, 60, 50, 66, 0, 4);
+    makeSyntheticWalkingPpg(walkingPpg, 120, 25, 95, 97, 108, 20, 5);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_heart_rate_at_rest);
+    RUN_TEST(test_heart_rate_with_noise);
+    RUN_TEST(test_motion_gated_heart_rate_walking);
+    RUN_TEST(test_heart_rate_without_spo2);
+    RUN_TEST(test_steps_exact_with_vehicle);
+    RUN_TEST(test_steps_exact_slow_walk_50hz);
+    RUN_TEST(test_steps_exact_walking_ppg);
+    RUN_TEST(test_still_trace_reaches_low_power);
+    RUN_TEST(test_walk_keeps_accel_active);
+    return UNITY_END();
+}
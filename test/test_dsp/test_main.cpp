@@ -0,0 +1,241 @@
+// test_main.cpp - Camino en coma fija de dsp_fixed.h frente a sus referencias en float
+//
+//   pio test -e native -f test_dsp
+//
+// Las mismas trazas sintéticas del banco de pruebas pasan muestra a muestra
+// por cada bloque entero y por su referencia; la diferencia debe quedar
+// dentro de una cota en LSB (cuentas del ADC, o Q16 en los cocientes)
+// que sale del redondeo de cada bloque, no de lo observado.
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#include "dsp_fixed.h"
+#include "trace.h"
+
+// Los parámetros de PpgPipelineConfig en el firmware
+static const float PPG_RATE_HZ = 25.0f;
+static const uint8_t DC_SHIFT = 5;
+static const float BAND_LOW_HZ = 0.5f;
+static const float BAND_HIGH_HZ = 4.0f;
+static const size_t RATIO_WINDOW = 64; // 2^spo2WindowShift
+
+// DcRemover: 0,5 LSB al redondear la DC de Q8 a entero, más el sesgo del
+// desplazamiento (trunca hacia -inf): la media se para a menos de
+// 2^shift / 2^8 = 0,125 cuentas de la exacta
+static const float DC_TOLERANCE_LSB = 0.5f + (float)(1 << DC_SHIFT) / (1 << DSP_DC_FRAC_BITS);
+
+static std::vector<Trace> traces;
+
+// Las del banco de pruebas: reposo, esfuerzo con ruido y pulso andando
+static void buildTraces()
+{
+    traces.resize(3);
+    makeSyntheticPpg(traces[0], 120, PPG_RATE_HZ, 72, 97, 40, 1);
+    makeSyntheticPpg(traces[1], 120, PPG_RATE_HZ, 110, 92, 150, 2);
+    makeSyntheticWalkingPpg(traces[2], 120, PPG_RATE_HZ, 95, 97, 108, 20, 5);
+}
+
+// Suma de |h[n]| de la respuesta al impulso de 1/A(z) (feedbackOnly) o
+// del filtro entero: cuánto puede amplificar la recursión un error por
+// muestra acotado
+static float impulseGain(const BiquadCoefficients &c, bool feedbackOnly)
+{
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0, sum = 0;
+    for (int n = 0; n < 20000; n++)
+    {
+        double x = n == 0 ? 1.0 : 0.0;
+        double y = feedbackOnly ? x - c.a1 * y1 - c.a2 * y2
+                                : c.b0 * x + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        sum += fabs(y);
+    }
+    return (float)sum;
+}
+
+// BiquadFilter: la salida se redondea (0,5 LSB) y vuelve a entrar por la
+// realimentación, así que el error llega a 0,5 · Σ|h| de 1/A(z) (~5,8 LSB
+// con la banda del firmware). Los coeficientes en Q28 añaden menos de 2^-28
+// por término: un margen de 0,5 LSB los cubre con señales de 2^22
+static float biquadToleranceLsb(const BiquadCoefficients &c)
+{
+    return 0.5f * impulseGain(c, true) + 0.5f;
+}
+
+static const std::vector<int32_t> &channel(const Trace &trace, int index)
+{
+    return index == 0 ? trace.ppg.ir : trace.ppg.red;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ===========================
+// BLOQUES
+// ===========================
+void test_dc_remover_matches_reference(void)
+{
+    for (size_t t = 0; t < traces.size(); t++)
+    {
+        for (int ch = 0; ch < 2; ch++)
+        {
+            const std::vector<int32_t> &x = channel(traces[t], ch);
+            DcRemover fixed(DC_SHIFT);
+            DcRemoverRef reference(DC_SHIFT);
+            for (size_t i = 0; i < x.size(); i++)
+            {
+                int32_t ac = fixed.update(x[i]);
+                float acRef = reference.update((float)x[i]);
+                TEST_ASSERT_FLOAT_WITHIN_MESSAGE(DC_TOLERANCE_LSB, acRef, (float)ac, traces[t].name.c_str());
+                TEST_ASSERT_FLOAT_WITHIN_MESSAGE(DC_TOLERANCE_LSB, reference.getDc(), (float)fixed.getDc(),
+                                                 traces[t].name.c_str());
+            }
+        }
+    }
+}
+
+// Misma entrada entera en los dos biquads: aísla el error del filtro
+void test_biquad_matches_reference(void)
+{
+    BiquadCoefficients coefficients = designBandPass(PPG_RATE_HZ, BAND_LOW_HZ, BAND_HIGH_HZ);
+    float tolerance = biquadToleranceLsb(coefficients);
+    TEST_ASSERT_TRUE_MESSAGE(tolerance < 8.0f, "la banda del firmware amplifica el redondeo más de lo previsto");
+
+    for (size_t t = 0; t < traces.size(); t++)
+    {
+        for (int ch = 0; ch < 2; ch++)
+        {
+            const std::vector<int32_t> &x = channel(traces[t], ch);
+            DcRemover dc(DC_SHIFT);
+            BiquadFilter fixed(coefficients);
+            BiquadFilterRef reference(coefficients);
+            for (size_t i = 0; i < x.size(); i++)
+            {
+                int32_t ac = dc.update(x[i]);
+                TEST_ASSERT_FLOAT_WITHIN_MESSAGE(tolerance, reference.update((float)ac), (float)fixed.update(ac),
+                                                 traces[t].name.c_str());
+            }
+        }
+    }
+}
+
+// Las dos cadenas completas por separado: el error de la DC entra además
+// por el filtro entero
+void test_chain_matches_reference(void)
+{
+    BiquadCoefficients coefficients = designBandPass(PPG_RATE_HZ, BAND_LOW_HZ, BAND_HIGH_HZ);
+    float tolerance = biquadToleranceLsb(coefficients) + DC_TOLERANCE_LSB * impulseGain(coefficients, false);
+
+    for (size_t t = 0; t < traces.size(); t++)
+    {
+        for (int ch = 0; ch < 2; ch++)
+        {
+            const std::vector<int32_t> &x = channel(traces[t], ch);
+            DcRemover dc(DC_SHIFT);
+            BiquadFilter fixed(coefficients);
+            DcRemoverRef dcRef(DC_SHIFT);
+            BiquadFilterRef reference(coefficients);
+            for (size_t i = 0; i < x.size(); i++)
+            {
+                int32_t y = fixed.update(dc.update(x[i]));
+                float yRef = reference.update(dcRef.update((float)x[i]));
+                TEST_ASSERT_FLOAT_WITHIN_MESSAGE(tolerance, yRef, (float)y, traces[t].name.c_str());
+            }
+        }
+    }
+}
+
+// ===========================
+// COCIENTES
+// ===========================
+// El Q16 trunca (hasta 1 LSB por debajo del exacto); la referencia en float
+// aporta unos pocos ulp (2^-20 relativo cubre las tres operaciones)
+static void assertRatio(uint32_t acRed, uint32_t dcRed, uint32_t acIr, uint32_t dcIr, const char *message)
+{
+    float reference = dspRatioOfRatiosRef((float)acRed, (float)dcRed, (float)acIr, (float)dcIr) * 65536.0f;
+    if (reference >= 4.0e9f)
+        return; // satura el Q16
+    float tolerance = 1.0f + reference / (1 << 20);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(tolerance, reference,
+                                     (float)dspRatioOfRatiosQ16(acRed, dcRed, acIr, dcIr), message);
+}
+
+// AC (RMS del paso banda) y DC de cada ventana de SpO2 de las trazas
+void test_ratio_of_ratios_on_traces(void)
+{
+    BiquadCoefficients coefficients = designBandPass(PPG_RATE_HZ, BAND_LOW_HZ, BAND_HIGH_HZ);
+    for (size_t t = 0; t < traces.size(); t++)
+    {
+        const PpgTrace &ppg = traces[t].ppg;
+        DcRemover irDc(DC_SHIFT), redDc(DC_SHIFT);
+        BiquadFilter irBandPass(coefficients), redBandPass(coefficients);
+        uint64_t irSquares = 0, redSquares = 0;
+        int64_t irDcSum = 0, redDcSum = 0;
+        size_t windows = 0;
+
+        for (size_t i = 0; i < ppg.ir.size(); i++)
+        {
+            int32_t irAc = irBandPass.update(irDc.update(ppg.ir[i]));
+            int32_t redAc = redBandPass.update(redDc.update(ppg.red[i]));
+            irSquares += (uint64_t)((int64_t)irAc * irAc);
+            redSquares += (uint64_t)((int64_t)redAc * redAc);
+            irDcSum += irDc.getDc();
+            redDcSum += redDc.getDc();
+
+            if ((i + 1) % RATIO_WINDOW == 0)
+            {
+                assertRatio(dspSqrt64(redSquares / RATIO_WINDOW), (uint32_t)(redDcSum / RATIO_WINDOW),
+                            dspSqrt64(irSquares / RATIO_WINDOW), (uint32_t)(irDcSum / RATIO_WINDOW),
+                            traces[t].name.c_str());
+                irSquares = redSquares = 0;
+                irDcSum = redDcSum = 0;
+                windows++;
+            }
+        }
+        TEST_ASSERT_TRUE(windows > 40);
+    }
+}
+
+// Valores altos: el numerador no cabe desplazado y se reduce el denominador
+void test_ratio_of_ratios_wide_range(void)
+{
+    srand(3);
+    for (int i = 0; i < 20000; i++)
+    {
+        uint32_t acRed = 1 + rand() % 5000, dcRed = 10000 + rand() % 250000;
+        uint32_t acIr = 1 + rand() % 5000, dcIr = 10000 + rand() % 250000;
+        assertRatio(acRed, dcRed, acIr, dcIr, "rango del sensor");
+
+        uint32_t big[4];
+        for (int k = 0; k < 4; k++)
+            big[k] = (1U << 20) + (uint32_t)(rand() % (1 << 24));
+        assertRatio(big[0], big[1], big[2], big[3], "reducción del denominador");
+    }
+}
+
+void test_sqrt_is_floor_of_root(void)
+{
+    srand(5);
+    for (int i = 0; i < 20000; i++)
+    {
+        uint64_t value = ((uint64_t)rand() << 31 ^ (uint64_t)rand()) >> (rand() % 40);
+        uint64_t root = dspSqrt64(value);
+        TEST_ASSERT_TRUE(root * root <= value && (root + 1) * (root + 1) > value);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    buildTraces();
+    UNITY_BEGIN();
+    RUN_TEST(test_dc_remover_matches_reference);
+    RUN_TEST(test_biquad_matches_reference);
+    RUN_TEST(test_chain_matches_reference);
+    RUN_TEST(test_ratio_of_ratios_on_traces);
+    RUN_TEST(test_ratio_of_ratios_wide_range);
+    RUN_TEST(test_sqrt_is_floor_of_root);
+    return UNITY_END();
+}